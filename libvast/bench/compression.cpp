@@ -0,0 +1,188 @@
+#include <chrono>
+#include <cstdlib>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include <caf/all.hpp>
+
+#include "vast/batch.hpp"
+#include "vast/compression.hpp"
+#include "vast/error.hpp"
+#include "vast/event.hpp"
+#include "vast/save.hpp"
+#include "vast/concept/printable/to_string.hpp"
+#include "vast/concept/printable/vast/error.hpp"
+#include "vast/format/bro.hpp"
+#include "vast/format/pcap.hpp"
+
+#include "data.hpp"
+
+// Measures compression ratio and throughput of the batch codecs on the test
+// data. Each input gets split into batches of a fixed number of events, as
+// the archive receives them from the importer.
+
+using namespace vast;
+using std::chrono::duration_cast;
+using std::chrono::steady_clock;
+using std::chrono::microseconds;
+
+namespace {
+
+struct input {
+  std::string name;
+  std::vector<event> events;
+};
+
+template <class Reader>
+std::vector<event> extract(Reader& reader) {
+  std::vector<event> result;
+  auto e = expected<event>{no_error};
+  while (e || !e.error()) {
+    e = reader.read();
+    if (e)
+      result.push_back(std::move(*e));
+  }
+  return result;
+}
+
+std::vector<event> read_bro(char const* filename) {
+  format::bro::reader reader{std::make_unique<std::ifstream>(filename)};
+  return extract(reader);
+}
+
+struct measurement {
+  uint64_t raw = 0;
+  uint64_t compressed = 0;
+  microseconds compress_time{0};
+  microseconds uncompress_time{0};
+};
+
+measurement run(std::vector<event> const& events, size_t batch_size,
+                codec c) {
+  measurement result;
+  for (auto i = 0u; i < events.size(); i += batch_size) {
+    auto first = events.begin() + i;
+    auto last = first + std::min(batch_size, events.size() - i);
+    // The size of the serialized events serves as the baseline.
+    batch::writer raw{compression::null};
+    for (auto e = first; e != last; ++e)
+      raw.write(*e);
+    result.raw += bytes(raw.seal());
+    auto start = steady_clock::now();
+    batch::writer writer{c};
+    for (auto e = first; e != last; ++e)
+      writer.write(*e);
+    auto b = writer.seal();
+    auto stop = steady_clock::now();
+    result.compress_time += duration_cast<microseconds>(stop - start);
+    result.compressed += bytes(b);
+    start = steady_clock::now();
+    batch::reader reader{b};
+    auto xs = reader.read();
+    stop = steady_clock::now();
+    result.uncompress_time += duration_cast<microseconds>(stop - start);
+    if (!xs || xs->size() != static_cast<size_t>(last - first)) {
+      std::cerr << "failed to read batch" << std::endl;
+      std::exit(1);
+    }
+  }
+  return result;
+}
+
+#ifdef VAST_HAVE_ZSTD
+// Trains a dictionary from the first events of an input, as the archive does
+// for each event type.
+expected<uint32_t> train(std::vector<event> const& events, size_t n) {
+  std::vector<char> samples;
+  std::vector<size_t> sizes;
+  for (auto i = 0u; i < std::min(n, events.size()); ++i) {
+    auto before = samples.size();
+    auto r = save(samples, events[i].timestamp(), events[i].data());
+    if (!r)
+      return r.error();
+    sizes.push_back(samples.size() - before);
+  }
+  auto dict = zstd::train_dictionary(samples, sizes, 16 << 10);
+  if (!dict)
+    return dict.error();
+  return zstd::add_dictionary(std::move(*dict));
+}
+#endif
+
+double rate(uint64_t bytes, microseconds us) {
+  return us.count() == 0 ? 0.0 : bytes / double(us.count()); // MB/s
+}
+
+} // namespace <anonymous>
+
+int main(int argc, char** argv) {
+  auto batch_size = size_t{1024};
+  auto samples = size_t{1000};
+  auto res = caf::message_builder(argv + 1, argv + argc).extract_opts({
+    {"batch-size,b", "number of events per batch", batch_size},
+    {"samples,s", "number of events to train a dictionary from", samples},
+  });
+  if (!res.error.empty()) {
+    std::cerr << res.error << std::endl;
+    return 1;
+  }
+  if (res.opts.count("help") > 0) {
+    std::cout << res.helptext << std::endl;
+    return 0;
+  }
+  std::vector<input> inputs = {
+    {"bro::conn", read_bro(bro::conn)},
+    {"bro::dns", read_bro(bro::dns)},
+    {"bro::http", read_bro(bro::http)},
+  };
+#ifdef VAST_HAVE_PCAP
+  format::pcap::reader pcap{traces::workshop_2011_browse};
+  inputs.push_back({"pcap", extract(pcap)});
+#endif
+  std::vector<std::pair<std::string, codec>> codecs = {
+    {"null", codec{compression::null}},
+    {"lz4", codec{compression::lz4}},
+#ifdef VAST_HAVE_SNAPPY
+    {"snappy", codec{compression::snappy}},
+#endif
+#ifdef VAST_HAVE_ZSTD
+    {"zstd-1", codec{compression::zstd, 1}},
+    {"zstd-3", codec{compression::zstd, 3}},
+    {"zstd-9", codec{compression::zstd, 9}},
+    {"zstd-19", codec{compression::zstd, 19}},
+#endif
+  };
+  std::cout << std::left << std::setw(12) << "input" << std::setw(12)
+            << "codec" << std::right << std::setw(10) << "events"
+            << std::setw(10) << "ratio" << std::setw(14) << "comp MB/s"
+            << std::setw(14) << "uncomp MB/s" << '\n';
+  auto print = [&](input const& in, std::string const& name,
+                   measurement const& m) {
+    std::cout << std::left << std::setw(12) << in.name << std::setw(12)
+              << name << std::right << std::setw(10) << in.events.size()
+              << std::setw(10) << std::fixed << std::setprecision(2)
+              << double(m.raw) / m.compressed
+              << std::setw(14) << rate(m.raw, m.compress_time)
+              << std::setw(14) << rate(m.raw, m.uncompress_time) << '\n';
+  };
+  for (auto& in : inputs) {
+    for (auto& c : codecs)
+      print(in, c.first, run(in.events, batch_size, c.second));
+#ifdef VAST_HAVE_ZSTD
+    auto id = train(in.events, samples);
+    if (!id) {
+      std::cerr << "failed to train dictionary for " << in.name << ": "
+                << to_string(id.error()) << std::endl;
+      continue;
+    }
+    for (auto level : {3, 19}) {
+      auto name = "zstd-" + std::to_string(level) + "+d";
+      print(in, name, run(in.events, batch_size,
+                          codec{compression::zstd, level, *id}));
+    }
+#endif
+  }
+}
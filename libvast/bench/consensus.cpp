@@ -0,0 +1,161 @@
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <caf/all.hpp>
+
+#include "vast/filesystem.hpp"
+
+#include "vast/system/atoms.hpp"
+#include "vast/system/configuration.hpp"
+#include "vast/system/consensus.hpp"
+#include "vast/system/replicated_store.hpp"
+#include "vast/system/timeouts.hpp"
+
+// Measures throughput and commit latency of replicated stores on top of a
+// quorum of three consensus modules within a single process. Each client
+// issues ADD operations one after another, hence the number of clients equals
+// the number of concurrent operations. The clients spread evenly over three
+// stores, one per consensus module.
+
+using namespace caf;
+using namespace vast;
+using namespace vast::system;
+using std::chrono::duration_cast;
+using std::chrono::microseconds;
+using std::chrono::steady_clock;
+
+namespace {
+
+using store_type = replicated_store_type<std::string, count>;
+
+struct client_state {
+  std::vector<uint64_t> latencies;
+  const char* name = "client";
+};
+
+// Issues *n* operations and reports their latencies in microseconds to the
+// parent.
+behavior client(stateful_actor<client_state>* self, store_type store,
+                size_t n, actor parent) {
+  self->send(self, run_atom::value);
+  return {
+    [=](run_atom) {
+      auto start = steady_clock::now();
+      self->request(store, consensus_timeout, add_atom::value,
+                    std::string{"counter"}, count{1}).then(
+        [=](count) {
+          auto latency = steady_clock::now() - start;
+          auto& xs = self->state.latencies;
+          xs.push_back(duration_cast<microseconds>(latency).count());
+          if (xs.size() < n) {
+            self->send(self, run_atom::value);
+          } else {
+            self->send(parent, std::move(xs));
+            self->quit();
+          }
+        },
+        [=](error& e) {
+          std::cerr << "operation failed: " << self->system().render(e)
+                    << std::endl;
+          std::exit(1);
+        }
+      );
+    }
+  };
+}
+
+} // namespace <anonymous>
+
+int main(int argc, char** argv) {
+  auto max_clients = size_t{64};
+  auto operations = size_t{1000};
+  auto dir = std::string{"vast-bench-consensus"};
+  auto res = caf::message_builder(argv + 1, argv + argc).extract_opts({
+    {"clients,c", "maximum number of concurrent clients", max_clients},
+    {"operations,n", "number of operations per client", operations},
+    {"dir,d", "directory for persistent state", dir},
+  });
+  if (!res.error.empty()) {
+    std::cerr << res.error << std::endl;
+    return 1;
+  }
+  if (res.opts.count("help") > 0) {
+    std::cout << res.helptext << std::endl;
+    return 0;
+  }
+  if (exists(dir))
+    rm(dir);
+  system::configuration cfg;
+  actor_system sys{cfg};
+  scoped_actor self{sys};
+  // Bring up the quorum.
+  std::vector<actor> servers;
+  for (auto i = 1u; i <= 3; ++i) {
+    auto server_dir = path{dir} / ("server" + std::to_string(i));
+    servers.push_back(self->spawn(raft::consensus, server_dir));
+    self->send(servers.back(), id_atom::value, raft::server_id{i});
+  }
+  for (auto i = 0u; i < servers.size(); ++i)
+    for (auto j = 0u; j < servers.size(); ++j)
+      if (i != j)
+        self->send(servers[i], peer_atom::value, servers[j],
+                   raft::server_id{j + 1});
+  for (auto& server : servers)
+    self->send(server, run_atom::value);
+  std::vector<store_type> stores;
+  for (auto& server : servers)
+    stores.push_back(self->spawn(replicated_store<std::string, count>,
+                                 server));
+  // Wait until the quorum has a leader.
+  std::cerr << "waiting for leader election" << std::endl;
+  auto ready = false;
+  while (!ready) {
+    std::this_thread::sleep_for(raft::election_timeout);
+    self->request(stores[0], consensus_timeout, put_atom::value,
+                  std::string{"counter"}, count{0}).receive(
+      [&](ok_atom) { ready = true; },
+      [&](error&) { /* retry */ }
+    );
+  }
+  std::cout << std::right << std::setw(8) << "clients" << std::setw(10)
+            << "ops" << std::setw(12) << "ops/sec" << std::setw(12)
+            << "p50 us" << std::setw(12) << "p99 us" << '\n';
+  for (auto clients = size_t{1}; clients <= max_clients; clients *= 4) {
+    auto start = steady_clock::now();
+    for (auto i = 0u; i < clients; ++i)
+      self->spawn(client, stores[i % stores.size()], operations,
+                  actor_cast<actor>(self));
+    std::vector<uint64_t> latencies;
+    auto done = size_t{0};
+    self->receive_for(done, clients)(
+      [&](std::vector<uint64_t>& xs) {
+        latencies.insert(latencies.end(), xs.begin(), xs.end());
+      }
+    );
+    auto elapsed = duration_cast<microseconds>(steady_clock::now() - start);
+    std::sort(latencies.begin(), latencies.end());
+    auto percentile = [&](double p) {
+      return latencies[static_cast<size_t>(p * (latencies.size() - 1))];
+    };
+    std::cout << std::setw(8) << clients << std::setw(10) << latencies.size()
+              << std::setw(12) << std::fixed << std::setprecision(0)
+              << latencies.size() * 1e6 / elapsed.count()
+              << std::setw(12) << percentile(0.5)
+              << std::setw(12) << percentile(0.99) << '\n';
+  }
+  for (auto& store : stores) {
+    self->send_exit(store, exit_reason::user_shutdown);
+    self->wait_for(store);
+  }
+  for (auto& server : servers) {
+    self->send_exit(server, exit_reason::user_shutdown);
+    self->wait_for(server);
+  }
+  rm(dir);
+}
@@ -0,0 +1,147 @@
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+#include <caf/all.hpp>
+
+#include "vast/address.hpp"
+#include "vast/port.hpp"
+#include "vast/uuid.hpp"
+#include "vast/concept/hashable/crc.hpp"
+#include "vast/concept/hashable/uhash.hpp"
+#include "vast/concept/hashable/xxh3.hpp"
+#include "vast/concept/hashable/xxhash.hpp"
+#include "vast/format/pcap.hpp"
+
+// Measures the time per digest of the hash functions for short keys. For
+// contiguous keys of fixed sizes, the benchmark compares the streaming
+// interface with the one-shot function of each hasher. For UUIDs and
+// connections, it measures the universal hash function as the hash tables
+// use it.
+
+using namespace vast;
+using std::chrono::duration_cast;
+using std::chrono::nanoseconds;
+using std::chrono::steady_clock;
+
+namespace {
+
+using format::pcap::connection;
+
+// Keeps the compiler from discarding the digests.
+size_t sink = 0;
+
+// Returns the average time in nanoseconds that *f* needs per key.
+template <class F>
+double measure(size_t keys, size_t rounds, F f) {
+  auto start = steady_clock::now();
+  for (auto i = 0u; i < rounds; ++i)
+    for (auto j = 0u; j < keys; ++j)
+      sink += f(j);
+  auto stop = steady_clock::now();
+  auto ns = duration_cast<nanoseconds>(stop - start).count();
+  return double(ns) / (rounds * keys);
+}
+
+void print(std::string const& key, char const* hasher, double ns) {
+  std::cout << std::left << std::setw(12) << key << std::setw(20) << hasher
+            << std::right << std::setw(10) << std::fixed
+            << std::setprecision(2) << ns << '\n';
+}
+
+template <class Hasher>
+void streaming(std::vector<char> const& bytes, size_t size, size_t rounds,
+               char const* name) {
+  auto keys = bytes.size() / size;
+  auto key = std::to_string(size) + " bytes";
+  print(key, name, measure(keys, rounds, [&](size_t i) {
+    Hasher h;
+    h(bytes.data() + i * size, size);
+    return static_cast<size_t>(h);
+  }));
+}
+
+template <class Hasher>
+void one_shot(std::vector<char> const& bytes, size_t size, size_t rounds,
+              char const* name) {
+  auto keys = bytes.size() / size;
+  auto key = std::to_string(size) + " bytes";
+  Hasher h;
+  print(key, name, measure(keys, rounds, [&](size_t i) {
+    return static_cast<size_t>(h.one_shot(bytes.data() + i * size, size));
+  }));
+}
+
+template <class Hasher, class T>
+void universal(std::vector<T> const& xs, size_t rounds, char const* key,
+               char const* name) {
+  uhash<Hasher> h;
+  print(key, name, measure(xs.size(), rounds, [&](size_t i) {
+    return static_cast<size_t>(h(xs[i]));
+  }));
+}
+
+std::vector<connection> make_connections(std::mt19937& gen, size_t n) {
+  std::uniform_int_distribution<uint32_t> host;
+  std::uniform_int_distribution<port::number_type> number;
+  std::vector<connection> result;
+  for (auto i = 0u; i < n; ++i) {
+    auto src = host(gen);
+    auto dst = host(gen);
+    result.push_back({address{&src, address::ipv4, address::host},
+                      address{&dst, address::ipv4, address::host},
+                      port{number(gen), port::tcp},
+                      port{number(gen), port::tcp}});
+  }
+  return result;
+}
+
+} // namespace <anonymous>
+
+int main(int argc, char** argv) {
+  auto keys = size_t{100000};
+  auto rounds = size_t{10};
+  auto res = caf::message_builder(argv + 1, argv + argc).extract_opts({
+    {"keys,k", "number of keys per input", keys},
+    {"rounds,r", "number of passes over each input", rounds},
+  });
+  if (!res.error.empty()) {
+    std::cerr << res.error << std::endl;
+    return 1;
+  }
+  if (res.opts.count("help") > 0) {
+    std::cout << res.helptext << std::endl;
+    return 0;
+  }
+  std::cout << std::left << std::setw(12) << "key" << std::setw(20)
+            << "hasher" << std::right << std::setw(10) << "ns/key" << '\n';
+  std::mt19937 gen{42};
+  std::uniform_int_distribution<int> byte{0, 255};
+  for (auto size : {4, 8, 16, 32, 64, 128}) {
+    std::vector<char> bytes(keys * size);
+    for (auto& x : bytes)
+      x = static_cast<char>(byte(gen));
+    streaming<crc32>(bytes, size, rounds, "crc32");
+    streaming<xxhash32>(bytes, size, rounds, "xxhash32");
+    one_shot<xxhash32>(bytes, size, rounds, "xxhash32 one-shot");
+    streaming<xxhash64>(bytes, size, rounds, "xxhash64");
+    one_shot<xxhash64>(bytes, size, rounds, "xxhash64 one-shot");
+    streaming<xxh3_64>(bytes, size, rounds, "xxh3_64");
+    one_shot<xxh3_64>(bytes, size, rounds, "xxh3_64 one-shot");
+  }
+  std::vector<uuid> uuids;
+  for (auto i = 0u; i < keys; ++i)
+    uuids.push_back(uuid::random());
+  universal<xxhash64>(uuids, rounds, "uuid", "xxhash64");
+  universal<xxh3_64>(uuids, rounds, "uuid", "xxh3_64");
+  auto conns = make_connections(gen, keys);
+  universal<xxhash64>(conns, rounds, "connection", "xxhash64");
+  universal<xxh3_64>(conns, rounds, "connection", "xxh3_64");
+  // Print the digests, so that the compiler cannot drop their computation.
+  std::cerr << "checksum: " << sink << std::endl;
+}
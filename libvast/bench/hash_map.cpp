@@ -0,0 +1,171 @@
+#include <chrono>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include <caf/all.hpp>
+
+#include "vast/address.hpp"
+#include "vast/port.hpp"
+#include "vast/type.hpp"
+#include "vast/uuid.hpp"
+#include "vast/detail/flat_hash_map.hpp"
+#include "vast/format/pcap.hpp"
+
+// Compares detail::flat_hash_map with std::unordered_map on the key types
+// that the hot paths use: UUIDs of partitions and lookups, types of batches
+// and indexers, and connections of the PCAP flow table. For each key type,
+// the benchmark measures insertion, successful and failing lookups, and
+// erasure over a set of distinct keys.
+
+using namespace vast;
+using std::chrono::duration_cast;
+using std::chrono::nanoseconds;
+using std::chrono::steady_clock;
+
+namespace {
+
+using format::pcap::connection;
+
+std::vector<uuid> make_uuids(size_t n) {
+  std::vector<uuid> result;
+  for (auto i = 0u; i < n; ++i)
+    result.push_back(uuid::random());
+  return result;
+}
+
+std::vector<type> make_types(size_t n) {
+  std::vector<type> result;
+  for (auto i = 0u; i < n; ++i) {
+    auto t = record_type{{"ts", timestamp_type{}},
+                         {"id", count_type{}},
+                         {"msg", string_type{}}};
+    result.push_back(t.name("event" + std::to_string(i)));
+  }
+  return result;
+}
+
+std::vector<connection> make_connections(std::mt19937& gen, size_t n) {
+  std::uniform_int_distribution<uint32_t> host{0, 0xffffff};
+  std::uniform_int_distribution<port::number_type> number{1024, 65535};
+  std::vector<connection> result;
+  for (auto i = 0u; i < n; ++i) {
+    auto src = uint32_t{0x0a000000} | host(gen);
+    auto dst = uint32_t{0xc0a80000} | (host(gen) & 0xffff);
+    result.push_back({address{&src, address::ipv4, address::host},
+                      address{&dst, address::ipv4, address::host},
+                      port{number(gen), port::tcp}, port{443, port::tcp}});
+  }
+  return result;
+}
+
+struct timings {
+  double insert;
+  double hit;
+  double miss;
+  double erase;
+};
+
+// Returns the average time in nanoseconds that *f* needs per key.
+template <class Key, class F>
+double measure(std::vector<Key> const& keys, size_t rounds, F f) {
+  auto start = steady_clock::now();
+  for (auto i = 0u; i < rounds; ++i)
+    f();
+  auto stop = steady_clock::now();
+  auto ns = duration_cast<nanoseconds>(stop - start).count();
+  return double(ns) / (rounds * keys.size());
+}
+
+template <class Map, class Key>
+timings run(std::vector<Key> const& keys, std::vector<Key> const& misses,
+            size_t rounds) {
+  timings result;
+  Map xs;
+  auto found = size_t{0};
+  result.insert = measure(keys, rounds, [&] {
+    xs = Map{};
+    for (auto i = 0u; i < keys.size(); ++i)
+      xs.emplace(keys[i], i);
+  });
+  result.hit = measure(keys, rounds, [&] {
+    for (auto& key : keys)
+      found += xs.find(key) != xs.end();
+  });
+  result.miss = measure(misses, rounds, [&] {
+    for (auto& key : misses)
+      found += xs.find(key) != xs.end();
+  });
+  auto copies = std::vector<Map>(rounds, xs);
+  auto round = size_t{0};
+  result.erase = measure(keys, rounds, [&] {
+    auto& ys = copies[round++];
+    for (auto& key : keys)
+      found += ys.erase(key);
+  });
+  if (found != rounds * 2 * keys.size()) {
+    std::cerr << "unexpected lookup results" << std::endl;
+    std::exit(1);
+  }
+  return result;
+}
+
+void print(char const* keys, char const* map, timings const& t) {
+  std::cout << std::left << std::setw(12) << keys << std::setw(16) << map
+            << std::right << std::fixed << std::setprecision(1)
+            << std::setw(10) << t.insert << std::setw(10) << t.hit
+            << std::setw(10) << t.miss << std::setw(10) << t.erase << '\n';
+}
+
+template <class Key>
+void compare(char const* name, std::vector<Key> const& keys,
+             std::vector<Key> const& misses, size_t rounds) {
+  print(name, "unordered_map",
+        run<std::unordered_map<Key, size_t>>(keys, misses, rounds));
+  print(name, "flat_hash_map",
+        run<detail::flat_hash_map<Key, size_t>>(keys, misses, rounds));
+}
+
+} // namespace <anonymous>
+
+int main(int argc, char** argv) {
+  auto keys = size_t{100000};
+  auto rounds = size_t{10};
+  auto res = caf::message_builder(argv + 1, argv + argc).extract_opts({
+    {"keys,k", "number of distinct keys per map", keys},
+    {"rounds,r", "number of passes over the keys", rounds},
+  });
+  if (!res.error.empty()) {
+    std::cerr << res.error << std::endl;
+    return 1;
+  }
+  if (res.opts.count("help") > 0) {
+    std::cout << res.helptext << std::endl;
+    return 0;
+  }
+  std::cout << std::left << std::setw(12) << "keys" << std::setw(16) << "map"
+            << std::right << std::setw(10) << "insert" << std::setw(10)
+            << "hit" << std::setw(10) << "miss" << std::setw(10) << "erase"
+            << "  (ns/key)\n";
+  auto uuids = make_uuids(2 * keys);
+  auto uuid_misses = std::vector<uuid>(uuids.begin() + keys, uuids.end());
+  uuids.resize(keys);
+  compare("uuid", uuids, uuid_misses, rounds);
+  // There are far fewer distinct types than UUIDs or connections in
+  // practice, so we use a smaller set.
+  auto types = make_types(std::min(keys, size_t{1000}) * 2);
+  auto type_misses = std::vector<type>(types.begin() + types.size() / 2,
+                                       types.end());
+  types.resize(types.size() / 2);
+  compare("type", types, type_misses, rounds);
+  std::mt19937 gen{42};
+  auto conns = make_connections(gen, 2 * keys);
+  auto conn_misses = std::vector<connection>(conns.begin() + keys,
+                                             conns.end());
+  conns.resize(keys);
+  compare("connection", conns, conn_misses, rounds);
+}
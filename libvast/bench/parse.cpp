@@ -0,0 +1,274 @@
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include <caf/all.hpp>
+
+#include "vast/address.hpp"
+#include "vast/data.hpp"
+#include "vast/port.hpp"
+#include "vast/string_view.hpp"
+#include "vast/time.hpp"
+#include "vast/type.hpp"
+#include "vast/concept/parseable/core.hpp"
+#include "vast/concept/parseable/string/quoted_string.hpp"
+#include "vast/concept/parseable/vast/address.hpp"
+#include "vast/concept/parseable/vast/port.hpp"
+#include "vast/concept/parseable/vast/subnet.hpp"
+#include "vast/detail/string.hpp"
+#include "vast/format/bro.hpp"
+
+#include "data.hpp"
+
+// Measures the time per field of the parsers on the hot path of the import.
+// Each parser runs over a set of fields several times. The fields come from
+// the Bro and BGPdump logs of the test data, or are synthetic. For the Bro
+// field parsers, the benchmark compares the type-erased rule that the reader
+// uses, the parser itself, and a statically dispatched rule.
+
+using namespace vast;
+using std::chrono::duration_cast;
+using std::chrono::nanoseconds;
+using std::chrono::steady_clock;
+
+namespace {
+
+using iterator = std::string::const_iterator;
+
+using field_list = std::vector<std::string>;
+
+template <class Parser, class Attribute>
+bool parse(Parser const& p, std::string const& str, Attribute& a) {
+  auto f = str.begin();
+  auto l = str.end();
+  return p(f, l, a) && f == l;
+}
+
+// Returns the average time in nanoseconds that *f* needs per field.
+template <class F>
+double measure(field_list const& fields, size_t rounds, F f) {
+  auto start = steady_clock::now();
+  for (auto i = 0u; i < rounds; ++i)
+    for (auto& x : fields)
+      if (!f(x)) {
+        std::cerr << "failed to parse " << x << std::endl;
+        std::exit(1);
+      }
+  auto stop = steady_clock::now();
+  auto ns = duration_cast<nanoseconds>(stop - start).count();
+  return double(ns) / (rounds * fields.size());
+}
+
+field_list make_addresses(std::mt19937& gen, size_t n) {
+  std::uniform_int_distribution<int> octet{0, 255};
+  std::uniform_int_distribution<int> word{0, 0xffff};
+  field_list result;
+  for (auto i = 0u; i < n; ++i) {
+    std::ostringstream ss;
+    if (i % 4 == 0)
+      ss << "fe80::" << std::hex << word(gen) << ':' << word(gen);
+    else
+      ss << "10." << octet(gen) << '.' << octet(gen) << '.' << octet(gen);
+    result.push_back(ss.str());
+  }
+  return result;
+}
+
+field_list make_timestamps(std::mt19937& gen, size_t n) {
+  std::uniform_int_distribution<int> usecs{0, 999999};
+  field_list result;
+  for (auto i = 0u; i < n; ++i) {
+    std::ostringstream ss;
+    ss << (1258531221 + i) << '.' << std::setw(6) << std::setfill('0')
+       << usecs(gen);
+    result.push_back(ss.str());
+  }
+  return result;
+}
+
+field_list make_ports(std::mt19937& gen, size_t n) {
+  std::uniform_int_distribution<int> number{0, 65535};
+  char const* protocols[] = {"tcp", "udp", "icmp", "?"};
+  field_list result;
+  for (auto i = 0u; i < n; ++i)
+    result.push_back(std::to_string(number(gen)) + '/' + protocols[i % 4]);
+  return result;
+}
+
+field_list make_quoted_strings(std::mt19937& gen, size_t n) {
+  std::uniform_int_distribution<int> id{0, 1 << 20};
+  field_list result;
+  for (auto i = 0u; i < n; ++i)
+    result.push_back("\"GET /index-" + std::to_string(id(gen))
+                     + ".html \\\"HTTP/1.1\\\"\"");
+  return result;
+}
+
+field_list make_bro_strings(std::mt19937& gen, size_t n) {
+  std::uniform_int_distribution<int> id{0, 1 << 20};
+  field_list result;
+  for (auto i = 0u; i < n; ++i)
+    result.push_back("Mozilla/5.0\\x20(X11;\\x20Linux\\x20x86_64)\\x20"
+                     + std::to_string(id(gen)));
+  return result;
+}
+
+// Extracts all fields of the given Bro types from a Bro log.
+field_list read_bro_fields(char const* filename,
+                           std::vector<std::string> const& types) {
+  field_list result;
+  std::ifstream in{filename};
+  std::vector<bool> selected;
+  std::string line;
+  while (std::getline(in, line)) {
+    auto fields = detail::split_to_str(line, "\t");
+    if (fields.empty())
+      continue;
+    if (fields[0] == "#types") {
+      selected.clear();
+      for (auto i = 1u; i < fields.size(); ++i)
+        selected.push_back(std::find(types.begin(), types.end(), fields[i])
+                           != types.end());
+    } else if (fields[0][0] != '#') {
+      for (auto i = 0u; i < std::min(fields.size(), selected.size()); ++i)
+        if (selected[i] && fields[i] != "-")
+          result.push_back(fields[i]);
+    }
+  }
+  return result;
+}
+
+// Extracts the prefixes of announcements from a BGPdump log.
+field_list read_bgpdump_prefixes(char const* filename) {
+  field_list result;
+  std::ifstream in{filename};
+  std::string line;
+  while (std::getline(in, line)) {
+    auto fields = detail::split_to_str(line, "|");
+    if (fields.size() > 5 && fields[2] == "A")
+      result.push_back(fields[5]);
+  }
+  return result;
+}
+
+} // namespace <anonymous>
+
+int main(int argc, char** argv) {
+  auto fields = size_t{100000};
+  auto rounds = size_t{10};
+  auto res = caf::message_builder(argv + 1, argv + argc).extract_opts({
+    {"fields,f", "number of fields per input", fields},
+    {"rounds,r", "number of passes over each input", rounds},
+  });
+  if (!res.error.empty()) {
+    std::cerr << res.error << std::endl;
+    return 1;
+  }
+  if (res.opts.count("help") > 0) {
+    std::cout << res.helptext << std::endl;
+    return 0;
+  }
+  std::mt19937 gen{42};
+  auto addresses = make_addresses(gen, fields);
+  auto timestamps = make_timestamps(gen, fields);
+  auto ports = make_ports(gen, fields);
+  auto quoted_strings = make_quoted_strings(gen, fields);
+  auto bro_strings = make_bro_strings(gen, fields);
+  std::cout << std::left << std::setw(16) << "input" << std::setw(24)
+            << "parser" << std::right << std::setw(10) << "ns/field" << '\n';
+  auto print = [&](char const* input, char const* parser, double ns) {
+    std::cout << std::left << std::setw(16) << input << std::setw(24)
+              << parser << std::right << std::setw(10) << std::fixed
+              << std::setprecision(1) << ns << '\n';
+  };
+  // Fields from real logs, with the generic and the fast parsers.
+  char const* bro_logs[] = {bro::conn, bro::dns, bro::ftp, bro::http,
+                            bro::smtp, bro::ssl};
+  field_list log_addresses;
+  field_list log_times;
+  for (auto log : bro_logs) {
+    auto xs = read_bro_fields(log, {"addr"});
+    log_addresses.insert(log_addresses.end(), xs.begin(), xs.end());
+    xs = read_bro_fields(log, {"time", "interval"});
+    log_times.insert(log_times.end(), xs.begin(), xs.end());
+  }
+  auto log_subnets = read_bgpdump_prefixes(bgpdump::updates20140821);
+  address addr;
+  print("bro addr", "addr", measure(log_addresses, rounds, [&](auto& x) {
+    return parse(parsers::addr, x, addr);
+  }));
+  print("bro addr", "fast_addr", measure(log_addresses, rounds, [&](auto& x) {
+    return parse(parsers::fast_addr, x, addr);
+  }));
+  double r;
+  print("bro time", "real", measure(log_times, rounds, [&](auto& x) {
+    return parse(parsers::real, x, r);
+  }));
+  print("bro time", "fast_real", measure(log_times, rounds, [&](auto& x) {
+    return parse(parsers::fast_real, x, r);
+  }));
+  subnet sn;
+  print("bgpdump prefix", "net", measure(log_subnets, rounds, [&](auto& x) {
+    return parse(parsers::net, x, sn);
+  }));
+  print("bgpdump prefix", "fast_net", measure(log_subnets, rounds,
+                                              [&](auto& x) {
+    return parse(parsers::fast_net, x, sn);
+  }));
+  // Synthetic addresses and ports.
+  print("address", "addr", measure(addresses, rounds, [&](auto& x) {
+    return parse(parsers::addr, x, addr);
+  }));
+  print("address", "fast_addr", measure(addresses, rounds, [&](auto& x) {
+    return parse(parsers::fast_addr, x, addr);
+  }));
+  port p;
+  print("port", "port", measure(ports, rounds, [&](auto& x) {
+    return parse(parsers::port, x, p);
+  }));
+  // Quoted strings, once copied and once as view into the input.
+  std::string str;
+  print("quoted string", "qq_str", measure(quoted_strings, rounds,
+                                           [&](auto& x) {
+    str.clear();
+    return parse(parsers::qq_str, x, str);
+  }));
+  string_view view;
+  print("quoted string", "raw(qq_str)", measure(quoted_strings, rounds,
+                                                [&](auto& x) {
+    return parse(raw(parsers::qq_str), x, view);
+  }));
+  // Bro fields, parsed into the same data as the reader does.
+  auto bro_timestamp = parsers::fast_real ->* [](real x) {
+    auto i = std::chrono::duration_cast<timespan>(double_seconds(x));
+    return timestamp{i};
+  };
+  auto bro_string = format::bro::make_bro_string_parser(+parsers::any);
+  using bro_rule = rule<iterator, data>;
+  using static_bro_rule =
+    static_rule<iterator, data, decltype(bro_timestamp), decltype(bro_string)>;
+  data d;
+  auto run = [&](char const* input, field_list const& xs, type const& t,
+                 auto const& direct, static_bro_rule const& s) {
+    auto r = bro_rule{format::bro::make_bro_parser<iterator>(t)};
+    print(input, "rule", measure(xs, rounds, [&](auto& x) {
+      return parse(r, x, d);
+    }));
+    print(input, "static_rule", measure(xs, rounds, [&](auto& x) {
+      return parse(s, x, d);
+    }));
+    print(input, "direct", measure(xs, rounds, [&](auto& x) {
+      return parse(direct, x, d);
+    }));
+  };
+  run("bro::timestamp", timestamps, timestamp_type{}, bro_timestamp,
+      bro_timestamp);
+  run("bro::string", bro_strings, string_type{}, bro_string, bro_string);
+}
@@ -1,3 +1,7 @@
+#include <cstring>
+#include <tuple>
+#include <utility>
+
 #include "vast/batch.hpp"
 #include "vast/detail/assert.hpp"
 #include "vast/detail/byte_swap.hpp"
@@ -37,14 +41,36 @@ uint64_t bytes(batch const& b) {
     sizeof(b.events_) + sizeof(b.ids_) + sizeof(b.data_) + b.data_.size();
 }
 
-batch::writer::writer(compression method)
+batch::writer::writer(compression method) : writer{codec{method}} {
+}
+
+batch::writer::writer(codec c)
   : vectorbuf_{batch_.data_},
-    compressedbuf_{vectorbuf_, method},
+    compressedbuf_{vectorbuf_, c},
     serializer_{compressedbuf_} {
-  batch_.method_ = method;
+  batch_.method_ = c.method;
+}
+
+batch::writer::packer::packer(type const& t) : layout{t}, builder{layout} {
 }
 
 bool batch::writer::write(event const& e) {
+  // Records take the packed representation, unless they don't match their
+  // type, in which case they go into the batch as they are.
+  if (is<record_type>(e.type()))
+    if (auto xs = get_if<vector>(e.data())) {
+      auto i = packers_.find(e.type());
+      if (i == packers_.end())
+        i = packers_.emplace(std::piecewise_construct,
+                             std::forward_as_tuple(e.type()),
+                             std::forward_as_tuple(e.type())).first;
+      auto x = pack(i->second.builder, *xs, arena_);
+      if (x) {
+        auto result = write(*x, e.timestamp());
+        arena_.reset();
+        return result;
+      }
+    }
   // Write meta data.
   if (e.timestamp() < batch_.first_)
     batch_.first_ = e.timestamp();
@@ -64,6 +90,40 @@ bool batch::writer::write(event const& e) {
   return true;
 }
 
+bool batch::writer::write(packed_record const& x, timestamp ts) {
+  if (ts < batch_.first_)
+    batch_.first_ = ts;
+  if (ts > batch_.last_)
+    batch_.last_ = ts;
+  auto& t = x.layout().type();
+  auto i = type_cache_.find(t);
+  if (i == type_cache_.end()) {
+    auto type_id = static_cast<uint32_t>(type_cache_.size());
+    type_cache_.emplace(t, type_id);
+    serializer_ << (type_id | packed_flag) << t;
+  } else {
+    serializer_ << (i->second | packed_flag);
+  }
+  auto size = static_cast<uint32_t>(x.block_size());
+  serializer_ << ts << size;
+  // Records go into the batch in little endian.
+  auto block = const_cast<char*>(x.block());
+  std::vector<char> swapped;
+  if (detail::host_endian != detail::little_endian) {
+    swapped.assign(block, block + size);
+    to_little_endian(x.layout(), swapped.data());
+    block = swapped.data();
+  }
+  if (serializer_.apply_raw(size, block))
+    return false;
+  // Containers live outside the record.
+  for (auto j = 0u; j < x.size(); ++j)
+    if (x.layout()[j].kind == record_layout::kind::container && !x.nil(j))
+      serializer_ << x.get(j);
+  ++batch_.events_;
+  return true;
+}
+
 batch batch::writer::seal() {
   auto n = compressedbuf_.pubsync();
   VAST_ASSERT(n >= 0);
@@ -159,6 +219,8 @@ expected<event> batch::reader::materialize() {
     // Read type.
     uint32_t type_id;
     deserializer_ >> type_id;
+    auto packed = (type_id & packed_flag) != 0;
+    type_id &= ~packed_flag;
     auto t = type_cache_.find(type_id);
     if (t == type_cache_.end()) {
       type new_type;
@@ -168,7 +230,15 @@ expected<event> batch::reader::materialize() {
     // Read event timestamp and data.
     timestamp ts;
     data d;
-    deserializer_ >> ts >> d;
+    deserializer_ >> ts;
+    if (packed) {
+      auto xs = unpack(type_id, t->second);
+      if (!xs)
+        return xs.error();
+      d = std::move(*xs);
+    } else {
+      deserializer_ >> d;
+    }
     event e{{std::move(d), t->second}};
     // Assign an event ID.
     if (!id_range_.done()) {
@@ -182,4 +252,32 @@ expected<event> batch::reader::materialize() {
   }
 }
 
+expected<vector> batch::reader::unpack(uint32_t type_id, type const& t) {
+  if (!is<record_type>(t))
+    return make_error(ec::type_clash, "packed event without record type");
+  auto i = layout_cache_.find(type_id);
+  if (i == layout_cache_.end())
+    i = layout_cache_.emplace(type_id, record_layout{t}).first;
+  auto& layout = i->second;
+  uint32_t size;
+  deserializer_ >> size;
+  if (size < layout.fixed_size())
+    return make_error(ec::unspecified, "truncated packed record");
+  auto block = static_cast<char*>(arena_.allocate(size, 8));
+  if (auto e = deserializer_.apply_raw(size, block))
+    return e;
+  from_little_endian(layout, block);
+  packed_record x{layout, block, size};
+  // Restore the containers and point the record to them.
+  for (auto j = 0u; j < x.size(); ++j)
+    if (layout[j].kind == record_layout::kind::container && !x.nil(j)) {
+      auto ptr = arena_.make<data>();
+      deserializer_ >> *ptr;
+      std::memcpy(block + layout[j].offset, &ptr, sizeof(ptr));
+    }
+  auto result = x.to_data();
+  arena_.reset();
+  return result;
+}
+
 } // namespace vast
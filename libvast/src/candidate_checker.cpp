@@ -0,0 +1,287 @@
+#include <regex>
+
+#include "vast/candidate_checker.hpp"
+#include "vast/event.hpp"
+#include "vast/pattern.hpp"
+#include "vast/subnet.hpp"
+#include "vast/time.hpp"
+
+#include "vast/detail/assert.hpp"
+
+namespace vast {
+
+namespace {
+
+using predicate_function = std::function<bool(event const&)>;
+
+// A predicate after compilation: either a function or a constant in case the
+// outcome does not depend on the event.
+struct compiled_predicate {
+  predicate_function f;
+  bool constant = false;
+};
+
+// Binds a function operating on a single value to the field at a given offset.
+// Events that lack the field do not satisfy the predicate.
+template <class F>
+predicate_function bind_field(offset const& o, F f) {
+  if (o.empty())
+    return [=](event const& e) { return f(e.data()); };
+  if (o.size() == 1)
+    return [=, i = o[0]](event const& e) {
+      auto v = get_if<vector>(e.data());
+      return v && i < v->size() && f((*v)[i]);
+    };
+  return [=](event const& e) {
+    auto x = get(e.data(), o);
+    return x && f(*x);
+  };
+}
+
+// Specializes a relational operator for a constant of type T. Values of a
+// different type fall back to the generic evaluation.
+template <class T>
+predicate_function relational(offset const& o, relational_operator op,
+                              T const& c, data const& rhs) {
+  auto make = [&](auto cmp) {
+    return bind_field(o, [=](data const& x) {
+      if (auto y = get_if<T>(x))
+        return cmp(*y, c);
+      return evaluate(x, op, rhs);
+    });
+  };
+  switch (op) {
+    default:
+      VAST_ASSERT(!"not a relational operator");
+      return {};
+    case equal:
+      return make(std::equal_to<T>{});
+    case not_equal:
+      return make(std::not_equal_to<T>{});
+    case less:
+      return make(std::less<T>{});
+    case less_equal:
+      return make(std::less_equal<T>{});
+    case greater:
+      return make(std::greater<T>{});
+    case greater_equal:
+      return make(std::greater_equal<T>{});
+  }
+}
+
+template <class T, class... Ts>
+predicate_function relational(offset const& o, relational_operator op,
+                              data const& rhs) {
+  if (auto c = get_if<T>(rhs))
+    return relational(o, op, *c, rhs);
+  return relational<Ts...>(o, op, rhs);
+}
+
+template <>
+predicate_function relational<none>(offset const&, relational_operator,
+                                    data const&) {
+  return {};
+}
+
+predicate_function compile_data(offset const& o, relational_operator op,
+                                data const& rhs) {
+  predicate_function result;
+  switch (op) {
+    default:
+      break;
+    case equal:
+    case not_equal:
+    case less:
+    case less_equal:
+    case greater:
+    case greater_equal:
+      result = relational<boolean, integer, count, real, timespan, timestamp,
+                          std::string, address, subnet, port, none>(o, op,
+                                                                    rhs);
+      break;
+    case match:
+    case not_match:
+      if (auto p = get_if<pattern>(rhs)) {
+        auto rx = std::regex{p->string()};
+        auto positive = op == match;
+        result = bind_field(o, [=](data const& x) {
+          auto str = get_if<std::string>(x);
+          auto matches = str && std::regex_match(str->begin(), str->end(), rx);
+          return matches == positive;
+        });
+      }
+      break;
+    case in:
+    case not_in: {
+      auto positive = op == in;
+      if (auto sn = get_if<subnet>(rhs)) {
+        result = bind_field(o, [=, net = *sn](data const& x) {
+          auto addr = get_if<address>(x);
+          return (addr && net.contains(*addr)) == positive;
+        });
+      } else if (auto p = get_if<pattern>(rhs)) {
+        auto rx = std::regex{p->string()};
+        result = bind_field(o, [=](data const& x) {
+          auto str = get_if<std::string>(x);
+          auto found = str && std::regex_search(str->begin(), str->end(), rx);
+          return found == positive;
+        });
+      } else if (auto s = get_if<std::string>(rhs)) {
+        result = bind_field(o, [=, haystack = *s](data const& x) {
+          auto str = get_if<std::string>(x);
+          auto found = str && haystack.find(*str) != std::string::npos;
+          return found == positive;
+        });
+      }
+      break;
+    }
+  }
+  if (!result)
+    result = bind_field(o, [=](data const& x) {
+      return evaluate(x, op, rhs);
+    });
+  return result;
+}
+
+compiled_predicate compile_time(relational_operator op, data const& rhs) {
+  auto make = [&](auto cmp) -> predicate_function {
+    return [=, c = get<timestamp>(rhs)](event const& e) {
+      return cmp(e.timestamp(), c);
+    };
+  };
+  if (is<timestamp>(rhs)) {
+    switch (op) {
+      default:
+        break;
+      case equal:
+        return {make(std::equal_to<timestamp>{})};
+      case not_equal:
+        return {make(std::not_equal_to<timestamp>{})};
+      case less:
+        return {make(std::less<timestamp>{})};
+      case less_equal:
+        return {make(std::less_equal<timestamp>{})};
+      case greater:
+        return {make(std::greater<timestamp>{})};
+      case greater_equal:
+        return {make(std::greater_equal<timestamp>{})};
+    }
+  }
+  return {[=](event const& e) { return evaluate(e.timestamp(), op, rhs); }};
+}
+
+compiled_predicate compile(predicate const& p, type const& t) {
+  // We accept extractors on either side and flip the operator accordingly.
+  auto lhs = &p.lhs;
+  auto op = p.op;
+  auto rhs = get_if<data>(p.rhs);
+  if (!rhs) {
+    lhs = &p.rhs;
+    op = flip(op);
+    rhs = get_if<data>(p.lhs);
+  }
+  if (!rhs)
+    return {};
+  if (auto ex = get_if<attribute_extractor>(*lhs)) {
+    // The type of all events is the same, which makes type predicates
+    // constant.
+    if (ex->attr == "type")
+      return {{}, evaluate(t.name(), op, *rhs)};
+    if (ex->attr == "time")
+      return compile_time(op, *rhs);
+    return {};
+  }
+  if (auto ex = get_if<data_extractor>(*lhs)) {
+    if (ex->type != t)
+      return {};
+    return {compile_data(ex->offset, op, *rhs)};
+  }
+  VAST_ASSERT(!"extractors should have been resolved at this point");
+  return {};
+}
+
+} // namespace <anonymous>
+
+candidate_checker::candidate_checker(expression const& expr, type const& t) {
+  // Translates the expression into prefix notation.
+  struct compiler {
+    void operator()(none) {
+      code.push_back({op_false, 0, 1});
+    }
+
+    void operator()(conjunction const& c) {
+      emit(op_and, c);
+    }
+
+    void operator()(disjunction const& d) {
+      emit(op_or, d);
+    }
+
+    void operator()(negation const& n) {
+      auto pos = code.size();
+      code.push_back({op_not, 1, 0});
+      visit(*this, n.expr());
+      code[pos].size = static_cast<uint32_t>(code.size() - pos);
+    }
+
+    void operator()(predicate const& p) {
+      auto x = compile(p, t);
+      if (!x.f) {
+        code.push_back({x.constant ? op_true : op_false, 0, 1});
+      } else {
+        auto i = static_cast<uint32_t>(predicates.size());
+        predicates.push_back(std::move(x.f));
+        code.push_back({op_pred, i, 1});
+      }
+    }
+
+    void emit(opcode op, std::vector<expression> const& xs) {
+      auto pos = code.size();
+      code.push_back({op, static_cast<uint32_t>(xs.size()), 0});
+      for (auto& x : xs)
+        visit(*this, x);
+      code[pos].size = static_cast<uint32_t>(code.size() - pos);
+    }
+
+    type const& t;
+    std::vector<instruction>& code;
+    std::vector<predicate_function>& predicates;
+  };
+  visit(compiler{t, code_, predicates_}, expr);
+}
+
+bool candidate_checker::operator()(event const& e) const {
+  return !code_.empty() && run(code_.data(), e);
+}
+
+bool candidate_checker::run(instruction const* code, event const& e) const {
+  switch (code->op) {
+    default:
+      VAST_ASSERT(!"missing case");
+      return false;
+    case op_true:
+      return true;
+    case op_false:
+      return false;
+    case op_pred:
+      return predicates_[code->arg](e);
+    case op_not:
+      return !run(code + 1, e);
+    case op_and: {
+      auto x = code + 1;
+      for (auto i = 0u; i < code->arg; ++i, x += x->size)
+        if (!run(x, e))
+          return false;
+      return true;
+    }
+    case op_or: {
+      auto x = code + 1;
+      for (auto i = 0u; i < code->arg; ++i, x += x->size)
+        if (run(x, e))
+          return true;
+      return false;
+    }
+  }
+}
+
+} // namespace vast
@@ -0,0 +1,76 @@
+#include "vast/config.hpp"
+
+#ifdef VAST_POSIX
+#  include <fcntl.h>
+#  include <unistd.h>
+#  include <sys/mman.h>
+#  include <sys/stat.h>
+#endif
+
+#include "vast/chunk.hpp"
+
+namespace vast {
+
+chunk_ptr chunk::make(std::vector<char> xs) {
+  auto result = std::shared_ptr<chunk>{new chunk};
+  result->buffer_ = std::move(xs);
+  result->data_ = result->buffer_.data();
+  result->size_ = result->buffer_.size();
+  return result;
+}
+
+chunk_ptr chunk::mmap(path const& filename) {
+#ifdef VAST_POSIX
+  auto fd = ::open(filename.str().c_str(), O_RDONLY);
+  if (fd == -1)
+    return nullptr;
+  struct stat st;
+  if (::fstat(fd, &st) == -1) {
+    ::close(fd);
+    return nullptr;
+  }
+  auto result = std::shared_ptr<chunk>{new chunk};
+  // Mapping an empty file fails, but an empty chunk is perfectly valid.
+  if (st.st_size > 0) {
+    auto size = static_cast<size_t>(st.st_size);
+    auto map = ::mmap(nullptr, size, PROT_READ, MAP_SHARED, fd, 0);
+    if (map == MAP_FAILED) {
+      ::close(fd);
+      return nullptr;
+    }
+    result->data_ = reinterpret_cast<char const*>(map);
+    result->size_ = size;
+    result->mapped_ = true;
+  }
+  // The mapping remains valid after closing the file descriptor.
+  ::close(fd);
+  return result;
+#else
+  return nullptr;
+#endif // VAST_POSIX
+}
+
+chunk::~chunk() {
+#ifdef VAST_POSIX
+  if (mapped_)
+    ::munmap(const_cast<char*>(data_), size_);
+#endif // VAST_POSIX
+}
+
+char const* chunk::data() const {
+  return data_;
+}
+
+chunk::size_type chunk::size() const {
+  return size_;
+}
+
+chunk::const_iterator chunk::begin() const {
+  return data_;
+}
+
+chunk::const_iterator chunk::end() const {
+  return data_ + size_;
+}
+
+} // namespace vast
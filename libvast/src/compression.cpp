@@ -1,13 +1,50 @@
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+
 #include "lz4/lz4.h"
 
 #include "vast/compression.hpp"
 #include "vast/die.hpp"
+#include "vast/error.hpp"
 
 #ifdef VAST_HAVE_SNAPPY
 #include <snappy.h>
 #endif
 
+#ifdef VAST_HAVE_ZSTD
+#include <zstd.h>
+#include <zdict.h>
+#endif
+
 namespace vast {
+
+expected<codec> make_codec(std::string const& name) {
+  if (name == "null")
+    return codec{compression::null};
+  if (name == "lz4")
+    return codec{compression::lz4};
+#ifdef VAST_HAVE_SNAPPY
+  if (name == "snappy")
+    return codec{compression::snappy};
+#endif
+#ifdef VAST_HAVE_ZSTD
+  if (name == "zstd")
+    return codec{compression::zstd};
+  if (name.compare(0, 5, "zstd-") == 0) {
+    auto level = 0;
+    try {
+      level = std::stoi(name.substr(5));
+    } catch (std::exception const&) {
+      return make_error(ec::parse_error, "invalid zstd level:", name);
+    }
+    if (level < 1 || level > ZSTD_maxCLevel())
+      return make_error(ec::parse_error, "zstd level out of range:", level);
+    return codec{compression::zstd, level};
+  }
+#endif
+  return make_error(ec::unspecified, "unknown or unavailable codec:", name);
+}
 namespace lz4 {
 
 size_t compress_bound(size_t size) {
@@ -52,4 +89,141 @@ bool uncompress(char const* in, size_t in_size, char* out) {
 } // namespace snappy
 #endif // VAST_HAVE_SNAPPY
 
+#ifdef VAST_HAVE_ZSTD
+namespace zstd {
+
+namespace {
+
+using cdict_ptr = std::unique_ptr<ZSTD_CDict, size_t (*)(ZSTD_CDict*)>;
+using ddict_ptr = std::unique_ptr<ZSTD_DDict, size_t (*)(ZSTD_DDict*)>;
+
+// A registered dictionary, prepared for uncompression and lazily for
+// compression at each level.
+struct dictionary {
+  std::vector<char> bytes;
+  ddict_ptr ddict;
+  std::unordered_map<int, cdict_ptr> cdicts;
+};
+
+// All registered dictionaries. We never remove a dictionary, so pointers to
+// them remain valid for the lifetime of the process.
+struct registry {
+  std::mutex mtx;
+  std::unordered_map<uint32_t, dictionary> dictionaries;
+};
+
+registry& get_registry() {
+  static registry instance;
+  return instance;
+}
+
+ZSTD_CDict const* find_cdict(uint32_t id, int level) {
+  auto& r = get_registry();
+  std::lock_guard<std::mutex> guard{r.mtx};
+  auto i = r.dictionaries.find(id);
+  if (i == r.dictionaries.end())
+    return nullptr;
+  auto& cdicts = i->second.cdicts;
+  auto j = cdicts.find(level);
+  if (j == cdicts.end()) {
+    auto& bytes = i->second.bytes;
+    auto cdict = ZSTD_createCDict(bytes.data(), bytes.size(),
+                                  level > 0 ? level : ZSTD_CLEVEL_DEFAULT);
+    if (!cdict)
+      return nullptr;
+    j = cdicts.emplace(level, cdict_ptr{cdict, ZSTD_freeCDict}).first;
+  }
+  return j->second.get();
+}
+
+ZSTD_DDict const* find_ddict(uint32_t id) {
+  auto& r = get_registry();
+  std::lock_guard<std::mutex> guard{r.mtx};
+  auto i = r.dictionaries.find(id);
+  return i == r.dictionaries.end() ? nullptr : i->second.ddict.get();
+}
+
+// Each thread reuses its contexts across calls, which saves allocations.
+ZSTD_CCtx* compression_context() {
+  thread_local std::unique_ptr<ZSTD_CCtx, size_t (*)(ZSTD_CCtx*)> ctx{
+    ZSTD_createCCtx(), ZSTD_freeCCtx};
+  return ctx.get();
+}
+
+ZSTD_DCtx* uncompression_context() {
+  thread_local std::unique_ptr<ZSTD_DCtx, size_t (*)(ZSTD_DCtx*)> ctx{
+    ZSTD_createDCtx(), ZSTD_freeDCtx};
+  return ctx.get();
+}
+
+} // namespace <anonymous>
+
+size_t compress_bound(size_t size) {
+  return ZSTD_compressBound(size);
+}
+
+size_t compress(char const* in, size_t in_size, char* out, size_t out_size,
+                int level, uint32_t dictionary) {
+  auto ctx = compression_context();
+  size_t n;
+  if (dictionary == 0) {
+    n = ZSTD_compressCCtx(ctx, out, out_size, in, in_size,
+                          level > 0 ? level : ZSTD_CLEVEL_DEFAULT);
+  } else {
+    auto cdict = find_cdict(dictionary, level);
+    if (!cdict)
+      return 0;
+    n = ZSTD_compress_usingCDict(ctx, out, out_size, in, in_size, cdict);
+  }
+  return ZSTD_isError(n) ? 0 : n;
+}
+
+size_t uncompress(char const* in, size_t in_size, char* out, size_t out_size) {
+  auto ctx = uncompression_context();
+  size_t n;
+  auto id = ZSTD_getDictID_fromFrame(in, in_size);
+  if (id == 0) {
+    n = ZSTD_decompressDCtx(ctx, out, out_size, in, in_size);
+  } else {
+    auto ddict = find_ddict(id);
+    if (!ddict)
+      return 0;
+    n = ZSTD_decompress_usingDDict(ctx, out, out_size, in, in_size, ddict);
+  }
+  return ZSTD_isError(n) ? 0 : n;
+}
+
+expected<std::vector<char>> train_dictionary(std::vector<char> const& samples,
+                                             std::vector<size_t> const& sizes,
+                                             size_t capacity) {
+  std::vector<char> result(capacity);
+  auto n = ZDICT_trainFromBuffer(result.data(), result.size(), samples.data(),
+                                 sizes.data(),
+                                 static_cast<unsigned>(sizes.size()));
+  if (ZDICT_isError(n))
+    return make_error(ec::unspecified, "failed to train dictionary:",
+                      ZDICT_getErrorName(n));
+  result.resize(n);
+  return result;
+}
+
+expected<uint32_t> add_dictionary(std::vector<char> dict) {
+  auto id = ZDICT_getDictID(dict.data(), dict.size());
+  if (id == 0)
+    return make_error(ec::unspecified, "invalid dictionary");
+  auto& r = get_registry();
+  std::lock_guard<std::mutex> guard{r.mtx};
+  if (r.dictionaries.count(id) > 0)
+    return id;
+  auto ddict = ZSTD_createDDict(dict.data(), dict.size());
+  if (!ddict)
+    return make_error(ec::unspecified, "failed to load dictionary", id);
+  auto x = dictionary{std::move(dict), ddict_ptr{ddict, ZSTD_freeDDict}, {}};
+  r.dictionaries.emplace(id, std::move(x));
+  return id;
+}
+
+} // namespace zstd
+#endif // VAST_HAVE_ZSTD
+
 } // namespace vast
@@ -0,0 +1,323 @@
+#include <cstring>
+
+#include "vast/concept/hashable/xxh3.hpp"
+#include "vast/detail/byte_swap.hpp"
+
+// A portable implementation of the 64-bit variant of XXH3 after the reference
+// implementation in xxHash 0.8. Inputs of up to 240 bytes take dedicated
+// paths. Longer inputs run through 8 independent 64-bit lanes per 64-byte
+// stripe, which compilers vectorize.
+
+namespace vast {
+namespace {
+
+constexpr uint64_t prime32_1 = 0x9E3779B1;
+constexpr uint64_t prime32_2 = 0x85EBCA77;
+constexpr uint64_t prime32_3 = 0xC2B2AE3D;
+constexpr uint64_t prime64_1 = 0x9E3779B185EBCA87;
+constexpr uint64_t prime64_2 = 0xC2B2AE3D27D4EB4F;
+constexpr uint64_t prime64_3 = 0x165667B19E3779F9;
+constexpr uint64_t prime64_4 = 0x85EBCA77C2B2AE63;
+constexpr uint64_t prime64_5 = 0x27D4EB2F165667C5;
+constexpr uint64_t prime_mx1 = 0x165667919E3779F9;
+constexpr uint64_t prime_mx2 = 0x9FB21C651E98DF25;
+
+constexpr size_t secret_size = 192;
+constexpr size_t stripe_size = 64;
+constexpr size_t stripes_per_block = (secret_size - stripe_size) / 8;
+constexpr size_t max_short_size = 240;
+
+alignas(64) constexpr uint8_t default_secret[secret_size] = {
+  0xb8, 0xfe, 0x6c, 0x39, 0x23, 0xa4, 0x4b, 0xbe, 0x7c, 0x01, 0x81, 0x2c,
+  0xf7, 0x21, 0xad, 0x1c, 0xde, 0xd4, 0x6d, 0xe9, 0x83, 0x90, 0x97, 0xdb,
+  0x72, 0x40, 0xa4, 0xa4, 0xb7, 0xb3, 0x67, 0x1f, 0xcb, 0x79, 0xe6, 0x4e,
+  0xcc, 0xc0, 0xe5, 0x78, 0x82, 0x5a, 0xd0, 0x7d, 0xcc, 0xff, 0x72, 0x21,
+  0xb8, 0x08, 0x46, 0x74, 0xf7, 0x43, 0x24, 0x8e, 0xe0, 0x35, 0x90, 0xe6,
+  0x81, 0x3a, 0x26, 0x4c, 0x3c, 0x28, 0x52, 0xbb, 0x91, 0xc3, 0x00, 0xcb,
+  0x88, 0xd0, 0x65, 0x8b, 0x1b, 0x53, 0x2e, 0xa3, 0x71, 0x64, 0x48, 0x97,
+  0xa2, 0x0d, 0xf9, 0x4e, 0x38, 0x19, 0xef, 0x46, 0xa9, 0xde, 0xac, 0xd8,
+  0xa8, 0xfa, 0x76, 0x3f, 0xe3, 0x9c, 0x34, 0x3f, 0xf9, 0xdc, 0xbb, 0xc7,
+  0xc7, 0x0b, 0x4f, 0x1d, 0x8a, 0x51, 0xe0, 0x4b, 0xcd, 0xb4, 0x59, 0x31,
+  0xc8, 0x9f, 0x7e, 0xc9, 0xd9, 0x78, 0x73, 0x64, 0xea, 0xc5, 0xac, 0x83,
+  0x34, 0xd3, 0xeb, 0xc3, 0xc5, 0x81, 0xa0, 0xff, 0xfa, 0x13, 0x63, 0xeb,
+  0x17, 0x0d, 0xdd, 0x51, 0xb7, 0xf0, 0xda, 0x49, 0xd3, 0x16, 0x55, 0x26,
+  0x29, 0xd4, 0x68, 0x9e, 0x2b, 0x16, 0xbe, 0x58, 0x7d, 0x47, 0xa1, 0xfc,
+  0x8f, 0xf8, 0xb8, 0xd1, 0x7a, 0xd0, 0x31, 0xce, 0x45, 0xcb, 0x3a, 0x8f,
+  0x95, 0x16, 0x04, 0x28, 0xaf, 0xd7, 0xfb, 0xca, 0xbb, 0x4b, 0x40, 0x7e,
+};
+
+uint32_t read32(uint8_t const* p) {
+  uint32_t x;
+  std::memcpy(&x, p, sizeof(x));
+#ifdef VAST_BIG_ENDIAN
+  x = detail::byte_swap(x);
+#endif
+  return x;
+}
+
+uint64_t read64(uint8_t const* p) {
+  uint64_t x;
+  std::memcpy(&x, p, sizeof(x));
+#ifdef VAST_BIG_ENDIAN
+  x = detail::byte_swap(x);
+#endif
+  return x;
+}
+
+void write64(uint8_t* p, uint64_t x) {
+#ifdef VAST_BIG_ENDIAN
+  x = detail::byte_swap(x);
+#endif
+  std::memcpy(p, &x, sizeof(x));
+}
+
+uint64_t rotl(uint64_t x, int r) {
+  return (x << r) | (x >> (64 - r));
+}
+
+// Multiplies two 64-bit integers and folds the 128-bit product. Without a
+// native 128-bit type, we compose the product from 32x32-bit multiplications.
+uint64_t mul_fold(uint64_t x, uint64_t y) {
+#ifdef __SIZEOF_INT128__
+  // GCC complains about __int128 with -pedantic or -pedantic-errors.
+  __extension__ typedef unsigned __int128 uint128;
+  auto product = static_cast<uint128>(x) * y;
+  return static_cast<uint64_t>(product) ^ static_cast<uint64_t>(product >> 64);
+#else
+  auto lo_lo = (x & 0xffffffff) * (y & 0xffffffff);
+  auto hi_lo = (x >> 32) * (y & 0xffffffff);
+  auto lo_hi = (x & 0xffffffff) * (y >> 32);
+  auto hi_hi = (x >> 32) * (y >> 32);
+  auto cross = (lo_lo >> 32) + (hi_lo & 0xffffffff) + lo_hi;
+  auto upper = (hi_lo >> 32) + (cross >> 32) + hi_hi;
+  auto lower = (cross << 32) | (lo_lo & 0xffffffff);
+  return lower ^ upper;
+#endif
+}
+
+uint64_t xxh64_avalanche(uint64_t h) {
+  h ^= h >> 33;
+  h *= prime64_2;
+  h ^= h >> 29;
+  h *= prime64_3;
+  return h ^ (h >> 32);
+}
+
+uint64_t avalanche(uint64_t h) {
+  h ^= h >> 37;
+  h *= prime_mx1;
+  return h ^ (h >> 32);
+}
+
+uint64_t rrmxmx(uint64_t h, uint64_t n) {
+  h ^= rotl(h, 49) ^ rotl(h, 24);
+  h *= prime_mx2;
+  h ^= (h >> 35) + n;
+  h *= prime_mx2;
+  return h ^ (h >> 28);
+}
+
+uint64_t mix16(uint8_t const* p, uint8_t const* secret, uint64_t seed) {
+  return mul_fold(read64(p) ^ (read64(secret) + seed),
+                  read64(p + 8) ^ (read64(secret + 8) - seed));
+}
+
+uint64_t hash_0_to_16(uint8_t const* p, size_t n, uint64_t seed) {
+  auto secret = default_secret;
+  if (n > 8) {
+    auto lo = read64(p) ^ ((read64(secret + 24) ^ read64(secret + 32)) + seed);
+    auto hi = read64(p + n - 8)
+              ^ ((read64(secret + 40) ^ read64(secret + 48)) - seed);
+    return avalanche(n + detail::byte_swap(lo) + hi + mul_fold(lo, hi));
+  }
+  if (n >= 4) {
+    seed ^= uint64_t{detail::byte_swap(static_cast<uint32_t>(seed))} << 32;
+    auto x = read32(p + n - 4) + (uint64_t{read32(p)} << 32);
+    return rrmxmx(x ^ ((read64(secret + 8) ^ read64(secret + 16)) - seed), n);
+  }
+  if (n > 0) {
+    auto x = (uint32_t{p[0]} << 16) | (uint32_t{p[n >> 1]} << 24)
+             | uint32_t{p[n - 1]} | static_cast<uint32_t>(n << 8);
+    return xxh64_avalanche(x ^ ((read32(secret) ^ read32(secret + 4)) + seed));
+  }
+  return xxh64_avalanche(seed ^ read64(secret + 56) ^ read64(secret + 64));
+}
+
+uint64_t hash_17_to_128(uint8_t const* p, size_t n, uint64_t seed) {
+  auto secret = default_secret;
+  auto acc = n * prime64_1;
+  if (n > 32) {
+    if (n > 64) {
+      if (n > 96) {
+        acc += mix16(p + 48, secret + 96, seed);
+        acc += mix16(p + n - 64, secret + 112, seed);
+      }
+      acc += mix16(p + 32, secret + 64, seed);
+      acc += mix16(p + n - 48, secret + 80, seed);
+    }
+    acc += mix16(p + 16, secret + 32, seed);
+    acc += mix16(p + n - 32, secret + 48, seed);
+  }
+  acc += mix16(p, secret, seed);
+  acc += mix16(p + n - 16, secret + 16, seed);
+  return avalanche(acc);
+}
+
+uint64_t hash_129_to_240(uint8_t const* p, size_t n, uint64_t seed) {
+  auto secret = default_secret;
+  auto acc = n * prime64_1;
+  for (auto i = 0u; i < 8; ++i)
+    acc += mix16(p + 16 * i, secret + 16 * i, seed);
+  acc = avalanche(acc);
+  auto acc_end = mix16(p + n - 16, secret + 136 - 17, seed);
+  for (auto i = 8u; i < n / 16; ++i)
+    acc_end += mix16(p + 16 * i, secret + 16 * (i - 8) + 3, seed);
+  return avalanche(acc + acc_end);
+}
+
+void init(uint64_t* acc) {
+  uint64_t const xs[8] = {prime32_3, prime64_1, prime64_2, prime64_3,
+                          prime64_4, prime32_2, prime64_5, prime32_1};
+  std::memcpy(acc, xs, sizeof(xs));
+}
+
+void accumulate(uint64_t* acc, uint8_t const* p, uint8_t const* secret) {
+  for (auto i = 0u; i < 8; ++i) {
+    auto x = read64(p + 8 * i);
+    auto key = x ^ read64(secret + 8 * i);
+    acc[i ^ 1] += x;
+    acc[i] += (key & 0xFFFFFFFF) * (key >> 32);
+  }
+}
+
+void scramble(uint64_t* acc, uint8_t const* secret) {
+  for (auto i = 0u; i < 8; ++i) {
+    auto x = acc[i];
+    x ^= x >> 47;
+    x ^= read64(secret + 8 * i);
+    acc[i] = x * prime32_1;
+  }
+}
+
+// Accumulates a number of stripes and scrambles the accumulators after each
+// full block.
+void consume(uint64_t* acc, uint64_t& block_stripes, uint8_t const* p,
+             size_t stripes, uint8_t const* secret) {
+  for (auto i = size_t{0}; i < stripes; ++i) {
+    accumulate(acc, p + i * stripe_size, secret + block_stripes * 8);
+    if (++block_stripes == stripes_per_block) {
+      scramble(acc, secret + secret_size - stripe_size);
+      block_stripes = 0;
+    }
+  }
+}
+
+uint64_t merge(uint64_t const* acc, uint8_t const* secret, uint64_t n) {
+  auto result = n * prime64_1;
+  for (auto i = 0u; i < 4; ++i)
+    result += mul_fold(acc[2 * i] ^ read64(secret + 16 * i),
+                       acc[2 * i + 1] ^ read64(secret + 16 * i + 8));
+  return avalanche(result);
+}
+
+// Long inputs use a secret that incorporates the seed instead of the seed
+// itself.
+uint8_t const* derive_secret(uint64_t seed, uint8_t* buffer) {
+  if (seed == 0)
+    return default_secret;
+  for (auto i = 0u; i < secret_size; i += 16) {
+    write64(buffer + i, read64(default_secret + i) + seed);
+    write64(buffer + i + 8, read64(default_secret + i + 8) - seed);
+  }
+  return buffer;
+}
+
+// Finishes the hash computation over a long input, given the state after
+// consuming all complete stripes but the last one.
+uint64_t finish(uint64_t* acc, uint8_t const* last_stripe, uint64_t n,
+                uint8_t const* secret) {
+  accumulate(acc, last_stripe, secret + secret_size - stripe_size - 7);
+  return merge(acc, secret + 11, n);
+}
+
+uint64_t hash_bytes(uint8_t const* p, size_t n, uint64_t seed) {
+  if (n <= 16)
+    return hash_0_to_16(p, n, seed);
+  if (n <= 128)
+    return hash_17_to_128(p, n, seed);
+  if (n <= max_short_size)
+    return hash_129_to_240(p, n, seed);
+  uint8_t buffer[secret_size];
+  auto secret = derive_secret(seed, buffer);
+  uint64_t acc[8];
+  init(acc);
+  auto block_stripes = uint64_t{0};
+  consume(acc, block_stripes, p, (n - 1) / stripe_size, secret);
+  return finish(acc, p + n - stripe_size, n, secret);
+}
+
+} // namespace <anonymous>
+
+void xxh3_64::operator()(void const* x, size_t n) noexcept {
+  auto p = static_cast<uint8_t const*>(x);
+  if (buffered_ + n <= buffer_size) {
+    if (n > 0)
+      std::memcpy(buffer_ + buffered_, p, n);
+    buffered_ += n;
+    total_ += n;
+    return;
+  }
+  // From here on, the input is too long for the short paths.
+  if (total_ == buffered_)
+    init(acc_);
+  total_ += n;
+  uint8_t buffer[secret_size];
+  auto secret = derive_secret(seed_, buffer);
+  // We always keep at least one byte in the buffer, because the final stripe
+  // requires special treatment.
+  if (buffered_ > 0) {
+    auto k = buffer_size - buffered_;
+    std::memcpy(buffer_ + buffered_, p, k);
+    p += k;
+    n -= k;
+    consume(acc_, stripes_, buffer_, buffer_size / stripe_size, secret);
+    std::memcpy(last_, buffer_ + buffer_size - stripe_size, stripe_size);
+  }
+  if (n > buffer_size) {
+    auto stripes = (n - 1) / stripe_size;
+    consume(acc_, stripes_, p, stripes, secret);
+    p += stripes * stripe_size;
+    n -= stripes * stripe_size;
+    std::memcpy(last_, p - stripe_size, stripe_size);
+  }
+  std::memcpy(buffer_, p, n);
+  buffered_ = n;
+}
+
+xxh3_64::operator result_type() noexcept {
+  if (total_ <= max_short_size)
+    return hash_bytes(buffer_, total_, seed_);
+  uint8_t buffer[secret_size];
+  auto secret = derive_secret(seed_, buffer);
+  uint64_t acc[8];
+  if (total_ == buffered_)
+    init(acc);
+  else
+    std::memcpy(acc, acc_, sizeof(acc));
+  auto block_stripes = stripes_;
+  auto stripes = (buffered_ - 1) / stripe_size;
+  consume(acc, block_stripes, buffer_, stripes, secret);
+  if (buffered_ >= stripe_size)
+    return finish(acc, buffer_ + buffered_ - stripe_size, total_, secret);
+  uint8_t last_stripe[stripe_size];
+  auto k = stripe_size - buffered_;
+  std::memcpy(last_stripe, last_ + buffered_, k);
+  std::memcpy(last_stripe + k, buffer_, buffered_);
+  return finish(acc, last_stripe, total_, secret);
+}
+
+xxh3_64::result_type xxh3_64::one_shot(void const* x, size_t n) const noexcept {
+  return hash_bytes(static_cast<uint8_t const*>(x), n, seed_);
+}
+
+} // namespace vast
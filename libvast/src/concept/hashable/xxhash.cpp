@@ -5,7 +5,7 @@
 
 namespace vast {
 
-xxhash32::xxhash32(result_type seed) noexcept {
+xxhash32::xxhash32(result_type seed) noexcept : seed_{seed} {
   static_assert(sizeof(xxhash32::state_type) == sizeof(XXH32_state_t)
                 && alignof(xxhash32::state_type) == alignof(XXH32_state_t),
                 "xxhash32 state types out of sync");
@@ -25,8 +25,14 @@ xxhash32::operator result_type() noexcept {
   return ::XXH32_digest(state);
 }
 
+xxhash32::result_type xxhash32::one_shot(void const* x,
+                                         size_t n) const noexcept {
+  VAST_ASSERT(n <= (1u << 31) - 1);
+  return ::XXH32(x, n, static_cast<unsigned>(seed_));
+}
+
 
-xxhash64::xxhash64(result_type seed) noexcept {
+xxhash64::xxhash64(result_type seed) noexcept : seed_{seed} {
   static_assert(sizeof(xxhash64::state_type) == sizeof(XXH64_state_t)
                 && alignof(xxhash64::state_type) == alignof(XXH64_state_t),
                 "xxhash64 state types out of sync");
@@ -45,4 +51,9 @@ xxhash64::operator result_type() noexcept {
   return ::XXH64_digest(state);
 }
 
+xxhash64::result_type xxhash64::one_shot(void const* x,
+                                         size_t n) const noexcept {
+  return ::XXH64(x, n, seed_);
+}
+
 } // namespace vast
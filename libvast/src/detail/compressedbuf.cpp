@@ -10,8 +10,12 @@ namespace detail {
 
 compressedbuf::compressedbuf(std::streambuf& sb, compression method,
                             size_t block_size)
+  : compressedbuf{sb, codec{method}, block_size} {
+}
+
+compressedbuf::compressedbuf(std::streambuf& sb, codec c, size_t block_size)
   : streambuf_{sb},
-    method_{method},
+    codec_{c},
     block_size_{block_size} {
   VAST_ASSERT(block_size > 0);
   compressed_.resize(block_size_);
@@ -111,7 +115,8 @@ compressedbuf::int_type compressedbuf::underflow() {
   if (got != compressed_size)
     return traits_type::eof();
   // Uncompress data.
-  uncompress();
+  if (!uncompress())
+    return traits_type::eof();
   // Reset get area.
   setg(uncompressed_.data(),
        uncompressed_.data(),
@@ -142,7 +147,7 @@ std::streamsize compressedbuf::xsgetn(char_type* s, std::streamsize n) {
 
 void compressedbuf::compress() {
   size_t n = 0;
-  switch (method_) {
+  switch (codec_.method) {
     case compression::null:
       compressed_.resize(uncompressed_.size());
       std::memcpy(compressed_.data(), uncompressed_.data(),
@@ -162,14 +167,24 @@ void compressedbuf::compress() {
       break;
     }
 #endif // VAST_HAVE_SNAPPY
+#ifdef VAST_HAVE_ZSTD
+    case compression::zstd: {
+      compressed_.resize(zstd::compress_bound(uncompressed_.size()));
+      n = zstd::compress(uncompressed_.data(), uncompressed_.size(),
+                         compressed_.data(), compressed_.size(),
+                         codec_.level, codec_.dictionary);
+      VAST_ASSERT(n > 0);
+      break;
+    }
+#endif // VAST_HAVE_ZSTD
   }
   compressed_.resize(n);
   uncompressed_.resize(block_size_);
 }
 
-void compressedbuf::uncompress() {
+bool compressedbuf::uncompress() {
   size_t n = 0;
-  switch (method_) {
+  switch (codec_.method) {
     case compression::null: {
       std::memcpy(uncompressed_.data(), compressed_.data(), compressed_.size());
       n = compressed_.size();
@@ -189,10 +204,20 @@ void compressedbuf::uncompress() {
       break;
     }
 #endif // VAST_HAVE_SNAPPY
+#ifdef VAST_HAVE_ZSTD
+    case compression::zstd: {
+      // Fails if the block requires a dictionary that we don't have.
+      n = zstd::uncompress(compressed_.data(), compressed_.size(),
+                           uncompressed_.data(), uncompressed_.size());
+      break;
+    }
+#endif // VAST_HAVE_ZSTD
   }
-  VAST_ASSERT(n > 0);
+  if (n == 0)
+    return false;
   uncompressed_.resize(n);
   compressed_.resize(block_size_);
+  return true;
 }
 
 } // namespace detail
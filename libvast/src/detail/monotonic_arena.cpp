@@ -0,0 +1,64 @@
+#include <algorithm>
+
+#include "vast/detail/monotonic_arena.hpp"
+#include "vast/detail/assert.hpp"
+
+namespace vast {
+namespace detail {
+
+monotonic_arena::monotonic_arena(size_t chunk_size)
+  : chunk_size_{chunk_size} {
+  VAST_ASSERT(chunk_size_ > 0);
+}
+
+monotonic_arena::~monotonic_arena() {
+  reset();
+}
+
+void* monotonic_arena::allocate(size_t n, size_t alignment) {
+  VAST_ASSERT(alignment > 0 && (alignment & (alignment - 1)) == 0);
+  VAST_ASSERT(alignment <= alignof(std::max_align_t));
+  auto align = [=](size_t x) { return (x + alignment - 1) & ~(alignment - 1); };
+  // Move on to the next chunk that can accommodate the allocation.
+  while (current_ < chunks_.size()) {
+    auto pos = align(position_);
+    if (pos + n <= chunks_[current_].size) {
+      position_ = pos + n;
+      bytes_ += n;
+      return chunks_[current_].data.get() + pos;
+    }
+    ++current_;
+    position_ = 0;
+  }
+  // Chunks start at the strictest fundamental alignment, hence an empty chunk
+  // satisfies any alignment.
+  auto size = std::max(chunk_size_, n);
+  chunks_.push_back({std::unique_ptr<char[]>(new char[size]), size});
+  current_ = chunks_.size() - 1;
+  position_ = n;
+  bytes_ += n;
+  return chunks_.back().data.get();
+}
+
+void monotonic_arena::reset() {
+  for (auto i = finalizers_.rbegin(); i != finalizers_.rend(); ++i)
+    i->destroy(i->ptr);
+  finalizers_.clear();
+  current_ = 0;
+  position_ = 0;
+  bytes_ = 0;
+}
+
+size_t monotonic_arena::bytes() const {
+  return bytes_;
+}
+
+size_t monotonic_arena::capacity() const {
+  auto result = size_t{0};
+  for (auto& c : chunks_)
+    result += c.size;
+  return result;
+}
+
+} // namespace detail
+} // namespace vast
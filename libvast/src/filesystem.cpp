@@ -419,6 +419,63 @@ bool rm(const path& p) {
   return false;
 }
 
+expected<void> rename(path const& from, path const& to) {
+  if (!VAST_MOVE_FILE(from.str().data(), to.str().data()))
+    return make_error(ec::filesystem_error, "failed to rename", from, "to",
+                      to);
+  return {};
+}
+
+expected<void> copy(path const& from, path const& to) {
+  if (exists(to))
+    return make_error(ec::filesystem_error, "file exists:", to);
+  if (from.kind() == path::type::directory) {
+    auto result = mkdir(to);
+    if (!result)
+      return result;
+    for (auto& entry : directory{from}) {
+      result = copy(entry, to / entry.basename());
+      if (!result)
+        return result;
+    }
+    return {};
+  }
+  std::ifstream in{from.str(), std::ios::binary};
+  if (!in)
+    return make_error(ec::filesystem_error, "failed to open file", from);
+  std::ofstream out{to.str(), std::ios::binary};
+  if (!out)
+    return make_error(ec::filesystem_error, "failed to create file", to);
+  if (in.peek() != std::ifstream::traits_type::eof())
+    out << in.rdbuf();
+  if (!out.flush())
+    return make_error(ec::filesystem_error, "failed to copy", from, "to", to);
+  return {};
+}
+
+expected<size_t> file_size(path const& p) {
+  auto t = p.kind();
+  if (t == path::type::directory) {
+    auto result = size_t{0};
+    for (auto& entry : directory{p}) {
+      auto n = file_size(entry);
+      if (!n)
+        return n;
+      result += *n;
+    }
+    return result;
+  }
+#ifdef VAST_POSIX
+  struct stat st;
+  if (::lstat(p.str().data(), &st) != 0)
+    return make_error(ec::filesystem_error, "failed to stat file:", p.str(),
+                      std::strerror(errno));
+  return static_cast<size_t>(st.st_size);
+#else
+  return make_error(ec::filesystem_error, "not yet implemented");
+#endif // VAST_POSIX
+}
+
 expected<void> mkdir(path const& p) {
   auto components = split(p);
   if (components.empty())
@@ -44,6 +44,11 @@ bgpdump_parser::bgpdump_parser() {
   };
   state_change_type = record_type{std::move(state_change_fields)};
   state_change_type.name("bgpdump::state_change");
+  // All events share the canonical types.
+  announce_type = intern(announce_type);
+  route_type = intern(route_type);
+  withdraw_type = intern(withdraw_type);
+  state_change_type = intern(state_change_type);
 }
 
 expected<void> reader::schema(vast::schema const& sch) {
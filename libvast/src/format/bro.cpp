@@ -251,7 +251,7 @@ reader::reader(std::unique_ptr<std::istream> input) : input_{std::move(input)} {
   lines_ = std::make_unique<detail::line_range>(*input_);
 }
 
-expected<event> reader::read() {
+expected<reader::field_list> reader::next_line() {
   if (lines_->done())
     return make_error(ec::end_of_input, "input exhausted");
   if (is<none_type>(type_)) {
@@ -282,6 +282,14 @@ expected<event> reader::read() {
       return no_error;
     }
   }
+  return s;
+}
+
+expected<event> reader::read() {
+  auto line = next_line();
+  if (!line)
+    return line.error();
+  auto& s = *line;
   // Construct the record.
   size_t f = 0;
   size_t depth = 1;
@@ -330,6 +338,52 @@ expected<event> reader::read() {
   return e;
 }
 
+expected<packed_record> reader::read(detail::monotonic_arena& a,
+                                     timestamp& ts) {
+  auto line = next_line();
+  if (!line)
+    return line.error();
+  auto& s = *line;
+  auto i = layouts_.find(type_);
+  if (i == layouts_.end())
+    i = layouts_.emplace(type_, record_layout{type_}).first;
+  auto& layout = i->second;
+  if (!builder_ || &builder_->layout() != &layout)
+    builder_ = std::make_unique<packed_record::builder>(layout);
+  if (s.size() < layout.size())
+    return make_error(ec::parse_error, "line", lines_->line_number(), "has",
+                      s.size(), "of", layout.size(), "fields");
+  ts = timestamp::clock::now();
+  data d;
+  for (auto f = 0u; f < layout.size(); ++f) {
+    auto first = s[f].first;
+    auto last = s[f].second;
+    expected<void> result;
+    if (std::equal(unset_field_.begin(), unset_field_.end(), first, last)) {
+      result = builder_->add_nil();
+    } else if (std::equal(empty_field_.begin(), empty_field_.end(), first,
+                          last)) {
+      result = builder_->add(construct(layout[f].type));
+    } else {
+      if (!parsers_[f](first, last, d)) {
+        builder_->reset();
+        return make_error(ec::parse_error,
+                          "field", f, "line", lines_->line_number(),
+                          std::string(first, last));
+      }
+      if (f == static_cast<size_t>(timestamp_field_))
+        if (auto tp = get_if<timestamp>(d))
+          ts = *tp;
+      result = builder_->add(d);
+    }
+    if (!result) {
+      builder_->reset();
+      return result.error();
+    }
+  }
+  return builder_->finish(a);
+}
+
 expected<void> reader::schema(vast::schema const& sch) {
   schema_ = sch;
   return no_error;
@@ -443,6 +497,8 @@ expected<void> reader::parse_header() {
       else
         return make_error(ec::format_error, "incongruent types in schema");
     }
+  // All events share the canonical type.
+  type_ = intern(type_);
   // Determine the timestamp field.
   if (timestamp_field_ > -1) {
     VAST_DEBUG(name(), "uses event timestamp from field", timestamp_field_);
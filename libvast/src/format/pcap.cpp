@@ -27,7 +27,7 @@ inline type make_packet_type() {
     {"data", string_type{}.attributes({{"skip"}})}
   };
   packet.name("pcap::packet");
-  return packet;
+  return intern(packet);
 }
 
 static auto const pcap_packet_type = make_packet_type();
@@ -0,0 +1,488 @@
+#include <algorithm>
+#include <cstring>
+
+#include "vast/error.hpp"
+#include "vast/packed_record.hpp"
+#include "vast/detail/assert.hpp"
+#include "vast/detail/byte_swap.hpp"
+
+namespace vast {
+namespace {
+
+using kind = record_layout::kind;
+
+// Strips aliases off a type.
+type const& resolve(type const& t) {
+  if (auto a = get_if<alias_type>(t))
+    return resolve(a->value_type);
+  return t;
+}
+
+struct kind_of {
+  template <class T>
+  kind operator()(T const&) const {
+    return kind::container;
+  }
+
+  kind operator()(none_type const&) const { return kind::none; }
+  kind operator()(boolean_type const&) const { return kind::boolean; }
+  kind operator()(integer_type const&) const { return kind::integer; }
+  kind operator()(count_type const&) const { return kind::count; }
+  kind operator()(real_type const&) const { return kind::real; }
+  kind operator()(timespan_type const&) const { return kind::timespan; }
+  kind operator()(timestamp_type const&) const { return kind::timestamp; }
+  kind operator()(string_type const&) const { return kind::string; }
+  kind operator()(pattern_type const&) const { return kind::pattern; }
+  kind operator()(address_type const&) const { return kind::address; }
+  kind operator()(subnet_type const&) const { return kind::subnet; }
+  kind operator()(port_type const&) const { return kind::port; }
+  kind operator()(enumeration_type const&) const { return kind::enumeration; }
+};
+
+uint32_t slot_size(kind k) {
+  switch (k) {
+    default:
+      return 8;
+    case kind::none:
+      return 0;
+    case kind::address:
+      return 16;
+    case kind::subnet:
+      return 24; // address + prefix length, padded
+  }
+}
+
+// Reverses the bytes of an unaligned scalar in place.
+template <class T>
+void swap_bytes(char* ptr) {
+  T x;
+  std::memcpy(&x, ptr, sizeof(T));
+  x = detail::byte_swap(x);
+  std::memcpy(ptr, &x, sizeof(T));
+}
+
+// Counts the leaves of a record.
+size_t leaves(record_type const& r) {
+  auto result = size_t{0};
+  for (auto& f : r.fields)
+    if (auto nested = get_if<record_type>(resolve(f.type)))
+      result += leaves(*nested);
+    else
+      ++result;
+  return result;
+}
+
+void unpack(packed_record const& x, record_type const& r, size_t& i,
+            vector& xs) {
+  xs.reserve(r.fields.size());
+  for (auto& f : r.fields) {
+    if (auto nested = get_if<record_type>(resolve(f.type))) {
+      vector ys;
+      unpack(x, *nested, i, ys);
+      xs.push_back(std::move(ys));
+    } else {
+      xs.push_back(x.get(i++));
+    }
+  }
+}
+
+expected<void> pack(packed_record::builder& b, record_type const& r,
+                    vector const& xs) {
+  if (xs.size() != r.fields.size())
+    return make_error(ec::type_clash, "record size mismatch:", xs.size(),
+                      "!=", r.fields.size());
+  for (auto i = 0u; i < xs.size(); ++i) {
+    auto nested = get_if<record_type>(resolve(r.fields[i].type));
+    if (!nested) {
+      auto result = b.add(xs[i]);
+      if (!result)
+        return result;
+    } else if (auto ys = get_if<vector>(xs[i])) {
+      auto result = pack(b, *nested, *ys);
+      if (!result)
+        return result;
+    } else if (is<none>(xs[i])) {
+      // A nil record becomes a record of nils.
+      for (auto n = leaves(*nested); n > 0; --n)
+        b.add_nil();
+    } else {
+      return make_error(ec::type_clash, "expected record for field",
+                        r.fields[i].name);
+    }
+  }
+  return {};
+}
+
+} // namespace <anonymous>
+
+record_layout::record_layout(vast::type t) : type_{std::move(t)} {
+  VAST_ASSERT(is<record_type>(type_));
+  add(get<record_type>(type_));
+  // The nil bitmap comes first, padded to the slot alignment.
+  auto nil_bytes = static_cast<uint32_t>((fields_.size() + 63) / 64 * 8);
+  auto offset = nil_bytes;
+  for (auto& f : fields_) {
+    f.offset = offset;
+    offset += slot_size(f.kind);
+  }
+  fixed_size_ = offset;
+}
+
+vast::type const& record_layout::type() const {
+  return type_;
+}
+
+size_t record_layout::size() const {
+  return fields_.size();
+}
+
+record_layout::field const& record_layout::operator[](size_t i) const {
+  VAST_ASSERT(i < fields_.size());
+  return fields_[i];
+}
+
+uint32_t record_layout::fixed_size() const {
+  return fixed_size_;
+}
+
+void record_layout::add(record_type const& r) {
+  for (auto& f : r.fields) {
+    auto& t = resolve(f.type);
+    if (auto nested = get_if<record_type>(t))
+      add(*nested);
+    else
+      fields_.push_back({f.type, visit(kind_of{}, t), 0});
+  }
+}
+
+packed_record::packed_record(record_layout const& layout, char const* block,
+                             size_t size)
+  : layout_{&layout},
+    block_{block},
+    size_{static_cast<uint32_t>(size)} {
+  VAST_ASSERT(size >= layout.fixed_size());
+}
+
+record_layout const& packed_record::layout() const {
+  VAST_ASSERT(layout_);
+  return *layout_;
+}
+
+size_t packed_record::size() const {
+  return layout_ ? layout_->size() : 0;
+}
+
+bool packed_record::nil(size_t i) const {
+  VAST_ASSERT(i < size());
+  return (static_cast<uint8_t>(block_[i / 8]) >> (i % 8)) & 1;
+}
+
+data packed_record::get(size_t i) const {
+  if (nil(i))
+    return vast::nil;
+  switch ((*layout_)[i].kind) {
+    case kind::none:
+      return vast::nil;
+    case kind::boolean:
+      return load<uint8_t>(i) != 0;
+    case kind::integer:
+      return load<integer>(i);
+    case kind::count:
+      return load<count>(i);
+    case kind::real:
+      return load<real>(i);
+    case kind::timespan:
+      return timespan{load<int64_t>(i)};
+    case kind::timestamp:
+      return timestamp{timespan{load<int64_t>(i)}};
+    case kind::string: {
+      auto str = string(i);
+      return std::string(str.first, str.second);
+    }
+    case kind::pattern: {
+      auto str = string(i);
+      return pattern{std::string(str.first, str.second)};
+    }
+    case kind::address: {
+      uint32_t bytes[4];
+      std::memcpy(bytes, block_ + (*layout_)[i].offset, sizeof(bytes));
+      return address{bytes, address::ipv6, address::network};
+    }
+    case kind::subnet: {
+      uint32_t bytes[4];
+      auto ptr = block_ + (*layout_)[i].offset;
+      std::memcpy(bytes, ptr, sizeof(bytes));
+      auto length = static_cast<uint8_t>(ptr[16]);
+      return subnet{{bytes, address::ipv6, address::network}, length};
+    }
+    case kind::port: {
+      auto ptr = block_ + (*layout_)[i].offset;
+      uint16_t number;
+      std::memcpy(&number, ptr, sizeof(number));
+      return port{number, static_cast<port::port_type>(ptr[2])};
+    }
+    case kind::enumeration:
+      return load<enumeration>(i);
+    case kind::container:
+      return *load<data const*>(i);
+  }
+  VAST_ASSERT(!"missing kind");
+  return vast::nil;
+}
+
+std::pair<char const*, size_t> packed_record::string(size_t i) const {
+  VAST_ASSERT(!nil(i));
+  VAST_ASSERT((*layout_)[i].kind == kind::string
+              || (*layout_)[i].kind == kind::pattern);
+  auto x = load<uint64_t>(i);
+  auto offset = static_cast<uint32_t>(x >> 32);
+  auto size = static_cast<uint32_t>(x);
+  VAST_ASSERT(offset + size <= size_);
+  return {block_ + offset, size};
+}
+
+vector packed_record::to_data() const {
+  vector result;
+  auto i = size_t{0};
+  unpack(*this, vast::get<record_type>(layout_->type()), i, result);
+  return result;
+}
+
+char const* packed_record::block() const {
+  return block_;
+}
+
+size_t packed_record::block_size() const {
+  return size_;
+}
+
+template <class T>
+T packed_record::load(size_t i) const {
+  T result;
+  std::memcpy(&result, block_ + (*layout_)[i].offset, sizeof(T));
+  return result;
+}
+
+packed_record::builder::builder(record_layout const& layout)
+  : layout_{layout},
+    block_(layout.fixed_size()) {
+}
+
+record_layout const& packed_record::builder::layout() const {
+  return layout_;
+}
+
+expected<void> packed_record::builder::add(data const& x) {
+  if (is<none>(x))
+    return add_nil();
+  auto f = next();
+  if (!f)
+    return f.error();
+  auto offset = (*f)->offset;
+  auto clash = [&] {
+    return make_error(ec::type_clash, "invalid data for field", field_ - 1);
+  };
+  switch ((*f)->kind) {
+    case kind::none:
+      return clash();
+    case kind::boolean:
+      if (auto y = get_if<boolean>(x)) {
+        store(offset, static_cast<uint8_t>(*y));
+        return {};
+      }
+      return clash();
+    case kind::integer:
+      if (auto y = get_if<integer>(x)) {
+        store(offset, *y);
+        return {};
+      }
+      return clash();
+    case kind::count:
+      if (auto y = get_if<count>(x)) {
+        store(offset, *y);
+        return {};
+      }
+      return clash();
+    case kind::real:
+      if (auto y = get_if<real>(x)) {
+        store(offset, *y);
+        return {};
+      }
+      return clash();
+    case kind::timespan:
+      if (auto y = get_if<timespan>(x)) {
+        store(offset, y->count());
+        return {};
+      }
+      return clash();
+    case kind::timestamp:
+      if (auto y = get_if<timestamp>(x)) {
+        store(offset, y->time_since_epoch().count());
+        return {};
+      }
+      return clash();
+    case kind::string:
+    case kind::pattern: {
+      std::string const* str = nullptr;
+      if ((*f)->kind == kind::string)
+        str = get_if<std::string>(x);
+      else if (auto y = get_if<pattern>(x))
+        str = &y->string();
+      if (!str)
+        return clash();
+      store_string(offset, str->data(), str->size());
+      return {};
+    }
+    case kind::address:
+      if (auto y = get_if<address>(x)) {
+        std::memcpy(block_.data() + offset, y->data().data(), 16);
+        return {};
+      }
+      return clash();
+    case kind::subnet:
+      if (auto y = get_if<subnet>(x)) {
+        std::memcpy(block_.data() + offset, y->network().data().data(), 16);
+        block_[offset + 16] = static_cast<char>(y->length());
+        return {};
+      }
+      return clash();
+    case kind::port:
+      if (auto y = get_if<port>(x)) {
+        store(offset, y->number());
+        block_[offset + 2] = static_cast<char>(y->type());
+        return {};
+      }
+      return clash();
+    case kind::enumeration:
+      if (auto y = get_if<enumeration>(x)) {
+        store(offset, *y);
+        return {};
+      }
+      return clash();
+    case kind::container:
+      if (is<vector>(x) || is<set>(x) || is<table>(x)) {
+        containers_.emplace_back(offset, x);
+        return {};
+      }
+      return clash();
+  }
+  return clash();
+}
+
+expected<void> packed_record::builder::add(char const* str, size_t size) {
+  auto f = next();
+  if (!f)
+    return f.error();
+  if ((*f)->kind != kind::string && (*f)->kind != kind::pattern)
+    return make_error(ec::type_clash, "expected string for field",
+                      field_ - 1);
+  store_string((*f)->offset, str, size);
+  return {};
+}
+
+expected<void> packed_record::builder::add_nil() {
+  auto f = next();
+  if (!f)
+    return f.error();
+  auto i = field_ - 1;
+  block_[i / 8] |= static_cast<char>(1 << (i % 8));
+  return {};
+}
+
+expected<packed_record>
+packed_record::builder::finish(detail::monotonic_arena& a) {
+  if (field_ != layout_.size())
+    return make_error(ec::type_clash, "missing fields:", layout_.size(),
+                      "!=", field_);
+  auto size = block_.size() + strings_.size();
+  auto ptr = static_cast<char*>(a.allocate(size, 8));
+  std::memcpy(ptr, block_.data(), block_.size());
+  if (!strings_.empty())
+    std::memcpy(ptr + block_.size(), strings_.data(), strings_.size());
+  for (auto& c : containers_) {
+    data const* x = a.make<data>(std::move(c.second));
+    std::memcpy(ptr + c.first, &x, sizeof(x));
+  }
+  reset();
+  return packed_record{layout_, ptr, size};
+}
+
+void packed_record::builder::reset() {
+  // Prepare for the next record without giving up the buffers.
+  std::fill(block_.begin(), block_.end(), 0);
+  strings_.clear();
+  containers_.clear();
+  field_ = 0;
+}
+
+expected<record_layout::field const*> packed_record::builder::next() {
+  if (field_ == layout_.size())
+    return make_error(ec::type_clash, "too many fields:", field_ + 1);
+  return &layout_[field_++];
+}
+
+template <class T>
+void packed_record::builder::store(uint32_t offset, T x) {
+  VAST_ASSERT(offset + sizeof(T) <= block_.size());
+  std::memcpy(block_.data() + offset, &x, sizeof(T));
+}
+
+void packed_record::builder::store_string(uint32_t offset, char const* str,
+                                          size_t size) {
+  // String offsets are relative to the start of the record.
+  auto pos = static_cast<uint64_t>(layout_.fixed_size() + strings_.size());
+  store(offset, (pos << 32) | static_cast<uint32_t>(size));
+  strings_.insert(strings_.end(), str, str + size);
+}
+
+void to_little_endian(record_layout const& layout, char* block) {
+  if (detail::host_endian == detail::little_endian)
+    return;
+  for (auto i = 0u; i < layout.size(); ++i) {
+    auto ptr = block + layout[i].offset;
+    switch (layout[i].kind) {
+      default:
+        // Single bytes, addresses in network order, and container pointers,
+        // which are meaningless outside of the arena anyway.
+        break;
+      case kind::integer:
+      case kind::count:
+      case kind::real:
+      case kind::timespan:
+      case kind::timestamp:
+      case kind::string:
+      case kind::pattern:
+        swap_bytes<uint64_t>(ptr);
+        break;
+      case kind::port:
+        swap_bytes<uint16_t>(ptr);
+        break;
+      case kind::enumeration:
+        swap_bytes<enumeration>(ptr);
+        break;
+    }
+  }
+}
+
+void from_little_endian(record_layout const& layout, char* block) {
+  // Swapping bytes is its own inverse.
+  to_little_endian(layout, block);
+}
+
+expected<packed_record> pack(record_layout const& layout, vector const& xs,
+                             detail::monotonic_arena& a) {
+  packed_record::builder b{layout};
+  return pack(b, xs, a);
+}
+
+expected<packed_record> pack(packed_record::builder& b, vector const& xs,
+                             detail::monotonic_arena& a) {
+  auto result = pack(b, get<record_type>(b.layout().type()), xs);
+  if (!result) {
+    b.reset();
+    return result.error();
+  }
+  return b.finish(a);
+}
+
+} // namespace vast
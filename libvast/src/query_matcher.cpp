@@ -0,0 +1,266 @@
+#include <algorithm>
+
+#include "vast/event.hpp"
+#include "vast/expression_visitors.hpp"
+#include "vast/query_matcher.hpp"
+#include "vast/subnet.hpp"
+
+#include "vast/detail/assert.hpp"
+
+namespace vast {
+namespace {
+
+// Tailors a query to an event type. The result is empty if the query does
+// not apply to the type.
+expression resolve(expression const& expr, type const& t) {
+  auto resolved = visit(type_resolver{t}, expr);
+  if (!resolved)
+    return {};
+  return visit(type_pruner{t}, *resolved);
+}
+
+} // namespace <anonymous>
+
+auto query_matcher::add(expression expr) -> query_id {
+  auto id = next_++;
+  invalidate(expr);
+  queries_.emplace(id, std::move(expr));
+  return id;
+}
+
+bool query_matcher::erase(query_id id) {
+  auto i = queries_.find(id);
+  if (i == queries_.end())
+    return false;
+  invalidate(i->second);
+  queries_.erase(i);
+  return true;
+}
+
+size_t query_matcher::size() const {
+  return queries_.size();
+}
+
+bool query_matcher::empty() const {
+  return queries_.empty();
+}
+
+void query_matcher::match(event const& e, std::vector<query_id>& result) {
+  if (queries_.empty())
+    return;
+  auto& p = compile(e.type());
+  if (p.predicates.empty())
+    return;
+  // Instead of resetting the outcome of all predicates for every event, we
+  // consider a predicate true iff its stamp equals the current epoch.
+  ++p.epoch;
+  hits_.clear();
+  auto mark = [&](size_t i) {
+    if (p.stamps[i] != p.epoch) {
+      p.stamps[i] = p.epoch;
+      hits_.push_back(i);
+    }
+  };
+  for (auto& f : p.fields) {
+    auto x = f.off.empty() ? &e.data() : get(e.data(), f.off);
+    if (!x)
+      continue;
+    if (!f.equal.empty()) {
+      auto i = f.equal.find(*x);
+      if (i != f.equal.end())
+        for (auto j : i->second)
+          mark(j);
+    }
+    if (!f.subnets.empty()) {
+      if (auto addr = get_if<address>(*x)) {
+        for (auto& s : f.subnets) {
+          auto network = *addr;
+          network.mask(s.first);
+          auto i = s.second.find(network);
+          if (i != s.second.end())
+            for (auto j : i->second)
+              mark(j);
+        }
+      }
+    }
+  }
+  event_evaluator evaluator{e};
+  for (auto i : p.generic)
+    if (evaluator(p.predicates[i]))
+      mark(i);
+  // A program can only hold if one of its predicates does, except for the
+  // unconditional ones.
+  auto execute = [&](size_t i) {
+    if (p.runs[i] == p.epoch)
+      return;
+    p.runs[i] = p.epoch;
+    auto& prog = p.programs[i];
+    if (run(p, prog.code.data()))
+      result.push_back(prog.id);
+  };
+  for (auto i : hits_) {
+    result.insert(result.end(), p.direct[i].begin(), p.direct[i].end());
+    for (auto j : p.triggers[i])
+      execute(j);
+  }
+  for (auto i : p.unconditional)
+    execute(i);
+}
+
+void query_matcher::invalidate(expression const& expr) {
+  // Plans get recompiled lazily when the next event of their type arrives.
+  auto i = plans_.begin();
+  while (i != plans_.end())
+    if (is<none>(resolve(expr, i->first)))
+      ++i;
+    else
+      i = plans_.erase(i);
+}
+
+auto query_matcher::compile(type const& t) -> plan& {
+  auto& p = plans_[t];
+  if (p)
+    return *p;
+  p = std::make_unique<plan>();
+  std::unordered_map<predicate, size_t> index;
+  auto field = [&](offset const& off) -> field_matcher& {
+    auto pred = [&](auto& x) { return x.off == off; };
+    auto i = std::find_if(p->fields.begin(), p->fields.end(), pred);
+    if (i != p->fields.end())
+      return *i;
+    p->fields.push_back({off, {}, {}});
+    return p->fields.back();
+  };
+  // Assigns each distinct predicate an index and files it under the
+  // cheapest way to evaluate it.
+  auto intern = [&](predicate const& pred) -> size_t {
+    auto i = index.find(pred);
+    if (i != index.end())
+      return i->second;
+    auto n = p->predicates.size();
+    index.emplace(pred, n);
+    p->predicates.push_back(pred);
+    p->direct.emplace_back();
+    auto dx = get_if<data_extractor>(pred.lhs);
+    auto rhs = get_if<data>(pred.rhs);
+    if (dx && rhs) {
+      if (pred.op == equal && (is<address>(*rhs) || is<subnet>(*rhs)
+                               || is<std::string>(*rhs))) {
+        field(dx->offset).equal[*rhs].push_back(n);
+        return n;
+      }
+      if (pred.op == in) {
+        if (auto sn = get_if<subnet>(*rhs)) {
+          // Masking counts prefix bits relative to the IPv6 bit width.
+          auto length = sn->network().is_v4() ? sn->length() + 96u
+                                              : sn->length() + 0u;
+          field(dx->offset).subnets[length][sn->network()].push_back(n);
+          return n;
+        }
+      }
+    }
+    p->generic.push_back(n);
+    return n;
+  };
+  // Translates an expression into prefix notation.
+  struct compiler {
+    using code_type = std::vector<program::instruction>;
+
+    void operator()(none) {
+      VAST_ASSERT(!"pruned expressions cannot be empty");
+    }
+
+    void operator()(conjunction const& c) {
+      emit(program::op_and, c.size(), c);
+    }
+
+    void operator()(disjunction const& d) {
+      emit(program::op_or, d.size(), d);
+    }
+
+    void operator()(negation const& n) {
+      auto pos = code.size();
+      code.push_back({program::op_not, 1, 0});
+      visit(*this, n.expr());
+      code[pos].size = static_cast<uint32_t>(code.size() - pos);
+    }
+
+    void operator()(predicate const& pred) {
+      auto i = static_cast<uint32_t>(intern(pred));
+      code.push_back({program::op_pred, i, 1});
+    }
+
+    void emit(program::opcode op, size_t n,
+              std::vector<expression> const& xs) {
+      auto pos = code.size();
+      code.push_back({op, static_cast<uint32_t>(n), 0});
+      for (auto& x : xs)
+        visit(*this, x);
+      code[pos].size = static_cast<uint32_t>(code.size() - pos);
+    }
+
+    decltype(intern)& intern;
+    code_type& code;
+  };
+  for (auto& q : queries_) {
+    auto pruned = resolve(q.second, t);
+    if (is<none>(pruned))
+      continue; // The query doesn't apply to this type.
+    program prog{q.first, {}};
+    visit(compiler{intern, prog.code}, pruned);
+    // Queries consisting of a single predicate don't need a program. We
+    // report them directly when their predicate holds.
+    if (prog.code.size() == 1)
+      p->direct[prog.code[0].arg].push_back(q.first);
+    else
+      p->programs.push_back(std::move(prog));
+  }
+  // With all stamps behind the epoch, all predicates are false. A program
+  // that holds nonetheless must run for every event.
+  p->stamps.resize(p->predicates.size(), 0);
+  p->runs.resize(p->programs.size(), 0);
+  p->triggers.resize(p->predicates.size());
+  p->epoch = 1;
+  for (auto i = 0u; i < p->programs.size(); ++i) {
+    auto& code = p->programs[i].code;
+    if (run(*p, code.data())) {
+      p->unconditional.push_back(i);
+      continue;
+    }
+    for (auto& x : code)
+      if (x.op == program::op_pred) {
+        auto& ts = p->triggers[x.arg];
+        if (ts.empty() || ts.back() != i)
+          ts.push_back(i);
+      }
+  }
+  return *p;
+}
+
+bool query_matcher::run(plan const& p, program::instruction const* code) {
+  switch (code->op) {
+    default:
+      VAST_ASSERT(!"missing case");
+      return false;
+    case program::op_pred:
+      return p.stamps[code->arg] == p.epoch;
+    case program::op_not:
+      return !run(p, code + 1);
+    case program::op_and: {
+      auto x = code + 1;
+      for (auto i = 0u; i < code->arg; ++i, x += x->size)
+        if (!run(p, x))
+          return false;
+      return true;
+    }
+    case program::op_or: {
+      auto x = code + 1;
+      for (auto i = 0u; i < code->arg; ++i, x += x->size)
+        if (run(p, x))
+          return true;
+      return false;
+    }
+  }
+}
+
+} // namespace vast
@@ -26,7 +26,7 @@ optional<schema> schema::merge(schema const& s1, schema const& s2) {
 bool schema::add(type const& t) {
   if (is<none_type>(t) || t.name().empty() || find(t.name()))
     return false;
-  types_.push_back(std::move(t));
+  types_.push_back(intern(t));
   return true;
 }
 
@@ -1,8 +1,13 @@
 #include <algorithm>
+#include <limits>
+#include <string>
+#include <unordered_set>
 
 #include "vast/logger.hpp"
 
 #include "vast/batch.hpp"
+#include "vast/concept/parseable/numeric/integral.hpp"
+#include "vast/concept/parseable/to.hpp"
 #include "vast/concept/printable/stream.hpp"
 #include "vast/concept/printable/to_string.hpp"
 #include "vast/concept/printable/vast/error.hpp"
@@ -34,12 +39,27 @@ void segment::add(batch&& b) {
   batches_.emplace(min, std::move(b));
 }
 
+expected<std::vector<event>> segment::extract(bitmap const& bm) const {
+  std::vector<event> result;
+  auto f = [&](std::vector<event> xs) {
+    result.reserve(result.size() + xs.size());
+    std::move(xs.begin(), xs.end(), std::back_inserter(result));
+  };
+  auto r = extract(bm, std::numeric_limits<size_t>::max(), f);
+  if (!r)
+    return r.error();
+  return result;
+}
+
 // FIXME: this algorithm is not very efficient. It operates in O(MN) time where
 // M is the number of batches and N the size of the bitmap. Conceptually,
 // there's a straight-forward O(log M * N) or even O(N) algorithm by walking
 // through the query bitmap in lock-step with the batches.
-expected<std::vector<event>> segment::extract(bitmap const& bm) const {
-  std::vector<event> result;
+expected<void> segment::extract(bitmap const& bm, size_t chunk_size,
+                                std::function<void(std::vector<event>)> f)
+const {
+  VAST_ASSERT(chunk_size > 0);
+  std::vector<event> chunk;
   auto min = select(bm, 1);
   auto max = select(bm, -1);
   // FIXME: what we really want here is detail::range_map, but it's currently
@@ -53,11 +73,38 @@ expected<std::vector<event>> segment::extract(bitmap const& bm) const {
     batch::reader reader{begin->second};
     auto xs = reader.read(bm);
     if (!xs)
-      return xs;
-    result.reserve(result.size() + xs->size());
-    std::move(xs->begin(), xs->end(), std::back_inserter(result));
+      return xs.error();
+    for (auto& x : *xs) {
+      chunk.push_back(std::move(x));
+      if (chunk.size() == chunk_size) {
+        f(std::move(chunk));
+        chunk.clear();
+      }
+    }
   }
-  return result;
+  if (!chunk.empty())
+    f(std::move(chunk));
+  return {};
+}
+
+expected<void> segment::recompress(codec c) {
+  uint64_t n = 0;
+  for (auto& x : batches_) {
+    batch::reader reader{x.second};
+    auto xs = reader.read();
+    if (!xs)
+      return xs.error();
+    batch::writer writer{c};
+    for (auto& e : *xs)
+      if (!writer.write(e))
+        return make_error(ec::unspecified, "failed to write event");
+    auto b = writer.seal();
+    b.ids(x.second.ids());
+    n += bytes(b);
+    x.second = std::move(b);
+  }
+  bytes_ = n;
+  return {};
 }
 
 uuid const& segment::id() const {
@@ -70,106 +117,397 @@ uint64_t bytes(segment const& s) {
 
 namespace {
 
-template <class Actor>
-expected<void> flush_active_segment(Actor* self) {
-  VAST_DEBUG(self, "flushes current segment", self->state.active.id());
-  // Don't touch filesystem if we have nothing to do.
-  if (bytes(self->state.active) == 0)
-    return {};
-  // Write segment to file system.
-  if (!exists(self->state.dir)) {
-    auto result = mkdir(self->state.dir);
-    if (!result)
-      return result.error();
-  }
-  auto id = self->state.active.id();
-  auto filename = self->state.dir / to_string(id);
-  auto start = steady_clock::now();
-  auto result = save(filename, segment::magic, segment::version,
-                     self->state.active);
+// Loads a segment from the file system.
+expected<segment> load_segment(path const& filename) {
+  segment::magic_type m;
+  segment::version_type v;
+  segment seg;
+  auto result = load(filename, m, v, seg);
   if (!result)
     return result.error();
-  if (self->state.accountant) {
-    auto stop = steady_clock::now();
-    auto unit = duration_cast<microseconds>(stop - start).count();
-    auto rate = bytes(self->state.active) * 1e6 / unit;
-    self->send(self->state.accountant, "archive.flush.rate", rate);
+  if (m != segment::magic)
+    return make_error(ec::unspecified, "segment magic error");
+  if (v < segment::version)
+    return make_error(ec::version_error, v, segment::version);
+  return seg;
+}
+
+// The meta data of a shard, i.e., the ID ranges of its segments.
+path meta_filename(path const& dir, size_t shard) {
+  return dir / ("meta-" + std::to_string(shard));
+}
+
+#ifdef VAST_HAVE_ZSTD
+// The maximum size of a trained dictionary. Zstandard recommends about 100
+// times more sample data than the dictionary size.
+constexpr size_t dictionary_size = 16 << 10;
+constexpr size_t dictionary_sample_bytes = 100 * dictionary_size;
+
+// The file name of a dictionary.
+path dictionary_filename(path const& dir, uint32_t id) {
+  return dir / ("dict-" + std::to_string(id));
+}
+#endif // VAST_HAVE_ZSTD
+
+// Removes segments from a map of ID ranges.
+void erase_segments(detail::range_map<event_id, uuid>& segments,
+                    std::unordered_set<uuid> const& xs) {
+  std::vector<std::pair<event_id, event_id>> ranges;
+  for (auto& x : segments)
+    if (xs.count(x.value) > 0)
+      ranges.emplace_back(x.left, x.right);
+  for (auto& r : ranges)
+    segments.erase(r.first, r.second);
+}
+
+// Per-segment summary statistics of a shard, which drive tiering.
+struct segment_synopsis {
+  timestamp last = timestamp::min(); // of the most recent event
+  uint64_t bytes = 0;
+  bool cold = false;
+};
+
+template <class Inspector>
+auto inspect(Inspector& f, segment_synopsis& x) {
+  return f(x.last, x.bytes, x.cold);
+}
+
+// Serialized events of a single type, for training a dictionary.
+struct dictionary_samples {
+  std::vector<char> bytes;
+  std::vector<size_t> sizes;
+};
+
+struct shard_state {
+  path dir;
+  size_t id;
+  uint64_t max_segment_size;
+  codec method;
+  bool train;
+  // The dictionary per event type, where 0 indicates a failed training.
+  std::unordered_map<type, uint32_t> dictionaries;
+  std::unordered_map<type, dictionary_samples> samples;
+  detail::range_map<event_id, uuid> segments;
+  std::unordered_map<uuid, segment_synopsis> synopses;
+  segment active;
+  timestamp active_last = timestamp::min();
+  // Flushed segments, until their write completes.
+  std::unordered_map<uuid, segment> flushing;
+  // Segments deleted by the retention policy.
+  std::unordered_set<uuid> expired;
+  detail::cache<uuid, segment> cache;
+  tiering_policy policy;
+  filesystem_type filesystem;
+  accountant_type accountant;
+  char const* name = "archive-shard";
+};
+
+using shard_pointer = stateful_actor<shard_state>*;
+
+// Resolves the file of a segment, which lives either in the directory of the
+// archive or in the cold tier. Without a synopsis, e.g., for a segment of a
+// shard that no longer exists, we look for the file in both places.
+path segment_path(shard_pointer self, uuid const& id) {
+  auto& st = self->state;
+  auto hot = st.dir / to_string(id);
+  auto i = st.synopses.find(id);
+  if (i != st.synopses.end())
+    return i->second.cold ? st.policy.cold_dir / to_string(id) : hot;
+  if (!st.policy.cold_dir.empty() && !exists(hot))
+    return st.policy.cold_dir / to_string(id);
+  return hot;
+}
+
+// Serializes the meta data of a shard. The meta data must only refer to
+// segments on disk, so we leave out the active segment and those whose write
+// is still pending.
+expected<void> save_meta(std::vector<char>& bytes, shard_state const& st) {
+  auto segments = st.segments;
+  auto synopses = st.synopses;
+  std::unordered_set<uuid> pending{st.active.id()};
+  for (auto& x : st.flushing) {
+    pending.insert(x.first);
+    synopses.erase(x.first);
   }
-  VAST_DEBUG(self, "wrote active segment to", filename.trim(-3));
-  self->state.cache.emplace(id, std::move(self->state.active));
-  self->state.active = {};
-  // Update meta data on filessytem.
-  auto t = save(self->state.dir / "meta", self->state.segments);
-  if (!t)
-    return t.error();
-  VAST_DEBUG(self, "updated persistent meta data");
-  return {};
+  erase_segments(segments, pending);
+  return save(bytes, segments, synopses);
 }
 
-using flush_promise = typed_response_promise<ok_atom>;
-using lookup_promise = typed_response_promise<std::vector<event>>;
+// Writes the active segment and the meta data of the shard to the file system
+// and invokes *f* with the outcome. Until its write completes, the segment
+// stays in memory to answer lookups. We write the meta data only after the
+// segment, so that it never refers to a segment that doesn't exist.
+template <class F>
+void flush_active_segment(shard_pointer self, F f) {
+  auto& st = self->state;
+  VAST_DEBUG(self, "flushes current segment", st.active.id());
+  // Don't touch filesystem if we have nothing to do.
+  if (bytes(st.active) == 0) {
+    f(expected<void>{});
+    return;
+  }
+  std::vector<char> data;
+  auto result = save(data, segment::magic, segment::version, st.active);
+  if (!result) {
+    f(std::move(result));
+    return;
+  }
+  auto id = st.active.id();
+  auto filename = st.dir / to_string(id);
+  auto size = bytes(st.active);
+  st.synopses[id] = {st.active_last, size, false};
+  st.active_last = timestamp::min();
+  auto start = steady_clock::now();
+  st.flushing.emplace(id, std::move(st.active));
+  st.active = {};
+  auto written = [=](expected<void> x) mutable {
+    auto& st = self->state;
+    auto i = st.flushing.find(id);
+    VAST_ASSERT(i != st.flushing.end());
+    if (!x) {
+      VAST_ERROR(self, "failed to write segment", id << ':',
+                 self->system().render(x.error()));
+      st.flushing.erase(i);
+      st.synopses.erase(id);
+      f(std::move(x));
+      return;
+    }
+    if (st.accountant) {
+      auto stop = steady_clock::now();
+      auto unit = duration_cast<microseconds>(stop - start).count();
+      auto rate = size * 1e6 / unit;
+      self->send(st.accountant, "archive.flush.rate", rate);
+    }
+    VAST_DEBUG(self, "wrote segment to", filename.trim(-3));
+    st.cache.emplace(id, std::move(i->second));
+    st.flushing.erase(i);
+    std::vector<char> meta;
+    auto result = save_meta(meta, st);
+    if (!result) {
+      f(std::move(result));
+      return;
+    }
+    submit(self, st.filesystem, write_atom::value,
+           meta_filename(st.dir, st.id), std::move(meta), f);
+  };
+  submit(self, st.filesystem, write_atom::value, filename, std::move(data),
+         written);
+}
 
-} // namespace <anonymous>
+#ifdef VAST_HAVE_ZSTD
+// Collects samples of events whose type has no dictionary yet, and trains a
+// dictionary once we have enough samples. Dictionaries go to the same
+// directory as the segments, so that a dictionary is always on disk before
+// the segments that need it.
+void train(shard_pointer self, std::vector<event> const& events) {
+  auto& st = self->state;
+  for (auto& e : events) {
+    if (st.dictionaries.count(e.type()) > 0)
+      continue;
+    auto& s = st.samples[e.type()];
+    auto before = s.bytes.size();
+    if (!save(s.bytes, e.timestamp(), e.data()))
+      continue;
+    s.sizes.push_back(s.bytes.size() - before);
+    if (s.bytes.size() < dictionary_sample_bytes)
+      continue;
+    auto& id = st.dictionaries[e.type()];
+    auto dict = zstd::train_dictionary(s.bytes, s.sizes, dictionary_size);
+    st.samples.erase(e.type());
+    if (!dict) {
+      VAST_WARNING(self, "failed to train dictionary for", e.type().name()
+                   << ':', self->system().render(dict.error()));
+      continue;
+    }
+    auto x = zstd::add_dictionary(*dict);
+    if (!x) {
+      VAST_WARNING(self, "failed to add dictionary for", e.type().name()
+                   << ':', self->system().render(x.error()));
+      continue;
+    }
+    id = *x;
+    VAST_DEBUG(self, "trained dictionary", id, "for", e.type().name());
+    auto filename = dictionary_filename(st.dir, id);
+    submit(self, st.filesystem, write_atom::value, filename, std::move(*dict),
+           [=](expected<void> result) {
+             if (!result)
+               VAST_ERROR(self, "failed to write dictionary", id << ':',
+                          self->system().render(result.error()));
+           });
+  }
+}
+#endif // VAST_HAVE_ZSTD
 
-archive_type::behavior_type
-archive(archive_type::stateful_pointer<archive_state> self,
-        path dir, size_t capacity, size_t max_segment_size) {
-  VAST_ASSERT(max_segment_size > 0);
+// Applies the tiering policy to the flushed segments of a shard: deletes the
+// oldest ones while they exceed the retention limits and moves the remaining
+// ones to the cold tier once they are old enough. Since the shard runs in its
+// own thread, we copy segments synchronously. Afterwards, the shard persists
+// its meta data and only then removes the obsolete files. Returns the deleted
+// segments and the number of moved segments.
+std::pair<std::vector<uuid>, size_t> tier(shard_pointer self) {
+  auto& st = self->state;
+  auto& policy = st.policy;
+  auto now = time_point_cast<timespan>(timestamp::clock::now());
+  std::vector<std::pair<timestamp, uuid>> xs;
+  auto total = uint64_t{0};
+  for (auto& x : st.synopses) {
+    total += x.second.bytes;
+    if (st.flushing.count(x.first) == 0)
+      xs.emplace_back(x.second.last, x.first);
+  }
+  std::sort(xs.begin(), xs.end());
+  // Delete the oldest segments first.
+  std::vector<uuid> expired;
+  std::vector<path> obsolete;
+  auto i = xs.begin();
+  for (; i != xs.end(); ++i) {
+    auto too_old = older_than(i->first, policy.max_age, now);
+    auto too_big = policy.max_bytes > 0 && total > policy.max_bytes;
+    if (!too_old && !too_big)
+      break;
+    VAST_DEBUG(self, "deletes segment", i->second);
+    obsolete.push_back(segment_path(self, i->second));
+    total -= st.synopses[i->second].bytes;
+    st.synopses.erase(i->second);
+    st.cache.erase(i->second);
+    st.expired.insert(i->second);
+    expired.push_back(i->second);
+  }
+  if (!expired.empty())
+    erase_segments(st.segments, {expired.begin(), expired.end()});
+  // Move the remaining old segments to the cold tier.
+  size_t moved = 0;
+  if (!policy.cold_dir.empty())
+    for (; i != xs.end(); ++i) {
+      if (!older_than(i->first, policy.cold_after, now))
+        break;
+      auto& synopsis = st.synopses[i->second];
+      if (synopsis.cold)
+        continue;
+      auto hot = st.dir / to_string(i->second);
+      auto seg = load_segment(hot);
+      auto result = seg ? expected<void>{} : expected<void>{seg.error()};
+      if (result && policy.recompress)
+        result = seg->recompress(policy.cold_codec);
+      std::vector<char> data;
+      if (result)
+        result = save(data, segment::magic, segment::version, *seg);
+      if (result)
+        result = replace_file(policy.cold_dir / to_string(i->second), data);
+      if (!result) {
+        VAST_ERROR(self, "failed to move segment", i->second << ':',
+                   self->system().render(result.error()));
+        break;
+      }
+      VAST_DEBUG(self, "moved segment", i->second, "to", policy.cold_dir);
+      synopsis.cold = true;
+      synopsis.bytes = bytes(*seg);
+      if (st.cache.find(i->second) != st.cache.end()) {
+        st.cache.erase(i->second);
+        st.cache.emplace(i->second, std::move(*seg));
+      }
+      obsolete.push_back(hot);
+      ++moved;
+    }
+  if (obsolete.empty())
+    return {std::move(expired), moved};
+  std::vector<char> meta;
+  auto result = save_meta(meta, st);
+  if (!result) {
+    VAST_ERROR(self, "failed to save meta data:",
+               self->system().render(result.error()));
+    return {std::move(expired), moved};
+  }
+  submit(self, st.filesystem, write_atom::value, meta_filename(st.dir, st.id),
+         std::move(meta), [=](expected<void> x) {
+           if (!x) {
+             // The meta data on disk still refers to the obsolete files,
+             // which we therefore keep.
+             VAST_ERROR(self, "failed to write meta data:",
+                        self->system().render(x.error()));
+             return;
+           }
+           for (auto& p : obsolete)
+             rm(p);
+         });
+  return {std::move(expired), moved};
+}
+
+// Compresses events into segments and extracts events from them. Each shard
+// owns the segments it creates and caches the segments it is responsible
+// for.
+behavior archive_shard(shard_pointer self, path dir, size_t id,
+                       size_t capacity, size_t max_segment_size,
+                       codec method, bool dictionaries,
+                       tiering_policy policy) {
   self->state.dir = std::move(dir);
+  self->state.id = id;
   self->state.max_segment_size = max_segment_size;
+  self->state.method = method;
+  self->state.train = dictionaries;
+  self->state.policy = std::move(policy);
+  self->state.filesystem = get_filesystem(self->system());
+  if (auto a = self->system().registry().get(accountant_atom::value))
+    self->state.accountant = actor_cast<accountant_type>(a);
   self->state.cache.capacity(capacity);
   self->state.cache.on_evict(
-    [=](uuid& id, segment&) {
-      VAST_DEBUG(self, "evicts cache entry: segment", id);
+    [=](uuid& x, segment&) {
+      VAST_DEBUG(self, "evicts cache entry: segment", x);
     }
   );
-  // Load meta data about existing segments.
-  if (exists(self->state.dir / "meta")) {
-    auto t = load(self->state.dir / "meta", self->state.segments);
-    if (!t) {
-      VAST_ERROR(self, "failed to unarchive meta data:",
-                 self->system().render(t.error()));
-      self->quit(t.error());
+  auto meta = meta_filename(self->state.dir, id);
+  if (exists(meta)) {
+    auto result = load(meta, self->state.segments, self->state.synopses);
+    if (!result) {
+      // Older versions of the archive did not keep synopses.
+      self->state.segments.clear();
+      self->state.synopses.clear();
+      result = load(meta, self->state.segments);
+    }
+    if (!result) {
+      VAST_ERROR(self, "failed to load meta data:",
+                 self->system().render(result.error()));
+      self->quit(result.error());
+      return {};
     }
   }
+  // Persist the active segment before terminating along with the archive,
+  // regardless of the exit reason.
   self->set_exit_handler(
     [=](const exit_msg& msg) {
-      flush_active_segment(self);
-      self->quit(msg.reason);
+      flush_active_segment(self, [=](expected<void> result) {
+        if (!result)
+          VAST_ERROR(self, "failed to flush active segment:",
+                     self->system().render(result.error()));
+        self->quit(msg.reason);
+      });
     }
   );
-  // Register the accountant, if available.
-  auto acc = self->system().registry().get(accountant_atom::value);
-  if (acc) {
-    VAST_DEBUG(self, "registers accountant", acc);
-    self->state.accountant = actor_cast<accountant_type>(acc);
-  }
   return {
-    [=](std::vector<event> const& events) {
-      VAST_ASSERT(!events.empty());
-      // Ensure that all events have strictly monotonic IDs
-      auto non_monotonic = [](auto& x, auto& y) {
-        return x.id() != y.id() - 1;
-      };
-      auto valid = std::adjacent_find(events.begin(), events.end(),
-                                      non_monotonic) == events.end();
-      if (!valid) {
-        VAST_WARNING(self, "ignores", events.size(),
-                     "events with non-monotonic IDs");
-        return;
-      }
-      // Construct a batch from the events.
+    [=](std::vector<event> const& events) -> result<uuid> {
       auto first_id = events.front().id();
       auto last_id  = events.back().id();
       VAST_DEBUG(self, "got", events.size(),
                  "events [" << first_id << ',' << (last_id + 1) << ')');
+      // Construct a batch from the events, using the dictionary for the type
+      // of the first event, if available.
       auto start = steady_clock::now();
-      batch::writer writer{compression::lz4};
-      for (auto& e : events)
-        if (!writer.write(e)) {
-          self->quit(make_error(ec::unspecified, "failed to create batch"));
-          return;
-        }
+      auto method = self->state.method;
+#ifdef VAST_HAVE_ZSTD
+      if (self->state.train) {
+        train(self, events);
+        auto i = self->state.dictionaries.find(events.front().type());
+        if (i != self->state.dictionaries.end())
+          method.dictionary = i->second;
+      }
+#endif
+      batch::writer writer{method};
+      auto last = timestamp::min();
+      for (auto& e : events) {
+        if (!writer.write(e))
+          return make_error(ec::unspecified, "failed to create batch");
+        last = std::max(last, e.timestamp());
+      }
       auto b = writer.seal();
       b.ids(first_id, last_id + 1);
       auto stop = steady_clock::now();
@@ -186,25 +524,350 @@ archive(archive_type::stateful_pointer<archive_state> self,
       auto too_big = bytes(self->state.active) >= self->state.max_segment_size;
       auto empty = bytes(self->state.active) == 0;
       if (!empty && too_big) {
-        auto result = flush_active_segment(self);
-        if (!result) {
-          self->quit(result.error());
-          return;
-        }
+        flush_active_segment(self, [=](expected<void> result) {
+          if (!result) {
+            VAST_ERROR(self, "failed to flush active segment:",
+                       self->system().render(result.error()));
+            self->quit(result.error());
+          }
+        });
       }
       auto active_id = self->state.active.id();
       self->state.segments.inject(first_id, last_id + 1, active_id);
       self->state.active.add(std::move(b));
+      self->state.active_last = std::max(self->state.active_last, last);
+      return active_id;
     },
-    [=](flush_atom) -> flush_promise {
-      auto rp = self->make_response_promise<flush_promise>();
-      auto result = flush_active_segment(self);
-      if (!result) {
-        rp.deliver(result.error());
-        self->quit(result.error());
+    [=](flush_atom) {
+      auto rp = self->make_response_promise<ok_atom>();
+      flush_active_segment(self, [=](expected<void> result) mutable {
+        if (result)
+          rp.deliver(ok_atom::value);
+        else
+          rp.deliver(result.error());
+      });
+    },
+    [=](uuid const& x, bitmap const& bm, actor const& sink)
+    -> result<done_atom> {
+      auto& st = self->state;
+      auto s = static_cast<segment const*>(nullptr);
+      if (x == st.active.id()) {
+        VAST_DEBUG(self, "looking into active segment");
+        s = &st.active;
+      } else if (st.flushing.count(x) > 0) {
+        VAST_DEBUG(self, "looking into segment", x, "being written");
+        s = &st.flushing[x];
       } else {
-        rp.deliver(ok_atom::value);
+        auto i = st.cache.find(x);
+        if (i != st.cache.end()) {
+          VAST_DEBUG(self, "got cache hit for segment", x);
+        } else if (st.expired.count(x) > 0) {
+          VAST_DEBUG(self, "skips expired segment", x);
+          return done_atom::value;
+        } else {
+          VAST_DEBUG(self, "got cache miss for segment", x);
+          auto seg = load_segment(segment_path(self, x));
+          if (!seg)
+            return seg.error();
+          i = st.cache.emplace(x, std::move(*seg)).first;
+        }
+        s = &i->second;
       }
+      auto ship = [&](std::vector<event> xs) {
+        self->send(sink, std::move(xs));
+      };
+      auto result = s->extract(bm, archive_chunk_size, ship);
+      if (!result)
+        return result.error();
+      return done_atom::value;
+    },
+    [=](tier_atom) -> result<std::vector<uuid>, size_t> {
+      auto x = tier(self);
+      return {std::move(x.first), x.second};
+    },
+  };
+}
+
+// Selects the shard responsible for a segment. Shards own the segments in
+// their meta data. All others, e.g., those from a previous run with more
+// shards, we assign by hashing.
+template <class Actor>
+size_t shard_for(Actor* self, uuid const& id) {
+  auto i = self->state.owners.find(id);
+  if (i != self->state.owners.end())
+    return i->second;
+  return std::hash<uuid>{}(id) % self->state.shards.size();
+}
+
+// Removes a lookup and stops monitoring its sink after the last lookup of
+// the sink.
+template <class Actor, class Iterator>
+void finish(Actor* self, Iterator i) {
+  auto& sinks = self->state.sinks;
+  auto& sink = i->second.sink;
+  auto j = sinks.find(sink.address());
+  VAST_ASSERT(j != sinks.end());
+  if (--j->second == 0) {
+    self->demonitor(sink);
+    sinks.erase(j);
+  }
+  self->state.lookups.erase(i);
+}
+
+// Processes the candidate segments of a lookup with at most one segment per
+// shard in flight, and completes the lookup after the last segment.
+template <class Actor>
+void dispatch(Actor* self, uuid const& id) {
+  auto i = self->state.lookups.find(id);
+  if (i == self->state.lookups.end())
+    return; // The lookup got cancelled.
+  auto& lookup = i->second;
+  for (auto s = 0u; s < lookup.candidates.size(); ++s) {
+    auto& candidates = lookup.candidates[s];
+    if (lookup.busy[s] || candidates.empty())
+      continue;
+    auto c = candidates.back();
+    candidates.pop_back();
+    lookup.busy[s] = true;
+    ++lookup.inflight;
+    auto& shard = self->state.shards[s];
+    self->request(shard, infinite, c, lookup.ids, lookup.sink).then(
+      [=](done_atom) {
+        auto j = self->state.lookups.find(id);
+        if (j == self->state.lookups.end())
+          return;
+        j->second.busy[s] = false;
+        --j->second.inflight;
+        dispatch(self, id);
+      },
+      [=](const error& e) {
+        auto j = self->state.lookups.find(id);
+        if (j == self->state.lookups.end())
+          return;
+        VAST_ERROR(self, "failed to extract events from segment", c << ':',
+                   self->system().render(e));
+        j->second.promise.deliver(e);
+        finish(self, j);
+      }
+    );
+  }
+  if (lookup.inflight == 0) {
+    VAST_DEBUG(self, "completed lookup", id);
+    lookup.promise.deliver(done_atom::value);
+    finish(self, i);
+  }
+}
+
+// Starts a lookup by collecting the candidate segments, seeking through the
+// query bitmap and probing each ID interval. The lookup then involves only
+// the shards that own a candidate.
+template <class Actor>
+void start(Actor* self, uuid const& id) {
+  auto i = self->state.lookups.find(id);
+  if (i == self->state.lookups.end())
+    return;
+  auto& lookup = i->second;
+  auto n = self->state.shards.size();
+  lookup.candidates.resize(n);
+  lookup.busy.resize(n, false);
+  auto ones = select(lookup.ids);
+  auto j = self->state.segments.begin();
+  auto end = self->state.segments.end();
+  while (ones && j != end) {
+    if (ones.get() < j->left) {
+      // Bitmap must catch up, segment is ahead.
+      ones.skip(j->left - ones.get());
+    } else if (ones.get() < j->right) {
+      // Match: bitmap is within an existing segment.
+      lookup.candidates[shard_for(self, j->value)].push_back(j->value);
+      ones.skip(j->right - ones.get());
+      ++j;
+    } else {
+      // Segment must catch up, bitmap is ahead.
+      ++j;
+    }
+  }
+  // We process the candidates of each shard *in reverse order* to get maximum
+  // LRU cache hits, which dispatch() achieves by taking them from the back.
+  auto total = size_t{0};
+  for (auto& xs : lookup.candidates)
+    total += xs.size();
+  VAST_DEBUG(self, "processing", total, "candidates");
+  dispatch(self, id);
+}
+
+using flush_promise = typed_response_promise<ok_atom>;
+using lookup_promise = typed_response_promise<done_atom>;
+using tier_promise = typed_response_promise<size_t>;
+
+} // namespace <anonymous>
+
+archive_type::behavior_type
+archive(archive_type::stateful_pointer<archive_state> self,
+        path dir, size_t capacity, size_t max_segment_size, size_t shards,
+        codec method, bool dictionaries, tiering_policy policy) {
+  VAST_ASSERT(max_segment_size > 0);
+  VAST_ASSERT(shards > 0);
+  self->state.dir = std::move(dir);
+  self->state.policy = policy;
+  // Merge the meta data of all shards, including those of previous runs.
+  // Older versions of the archive wrote a single meta file.
+  if (exists(self->state.dir)) {
+    for (auto& p : directory{self->state.dir}) {
+      auto name = p.basename().str();
+      // Skip leftovers of interrupted writes, e.g., "meta-0.tmp".
+      auto is_meta = name == "meta" || (name.compare(0, 5, "meta-") == 0
+                                        && name.find('.') == std::string::npos);
+      if (!is_meta)
+        continue;
+      detail::range_map<event_id, uuid> segments;
+      auto t = load(p, segments);
+      if (!t) {
+        VAST_ERROR(self, "failed to unarchive meta data:",
+                   self->system().render(t.error()));
+        self->quit(t.error());
+        return {};
+      }
+      // The shard with the same number loads this file again and thereby
+      // owns its segments, including their location in the tiers.
+      auto shard = shards;
+      if (name != "meta")
+        if (auto n = to<size_t>(name.substr(5)))
+          shard = *n;
+      for (auto& x : segments) {
+        self->state.segments.inject(x.left, x.right, x.value);
+        if (shard < shards)
+          self->state.owners.emplace(x.value, shard);
+      }
+    }
+#ifdef VAST_HAVE_ZSTD
+    // Make the dictionaries of previous runs available for reading.
+    for (auto& p : directory{self->state.dir}) {
+      auto name = p.basename().str();
+      if (name.compare(0, 5, "dict-") != 0
+          || name.find('.') != std::string::npos)
+        continue;
+      auto dict = read_file(p);
+      auto id = dict ? zstd::add_dictionary(std::move(*dict))
+                     : expected<uint32_t>{dict.error()};
+      if (!id) {
+        VAST_ERROR(self, "failed to load dictionary", p.trim(-1) << ':',
+                   self->system().render(id.error()));
+        self->quit(id.error());
+        return {};
+      }
+    }
+#endif
+  }
+  // Spread the cache capacity over the shards.
+  auto shard_capacity = std::max(capacity / shards, size_t{1});
+  // Likewise, each shard enforces its share of the size limit.
+  if (policy.max_bytes > 0)
+    policy.max_bytes = std::max(policy.max_bytes / shards, uint64_t{1});
+  for (auto i = 0u; i < shards; ++i) {
+    auto s = self->spawn<detached + linked>(archive_shard, self->state.dir,
+                                            i, shard_capacity,
+                                            max_segment_size, method,
+                                            dictionaries, policy);
+    self->state.shards.push_back(s);
+  }
+  self->set_exit_handler(
+    [=](const exit_msg& msg) {
+      auto& shards = self->state.shards;
+      auto i = std::find(shards.begin(), shards.end(), msg.source);
+      if (i == shards.end()) {
+        // Let the shards persist their state before we terminate.
+        VAST_DEBUG(self, "terminates", shards.size(), "shards");
+        self->state.terminating = true;
+        self->state.exit_reason = msg.reason;
+        for (auto& s : shards)
+          self->send_exit(s, msg.reason);
+        if (shards.empty())
+          self->quit(msg.reason);
+        return;
+      }
+      shards.erase(i);
+      if (!self->state.terminating)
+        self->quit(msg.reason); // A shard failed.
+      else if (shards.empty())
+        self->quit(self->state.exit_reason);
+    }
+  );
+  self->set_down_handler(
+    [=](const down_msg& msg) {
+      // Cancel all lookups whose results would go nowhere.
+      auto& lookups = self->state.lookups;
+      for (auto i = lookups.begin(); i != lookups.end(); ) {
+        if (i->second.sink == msg.source) {
+          VAST_DEBUG(self, "cancels lookup", i->first);
+          i = lookups.erase(i);
+        } else {
+          ++i;
+        }
+      }
+      self->state.sinks.erase(msg.source);
+    }
+  );
+  if (policy.enabled())
+    self->delayed_anon_send(self, policy.interval, tier_atom::value);
+  return {
+    [=](std::vector<event>& events) {
+      VAST_ASSERT(!events.empty());
+      // Ensure that all events have strictly monotonic IDs
+      auto non_monotonic = [](auto& x, auto& y) {
+        return x.id() != y.id() - 1;
+      };
+      auto valid = std::adjacent_find(events.begin(), events.end(),
+                                      non_monotonic) == events.end();
+      if (!valid) {
+        VAST_WARNING(self, "ignores", events.size(),
+                     "events with non-monotonic IDs");
+        return;
+      }
+      // Distribute the batches over the shards, which compress them in
+      // parallel.
+      auto first_id = events.front().id();
+      auto last_id  = events.back().id();
+      auto n = self->state.next_shard++ % self->state.shards.size();
+      auto& shard = self->state.shards[n];
+      auto seq = self->state.next_batch++;
+      self->state.ingesting.insert(seq);
+      VAST_DEBUG(self, "relays", events.size(), "events to shard", n);
+      self->request(shard, infinite, std::move(events)).then(
+        [=](uuid const& id) {
+          auto& st = self->state;
+          st.segments.inject(first_id, last_id + 1, id);
+          st.owners.emplace(id, n);
+          st.ingesting.erase(seq);
+          // Start the lookups waiting for this batch.
+          while (!st.deferred.empty()
+                 && (st.ingesting.empty()
+                     || st.deferred.front().first <= *st.ingesting.begin())) {
+            auto lookup_id = st.deferred.front().second;
+            st.deferred.pop_front();
+            start(self, lookup_id);
+          }
+        },
+        [=](error& e) {
+          VAST_ERROR(self, "failed to archive events:",
+                     self->system().render(e));
+          self->quit(std::move(e));
+        }
+      );
+    },
+    [=](flush_atom) -> flush_promise {
+      auto rp = self->make_response_promise<flush_promise>();
+      auto n = std::make_shared<size_t>(self->state.shards.size());
+      for (auto& s : self->state.shards)
+        self->request(s, infinite, flush_atom::value).then(
+          [=](ok_atom) mutable {
+            if (--*n == 0)
+              rp.deliver(ok_atom::value);
+          },
+          [=](error& e) mutable {
+            rp.deliver(std::move(e));
+          }
+        );
       return rp;
     },
     [=](bitmap const& bm) -> lookup_promise {
@@ -212,78 +875,51 @@ archive(archive_type::stateful_pointer<archive_state> self,
       VAST_DEBUG(self, "got query for", rank(bm), "events in range ["
                  << select(bm, 1) << ',' << (select(bm, -1) + 1) << ')');
       auto rp = self->make_response_promise<lookup_promise>();
-      // Collect candidate segments by seeking through the query bitmap and
-      // probing each ID interval.
-      std::vector<uuid const*> candidates;
-      auto ones = select(bm);
-      auto i = self->state.segments.begin();
-      auto end = self->state.segments.end();
-      while (ones && i != end) {
-        if (ones.get() < i->left) {
-          // Bitmap must catch up, segment is ahead.
-          ones.skip(i->left - ones.get());
-        } else if (ones.get() < i->right) {
-          // Match: bitmap is within an existing segment.
-          candidates.push_back(&i->value);
-          ones.skip(i->right - ones.get());
-          ++i;
-        } else {
-          // Segment must catch up, bitmap is ahead.
-          ++i;
-        }
+      auto sink = actor_cast<actor>(self->current_sender());
+      if (!sink) {
+        rp.deliver(make_error(ec::unspecified, "no sink for lookup results"));
+        return rp;
       }
-      // Process candidates *in reverse order* to get maximum LRU cache hits.
-      std::vector<event> result;
-      VAST_DEBUG(self, "processing", candidates.size(), "candidates");
-      for (auto c = candidates.rbegin(); c != candidates.rend(); ++c) {
-        segment* s = nullptr;
-        // If the segment turns out to be the active segment, we can
-        // can query it immediately.
-        if (**c == self->state.active.id()) {
-          VAST_DEBUG(self, "looking into active segment");
-          s = &self->state.active;
-        } else {
-          // Otherwise we look into the cache.
-          auto i = self->state.cache.find(**c);
-          if (i != self->state.cache.end()) {
-            VAST_DEBUG(self, "got cache hit for segment", **c);
-            s = &i->second;
-          } else {
-            VAST_DEBUG(self, "got cache miss for segment", **c);
-            auto filename = self->state.dir / to_string(**c);
-            segment::magic_type m;
-            segment::version_type v;
-            segment seg;
-            auto result = load(filename, m, v, seg);
-            if (!result) {
-              rp.deliver(result.error());
-              return rp;
-            }
-            if (m != segment::magic) {
-              rp.deliver(make_error(ec::unspecified, "segment magic error"));
-              return rp;
-            }
-            if (v < segment::version) {
-              rp.deliver(make_error(ec::version_error, v, segment::version));
-              return rp;
+      auto id = uuid::random();
+      self->state.lookups.emplace(id, archive_lookup{bm, sink, {}, 0, rp});
+      // Monitor each sink only once, no matter how many lookups it has.
+      if (self->state.sinks[sink.address()]++ == 0)
+        self->monitor(sink);
+      // A lookup must see all batches that arrived before it, so we defer it
+      // until the shards have processed them.
+      if (self->state.ingesting.empty())
+        start(self, id);
+      else
+        self->state.deferred.emplace_back(self->state.next_batch, id);
+      return rp;
+    },
+    [=](tier_atom) -> tier_promise {
+      auto rp = self->make_response_promise<tier_promise>();
+      // Only the timer sends anonymous messages, which we answer by arming
+      // it again.
+      if (!self->current_sender())
+        self->delayed_anon_send(self, self->state.policy.interval,
+                                tier_atom::value);
+      auto n = std::make_shared<size_t>(self->state.shards.size());
+      auto total = std::make_shared<size_t>(0);
+      for (auto& s : self->state.shards)
+        self->request(s, infinite, tier_atom::value).then(
+          [=](std::vector<uuid> const& expired, size_t k) mutable {
+            auto& st = self->state;
+            if (!expired.empty()) {
+              VAST_DEBUG(self, "deleted", expired.size(), "segments");
+              erase_segments(st.segments, {expired.begin(), expired.end()});
+              for (auto& x : expired)
+                st.owners.erase(x);
             }
-            i = self->state.cache.emplace(**c, std::move(seg)).first;
-            s = &i->second;
+            *total += expired.size() + k;
+            if (--*n == 0)
+              rp.deliver(*total);
+          },
+          [=](error& e) mutable {
+            rp.deliver(std::move(e));
           }
-        }
-        // Perform lookup in segment and append extracted events to result.
-        VAST_ASSERT(s != nullptr);
-        auto xs = s->extract(bm);
-        if (!xs) {
-          VAST_ERROR(self, self->system().render(xs.error()));
-          rp.deliver(xs.error());
-          return rp;
-        }
-        result.reserve(result.size() + xs->size());
-        std::move(xs->begin(), xs->end(), std::back_inserter(result));
-      }
-      VAST_DEBUG(self, "delivers", result.size(), "events");
-      rp.deliver(std::move(result));
+        );
       return rp;
     },
   };
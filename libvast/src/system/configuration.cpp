@@ -44,6 +44,7 @@ configuration::configuration() {
   add_message_type<uuid>("vast::uuid");
   // Containers
   add_message_type<std::vector<event>>("std::vector<vast::event>");
+  add_message_type<std::vector<message>>("std::vector<caf::message>");
   // Actor-specific messages
   add_message_type<registry>("vast::system::registry");
   add_message_type<registry_entry>("vast::system::registry_entry");
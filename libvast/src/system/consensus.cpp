@@ -1,6 +1,17 @@
+#include "vast/config.hpp"
+
+#ifdef VAST_POSIX
+#  include <unistd.h>
+#endif
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+
 #include <caf/all.hpp>
 
 #include "vast/concept/parseable/numeric/integral.hpp"
+#include "vast/concept/parseable/to.hpp"
 #include "vast/concept/printable/std/chrono.hpp"
 #include "vast/die.hpp"
 #include "vast/error.hpp"
@@ -20,128 +31,317 @@ namespace vast {
 namespace system {
 namespace raft {
 
-log::log(path dir) : dir_{std::move(dir)} {
-  auto meta_filename = dir_ / "meta";
-  auto entries_filename = dir_ / "entries";
-  if (exists(dir_)) {
-    if (exists(meta_filename))
-      if (!load(meta_filename, start_))
-        die("failed to load raft log meta data");
-    if (exists(entries_filename)) {
-      std::ifstream entries{entries_filename.str(), std::ios::binary};
-      while (entries.peek() != std::ifstream::traits_type::eof()) {
-        std::vector<log_entry> xs;
-        if (!load(entries, xs))
-          die("failed to load raft log entries");
-        std::move(xs.begin(), xs.end(), std::back_inserter(entries_));
-      }
-    }
-  } else {
+namespace {
+
+// Each entry in a segment consists of this header followed by the entry
+// data.
+struct entry_header {
+  term_type term;
+  index_type index;
+  uint64_t size;
+};
+
+constexpr auto segment_prefix = "segment-";
+
+expected<void> truncate_file(path const& filename, uint64_t size) {
+#ifdef VAST_POSIX
+  if (::truncate(filename.str().c_str(), static_cast<off_t>(size)) != 0)
+    return make_error(ec::filesystem_error, "failed to truncate file",
+                      filename, std::strerror(errno));
+  return {};
+#else
+  return make_error(ec::filesystem_error, "truncation not supported");
+#endif
+}
+
+} // namespace <anonymous>
+
+log::log(path dir, uint64_t segment_size)
+  : segment_size_{segment_size},
+    dir_{std::move(dir)} {
+  VAST_ASSERT(segment_size_ > 0);
+  if (!exists(dir_)) {
     if (!mkdir(dir_))
       die("failed to create raft log directory");
+    if (!persist_meta_data())
+      die("failed to persist raft log meta data");
+    return;
   }
-}
-
-log_entry& log::first() {
-  VAST_ASSERT(!empty());
-  return entries_.front();
+  auto meta_filename = dir_ / "meta";
+  if (exists(meta_filename)) {
+    if (!load(meta_filename, start_))
+      die("failed to load raft log meta data");
+  } else if (!persist_meta_data()) {
+    die("failed to persist raft log meta data");
+  }
+  // Read the headers of all segments in the order of their first index.
+  std::vector<std::pair<index_type, path>> files;
+  for (auto& p : directory{dir_}) {
+    auto name = p.basename().str();
+    if (!detail::starts_with(name, segment_prefix))
+      continue;
+    if (auto first = to<index_type>(name.substr(std::strlen(segment_prefix))))
+      files.emplace_back(*first, p);
+  }
+  std::sort(files.begin(), files.end());
+  for (auto& file : files)
+    if (!load_segment(file.second, file.first))
+      die("failed to load raft log segment");
+  // Prior versions kept all entries in a single file, which we convert once.
+  auto entries_filename = dir_ / "entries";
+  if (exists(entries_filename) && !migrate(entries_filename))
+    die("failed to migrate raft log entries");
 }
 
 index_type log::first_index() const {
   return start_;
 }
 
-log_entry& log::last() {
-  VAST_ASSERT(!empty());
-  return entries_.back();
-}
-
 index_type log::last_index() const {
-  return start_ + entries_.size() - 1;
+  if (segments_.empty())
+    return start_ - 1;
+  auto& last = segments_.back();
+  return last.first + last.entries.size() - 1;
 }
 
 index_type log::truncate_before(index_type index) {
   if (index <= start_)
     return 0; // already truncated
-  auto n = std::min(index_type{entries_.size()}, index - start_);
+  auto n = std::min(last_index() + 1 - start_, index - start_);
   if (n > 0) {
-    entries_.erase(entries_.begin(), entries_.begin() + n);
     start_ += n;
-    // Persists meta data and entries.
+    // Persist the new start first, so that a crash while deleting segments
+    // cannot resurrect truncated entries.
     if (!persist_meta_data())
       die("failed to persist log meta data");
-    if (!persist_entries())
-      die("failed to persist log entries");
+    // Delete all segments whose entries precede the new start. The first
+    // remaining segment may still contain a few of them, which we skip.
+    while (!segments_.empty()) {
+      auto& seg = segments_.front();
+      if (seg.first + seg.entries.size() > start_)
+        break;
+      if (segments_.size() == 1)
+        active_.close();
+      if (!rm(segment_filename(seg.first)))
+        die("failed to delete log segment");
+      segments_.pop_front();
+    }
   }
   return n;
 }
 
 index_type log::truncate_after(index_type index) {
-  VAST_ASSERT(index >= start_);
-  if (index > last_index())
+  VAST_ASSERT(index + 1 >= start_);
+  auto last = last_index();
+  if (index >= last)
     return 0;
-  auto old_size = entries_.size();
-  auto new_size = index - start_ + 1;
-  VAST_ASSERT(new_size <= old_size);
-  if (new_size < old_size) {
-    entries_.resize(new_size);
-    if (!persist_entries())
-      die("failed to persist log entries");
+  active_.close();
+  // Delete all segments that begin after the index...
+  while (!segments_.empty() && segments_.back().first > index) {
+    if (!rm(segment_filename(segments_.back().first)))
+      die("failed to delete log segment");
+    segments_.pop_back();
   }
-  return old_size - new_size;
+  // ...and cut off the tail of the one containing it.
+  if (!segments_.empty()) {
+    auto& seg = segments_.back();
+    auto n = index + 1 - seg.first;
+    if (n < seg.entries.size()) {
+      seg.bytes = seg.entries[n].offset;
+      seg.entries.resize(n);
+      seg.chunk = nullptr;
+      if (!truncate_file(segment_filename(seg.first), seg.bytes))
+        die("failed to truncate log segment");
+    }
+  }
+  return last - index;
 }
 
-log_entry& log::at(index_type i) {
-  VAST_ASSERT(!empty());
-  VAST_ASSERT(i >= start_ && i - start_ < entries_.size());
-  return entries_[i - start_];
+term_type log::term(index_type i) const {
+  auto& seg = locate(i);
+  return seg.entries[i - seg.first].term;
+}
+
+log_entry log::at(index_type i) {
+  auto& seg = locate(i);
+  auto& meta = seg.entries[i - seg.first];
+  auto end = meta.offset + sizeof(entry_header) + meta.size;
+  // Map the segment on first access, and again if it has grown since.
+  if (!seg.chunk || seg.chunk->size() < end) {
+    seg.chunk = chunk::mmap(segment_filename(seg.first));
+    if (!seg.chunk || seg.chunk->size() < end)
+      die("failed to map log segment");
+  }
+  log_entry result;
+  result.term = meta.term;
+  result.index = i;
+  auto data = seg.chunk->data() + meta.offset + sizeof(entry_header);
+  result.data.assign(data, data + meta.size);
+  return result;
 }
 
 expected<void> log::append(std::vector<log_entry> xs) {
-  // Allocate persistent state on first entry.
-  if (!entries_file_.is_open()) {
-    auto entries_filename = dir_ / "entries";
-    auto flags = std::ios::app | std::ios::binary | std::ios::ate;
-    entries_file_.open(entries_filename.str(), flags);
-    if (!entries_file_)
-      return make_error(ec::filesystem_error, "failed to open log entry file");
-    if (!exists(dir_ / "meta")) {
-      auto res = persist_meta_data();
+  // We record the entries in the segment meta data only after they made it
+  // to the file system, so that a failed write leaves the log unchanged.
+  std::vector<char> buffer;
+  std::vector<entry_meta> pending;
+  auto write = [&]() -> expected<void> {
+    if (buffer.empty())
+      return {};
+    auto& seg = segments_.back();
+    active_.write(buffer.data(), buffer.size());
+    active_.flush();
+    if (!active_) {
+      // Discard whatever part of the buffer reached the file, and reopen the
+      // segment with the next append.
+      active_.close();
+      active_.clear();
+      auto filename = segment_filename(seg.first);
+      if (seg.entries.empty()) {
+        rm(filename);
+        segments_.pop_back();
+      } else {
+        truncate_file(filename, seg.bytes);
+      }
+      return make_error(ec::filesystem_error, "bad log segment", filename);
+    }
+    for (auto& x : pending) {
+      seg.entries.push_back(x);
+      seg.bytes += sizeof(entry_header) + x.size;
+    }
+    buffer.clear();
+    pending.clear();
+    return {};
+  };
+  for (auto& x : xs) {
+    if (segments_.empty()
+        || segments_.back().bytes + buffer.size() >= segment_size_) {
+      // Start a new segment.
+      auto res = write();
       if (!res)
         return res;
+      active_.close();
+      segments_.emplace_back();
+      segments_.back().first = last_index() + 1;
+    }
+    auto& seg = segments_.back();
+    if (!active_.is_open()) {
+      auto filename = segment_filename(seg.first);
+      active_.clear();
+      active_.open(filename.str(), std::ios::binary | std::ios::app);
+      if (!active_) {
+        active_.close();
+        active_.clear();
+        if (seg.entries.empty())
+          segments_.pop_back();
+        return make_error(ec::filesystem_error, "failed to open log segment",
+                          filename);
+      }
     }
+    entry_header hdr;
+    hdr.term = x.term;
+    hdr.index = seg.first + seg.entries.size() + pending.size();
+    hdr.size = x.data.size();
+    pending.push_back({x.term, seg.bytes + buffer.size(), x.data.size()});
+    auto ptr = reinterpret_cast<char const*>(&hdr);
+    buffer.insert(buffer.end(), ptr, ptr + sizeof(hdr));
+    buffer.insert(buffer.end(), x.data.begin(), x.data.end());
   }
-  // Serialize the entries...
-  auto res = save(entries_file_, xs);
-  if (!res)
-    return res;
-  // ...and make them persistent...
-  entries_file_.flush();
-  if (!entries_file_)
-    return make_error(ec::filesystem_error, "bad log entry file");
-  // ...before keeping 'em.
-  std::move(xs.begin(), xs.end(), std::back_inserter(entries_));
-  return {};
+  return write();
 }
 
 bool log::empty() const {
-  return entries_.empty();
+  return last_index() < start_;
 }
 
 uint64_t bytes(log& l) {
-  auto pos = l.entries_file_.tellp();
-  if (pos == -1)
-    return 0;
-  return static_cast<uint64_t>(pos);
+  auto result = uint64_t{0};
+  for (auto& seg : l.segments_)
+    result += seg.bytes;
+  return result;
 }
 
-expected<void> log::persist_meta_data() {
-  return save(dir_ / "meta", start_);
+log::segment& log::locate(index_type i) {
+  auto& seg = static_cast<log const*>(this)->locate(i);
+  return const_cast<segment&>(seg);
+}
+
+log::segment const& log::locate(index_type i) const {
+  VAST_ASSERT(i >= start_ && i <= last_index());
+  auto pred = [](index_type x, segment const& seg) { return x < seg.first; };
+  auto s = std::upper_bound(segments_.begin(), segments_.end(), i, pred);
+  VAST_ASSERT(s != segments_.begin());
+  return *--s;
 }
 
-expected<void> log::persist_entries() {
-  entries_file_.close();
-  return save(dir_ / "entries", entries_);
+path log::segment_filename(index_type first) const {
+  return dir_ / (segment_prefix + std::to_string(first));
+}
+
+expected<void> log::load_segment(path const& filename, index_type first) {
+  if (!segments_.empty() && last_index() + 1 != first)
+    return make_error(ec::unspecified, "non-contiguous log segment", filename);
+  segment seg;
+  seg.first = first;
+  auto chk = chunk::mmap(filename);
+  if (!chk)
+    return make_error(ec::filesystem_error, "failed to map file", filename);
+  while (seg.bytes + sizeof(entry_header) <= chk->size()) {
+    entry_header hdr;
+    std::memcpy(&hdr, chk->data() + seg.bytes, sizeof(hdr));
+    auto end = seg.bytes + sizeof(hdr) + hdr.size;
+    if (hdr.index != first + seg.entries.size() || end > chk->size())
+      break;
+    seg.entries.push_back({hdr.term, seg.bytes, hdr.size});
+    seg.bytes = end;
+  }
+  // A crash during an append leaves a partial entry at the end of the last
+  // segment, which never made it into the log.
+  if (seg.bytes < chk->size()) {
+    chk = nullptr;
+    auto res = truncate_file(filename, seg.bytes);
+    if (!res)
+      return res;
+  }
+  // A crash after truncating the prefix may have left segments behind that
+  // precede the start of the log.
+  if (first + seg.entries.size() <= start_) {
+    if (!rm(filename))
+      return make_error(ec::filesystem_error, "failed to delete", filename);
+    return {};
+  }
+  if (segments_.empty() && first > start_)
+    return make_error(ec::unspecified, "missing log segment before", filename);
+  segments_.push_back(std::move(seg));
+  return {};
+}
+
+expected<void> log::migrate(path const& filename) {
+  std::vector<log_entry> entries;
+  std::ifstream in{filename.str(), std::ios::binary};
+  while (in.peek() != std::ifstream::traits_type::eof()) {
+    std::vector<log_entry> xs;
+    auto res = load(in, xs);
+    if (!res)
+      return res;
+    std::move(xs.begin(), xs.end(), std::back_inserter(entries));
+  }
+  // Discard the segments of an interrupted migration.
+  active_.close();
+  for (auto& seg : segments_)
+    if (!rm(segment_filename(seg.first)))
+      return make_error(ec::filesystem_error, "failed to delete segment");
+  segments_.clear();
+  auto res = append(std::move(entries));
+  if (!res)
+    return res;
+  if (!rm(filename))
+    return make_error(ec::filesystem_error, "failed to delete", filename);
+  return {};
+}
+
+expected<void> log::persist_meta_data() {
+  return save(dir_ / "meta", start_);
 }
 
 namespace {
@@ -168,7 +368,7 @@ template <class Actor>
 term_type last_log_term(Actor* self) {
   if (self->state.log->empty())
     return self->state.last_snapshot_term;
-  return self->state.log->last().term;
+  return self->state.log->term(self->state.log->last_index());
 }
 
 // prints the server's role (for logging purposes)
@@ -224,6 +424,20 @@ peer_state* current_peer(Actor* self) {
   return &*p;
 }
 
+// Retrieves the peer state for a given server ID.
+template <class Actor>
+peer_state* find_peer(Actor* self, server_id id) {
+  auto f = [=](auto& x) { return x.id == id; };
+  auto p = std::find_if(self->state.peers.begin(), self->state.peers.end(), f);
+  return p == self->state.peers.end() ? nullptr : &*p;
+}
+
+template <class Actor>
+void replicate_to(Actor* self, peer_state& peer, bool heartbeat = false);
+
+template <class Actor>
+void serve_reads(Actor* self);
+
 // Picks a election timeout uniformly at random from [T, T * 2], where T is the
 // configured election timeout.
 template <class Actor>
@@ -243,12 +457,9 @@ void reset_election_time(Actor* self) {
   self->delayed_send(self, timeout, election_atom::value);
 }
 
-// Saves a state machine snapshot that represents all the applied state up to a
-// given index.
+// Checks whether we can take a snapshot at a given index.
 template <class Actor>
-result<index_type> save_snapshot(Actor* self, index_type index,
-                                 const std::vector<char>& snapshot) {
-  VAST_DEBUG(role(self), "creates snapshot of indices [1,", index << ']');
+expected<void> check_snapshot_index(Actor* self, index_type index) {
   VAST_ASSERT(index > 0);
   if (index == self->state.last_snapshot_index)
     return make_error(ec::unspecified, "ignores request to take redundant "
@@ -264,6 +475,17 @@ result<index_type> save_snapshot(Actor* self, index_type index,
   if (index > self->state.commit_index)
     return make_error(ec::unspecified, "cannot take snapshot of uncommitted "
                       "index", index);
+  return {};
+}
+
+// Starts writing a snapshot that represents all the applied state up to a
+// given index.
+template <class Actor>
+expected<void> begin_snapshot(Actor* self, index_type index) {
+  VAST_DEBUG(role(self), "creates snapshot of indices [1,", index << ']');
+  auto res = check_snapshot_index(self, index);
+  if (!res)
+    return res;
   // Request to snapshot is now guaranteed to fall within the window of our log.
   VAST_ASSERT(index >= self->state.log->first_index()
               && index <= self->state.log->last_index());
@@ -272,25 +494,87 @@ result<index_type> save_snapshot(Actor* self, index_type index,
   // operations at the same time.
   if (self->state.snapshot.is_open())
     return make_error(ec::unspecified, "snapshot delivery in progress");
-  // Write snapshot to file.
+  auto& out = self->state.local_snapshot;
+  if (out.is_open()) {
+    VAST_DEBUG(role(self), "abandons incomplete snapshot at index",
+               self->state.local_snapshot_index);
+    out.close();
+  }
+  // We write to a temporary file, so that a crash leaves the current
+  // snapshot intact and transfers to peers can continue reading it.
+  auto filename = self->state.dir / "snapshot.tmp";
+  out.open(filename.str(), std::ios::binary | std::ios::trunc);
+  if (!out)
+    return make_error(ec::filesystem_error, "failed to open", filename);
   snapshot_header hdr;
   hdr.last_included_index = index;
-  hdr.last_included_term = self->state.log->at(index).term;
-  auto result = save(self->state.dir / "snapshot", hdr, snapshot);
-  if (!result)
-    return result.error();
-  VAST_DEBUG(role(self), "completed snapshotting, last included term =",
-             hdr.last_included_term << ", index =", hdr.last_included_index);
-  VAST_ASSERT(self->state.log->first_index() <= hdr.last_included_index);
+  hdr.last_included_term = self->state.log->term(index);
+  self->state.local_snapshot_index = index;
+  self->state.local_snapshot_parts = 0;
+  return save(out, hdr);
+}
+
+// Appends a part of the state machine state to the snapshot in progress.
+template <class Actor>
+expected<void> write_snapshot_part(Actor* self, const std::vector<char>& part) {
+  auto& out = self->state.local_snapshot;
+  VAST_ASSERT(out.is_open());
+  auto res = save(out, part);
+  if (!res) {
+    out.close();
+    return res;
+  }
+  ++self->state.local_snapshot_parts;
+  return {};
+}
+
+// Makes the snapshot in progress the current one and discards the log
+// entries it covers.
+template <class Actor>
+result<index_type> finish_snapshot(Actor* self) {
+  auto index = self->state.local_snapshot_index;
+  auto tmp = self->state.dir / "snapshot.tmp";
+  auto& out = self->state.local_snapshot;
+  out.close();
+  if (!out)
+    return make_error(ec::filesystem_error, "failed to write", tmp);
+  // The log may have moved on while the state machine handed over the parts,
+  // e.g., because we installed a snapshot from the leader in the meantime.
+  auto res = check_snapshot_index(self, index);
+  if (!res) {
+    rm(tmp);
+    return res.error();
+  }
+  res = rename(tmp, self->state.dir / "snapshot");
+  if (!res)
+    return res.error();
   // Update (volatile) server state.
-  self->state.last_snapshot_index = hdr.last_included_index;
-  self->state.last_snapshot_term = hdr.last_included_term;
+  self->state.last_snapshot_index = index;
+  self->state.last_snapshot_term = self->state.log->term(index);
+  VAST_DEBUG(role(self), "completed snapshotting, last included term =",
+             self->state.last_snapshot_term << ", index =",
+             index << ", parts =", self->state.local_snapshot_parts);
   // Truncate now no longer needed entries.
   auto n = self->state.log->truncate_before(index + 1);
   VAST_DEBUG(role(self), "truncated", n, "log entries");
   return index;
 }
 
+// Saves a state machine snapshot that represents all the applied state up to a
+// given index.
+template <class Actor>
+result<index_type> save_snapshot(Actor* self, index_type index,
+                                 const std::vector<char>& snapshot) {
+  auto res = begin_snapshot(self, index);
+  if (res)
+    res = write_snapshot_part(self, snapshot);
+  if (!res) {
+    self->state.local_snapshot.close();
+    return res.error();
+  }
+  return finish_snapshot(self);
+}
+
 // Loads a snapshot header into memory and adapts the server state accordingly.
 template <class Actor>
 expected<void> load_snapshot_header(Actor* self) {
@@ -300,8 +584,9 @@ expected<void> load_snapshot_header(Actor* self) {
   auto result = load(self->state.dir / "snapshot", hdr);
   if (!result)
     return result.error();
-  if (hdr.version != 1)
-    return make_error(ec::version_error, "needed version 1, got", hdr.version);
+  if (hdr.version < 1 || hdr.version > 2)
+    return make_error(ec::version_error, "needed version 1 or 2, got",
+                      hdr.version);
   if (hdr.last_included_index < self->state.last_snapshot_index)
     return make_error(ec::unspecified, "stale snapshot");
   // Update actor state.
@@ -315,7 +600,7 @@ expected<void> load_snapshot_header(Actor* self) {
   // entry and both entries have different terms.
   if (self->state.log->last_index() < self->state.last_snapshot_index
       || (self->state.log->first_index() <= self->state.last_snapshot_index
-          && self->state.log->at(self->state.last_snapshot_index).term
+          && self->state.log->term(self->state.last_snapshot_index)
              != self->state.last_snapshot_term)) {
     VAST_DEBUG(role(self), "discards entire log");
     self->state.log->truncate_before(self->state.last_snapshot_index + 1);
@@ -324,46 +609,117 @@ expected<void> load_snapshot_header(Actor* self) {
   return {};
 }
 
-// Loads snapshot contents.
 template <class Actor>
-expected<std::vector<char>> load_snapshot_data(Actor* self) {
-  VAST_DEBUG(role(self), "loads snapshot data");
-  snapshot_header hdr;
+void deliver(Actor* self, index_type from, index_type to);
+
+// Sends the next part of the snapshot in delivery to the state machine. We
+// read and send the following part only after the state machine has applied
+// this one, and deliver the entries committed in the meantime after the last.
+template <class Actor>
+expected<void> deliver_snapshot_part(Actor* self, index_type index,
+                                     uint64_t part) {
+  auto& in = self->state.delivered_snapshot;
   std::vector<char> data;
-  auto result = load(self->state.dir / "snapshot", hdr, data);
-  if (!result)
-    return result.error();
-  if (hdr.version != 1)
-    return make_error(ec::version_error, "needed version 1, got", hdr.version);
-  return data;
+  auto res = load(in, data);
+  if (!res) {
+    in.close();
+    return res;
+  }
+  auto last = in.peek() == std::ifstream::traits_type::eof();
+  auto msg = make_message(snapshot_atom::value, index, part, std::move(data),
+                          last);
+  auto delivery = self->state.delivery;
+  self->request(self->state.state_machine, infinite, index, msg).then(
+    [=] {
+      auto& st = self->state;
+      // A newer snapshot may have superseded this one.
+      if (st.delivery != delivery)
+        return;
+      if (!last) {
+        auto res = deliver_snapshot_part(self, index, part + 1);
+        if (!res) {
+          VAST_ERROR(role(self), "failed to deliver snapshot:",
+                     self->system().render(res.error()));
+          self->quit(res.error());
+        }
+        return;
+      }
+      VAST_DEBUG(role(self), "delivered snapshot at index", index, "in",
+                 part + 1, "parts");
+      st.delivered_snapshot.close();
+      auto to = st.deferred_index;
+      st.deferred_index = 0;
+      if (to > index)
+        deliver(self, index + 1, to);
+    },
+    [=](error& e) {
+      auto& st = self->state;
+      if (st.delivery != delivery)
+        return;
+      VAST_ERROR(role(self), "failed to deliver snapshot part", part << ':',
+                 self->system().render(e));
+      st.delivered_snapshot.close();
+      st.deferred_index = 0;
+    }
+  );
+  return {};
 }
 
-// Sends a range of entries to the state machine.
+// Starts sending the parts of the current snapshot to the state machine, one
+// message per part, without reading the whole snapshot into memory at once.
+// A new delivery abandons the one in progress.
+template <class Actor>
+expected<void> deliver_snapshot(Actor* self) {
+  auto& st = self->state;
+  auto index = st.last_snapshot_index;
+  VAST_DEBUG(role(self), "delivers snapshot at index", index);
+  auto filename = st.dir / "snapshot";
+  auto& in = st.delivered_snapshot;
+  if (in.is_open()) {
+    VAST_DEBUG(role(self), "abandons delivery of prior snapshot");
+    in.close();
+  }
+  in.open(filename.str(), std::ios::binary);
+  if (!in)
+    return make_error(ec::filesystem_error, "failed to open", filename);
+  snapshot_header hdr;
+  auto res = load(in, hdr);
+  if (!res) {
+    in.close();
+    return res;
+  }
+  VAST_ASSERT(hdr.last_included_index == index);
+  ++st.delivery;
+  return deliver_snapshot_part(self, index, 0);
+}
+
+// Sends a range of entries to the state machine. While a snapshot delivery is
+// in progress, we defer the entries until the state machine has the snapshot.
 template <class Actor>
 void deliver(Actor* self, index_type from, index_type to) {
   VAST_ASSERT(from != 0 && to != 0);
-  if (!self->state.state_machine)
+  auto& st = self->state;
+  if (!st.state_machine)
     return;
-  if (from < self->state.log->first_index()) {
-    VAST_ASSERT(self->state.last_snapshot_index > 0);
-    auto snapshot = load_snapshot_data(self);
-    if (!snapshot) {
-      VAST_ERROR(role(self), "failed to load snapshot data",
-                 self->system().render(snapshot.error()));
-      self->quit(snapshot.error());
-      return;
+  if (from < st.log->first_index()) {
+    VAST_ASSERT(st.last_snapshot_index > 0);
+    st.deferred_index = std::max(st.deferred_index, to);
+    auto res = deliver_snapshot(self);
+    if (!res) {
+      VAST_ERROR(role(self), "failed to deliver snapshot",
+                 self->system().render(res.error()));
+      self->quit(res.error());
     }
-    VAST_DEBUG(role(self), "delivers snapshot at index",
-               self->state.last_snapshot_index);
-    auto msg = make_message(snapshot_atom::value,
-                            self->state.last_snapshot_index,
-                            std::move(*snapshot));
-    self->send(self->state.state_machine, self->state.last_snapshot_index, msg);
-    from = self->state.last_snapshot_index + 1;
+    return;
+  }
+  if (st.delivered_snapshot.is_open()) {
+    VAST_DEBUG(role(self), "defers entries", from, "to", to);
+    st.deferred_index = std::max(st.deferred_index, to);
+    return;
   }
   VAST_DEBUG(role(self), "sends entries", from, "to", to);
   for (auto i = from; i <= to; ++i) {
-    auto& entry = self->state.log->at(i);
+    auto entry = self->state.log->at(i);
     if (entry.data.empty()) {
       VAST_DEBUG(role(self), "skips delivery of no-op entry", i);
     } else {
@@ -406,7 +762,7 @@ void advance_commit_index(Actor* self) {
     return;
   }
   VAST_ASSERT(index >= self->state.log->first_index());
-  if (self->state.log->at(index).term != self->state.current_term)
+  if (self->state.log->term(index) != self->state.current_term)
     return;
   VAST_DEBUG(role(self), "advances commitIndex", self->state.commit_index,
              "->", index);
@@ -428,6 +784,13 @@ expected<void> become_follower(Actor* self, term_type term) {
     if (!result)
       return result;
   }
+  if (!self->state.pending_reads.empty()) {
+    auto e = make_error(ec::unspecified, "lost leadership");
+    for (auto& x : self->state.pending_reads)
+      x.second.deliver(e);
+    self->state.pending_reads.clear();
+  }
+  self->state.read_round = {};
   self->become(self->state.following);
   if (self->state.election_time == clock::time_point::max())
     reset_election_time(self);
@@ -445,6 +808,7 @@ void become_leader(Actor* self) {
     peer.next_index = self->state.log->last_index() + 1;
     peer.match_index = 0;
     peer.last_snapshot_index = 0;
+    peer.last_ack = {};
   }
   // (A no-op entry has an index of 0 and no data in our implementation.)
   log_entry entry;
@@ -456,6 +820,7 @@ void become_leader(Actor* self) {
     self->quit(res.error());
     return;
   }
+  self->state.term_start_index = self->state.log->last_index();
   advance_commit_index(self);
   // Kick off leader heartbeat loop.
   if (!self->state.peers.empty() && !self->state.heartbeat_inflight) {
@@ -546,6 +911,17 @@ auto handle_request_vote(Actor* self, request_vote::request& req) {
              req.candidate_id << ", last log index =",
              req.last_log_index << ", last log term =", req.last_log_term);
   request_vote::response resp;
+  // From §4.2.3 in the Raft dissertation: "[..] if a server receives a
+  // RequestVote request within the minimum election timeout of hearing from
+  // a current leader, it does not update its term or grant its vote." This
+  // also protects the lease of the leader.
+  if (is_follower(self) && self->state.leader
+      && clock::now() < self->state.last_heard + election_timeout) {
+    VAST_DEBUG(role(self), "rejects RequestVote while leader is alive");
+    resp.term = self->state.current_term;
+    resp.vote_granted = false;
+    return resp;
+  }
   // From §5.1 in the Raft paper: "If a server receives a request with a stale
   // term number, it rejects it."
   if (req.term < self->state.current_term) {
@@ -603,9 +979,8 @@ make_install_snapshot(Actor* self, peer_state& peer) {
   }
   req.last_snapshot_index = peer.last_snapshot_index;
   req.byte_offset = peer.snapshot->size() - peer.snapshot->in_avail();
-  // Construct at most chunks of 1 MB.
-  auto one_mb = std::streamsize{1 << 20};
-  req.data.resize(std::min(one_mb, peer.snapshot->in_avail()));
+  auto chunk_size = static_cast<std::streamsize>(snapshot_chunk_size);
+  req.data.resize(std::min(chunk_size, peer.snapshot->in_avail()));
   VAST_DEBUG(role(self), "fills snapshot chunk with", req.data.size(), "bytes");
   auto got = peer.snapshot->sgetn(req.data.data(), req.data.size());
   if (got != static_cast<std::streamsize>(req.data.size()))
@@ -614,23 +989,28 @@ make_install_snapshot(Actor* self, peer_state& peer) {
   return req;
 }
 
-// Sends an InstallSnapshot message to a peer.
+// Sends the next chunk of the snapshot to a peer.
+// @returns `true` if we sent an InstallSnapshot request.
 template <class Actor>
-auto send_install_snapshot(Actor* self, peer_state& peer) {
+bool send_install_snapshot(Actor* self, peer_state& peer) {
   VAST_ASSERT(peer.peer);
   auto req = make_install_snapshot(self, peer);
   if (!req) {
     VAST_ERROR(role(self), self->system().render(req.error()));
     self->quit(req.error());
-    return;
+    return false;
   }
   auto peer_id = peer.id;
   auto req_term = req->term;
+  auto expected_bytes = req->byte_offset + req->data.size();
+  ++peer.inflight;
   self->request(peer.peer, request_timeout, std::move(*req)).then(
     [=](const install_snapshot::response& resp) {
       VAST_DEBUG(role(self), "got InstallSnapshot response from peer", peer_id,
                  ": term =", resp.term << ", bytes stored =",
                  resp.bytes_stored);
+      if (auto p = find_peer(self, peer_id))
+        --p->inflight;
       if (req_term != self->state.current_term) {
         VAST_DEBUG(role(self), "ignores stale response");
         return;
@@ -643,7 +1023,13 @@ auto send_install_snapshot(Actor* self, peer_state& peer) {
       }
       VAST_ASSERT(resp.term == self->state.current_term);
       if (auto p = current_peer(self)) {
-        if (p->snapshot->in_avail() == 0) {
+        if (!p->snapshot) {
+          VAST_DEBUG(role(self), "ignores response for abandoned transfer");
+        } else if (resp.bytes_stored != expected_bytes) {
+          // The peer missed a chunk, so we start over.
+          VAST_DEBUG(role(self), "restarts snapshot transfer to peer", p->id);
+          p->snapshot.reset();
+        } else if (resp.bytes_stored == p->snapshot->size()) {
           VAST_DEBUG(role(self), "completed sending snapshot to peer", p->id,
                      "(index", p->last_snapshot_index << ')');
           p->next_index = p->last_snapshot_index + 1;
@@ -652,9 +1038,21 @@ auto send_install_snapshot(Actor* self, peer_state& peer) {
           p->snapshot.reset();
           p->last_snapshot_index = 0;
         }
+        // Continue with the next chunks or the entries after the snapshot.
+        replicate_to(self, *p);
+      }
+    },
+    [=](error& e) {
+      VAST_WARNING(role(self), "failed to send snapshot to peer", peer_id
+                   << ':', self->system().render(e));
+      if (auto p = find_peer(self, peer_id)) {
+        --p->inflight;
+        // Start over with the next attempt.
+        p->snapshot.reset();
       }
     }
   );
+  return true;
 }
 
 template <class Actor>
@@ -673,13 +1071,21 @@ auto handle_install_snapshot(Actor* self, install_snapshot::request& req) {
     resp.term = req.term;
   auto grd = caf::detail::make_scope_guard([&] { reset_election_time(self); });
   become_follower(self, req.term);
+  self->state.last_heard = clock::now();
   if (self->state.leader != self->current_sender())
     self->state.leader = actor_cast<actor>(self->current_sender());
   // Prepare for writing a snapshot unless we're already in the middle of
-  // receiving snapshot chunks.
+  // receiving snapshot chunks. The first chunk restarts an interrupted
+  // transfer.
+  auto filename = self->state.dir / "snapshot.install";
+  if (self->state.snapshot.is_open() && req.byte_offset == 0
+      && self->state.snapshot.tellp() > 0) {
+    VAST_DEBUG(role(self), "restarts receiving snapshot");
+    self->state.snapshot.close();
+  }
   if (!self->state.snapshot.is_open()) {
-    auto filename = self->state.dir / "snapshot";
-    self->state.snapshot.open(filename.str());
+    self->state.snapshot.open(filename.str(),
+                              std::ios::binary | std::ios::trunc);
     if (!self->state.snapshot) {
       VAST_ERROR(role(self), "failed to open snapshot writer");
       return resp;
@@ -710,7 +1116,9 @@ auto handle_install_snapshot(Actor* self, install_snapshot::request& req) {
   // If this was the last chunk, load the snapshot.
   if (req.done) {
     self->state.snapshot.close();
-    auto res = load_snapshot_header(self);
+    auto res = rename(filename, self->state.dir / "snapshot");
+    if (res)
+      res = load_snapshot_header(self);
     if (!res) {
       VAST_ERROR(role(self), "failed to apply remote snapshot:",
                  self->system().render(res.error()));
@@ -721,41 +1129,47 @@ auto handle_install_snapshot(Actor* self, install_snapshot::request& req) {
                self->state.last_snapshot_index, "and term",
                self->state.last_snapshot_term);
     if (self->state.state_machine) {
-      auto snapshot = load_snapshot_data(self);
-      if (!snapshot) {
-        VAST_ERROR(role(self), "failed to load snapshot:",
-                   self->system().render(snapshot.error()));
-        self->quit(snapshot.error());
+      res = deliver_snapshot(self);
+      if (!res) {
+        VAST_ERROR(role(self), "failed to deliver snapshot:",
+                   self->system().render(res.error()));
+        self->quit(res.error());
         return resp;
       }
-      VAST_DEBUG(role(self), "delivers snapshot");
-      self->send(self->state.state_machine,
-                 self->state.last_snapshot_index,
-                 make_message(snapshot_atom::value,
-                              self->state.last_snapshot_index,
-                              std::move(*snapshot)));
     }
   }
   return resp;
 }
 
+// Sends an AppendEntries request with the next batch of entries to a peer,
+// or an InstallSnapshot request if the peer needs entries that we no longer
+// have. Snapshot chunks go out one at a time.
+// @returns `true` if we sent an AppendEntries request.
 template <class Actor>
-auto send_append_entries(Actor* self, peer_state& peer) {
+bool send_append_entries(Actor* self, peer_state& peer) {
   // Find the previous index for this peer.
   auto prev_log_index = peer.next_index - 1;
   VAST_ASSERT(prev_log_index <= self->state.log->last_index());
+  // Snapshot chunks share the pipeline with AppendEntries requests, which
+  // bounds the number of chunks in flight.
+  auto send_snapshot = [&] {
+    while (peer.inflight < max_inflight_requests
+           && (!peer.snapshot || peer.snapshot->in_avail() > 0))
+      if (!send_install_snapshot(self, peer))
+        break;
+    return false;
+  };
   // If we cannot provide the log the peer needs, we send a snapshot.
   if (peer.next_index < self->state.log->first_index()) {
     VAST_DEBUG(role(self), "sends snapshot, server", peer.id, "needs index",
                peer.next_index, "but log starts at",
                self->state.log->first_index());
-    send_install_snapshot(self, peer);
-    return;
+    return send_snapshot();
   }
   // Find the previous term for this peer.
   index_type prev_log_term;
   if (prev_log_index >= self->state.log->first_index()) {
-    prev_log_term = self->state.log->at(prev_log_index).term;
+    prev_log_term = self->state.log->term(prev_log_index);
   } else if (prev_log_index == 0) {
     prev_log_term = 0;
   } else if (prev_log_index == self->state.last_snapshot_index) {
@@ -763,8 +1177,7 @@ auto send_append_entries(Actor* self, peer_state& peer) {
   } else {
     VAST_DEBUG(role(self), "sends snapshot, can't find previous log term "
                "for server", peer.id);
-    send_install_snapshot(self, peer);
-    return;
+    return send_snapshot();
   }
   // Assemble an AppendEntries request.
   append_entries::request req;
@@ -773,20 +1186,30 @@ auto send_append_entries(Actor* self, peer_state& peer) {
   req.commit_index = self->state.commit_index;
   req.prev_log_index = prev_log_index;
   req.prev_log_term = prev_log_term;
-  // Add log entries [peer next index, local last log index].
-  for (auto i = peer.next_index; i <= self->state.log->last_index(); ++i)
+  // Add log entries [peer next index, local last log index], but no more
+  // than fit into a single request.
+  auto last = std::min(self->state.log->last_index(),
+                       prev_log_index + max_entries_per_request);
+  for (auto i = peer.next_index; i <= last; ++i)
     req.entries.push_back(self->state.log->at(i));
   auto req_term = req.term;
   auto num_entries = req.entries.size();
   auto peer_id = peer.id;
   VAST_DEBUG(role(self), "sends AppendEntries request to peer", peer_id,
              "with", num_entries, "entries");
+  // Assume that the request succeeds, so that the next request can go out
+  // before the response arrives.
+  peer.next_index += num_entries;
+  ++peer.inflight;
+  auto sent = clock::now();
   // Send request away and process response.
-  self->request(peer.peer, request_timeout, req).then(
+  self->request(peer.peer, request_timeout, std::move(req)).then(
     [=](const append_entries::response& resp) {
       VAST_DEBUG(role(self), "got AppendEntries response: peer =",
                  peer_id << ", term =", resp.term << ", success =",
                  (resp.success ? 'T' : 'F'));
+      if (auto p = find_peer(self, peer_id))
+        --p->inflight;
       if (req_term != self->state.current_term) {
         VAST_DEBUG(role(self), "ignores stale response");
         return;
@@ -799,6 +1222,8 @@ auto send_append_entries(Actor* self, peer_state& peer) {
       }
       VAST_ASSERT(resp.term == self->state.current_term);
       if (auto p = current_peer(self)) {
+        // Any response in our term confirms our leadership at send time.
+        p->last_ack = std::max(p->last_ack, sent);
         if (resp.success) {
           if (p->match_index > prev_log_index + num_entries) {
             VAST_WARNING(role(self), "got nonmonotonic matchIndex with a term");
@@ -806,17 +1231,146 @@ auto send_append_entries(Actor* self, peer_state& peer) {
             p->match_index = prev_log_index + num_entries;
             advance_commit_index(self);
           }
-          p->next_index = p->match_index + 1;
+          p->next_index = std::max(p->next_index, p->match_index + 1);
         } else {
-          if (p->next_index > 1)
-            --p->next_index;
-          if (p->next_index > resp.last_log_index + 1)
-            p->next_index = resp.last_log_index + 1;
+          // Back off relative to the failed request, since the current next
+          // index may be ahead due to pipelining. Failures may also arrive
+          // out of order, so we never move forward again.
+          p->next_index = std::min({p->next_index, prev_log_index,
+                                    resp.last_log_index + 1});
+          if (p->next_index == 0)
+            p->next_index = 1;
         }
         VAST_DEBUG(role(self), "now has peer's next index at", p->next_index);
+        replicate_to(self, *p);
+      }
+      serve_reads(self);
+    },
+    [=](error& e) {
+      VAST_WARNING(role(self), "failed to send AppendEntries to peer", peer_id
+                   << ':', self->system().render(e));
+      if (auto p = find_peer(self, peer_id)) {
+        --p->inflight;
+        // Resend everything the peer has not acknowledged yet.
+        if (req_term == self->state.current_term)
+          p->next_index = std::min(p->next_index, prev_log_index + 1);
       }
     }
   );
+  return true;
+}
+
+// Sends AppendEntries requests to a peer until the peer has all entries or
+// the pipeline to the peer is full. A heartbeat sends a request even if there
+// are no new entries.
+template <class Actor>
+void replicate_to(Actor* self, peer_state& peer, bool heartbeat) {
+  if (!peer.peer || !is_leader(self))
+    return;
+  auto sent = false;
+  while (peer.inflight < max_inflight_requests
+         && peer.next_index <= self->state.log->last_index())
+    if (send_append_entries(self, peer))
+      sent = true;
+    else
+      return;
+  if (heartbeat && !sent)
+    send_append_entries(self, peer);
+}
+
+// Returns the latest point in time at which a majority of servers including
+// ourselves acknowledged our leadership.
+template <class Actor>
+clock::time_point quorum_ack_time(Actor* self, clock::time_point now) {
+  auto n = self->state.peers.size() + 1;
+  std::vector<clock::time_point> xs;
+  xs.reserve(n);
+  xs.emplace_back(now);
+  for (auto& peer : self->state.peers)
+    xs.emplace_back(peer.last_ack);
+  std::sort(xs.begin(), xs.end());
+  return xs[(n - 1) / 2];
+}
+
+// Answers pending reads with the commit index once a majority has confirmed
+// our leadership after the read arrived, or right away while our lease
+// holds. Otherwise starts a round of heartbeats that covers all pending
+// reads, unless one is already under way.
+template <class Actor>
+void serve_reads(Actor* self) {
+  auto& st = self->state;
+  if (!is_leader(self) || st.pending_reads.empty())
+    return;
+  // Only after committing an entry in our term do we know the index of the
+  // latest committed entry (§6.4 in the Raft dissertation).
+  if (st.commit_index < st.term_start_index)
+    return;
+  auto now = clock::now();
+  auto ack = quorum_ack_time(self, now);
+  auto lease = now - ack < lease_timeout;
+  auto i = st.pending_reads.begin();
+  for (; i != st.pending_reads.end() && (lease || ack >= i->first); ++i)
+    i->second.deliver(st.commit_index);
+  if (i != st.pending_reads.begin())
+    VAST_DEBUG(role(self), "serves", i - st.pending_reads.begin(), "reads",
+               "at index", st.commit_index, (lease ? "(lease)" : ""));
+  st.pending_reads.erase(st.pending_reads.begin(), i);
+  if (st.read_round && ack >= *st.read_round)
+    st.read_round = {};
+  if (!st.pending_reads.empty() && !st.read_round) {
+    VAST_DEBUG(role(self), "confirms leadership for",
+               st.pending_reads.size(), "reads");
+    st.read_round = now;
+    for (auto& peer : st.peers)
+      replicate_to(self, peer, true);
+  }
+}
+
+// Appends the pending client commands to the log with a single write and
+// replicates them right away.
+template <class Actor>
+void flush_pending(Actor* self) {
+  auto& st = self->state;
+  st.flush_inflight = false;
+  if (st.pending_entries.empty())
+    return;
+  auto entries = std::move(st.pending_entries);
+  auto promises = std::move(st.pending_promises);
+  st.pending_entries.clear();
+  st.pending_promises.clear();
+  auto fail = [&](error const& e) {
+    for (auto& rp : promises)
+      rp.deliver(e);
+  };
+  if (!is_leader(self)) {
+    VAST_DEBUG(role(self), "drops", entries.size(), "commands after losing",
+               "leadership");
+    fail(make_error(ec::unspecified, "lost leadership"));
+    return;
+  }
+  auto index = st.log->last_index();
+  VAST_ASSERT(index + 1 > st.commit_index);
+  for (auto& entry : entries) {
+    entry.term = st.current_term;
+    entry.index = ++index;
+  }
+  auto n = entries.size();
+  auto res = st.log->append(std::move(entries));
+  if (!res) {
+    VAST_ERROR(role(self), "failed to append new entries:",
+               self->system().render(res.error()));
+    fail(res.error());
+    return;
+  }
+  VAST_DEBUG(role(self), "appended", n, "new entries up to index", index);
+  for (auto& rp : promises)
+    rp.deliver(ok_atom::value);
+  // Without peers, we can commit the entries immediately.
+  if (st.peers.empty())
+    advance_commit_index(self);
+  else
+    for (auto& peer : st.peers)
+      replicate_to(self, peer);
 }
 
 template <class Actor>
@@ -841,6 +1395,7 @@ handle_append_entries(Actor* self, append_entries::request& req) {
   }
   auto grd = caf::detail::make_scope_guard([&] { reset_election_time(self); });
   become_follower(self, req.term);
+  self->state.last_heard = clock::now();
   // We can only append contiguous entries.
   if (req.prev_log_index > self->state.log->last_index()) {
     VAST_DEBUG(role(self), "rejects request: not contiguous ("
@@ -851,7 +1406,7 @@ handle_append_entries(Actor* self, append_entries::request& req) {
   // Ensure term compatibility with previous entry (and thereby inductively
   // with all prior entries as well).
   if (req.prev_log_index >= self->state.log->first_index()
-      && req.prev_log_term != self->state.log->at(req.prev_log_index).term) {
+      && req.prev_log_term != self->state.log->term(req.prev_log_index)) {
     VAST_DEBUG(role(self), "rejects request: terms disagree");
     return resp;
   }
@@ -865,7 +1420,7 @@ handle_append_entries(Actor* self, append_entries::request& req) {
   for (auto& entry : req.entries) {
     ++index;
     if (index <= self->state.log->last_index()) {
-      if (entry.term == self->state.log->at(index).term)
+      if (entry.term == self->state.log->term(index))
         continue;
       VAST_ASSERT(self->state.commit_index < index);
       auto n = self->state.log->truncate_after(index - 1);
@@ -946,6 +1501,9 @@ behavior consensus(stateful_actor<server_state>* self, path dir) {
       if (clock::now() >= self->state.election_time)
         become_candidate(self);
     },
+    [=](flush_atom) {
+      flush_pending(self);
+    },
     [=](statistics_atom) -> result<statistics> {
       statistics stats;
       auto& l = *self->state.log;
@@ -960,6 +1518,28 @@ behavior consensus(stateful_actor<server_state>* self, path dir) {
       //                     "not enough commited entries to snapshot");
       return save_snapshot(self, index, snapshot);
     },
+    [=](snapshot_atom, index_type index, uint64_t part,
+        const std::vector<char>& data, bool done) -> result<index_type> {
+      auto& st = self->state;
+      if (part == 0) {
+        auto res = begin_snapshot(self, index);
+        if (!res) {
+          st.local_snapshot.close();
+          return res.error();
+        }
+      } else if (!st.local_snapshot.is_open()
+                 || st.local_snapshot_index != index
+                 || st.local_snapshot_parts != part) {
+        return make_error(ec::unspecified, "got snapshot part", part,
+                          "at index", index, "out of sequence");
+      }
+      auto res = write_snapshot_part(self, data);
+      if (!res)
+        return res.error();
+      if (done)
+        return finish_snapshot(self);
+      return index;
+    },
     [=](peer_atom, actor const& peer, server_id peer_id) {
       VAST_DEBUG(role(self), "re-activates peer", peer_id);
       VAST_ASSERT(peer_id != 0);
@@ -1005,6 +1585,13 @@ behavior consensus(stateful_actor<server_state>* self, path dir) {
         rp.deliver(make_error(ec::unspecified, "no leader available"));
       else
         rp.delegate(self->state.leader, replicate_atom::value, command);
+    },
+    [=](read_atom) {
+      auto rp = self->make_response_promise();
+      if (!self->state.leader)
+        rp.deliver(make_error(ec::unspecified, "no leader available"));
+      else
+        rp.delegate(self->state.leader, read_atom::value);
     }
   }.or_else(common);
   // -- leader ---------------------------------------------------------------
@@ -1016,32 +1603,30 @@ behavior consensus(stateful_actor<server_state>* self, path dir) {
         return;
       }
       for (auto& peer : self->state.peers)
-        if (peer.peer)
-          send_append_entries(self, peer);
+        replicate_to(self, peer, true);
       self->delayed_send(self, heartbeat_period, heartbeat_atom::value);
       self->state.heartbeat_inflight = true;
     },
-    [=](replicate_atom, const message& command) -> result<ok_atom> {
-      auto log_index = self->state.log->last_index() + 1;
-      VAST_DEBUG(role(self), "replicates new entry with index", log_index);
-      VAST_ASSERT(log_index > self->state.commit_index);
-      // Create new log entry.
-      std::vector<log_entry> entry(1);
-      entry[0].term = self->state.current_term;
-      entry[0].index = log_index;
-      caf::binary_serializer bs{self->system(), entry[0].data};
+    [=](replicate_atom, const message& command) {
+      VAST_DEBUG(role(self), "queues new entry");
+      auto& st = self->state;
+      log_entry entry;
+      caf::binary_serializer bs{self->system(), entry.data};
       bs << command;
-      // Append to log and wait for commit via AppendEntries.
-      auto res = self->state.log->append(std::move(entry));
-      if (!res) {
-        VAST_ERROR(role(self), "failed to append new entry:",
-                   self->system().render(res.error()));
-        return res.error();
+      st.pending_entries.push_back(std::move(entry));
+      st.pending_promises.push_back(self->make_response_promise());
+      // Commands already in our mailbox make it into the same append.
+      if (!st.flush_inflight) {
+        self->send(self, flush_atom::value);
+        st.flush_inflight = true;
       }
-      // Without peers, we can commit the entry immediately.
-      if (self->state.peers.empty())
-        advance_commit_index(self);
-      return ok_atom::value;
+    },
+    [=](read_atom) {
+      VAST_DEBUG(role(self), "got read request");
+      auto now = clock::now();
+      self->state.pending_reads.emplace_back(now,
+                                             self->make_response_promise());
+      serve_reads(self);
     }
   }.or_else(common);
   // -- startup --------------------------------------------------------------
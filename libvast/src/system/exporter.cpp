@@ -1,5 +1,8 @@
+#include <algorithm>
+
 #include <caf/all.hpp>
 
+#include "vast/candidate_checker.hpp"
 #include "vast/event.hpp"
 #include "vast/logger.hpp"
 #include "vast/concept/printable/std/chrono.hpp"
@@ -22,9 +25,46 @@ namespace system {
 
 namespace {
 
+// Checks whether the historical results go out in timestamp order.
+bool is_ordered(query_options opts) {
+  return has_ordered_option(opts) && !has_continuous_option(opts);
+}
+
+// Orders events by timestamp, and events with equal timestamp by ID.
+bool earlier(event const& x, event const& y) {
+  return x.timestamp() < y.timestamp()
+         || (x.timestamp() == y.timestamp() && x.id() < y.id());
+}
+
+// Checks whether we have evaluated all hits of a historical query.
+bool complete(stateful_actor<exporter_state>* self) {
+  return self->state.stats.received == self->state.stats.expected
+         && !any<1>(self->state.deferred)
+         && !any<1>(self->state.unprocessed);
+}
+
+// Computes the number of events that the sink still needs, beyond those that
+// we have requested from the ARCHIVE already. Ordered results require all
+// events.
+uint64_t missing(stateful_actor<exporter_state>* self) {
+  auto& st = self->state;
+  if (st.stats.requested == 0)
+    return 0;
+  if (is_ordered(st.options))
+    return max_events;
+  auto pending = st.results.size() + rank(st.unprocessed);
+  return st.stats.requested > pending ? st.stats.requested - pending : 0;
+}
+
 void ship_results(stateful_actor<exporter_state>* self) {
   if (self->state.results.empty() || self->state.stats.requested == 0)
     return;
+  if (is_ordered(self->state.options)) {
+    if (!complete(self))
+      return;
+    std::sort(self->state.results.begin(), self->state.results.end(),
+              earlier);
+  }
   VAST_DEBUG(self, "relays", self->state.results.size(), "events");
   message msg;
   if (self->state.results.size() <= self->state.stats.requested) {
@@ -47,8 +87,17 @@ void ship_results(stateful_actor<exporter_state>* self) {
 }
 
 void shutdown(stateful_actor<exporter_state>* self) {
-  if (rank(self->state.unprocessed) > 0 || !self->state.results.empty())
+  if (has_continuous_option(self->state.options)) {
+    // A continuous query runs until its sink got all requested results.
+    if (self->state.stats.requested > 0)
+      return;
+  } else if (self->state.limited && self->state.stats.requested == 0) {
+    // The sink got all requested results, so we skip the remaining hits.
+    if (self->state.stats.received < self->state.stats.expected)
+      self->send(self->state.index, self->state.id, size_t{0});
+  } else if (!complete(self) || !self->state.results.empty()) {
     return;
+  }
   timespan runtime = steady_clock::now() - self->state.start;
   self->state.stats.runtime = runtime;
   VAST_DEBUG(self, "completed in", runtime);
@@ -72,24 +121,63 @@ void shutdown(stateful_actor<exporter_state>* self) {
 void request_more_hits(stateful_actor<exporter_state>* self) {
   auto waiting_for_hits =
     self->state.stats.received == self->state.stats.scheduled;
-  auto need_more_results = self->state.stats.requested > 0;
-  auto have_no_inflight_requests = any<1>(self->state.unprocessed);
-  // If we're (1) no longer waiting for index hits, (2) still need more
-  // results, and (3) have no inflight requests to the archive, we ask
-  // the index for more hits.
-  if (waiting_for_hits && need_more_results && have_no_inflight_requests) {
-    auto remaining = self->state.stats.expected - self->state.stats.received;
+  auto remaining = self->state.stats.expected - self->state.stats.received;
+  // The hits we have already may suffice for the sink.
+  auto need_more_hits = missing(self) > rank(self->state.deferred);
+  // If we're (1) no longer waiting for index hits, (2) the index has more
+  // partitions, and (3) the events of all known hits cannot satisfy the sink,
+  // we ask the index for more hits.
+  if (waiting_for_hits && remaining > 0 && need_more_hits) {
     // TODO: Figure out right amount of partitions to ask for.
     auto n = std::min(remaining, size_t{2});
     VAST_DEBUG(self, "asks index to process", n, "more partitions");
+    self->state.stats.scheduled += n;
     self->send(self->state.index, self->state.id, n);
   }
 }
 
+// Requests the events for the deferred hits from the ARCHIVE, but only for
+// as many of the first hits as the sink still needs. The remaining hits stay
+// deferred in case the candidate check discards some of the events.
+void request_events(stateful_actor<exporter_state>* self) {
+  auto n = missing(self);
+  if (n == 0 || !any<1>(self->state.deferred))
+    return;
+  auto hits = self->state.deferred;
+  if (n < rank(hits)) {
+    bitmap mask;
+    mask.append_bits(true, select(hits, n) + 1);
+    mask.append_bits(false, hits.size() - mask.size());
+    hits &= mask;
+  }
+  self->state.deferred -= hits;
+  self->state.unprocessed |= hits;
+  auto count = rank(hits);
+  VAST_DEBUG(self, "requests", count, "events from archive");
+  // The archive streams the events as they become available and replies
+  // once it has shipped the last one.
+  self->request(self->state.archive, infinite, hits).then(
+    [=](done_atom) {
+      VAST_DEBUG(self, "got all events for", count, "hits from archive");
+    },
+    [=](const error& e) {
+      VAST_ERROR(self, "failed to extract events from archive:",
+                 self->system().render(e));
+      // Stop waiting for the events that will not arrive anymore.
+      self->state.unprocessed -= hits;
+      request_events(self);
+      request_more_hits(self);
+      ship_results(self);
+      shutdown(self);
+    }
+  );
+}
+
 } // namespace <anonymous>
 
 behavior exporter(stateful_actor<exporter_state>* self, expression expr,
-                  query_options) {
+                  query_options opts) {
+  self->state.options = opts;
   auto eu = self->system().dummy_execution_unit();
   self->state.sink = actor_pool::make(eu, actor_pool::broadcast());
   if (auto a = self->system().registry().get(accountant_atom::value))
@@ -114,16 +202,20 @@ behavior exporter(stateful_actor<exporter_state>* self, expression expr,
       }
       VAST_DEBUG(self, "got", rank(hits), "index hits in ["
                  << select(hits, 1) << ',' << (select(hits, -1) + 1) << ')');
+      // Skip the hits that the continuous query has delivered already.
+      if (has_continuous_option(opts) && count > 0
+          && any<1>(self->state.continuous_hits)) {
+        hits -= self->state.continuous_hits;
+        count = rank(hits);
+      }
       if (count > 0) {
         self->state.hits |= hits;
-        self->state.unprocessed |= hits;
-        VAST_DEBUG(self, "forwards hits to archive");
-        // FIXME: restrict according to configured limit.
-        self->send(self->state.archive, std::move(hits));
+        self->state.deferred |= hits;
       }
       // Figure out if we're done.
       ++self->state.stats.received;
       self->send(self->state.sink, self->state.id, self->state.stats);
+      request_events(self);
       if (self->state.stats.received < self->state.stats.expected) {
         VAST_DEBUG(self, "received", self->state.stats.received << '/'
                                      << self->state.stats.expected, "bitmaps");
@@ -133,6 +225,7 @@ behavior exporter(stateful_actor<exporter_state>* self, expression expr,
                    "bitmap(s) in", runtime);
         if (self->state.accountant)
           self->send(self->state.accountant, "exporter.hits.runtime", runtime);
+        ship_results(self);
         shutdown(self);
       }
     },
@@ -140,18 +233,20 @@ behavior exporter(stateful_actor<exporter_state>* self, expression expr,
       VAST_DEBUG(self, "got batch of", candidates.size(), "events");
       bitmap mask;
       for (auto& candidate : candidates) {
-        auto& checker = self->state.checkers[candidate.type()];
+        auto i = self->state.checkers.find(candidate.type());
         // Construct a candidate checker if we don't have one for this type.
-        if (is<none>(checker)) {
+        if (i == self->state.checkers.end()) {
           auto x = visit(type_resolver{candidate.type()}, expr);
           VAST_ASSERT(x);
-          checker = visit(type_pruner{candidate.type()}, *x);
-          VAST_ASSERT(!is<none>(checker));
+          auto pruned = visit(type_pruner{candidate.type()}, *x);
+          VAST_ASSERT(!is<none>(pruned));
           VAST_DEBUG(self, "resolved AST for", candidate.type() << ':',
-                     checker);
+                     pruned);
+          auto checker = candidate_checker{pruned, candidate.type()};
+          i = self->state.checkers.emplace(candidate.type(), checker).first;
         }
         // Perform candidate check and keep event as result on success.
-        if (visit(event_evaluator{candidate}, checker))
+        if (i->second(candidate))
           self->state.results.push_back(std::move(candidate));
         else
           VAST_DEBUG(self, "ignores false positive:", candidate);
@@ -160,10 +255,48 @@ behavior exporter(stateful_actor<exporter_state>* self, expression expr,
       }
       self->state.stats.processed += candidates.size();
       self->state.unprocessed -= mask;
+      // Keep only the earliest results that the sink can take.
+      auto& results = self->state.results;
+      auto requested = self->state.stats.requested;
+      if (is_ordered(opts) && self->state.limited
+          && results.size() > requested) {
+        std::nth_element(results.begin(), results.begin() + requested,
+                         results.end(), earlier);
+        results.resize(requested);
+      }
       ship_results(self);
+      request_events(self);
       request_more_hits(self);
-      if (self->state.stats.received == self->state.stats.expected)
-        shutdown(self);
+      shutdown(self);
+    },
+    [=](continuous_atom, std::vector<event>& xs) {
+      VAST_ASSERT(!xs.empty());
+      VAST_DEBUG(self, "got", xs.size(), "continuous results");
+      bitmap mask;
+      for (auto& x : xs) {
+        mask.append_bits(false, x.id() - mask.size());
+        mask.append_bit(true);
+      }
+      self->state.continuous_hits |= mask;
+      // In unified mode, the historical query may deliver the same events.
+      // We only keep those that are not among the historical hits.
+      if (has_historical_option(opts)) {
+        mask &= self->state.hits;
+        if (any<1>(mask)) {
+          auto dups = std::vector<event_id>{};
+          for (auto id : select(mask))
+            dups.push_back(id);
+          auto is_dup = [&](auto& x) {
+            return std::binary_search(dups.begin(), dups.end(), x.id());
+          };
+          xs.erase(std::remove_if(xs.begin(), xs.end(), is_dup), xs.end());
+        }
+      }
+      self->state.stats.processed += xs.size();
+      std::move(xs.begin(), xs.end(),
+                std::back_inserter(self->state.results));
+      ship_results(self);
+      shutdown(self);
     },
     [=](extract_atom) {
       if (self->state.stats.requested == max_events) {
@@ -171,7 +304,9 @@ behavior exporter(stateful_actor<exporter_state>* self, expression expr,
         return;
       }
       self->state.stats.requested = max_events;
+      self->state.limited = false;
       ship_results(self);
+      request_events(self);
       request_more_hits(self);
     },
     [=](extract_atom, uint64_t requested) {
@@ -181,9 +316,11 @@ behavior exporter(stateful_actor<exporter_state>* self, expression expr,
       }
       auto n = std::min(max_events - requested, requested);
       self->state.stats.requested += n;
+      self->state.limited = true;
       VAST_DEBUG(self, "got request to extract", n, "new events in addition to",
                  self->state.stats.requested, "pending results");
       ship_results(self);
+      request_events(self);
       request_more_hits(self);
     },
     [=](archive_type const& archive) {
@@ -194,6 +331,12 @@ behavior exporter(stateful_actor<exporter_state>* self, expression expr,
       VAST_DEBUG(self, "registers index", index);
       self->state.index = index;
     },
+    [=](importer_atom, actor const& importer) {
+      if (!has_continuous_option(opts))
+        return;
+      VAST_DEBUG(self, "registers continuous query at importer", importer);
+      self->send(importer, continuous_atom::value, expr);
+    },
     [=](sink_atom, actor const& sink) {
       VAST_DEBUG(self, "registers index", sink);
       self->send(self->state.sink, sys_atom::value, put_atom::value, sink);
@@ -201,6 +344,8 @@ behavior exporter(stateful_actor<exporter_state>* self, expression expr,
     [=](run_atom) {
       VAST_INFO(self, "executes query", expr);
       self->state.start = steady_clock::now();
+      if (!has_historical_option(opts))
+        return;
       self->request(self->state.index, infinite, expr).then(
         [=](const uuid& lookup, size_t partitions, size_t scheduled) {
           VAST_DEBUG(self, "got lookup handle", lookup << ", scheduled",
@@ -0,0 +1,176 @@
+#include <chrono>
+#include <fstream>
+#include <functional>
+#include <iterator>
+#include <string>
+
+#include <caf/all.hpp>
+
+#include "vast/error.hpp"
+#include "vast/logger.hpp"
+#include "vast/concept/printable/stream.hpp"
+#include "vast/concept/printable/vast/error.hpp"
+#include "vast/concept/printable/vast/filesystem.hpp"
+#include "vast/detail/assert.hpp"
+
+#include "vast/system/filesystem.hpp"
+
+using std::chrono::steady_clock;
+using namespace caf;
+
+namespace vast {
+namespace system {
+
+namespace {
+
+expected<void> make_parent(path const& filename) {
+  auto dir = filename.parent();
+  if (dir.empty() || exists(dir))
+    return {};
+  return mkdir(dir);
+}
+
+expected<void> write_file(path const& filename, std::vector<char> const& bytes,
+                          std::ios_base::openmode mode) {
+  auto result = make_parent(filename);
+  if (!result)
+    return result;
+  std::ofstream fs{filename.str(), std::ios::binary | mode};
+  if (!fs)
+    return make_error(ec::filesystem_error, "failed to open file", filename);
+  fs.write(bytes.data(), bytes.size());
+  if (!fs.flush())
+    return make_error(ec::filesystem_error, "failed to write file", filename);
+  return {};
+}
+
+behavior filesystem_worker(event_based_actor* self) {
+  // Terminate along with the FILESYSTEM, regardless of the exit reason.
+  self->set_exit_handler(
+    [=](const exit_msg& msg) {
+      self->quit(msg.reason);
+    }
+  );
+  return {
+    [=](write_atom, path const& filename, std::vector<char> const& bytes)
+    -> result<ok_atom> {
+      auto r = replace_file(filename, bytes);
+      if (!r)
+        return r.error();
+      return ok_atom::value;
+    },
+    [=](append_atom, path const& filename, std::vector<char> const& bytes)
+    -> result<ok_atom> {
+      auto r = append_file(filename, bytes);
+      if (!r)
+        return r.error();
+      return ok_atom::value;
+    },
+    [=](read_atom, path const& filename) -> result<std::vector<char>> {
+      auto r = read_file(filename);
+      if (!r)
+        return r.error();
+      return std::move(*r);
+    },
+  };
+}
+
+// Forwards a request to the worker responsible for the directory of a file
+// and keeps track of the number of pending requests.
+template <class T, class... Ts>
+typed_response_promise<T>
+dispatch(filesystem_type::stateful_pointer<filesystem_state> self,
+         std::string metric, path const& filename, Ts&&... xs) {
+  auto rp = self->make_response_promise<typed_response_promise<T>>();
+  auto& workers = self->state.workers;
+  auto h = std::hash<std::string>{}(filename.parent().str());
+  auto& worker = workers[h % workers.size()];
+  ++self->state.pending;
+  if (self->state.accountant)
+    self->send(self->state.accountant, "filesystem.queue.depth",
+               self->state.pending);
+  auto start = steady_clock::now();
+  auto complete = [=] {
+    --self->state.pending;
+    if (self->state.accountant) {
+      timespan latency = steady_clock::now() - start;
+      self->send(self->state.accountant, metric, latency);
+    }
+  };
+  self->request(worker, infinite, std::forward<Ts>(xs)...).then(
+    [=](T& x) mutable {
+      complete();
+      rp.deliver(std::move(x));
+    },
+    [=](error& e) mutable {
+      complete();
+      VAST_ERROR(self, "failed I/O on", filename << ':',
+                 self->system().render(e));
+      rp.deliver(std::move(e));
+    }
+  );
+  return rp;
+}
+
+} // namespace <anonymous>
+
+expected<void> replace_file(path const& filename,
+                            std::vector<char> const& bytes) {
+  auto tmp = filename + ".tmp";
+  auto result = write_file(tmp, bytes, std::ios::trunc);
+  if (!result)
+    return result;
+  return rename(tmp, filename);
+}
+
+expected<void> append_file(path const& filename,
+                           std::vector<char> const& bytes) {
+  return write_file(filename, bytes, std::ios::app);
+}
+
+expected<std::vector<char>> read_file(path const& filename) {
+  std::ifstream fs{filename.str(), std::ios::binary};
+  if (!fs)
+    return make_error(ec::filesystem_error, "failed to open file", filename);
+  std::vector<char> result{std::istreambuf_iterator<char>{fs},
+                           std::istreambuf_iterator<char>{}};
+  if (fs.bad())
+    return make_error(ec::filesystem_error, "failed to read file", filename);
+  return result;
+}
+
+filesystem_type::behavior_type
+filesystem(filesystem_type::stateful_pointer<filesystem_state> self,
+           size_t workers) {
+  VAST_ASSERT(workers > 0);
+  for (auto i = 0u; i < workers; ++i)
+    self->state.workers.push_back(
+      self->spawn<detached + linked>(filesystem_worker));
+  if (auto a = self->system().registry().get(accountant_atom::value))
+    self->state.accountant = actor_cast<accountant_type>(a);
+  return {
+    [=](write_atom, path& filename, std::vector<char>& bytes) {
+      return dispatch<ok_atom>(self, "filesystem.write.latency", filename,
+                               write_atom::value, filename, std::move(bytes));
+    },
+    [=](append_atom, path& filename, std::vector<char>& bytes) {
+      return dispatch<ok_atom>(self, "filesystem.append.latency", filename,
+                               append_atom::value, filename,
+                               std::move(bytes));
+    },
+    [=](read_atom, path& filename) {
+      return dispatch<std::vector<char>>(self, "filesystem.read.latency",
+                                         filename, read_atom::value,
+                                         filename);
+    },
+  };
+}
+
+filesystem_type get_filesystem(caf::actor_system& sys) {
+  if (auto fs = sys.registry().get(filesystem_atom::value))
+    return actor_cast<filesystem_type>(fs);
+  return {};
+}
+
+} // namespace system
+} // namespace vast
@@ -1,8 +1,11 @@
 #include <fstream>
+#include <unordered_map>
 
 #include "vast/concept/printable/to_string.hpp"
 #include "vast/concept/printable/vast/error.hpp"
+#include "vast/concept/printable/vast/expression.hpp"
 #include "vast/concept/printable/vast/filesystem.hpp"
+#include "vast/expression.hpp"
 #include "vast/logger.hpp"
 
 #include "vast/system/atoms.hpp"
@@ -70,12 +73,34 @@ auto shutdown(stateful_actor<importer_state>* self) {
   };
 }
 
+// Evaluates a batch of events against all continuous queries and relays the
+// matching events to the corresponding subscribers.
+void evaluate(stateful_actor<importer_state>* self,
+              std::vector<event> const& batch) {
+  std::unordered_map<query_matcher::query_id, std::vector<event>> results;
+  std::vector<query_matcher::query_id> ids;
+  for (auto& e : batch) {
+    ids.clear();
+    self->state.matcher.match(e, ids);
+    for (auto id : ids)
+      results[id].push_back(e);
+  }
+  for (auto& x : results) {
+    auto i = self->state.subscribers.find(x.first);
+    VAST_ASSERT(i != self->state.subscribers.end());
+    VAST_DEBUG(self, "relays", x.second.size(), "matches to", i->second);
+    self->send(i->second, continuous_atom::value, std::move(x.second));
+  }
+}
+
 // Ships a batch of events to archive and index.
 void ship(stateful_actor<importer_state>* self, std::vector<event>&& batch) {
   VAST_ASSERT(batch.size() <= self->state.available);
   for (auto& e : batch)
     e.id(self->state.next++);
   self->state.available -= batch.size();
+  if (!self->state.matcher.empty())
+    evaluate(self, batch);
   VAST_DEBUG(self, "ships", batch.size(), "events");
   // TODO: How to retain type safety without copying the entire batch?
   auto msg = make_message(std::move(batch));
@@ -152,8 +177,21 @@ behavior importer(stateful_actor<importer_state>* self, path dir,
   self->set_exit_handler(shutdown(self));
   self->set_down_handler(
     [=](down_msg const& msg) {
-      if (msg.source == self->state.meta_store)
+      if (msg.source == self->state.meta_store) {
         self->state.meta_store = meta_store_type{};
+        return;
+      }
+      // Remove all continuous queries of a terminated subscriber.
+      auto& subscribers = self->state.subscribers;
+      for (auto i = subscribers.begin(); i != subscribers.end(); ) {
+        if (i->second == msg.source) {
+          VAST_DEBUG(self, "removes continuous query", i->first);
+          self->state.matcher.erase(i->first);
+          i = subscribers.erase(i);
+        } else {
+          ++i;
+        }
+      }
     }
   );
   return {
@@ -172,6 +210,17 @@ behavior importer(stateful_actor<importer_state>* self, path dir,
       VAST_DEBUG(self, "registers index", index);
       self->send(self->state.index, sys_atom::value, put_atom::value, index);
     },
+    [=](continuous_atom, expression const& expr) {
+      auto subscriber = actor_cast<actor>(self->current_sender());
+      if (!subscriber) {
+        VAST_WARNING(self, "ignores continuous query from anonymous sender");
+        return;
+      }
+      auto id = self->state.matcher.add(normalize(expr));
+      VAST_DEBUG(self, "registers continuous query", id << ':', expr);
+      self->monitor(subscriber);
+      self->state.subscribers.emplace(id, subscriber);
+    },
     [=](std::vector<event>& events) {
       VAST_ASSERT(!events.empty());
       VAST_DEBUG(self, "got", events.size(), "events");
@@ -1,4 +1,6 @@
+#include <algorithm>
 #include <deque>
+#include <functional>
 #include <unordered_set>
 
 #include <caf/all.hpp>
@@ -17,6 +19,7 @@
 #include "vast/save.hpp"
 
 #include "vast/system/accountant.hpp"
+#include "vast/system/filesystem.hpp"
 #include "vast/system/index.hpp"
 #include "vast/system/partition.hpp"
 #include "vast/system/task.hpp"
@@ -42,33 +45,239 @@ void partition_index::add(const std::vector<event> xs, const uuid& partition) {
   // Update index.
   auto& x = partitions_[partition];
   x.range = bound(x.range, result);
+  x.events += xs.size();
+}
+
+void partition_index::merge(const std::vector<uuid>& xs, const uuid& y) {
+  auto& result = partitions_[y];
+  for (auto& x : xs) {
+    auto i = partitions_.find(x);
+    if (i == partitions_.end())
+      continue;
+    result.range.from = std::min(result.range.from, i->second.range.from);
+    result.range.to = std::max(result.range.to, i->second.range.to);
+    result.events += i->second.events;
+    partitions_.erase(i);
+  }
+}
+
+void partition_index::freeze(const uuid& x) {
+  auto i = partitions_.find(x);
+  if (i != partitions_.end())
+    i->second.cold = true;
+}
+
+void partition_index::erase(const uuid& x) {
+  partitions_.erase(x);
 }
 
 std::vector<uuid> partition_index::lookup(const expression& expr) const {
-  std::vector<uuid> result;
+  std::vector<std::pair<timestamp, uuid>> xs;
   for (auto& x : partitions_)
     if (visit(time_restrictor{x.second.range.from, x.second.range.to}, expr))
-      result.push_back(x.first);
+      xs.emplace_back(x.second.range.from, x.first);
+  std::sort(xs.begin(), xs.end());
+  std::vector<uuid> result;
+  result.reserve(xs.size());
+  for (auto& x : xs)
+    result.push_back(x.second);
   return result;
 }
 
+auto partition_index::partitions() const
+-> const std::unordered_map<uuid, partition_synopsis>& {
+  return partitions_;
+}
+
 namespace {
 
-// -- scheduling --------------------------------------------------------------
+// -- residency ---------------------------------------------------------------
 
-void evict(stateful_actor<index_state>* self) {
-  // TODO: pick the LRU partition, not just a random one.
-  for (auto& x : self->state.loaded) {
-    if (self->state.evicted.count(x.second) == 0) {
-      VAST_DEBUG(self, "evicts partition", x.first);
-      self->send(x.second, shutdown_atom::value);
-      self->state.evicted.emplace(x.second, x.first);
-      break;
+// Resolves the directory of a partition, which lives either in the directory
+// of the INDEX or in the cold tier.
+path partition_dir(stateful_actor<index_state>* self, const uuid& part) {
+  auto& parts = self->state.part_index.partitions();
+  auto i = parts.find(part);
+  if (i != parts.end() && i->second.cold)
+    return self->state.policy.cold_dir / to_string(part);
+  return self->state.dir / to_string(part);
+}
+
+// The assumed size of a partition when we have nothing better to go by.
+constexpr uint64_t default_partition_size = 16 << 20;
+
+// Measures the size of partitions on the file system. The measurement runs in
+// its own thread to keep the INDEX responsive.
+behavior measurer(event_based_actor* self) {
+  return {
+    [=](const std::vector<path>& dirs) -> std::vector<uint64_t> {
+      self->quit();
+      std::vector<uint64_t> result;
+      result.reserve(dirs.size());
+      for (auto& x : dirs) {
+        auto n = file_size(x);
+        result.push_back(n ? *n : 0);
+      }
+      return result;
     }
-  }
+  };
+}
+
+// Records the sizes of partitions on the file system, as measured outside of
+// the INDEX.
+void measure(stateful_actor<index_state>* self, const std::vector<uuid>& xs) {
+  std::vector<uuid> parts;
+  std::vector<path> dirs;
+  for (auto& x : xs)
+    if (self->state.measuring.insert(x).second) {
+      parts.push_back(x);
+      dirs.push_back(partition_dir(self, x));
+    }
+  if (parts.empty())
+    return;
+  auto m = self->spawn<detached>(measurer);
+  self->request(m, infinite, std::move(dirs)).then(
+    [=](const std::vector<uint64_t>& xs) {
+      auto& st = self->state;
+      for (auto i = 0u; i < parts.size(); ++i) {
+        st.measuring.erase(parts[i]);
+        if (xs[i] > 0 && st.part_index.partitions().count(parts[i]) > 0)
+          st.sizes[parts[i]] = xs[i];
+      }
+    },
+    [=](const error& e) {
+      VAST_WARNING(self, "failed to measure partitions:",
+                   self->system().render(e));
+      for (auto& x : parts)
+        self->state.measuring.erase(x);
+    }
+  );
+}
+
+// Approximates the memory footprint of a partition by its size on disk, as
+// last measured. For partitions that we have not measured yet, we fall back
+// to the average size of the resident partitions and measure them in the
+// background.
+uint64_t estimate_size(stateful_actor<index_state>* self, const uuid& part) {
+  auto i = self->state.sizes.find(part);
+  if (i != self->state.sizes.end())
+    return i->second;
+  if (part != self->state.active.id)
+    measure(self, {part});
+  if (!self->state.loaded.empty())
+    return std::max(uint64_t{1},
+                    self->state.resident / self->state.loaded.size());
+  return default_partition_size;
+}
+
+// Checks whether a partition of a given size fits into the memory budget.
+bool fits(stateful_actor<index_state>* self, uint64_t bytes) {
+  return self->state.resident + bytes <= self->state.budget;
+}
+
+// Renews the priority of a resident partition upon access. Following the
+// GreedyDual-Size policy, small partitions retain a higher priority than large
+// ones, and the priority of all partitions decays as the clock advances.
+void touch(stateful_actor<index_state>* self, loaded_partition_state& x) {
+  auto cost = static_cast<double>(default_partition_size);
+  x.priority = self->state.clock + cost / x.bytes;
+}
+
+// Adds a partition to the set of resident partitions.
+void make_resident(stateful_actor<index_state>* self, const uuid& part,
+                   actor p, uint64_t bytes) {
+  auto x = loaded_partition_state{std::move(p), bytes, 0};
+  auto i = self->state.loaded.emplace(part, std::move(x));
+  VAST_ASSERT(i.second);
+  touch(self, i.first->second);
+  self->state.resident += bytes;
+  VAST_DEBUG(self, "holds", self->state.loaded.size(), "partitions with",
+             self->state.resident, '/', self->state.budget, "bytes");
+}
+
+actor spawn_partition(stateful_actor<index_state>* self, const uuid& part,
+                      uint64_t bytes) {
+  auto p = self->spawn<monitored>(partition, partition_dir(self, part));
+  make_resident(self, part, p, bytes);
+  return p;
+}
+
+// Evicts the partition with the lowest priority. Returns false if all
+// resident partitions are being evicted already.
+bool evict(stateful_actor<index_state>* self) {
+  auto victim = self->state.loaded.end();
+  for (auto i = self->state.loaded.begin(); i != self->state.loaded.end(); ++i)
+    if (self->state.evicted.count(i->second.partition) == 0)
+      if (victim == self->state.loaded.end()
+          || i->second.priority < victim->second.priority)
+        victim = i;
+  if (victim == self->state.loaded.end())
+    return false;
+  VAST_DEBUG(self, "evicts partition", victim->first);
+  self->state.clock = victim->second.priority;
+  self->state.evicting += victim->second.bytes;
+  self->state.evicted.emplace(victim->second.partition, victim->first);
+  self->send(victim->second.partition, shutdown_atom::value);
+  return true;
+}
+
+// Evicts as many partitions as necessary to accommodate all queued
+// partitions.
+void make_room(stateful_actor<index_state>* self) {
+  auto needed = uint64_t{0};
+  for (auto& x : self->state.scheduled)
+    needed += x.bytes;
+  auto remaining = [&] {
+    return self->state.resident - self->state.evicting;
+  };
+  while (remaining() + needed > self->state.budget && evict(self))
+    ; // nop
+}
+
+// -- scheduling --------------------------------------------------------------
+
+// Checks whether a sink has lookups in progress.
+bool has_lookups(stateful_actor<index_state>* self, const actor& sink) {
+  auto same_sink = [&](auto& x) { return x.second.sink == sink; };
+  return std::any_of(self->state.lookups.begin(), self->state.lookups.end(),
+                     same_sink);
+}
+
+// Forgets a lookup once it has no more partitions to schedule and none of its
+// partitions awaits spawning. We monitor a sink as long as it has lookups.
+void retire(stateful_actor<index_state>* self, const uuid& lookup) {
+  auto& st = self->state;
+  auto i = st.lookups.find(lookup);
+  if (i == st.lookups.end() || !i->second.partitions.empty())
+    return;
+  for (auto& x : st.scheduled)
+    if (x.lookups.count(lookup) > 0)
+      return;
+  VAST_DEBUG(self, "completed lookup", lookup);
+  auto sink = i->second.sink;
+  st.lookups.erase(i);
+  if (!has_lookups(self, sink))
+    self->demonitor(sink);
+}
+
+// Drops a lookup along with the queued partitions that only it waits for.
+void cancel(stateful_actor<index_state>* self, const uuid& lookup) {
+  auto& scheduled = self->state.scheduled;
+  for (auto& x : scheduled)
+    x.lookups.erase(lookup);
+  auto unused = [](auto& x) { return x.lookups.empty(); };
+  auto i = std::remove_if(scheduled.begin(), scheduled.end(), unused);
+  VAST_DEBUG(self, "erases", scheduled.end() - i, "scheduled partitions");
+  scheduled.erase(i, scheduled.end());
+  auto j = self->state.lookups.find(lookup);
+  if (j == self->state.lookups.end())
+    return;
+  auto sink = j->second.sink;
+  self->state.lookups.erase(j);
+  if (!has_lookups(self, sink))
+    self->demonitor(sink);
 }
 
-// FIXME: erase lookups that have completed.
 void schedule(stateful_actor<index_state>* self, const uuid& part,
               const uuid& lookup) {
   auto& ctx = self->state.lookups[lookup];
@@ -78,76 +287,529 @@ void schedule(stateful_actor<index_state>* self, const uuid& part,
     send_as(ctx.sink, self->state.active.partition, ctx.expr);
     return;
   }
-  // If the partition is loaded, we can also dispatch immediately.
+  // If the partition is loaded, we can also dispatch immediately, unless it's
+  // about to go away.
   auto l = self->state.loaded.find(part);
-  if (l != self->state.loaded.end()) {
+  if (l != self->state.loaded.end()
+      && self->state.evicted.count(l->second.partition) == 0) {
     VAST_DEBUG(self, "dispatches to loaded partition", part);
-    send_as(ctx.sink, l->second, ctx.expr);
-    return;
-  }
-  // If we have enough room, we can spin up the next partition.
-  if (self->state.loaded.size() < self->state.capacity) {
-    VAST_ASSERT(self->state.scheduled.empty());
-    VAST_DEBUG(self, "spawns and dispatches partition", part);
-    auto part_dir = self->state.dir / to_string(part);
-    auto p = self->spawn<monitored>(partition, std::move(part_dir));
-    self->state.loaded.emplace(part, p);
-    send_as(ctx.sink, p, ctx.expr);
+    touch(self, l->second);
+    send_as(ctx.sink, l->second.partition, ctx.expr);
     return;
   }
-  // If we're full, we delay dispatching until having evicted a partition.
-  VAST_DEBUG(self, "queues partition", part);
+  // If the partition is queued already, we piggyback on it.
   auto i = std::find_if(self->state.scheduled.begin(),
                         self->state.scheduled.end(),
                         [&](auto& x) { return x.id == part; });
   if (i != self->state.scheduled.end()) {
-    VAST_ASSERT(!self->state.evicted.empty());
+    VAST_DEBUG(self, "adds lookup to queued partition", part);
     i->lookups.insert(lookup);
-  } else {
-    self->state.scheduled.push_back({part, {lookup}});
-    evict(self);
+    return;
+  }
+  // If we have enough room, we can spin up the partition right away. We
+  // always allow for at least one partition, regardless of its size.
+  auto bytes = estimate_size(self, part);
+  if (l == self->state.loaded.end() && self->state.scheduled.empty()
+      && (fits(self, bytes) || self->state.loaded.empty())) {
+    VAST_DEBUG(self, "spawns and dispatches partition", part);
+    auto p = spawn_partition(self, part, bytes);
+    send_as(ctx.sink, p, ctx.expr);
+    return;
   }
+  // Otherwise we delay dispatching until having evicted enough partitions.
+  VAST_DEBUG(self, "queues partition", part);
+  self->state.scheduled.push_back({part, bytes, {lookup}});
+  make_room(self);
+}
+
+// Spawns queued partitions while they fit into the budget.
+void spawn_scheduled(stateful_actor<index_state>* self) {
+  while (!self->state.scheduled.empty()) {
+    auto& next = self->state.scheduled.front();
+    // A queued partition may still await the completion of its eviction.
+    if (self->state.loaded.count(next.id) > 0)
+      break;
+    if (!fits(self, next.bytes) && !self->state.loaded.empty())
+      break;
+    VAST_DEBUG(self, "spawns next partition", next.id);
+    auto p = spawn_partition(self, next.id, next.bytes);
+    auto lookups = std::move(next.lookups);
+    self->state.scheduled.pop_front();
+    for (auto& id : lookups) {
+      VAST_ASSERT(self->state.lookups.count(id) > 0);
+      auto& ctx = self->state.lookups[id];
+      VAST_DEBUG(self, "dispatches expression", ctx.expr);
+      send_as(ctx.sink, p, ctx.expr);
+      retire(self, id);
+    }
+  }
+  // If we have more pending partitions, try to evict more.
+  if (!self->state.scheduled.empty())
+    make_room(self);
 }
 
-// FIXME: erase lookups that have completed.
 void unschedule(stateful_actor<index_state>* self, const actor& part) {
-  // Check if we got an evicted partition.
   auto i = self->state.evicted.find(part);
   if (i != self->state.evicted.end()) {
     VAST_DEBUG(self, "completed eviction of partition", i->second);
-    self->state.loaded.erase(i->second);
+    auto l = self->state.loaded.find(i->second);
+    VAST_ASSERT(l != self->state.loaded.end());
+    self->state.resident -= l->second.bytes;
+    self->state.evicting -= l->second.bytes;
+    self->state.loaded.erase(l);
     self->state.evicted.erase(i);
-    // Fill the hole if we have scheduled partition.
-    if (!self->state.scheduled.empty()) {
-      auto& next = self->state.scheduled.front();
-      VAST_DEBUG(self, "spawns next partition", next.id);
-      auto part_dir = self->state.dir / to_string(next.id);
-      auto p = self->spawn<monitored>(partition, std::move(part_dir));
-      self->state.loaded.emplace(next.id, p);
-      for (auto& id : next.lookups) {
-        VAST_ASSERT(self->state.lookups.count(id) > 0);
-        auto& ctx = self->state.lookups[id];
-        VAST_DEBUG(self, "dispatches expression", ctx.expr);
-        send_as(ctx.sink, p, ctx.expr);
+  } else {
+    // A partition may also terminate on its own, e.g., due to an error.
+    auto pred = [&](auto& x) { return x.second.partition == part; };
+    auto l = std::find_if(self->state.loaded.begin(),
+                          self->state.loaded.end(), pred);
+    if (l == self->state.loaded.end())
+      return;
+    VAST_DEBUG(self, "lost partition", l->first);
+    self->state.resident -= l->second.bytes;
+    self->state.loaded.erase(l);
+  }
+  // Fill the hole with scheduled partitions.
+  spawn_scheduled(self);
+}
+
+// Loads the partitions that a lookup will request next, as long as they fit
+// into the budget without evicting other partitions.
+void prefetch(stateful_actor<index_state>* self, const uuid& lookup,
+              size_t n) {
+  auto& ctx = self->state.lookups[lookup];
+  n = std::min(ctx.partitions.size(), n);
+  for (auto i = ctx.partitions.rbegin(); i != ctx.partitions.rbegin() + n;
+       ++i) {
+    // Partitions waiting in the queue take precedence over prefetching.
+    if (!self->state.scheduled.empty())
+      return;
+    if (*i == self->state.active.id || self->state.loaded.count(*i) > 0)
+      continue;
+    auto bytes = estimate_size(self, *i);
+    if (!fits(self, bytes))
+      return;
+    VAST_DEBUG(self, "prefetches partition", *i);
+    auto p = spawn_partition(self, *i, bytes);
+    self->send(p, load_atom::value, ctx.expr);
+  }
+}
+
+// -- persistence -------------------------------------------------------------
+
+// Writes the partition index without blocking the INDEX and hands the outcome
+// to *f*. The FILESYSTEM replaces the file atomically, such that a crash
+// during a periodic flush leaves the previous version intact, and performs
+// successive writes in order.
+template <class F>
+void persist(stateful_actor<index_state>* self, F f) {
+  VAST_DEBUG(self, "persists partition index");
+  std::vector<char> bytes;
+  auto result = save(bytes, self->state.part_index);
+  if (!result) {
+    f(std::move(result));
+    return;
+  }
+  submit(self, self->state.filesystem, write_atom::value,
+         self->state.dir / "meta", std::move(bytes), f);
+}
+
+// Removes obsolete partitions from the file system in its own thread.
+behavior remover(event_based_actor* self) {
+  return {
+    [=](const std::vector<path>& dirs) {
+      self->quit();
+      for (auto& x : dirs)
+        if (exists(x))
+          rm(x);
+    }
+  };
+}
+
+// Removes partitions without blocking the INDEX.
+void discard(stateful_actor<index_state>* self, std::vector<path> dirs) {
+  if (!dirs.empty())
+    self->send(self->spawn<detached>(remover), std::move(dirs));
+}
+
+// Flushes a partition to the file system and invokes `f` once the partition
+// has written its state.
+template <class F>
+void flush(stateful_actor<index_state>* self,
+           const active_partition_state& part, F f) {
+  auto id = part.id;
+  VAST_DEBUG(self, "flushes partition", id);
+  self->request(part.partition, infinite, flush_atom::value).then(
+    [=](ok_atom) mutable {
+      VAST_DEBUG(self, "flushed partition", id);
+      f();
+    },
+    [=](const error& e) {
+      VAST_ERROR(self, "failed to flush partition", id << ':',
+                 self->system().render(e));
+    }
+  );
+}
+
+void flush(stateful_actor<index_state>* self,
+           const active_partition_state& part) {
+  flush(self, part, [] { /* nop */ });
+}
+
+// -- compaction --------------------------------------------------------------
+
+// Checks whether no part of the INDEX currently uses a partition, i.e.,
+// whether we can replace it on the file system.
+bool idle(stateful_actor<index_state>* self, const uuid& part) {
+  if (part == self->state.active.id || self->state.loaded.count(part) > 0)
+    return false;
+  for (auto& x : self->state.scheduled)
+    if (x.id == part)
+      return false;
+  for (auto& x : self->state.lookups) {
+    auto& xs = x.second.partitions;
+    if (std::find(xs.begin(), xs.end(), part) != xs.end())
+      return false;
+  }
+  return true;
+}
+
+// Selects the first run of adjacent small partitions, ordered by time, whose
+// events fit into a single partition. A partition counts as small if it holds
+// less than half of the maximum number of events. We leave partitions in the
+// cold tier alone.
+std::vector<uuid> select_compaction(stateful_actor<index_state>* self,
+                                    size_t max_events) {
+  auto& parts = self->state.part_index.partitions();
+  std::vector<std::pair<timestamp, uuid>> xs;
+  xs.reserve(parts.size());
+  for (auto& x : parts)
+    xs.emplace_back(x.second.range.from, x.first);
+  std::sort(xs.begin(), xs.end());
+  std::vector<uuid> run;
+  size_t events = 0;
+  for (auto& x : xs) {
+    auto& synopsis = parts.at(x.second);
+    auto n = synopsis.events;
+    auto eligible = n < max_events / 2 && !synopsis.cold
+                    && idle(self, x.second);
+    if (eligible && events + n <= max_events) {
+      run.push_back(x.second);
+      events += n;
+      continue;
+    }
+    if (run.size() > 1)
+      return run;
+    run.clear();
+    events = 0;
+    if (eligible) {
+      run.push_back(x.second);
+      events = n;
+    }
+  }
+  if (run.size() < 2)
+    run.clear();
+  return run;
+}
+
+// Merges partitions on the file system. The merge runs in its own thread to
+// keep the INDEX responsive. The merged partition appears atomically under
+// its final name.
+behavior compactor(event_based_actor* self) {
+  return {
+    [=](const std::vector<path>& sources, const path& dir) -> result<ok_atom> {
+      self->quit();
+      auto tmp = dir + ".tmp";
+      auto result = merge_partitions(sources, tmp);
+      if (result)
+        result = rename(tmp, dir);
+      if (!result) {
+        if (exists(tmp))
+          rm(tmp);
+        return result.error();
       }
-      self->state.scheduled.pop_front();
-      // If we have more pending partitions, try to evict more.
-      if (self->state.scheduled.size() > self->state.evicted.size())
-        evict(self);
+      return ok_atom::value;
     }
+  };
+}
+
+// Merges a run of small partitions into a single one and reports the number
+// of merged partitions to *done*.
+void compact(stateful_actor<index_state>* self, size_t max_events,
+             std::function<void(size_t)> done) {
+  // Tiering may delete or move the partitions that we would merge, so we
+  // wait for it to finish.
+  if (self->state.compacting || self->state.tiering) {
+    done(0);
+    return;
+  }
+  auto parts = select_compaction(self, max_events);
+  if (parts.empty()) {
+    done(0);
+    return;
   }
+  auto id = uuid::random();
+  VAST_DEBUG(self, "merges", parts.size(), "partitions into", id);
+  self->state.compacting = true;
+  std::vector<path> sources;
+  for (auto& x : parts)
+    sources.push_back(self->state.dir / to_string(x));
+  auto part_dir = self->state.dir / to_string(id);
+  auto c = self->spawn<detached>(compactor);
+  self->request(c, infinite, std::move(sources), part_dir).then(
+    [=](ok_atom) {
+      // A lookup may have loaded one of the partitions in the meantime, in
+      // which case we try again later.
+      for (auto& x : parts)
+        if (!idle(self, x)) {
+          VAST_DEBUG(self, "discards merged partition", id);
+          self->state.compacting = false;
+          discard(self, {part_dir});
+          done(0);
+          return;
+        }
+      self->state.part_index.merge(parts, id);
+      auto& sizes = self->state.sizes;
+      auto bytes = uint64_t{0};
+      for (auto& x : parts) {
+        auto i = sizes.find(x);
+        if (i != sizes.end()) {
+          bytes += i->second;
+          sizes.erase(i);
+        }
+      }
+      if (bytes > 0)
+        sizes[id] = bytes;
+      persist(self, [=](expected<void> result) {
+        self->state.compacting = false;
+        if (!result) {
+          // The persistent partition index still refers to the original
+          // partitions, which we therefore keep.
+          VAST_ERROR(self, "failed to persist partition index:",
+                     self->system().render(result.error()));
+        } else {
+          std::vector<path> obsolete;
+          for (auto& x : parts)
+            obsolete.push_back(self->state.dir / to_string(x));
+          discard(self, std::move(obsolete));
+        }
+        done(parts.size());
+      });
+    },
+    [=](const error& e) {
+      self->state.compacting = false;
+      VAST_ERROR(self, "failed to merge partitions:",
+                 self->system().render(e));
+      done(0);
+    }
+  );
+}
+
+// -- tiering -----------------------------------------------------------------
+
+// Copies partitions into the cold tier. The copy runs in its own thread to
+// keep the INDEX responsive. Each copy appears atomically under its final
+// name.
+behavior copier(event_based_actor* self) {
+  return {
+    [=](const std::vector<path>& sources, const path& dir) -> result<ok_atom> {
+      self->quit();
+      if (!exists(dir)) {
+        auto result = mkdir(dir);
+        if (!result)
+          return result.error();
+      }
+      for (auto& x : sources) {
+        auto tmp = dir / (x.basename().str() + ".tmp");
+        if (exists(tmp))
+          rm(tmp);
+        auto result = copy(x, tmp);
+        if (result)
+          result = rename(tmp, dir / x.basename());
+        if (!result)
+          return result.error();
+      }
+      return ok_atom::value;
+    }
+  };
+}
+
+// Moves partitions into the cold tier and reports the number of moved
+// partitions to *done*.
+void move_to_cold_tier(stateful_actor<index_state>* self,
+                       std::vector<uuid> parts,
+                       std::function<void(size_t)> done) {
+  auto& policy = self->state.policy;
+  VAST_DEBUG(self, "moves", parts.size(), "partitions to", policy.cold_dir);
+  std::vector<path> sources;
+  for (auto& x : parts)
+    sources.push_back(self->state.dir / to_string(x));
+  auto c = self->spawn<detached>(copier);
+  self->request(c, infinite, std::move(sources), policy.cold_dir).then(
+    [=](ok_atom) {
+      auto& st = self->state;
+      // A lookup may have loaded one of the partitions in the meantime, in
+      // which case we keep using the original and try again later.
+      std::vector<uuid> moved;
+      std::vector<path> discarded;
+      for (auto& x : parts) {
+        if (st.part_index.partitions().count(x) > 0 && idle(self, x)) {
+          st.part_index.freeze(x);
+          moved.push_back(x);
+        } else {
+          discarded.push_back(st.policy.cold_dir / to_string(x));
+        }
+      }
+      persist(self, [=](expected<void> result) mutable {
+        if (!result) {
+          // The persistent partition index still refers to the original
+          // partitions, which we therefore keep.
+          VAST_ERROR(self, "failed to persist partition index:",
+                     self->system().render(result.error()));
+        } else {
+          for (auto& x : moved)
+            discarded.push_back(self->state.dir / to_string(x));
+        }
+        discard(self, std::move(discarded));
+        done(moved.size());
+      });
+    },
+    [=](const error& e) {
+      VAST_ERROR(self, "failed to move partitions:", self->system().render(e));
+      done(0);
+    }
+  );
+}
+
+// Applies the tiering policy, given the sizes of the partitions on the file
+// system. See ::tier.
+void tier(stateful_actor<index_state>* self,
+          const std::unordered_map<uuid, uint64_t>& sizes,
+          std::function<void(size_t)> done) {
+  auto& st = self->state;
+  auto& policy = st.policy;
+  auto now = time_point_cast<timespan>(timestamp::clock::now());
+  std::vector<std::pair<timestamp, uuid>> xs;
+  auto total = uint64_t{0};
+  for (auto& x : st.part_index.partitions()) {
+    auto i = sizes.find(x.first);
+    if (i != sizes.end())
+      total += i->second;
+    if (x.first != st.active.id)
+      xs.emplace_back(x.second.range.to, x.first);
+  }
+  std::sort(xs.begin(), xs.end());
+  // Delete the oldest partitions first. We stop at the first partition in
+  // use, because deleting a younger one instead would violate the order.
+  std::vector<uuid> expired;
+  std::vector<path> obsolete;
+  auto i = xs.begin();
+  for (; i != xs.end(); ++i) {
+    auto too_old = older_than(i->first, policy.max_age, now);
+    auto too_big = policy.max_bytes > 0 && total > policy.max_bytes;
+    if (!too_old && !too_big)
+      break;
+    if (!idle(self, i->second))
+      break;
+    VAST_DEBUG(self, "deletes partition", i->second);
+    obsolete.push_back(partition_dir(self, i->second));
+    st.part_index.erase(i->second);
+    st.sizes.erase(i->second);
+    auto j = sizes.find(i->second);
+    if (j != sizes.end())
+      total -= j->second;
+    expired.push_back(i->second);
+  }
+  // Only remove the partitions after the persistent partition index no
+  // longer refers to them.
+  if (!expired.empty())
+    persist(self, [=](expected<void> result) mutable {
+      if (result)
+        discard(self, std::move(obsolete));
+      else
+        VAST_ERROR(self, "failed to persist partition index:",
+                   self->system().render(result.error()));
+    });
+  // Move the remaining old partitions to the cold tier.
+  std::vector<uuid> parts;
+  if (!policy.cold_dir.empty())
+    for (; i != xs.end(); ++i) {
+      if (!older_than(i->first, policy.cold_after, now))
+        break;
+      if (!st.part_index.partitions().at(i->second).cold
+          && idle(self, i->second))
+        parts.push_back(i->second);
+    }
+  if (parts.empty()) {
+    done(expired.size());
+    return;
+  }
+  auto n = expired.size();
+  move_to_cold_tier(self, std::move(parts), [=](size_t moved) {
+    done(n + moved);
+  });
+}
+
+// Applies the tiering policy to the passive partitions: deletes the oldest
+// ones while they exceed the retention limits and moves the remaining ones
+// to the cold tier once they are old enough. Reports the number of deleted
+// and moved partitions to *done*. All file system operations run outside of
+// the INDEX.
+void tier(stateful_actor<index_state>* self, std::function<void(size_t)> done) {
+  auto& st = self->state;
+  // A running compaction still relies on its source partitions, and the
+  // partition it produces is not yet known to the partition index.
+  if (st.tiering || st.compacting) {
+    done(0);
+    return;
+  }
+  st.tiering = true;
+  auto finish = [=](size_t n) {
+    self->state.tiering = false;
+    done(n);
+  };
+  if (st.policy.max_bytes == 0) {
+    tier(self, {}, finish);
+    return;
+  }
+  std::vector<uuid> parts;
+  std::vector<path> dirs;
+  for (auto& x : st.part_index.partitions()) {
+    parts.push_back(x.first);
+    dirs.push_back(partition_dir(self, x.first));
+  }
+  auto m = self->spawn<detached>(measurer);
+  self->request(m, infinite, std::move(dirs)).then(
+    [=](const std::vector<uint64_t>& xs) {
+      std::unordered_map<uuid, uint64_t> sizes;
+      for (auto i = 0u; i < parts.size(); ++i) {
+        sizes.emplace(parts[i], xs[i]);
+        if (xs[i] > 0 && self->state.part_index.partitions().count(parts[i]))
+          self->state.sizes[parts[i]] = xs[i];
+      }
+      tier(self, sizes, finish);
+    },
+    [=](const error& e) {
+      VAST_ERROR(self, "failed to measure partitions:",
+                 self->system().render(e));
+      finish(0);
+    }
+  );
 }
 
 } // namespace <anonymous>
 
 behavior index(stateful_actor<index_state>* self, const path& dir,
-               size_t max_events, size_t max_parts, size_t taste_parts) {
+               size_t max_events, uint64_t max_bytes, size_t taste_parts,
+               timespan flush_interval, tiering_policy policy) {
   VAST_ASSERT(max_events > 0);
-  VAST_ASSERT(max_parts > 0);
+  VAST_ASSERT(max_bytes > 0);
   VAST_DEBUG(self, "caps partitions at", max_events, "events");
-  VAST_DEBUG(self, "keeps at most", max_parts, "partitions in memory");
-  self->state.capacity = max_parts;
+  VAST_DEBUG(self, "keeps at most", max_bytes, "bytes of partitions in memory");
+  self->state.budget = max_bytes;
   self->state.dir = dir;
+  self->state.policy = std::move(policy);
+  self->state.filesystem = get_filesystem(self->system());
   auto accountant = accountant_type{};
   if (auto a = self->system().registry().get(accountant_atom::value))
     accountant = actor_cast<accountant_type>(a);
@@ -160,24 +822,33 @@ behavior index(stateful_actor<index_state>* self, const path& dir,
       self->quit(result.error());
       return {};
     }
+    std::vector<uuid> parts;
+    for (auto& x : self->state.part_index.partitions())
+      parts.push_back(x.first);
+    measure(self, parts);
   }
   self->set_exit_handler(
     [=](const exit_msg& msg) {
+      // Save our own state only if we have written something.
+      auto persisted = std::make_shared<bool>(!self->state.active.partition);
       auto can_terminate = [=] {
-        return !self->state.active.partition && self->state.loaded.empty();
+        return *persisted && !self->state.active.partition
+               && self->state.loaded.empty();
       };
       // Shut down all partitions.
       if (!can_terminate()) {
         if (self->state.active.partition)
           self->send(self->state.active.partition, shutdown_atom::value);
         for (auto& x : self->state.loaded)
-          self->send(x.second, shutdown_atom::value);
+          self->send(x.second.partition, shutdown_atom::value);
         self->set_down_handler(
           [=](const down_msg& msg) {
             if (self->state.active.partition == msg.source) {
               self->state.active.partition = {};
             } else {
-              auto pred = [&](auto& x) { return x.second == msg.source; };
+              auto pred = [&](auto& x) {
+                return x.second.partition == msg.source;
+              };
               auto i = std::find_if(self->state.loaded.begin(),
                                     self->state.loaded.end(), pred);
               if (i != self->state.loaded.end())
@@ -188,53 +859,48 @@ behavior index(stateful_actor<index_state>* self, const path& dir,
           }
         );
       }
-      // Save our own state only if we have written something.
-      if (self->state.active.partition) {
-        VAST_DEBUG(self, "persists partition index");
-        if (!exists(self->state.dir)) {
-          auto result = mkdir(self->state.dir);
-          if (!result) {
-            VAST_ERROR(self, self->system().render(result.error()));
-            self->quit(result.error());
-            return;
-          }
-        }
-        auto result = save(self->state.dir / "meta",
-                           self->state.part_index);
+      if (*persisted) {
+        if (can_terminate())
+          self->quit(msg.reason);
+        return;
+      }
+      persist(self, [=](expected<void> result) {
         if (!result) {
           VAST_ERROR(self, "failed to persist partition index:",
                      self->system().render(result.error()));
           self->quit(result.error());
           return;
         }
-      }
-      if (can_terminate())
-        self->quit(msg.reason);
+        *persisted = true;
+        if (can_terminate())
+          self->quit(msg.reason);
+      });
     }
   );
   self->set_down_handler(
     [=](const down_msg& msg) {
-      auto i = std::find_if(
-        self->state.lookups.begin(),
-        self->state.lookups.end(),
-        [&](auto& x) { return x.second.sink == msg.source; });
-      if (i != self->state.lookups.end()) {
-        // A lookup actor went down. We can remove all queued partitions where
-        // this actor was the only lookup.
-        auto is_only_lookup = [&](auto& x) {
-          return x.lookups.size() == 1 && x.lookups.count(i->first) > 0;
-        };
-        auto j = std::remove_if(self->state.scheduled.begin(),
-                                self->state.scheduled.end(), is_only_lookup);
-        auto n = self->state.scheduled.end() - j;
-        VAST_DEBUG(self, "erasing", n, "scheduled lookups");
-        self->state.scheduled.erase(j, self->state.scheduled.end());
+      std::vector<uuid> lookups;
+      for (auto& x : self->state.lookups)
+        if (x.second.sink == msg.source)
+          lookups.push_back(x.first);
+      if (!lookups.empty()) {
+        // A lookup actor went down. We drop its lookups and all queued
+        // partitions where this actor was the only lookup.
+        for (auto& x : lookups)
+          cancel(self, x);
       } else {
         // A partition went down.
         unschedule(self, actor_cast<actor>(msg.source));
       }
     }
   );
+  // Kick off flush loop.
+  if (flush_interval > timespan::zero())
+    delayed_anon_send(self, flush_interval, flush_atom::value);
+  // Kick off tiering loop. The anonymous message distinguishes the loop from
+  // explicit requests.
+  if (self->state.policy.enabled())
+    delayed_anon_send(self, self->state.policy.interval, tier_atom::value);
   return {
     [=](const std::vector<event>& events) {
       VAST_DEBUG(self, "got", events.size(), "events ["
@@ -245,13 +911,17 @@ behavior index(stateful_actor<index_state>* self, const path& dir,
       if (partition_full || !self->state.active.partition) {
         if (partition_full) {
           VAST_DEBUG(self, "encountered full partition");
-          if (self->state.loaded.size() == self->state.capacity) {
+          auto bytes = estimate_size(self, self->state.active.id);
+          if (!self->state.scheduled.empty() || !fits(self, bytes)) {
             VAST_DEBUG(self, "evicts active partition");
             self->send(self->state.active.partition, shutdown_atom::value);
           } else {
             VAST_DEBUG(self, "moves active partition to cache");
-            self->state.loaded.emplace(self->state.active.id,
-                                       self->state.active.partition);
+            make_resident(self, self->state.active.id,
+                          self->state.active.partition, bytes);
+            // A passive partition receives no more events, so we persist
+            // it right away instead of on eviction.
+            flush(self, self->state.active);
           }
         }
         auto id = uuid::random();
@@ -275,10 +945,14 @@ behavior index(stateful_actor<index_state>* self, const path& dir,
         VAST_DEBUG(self, "returns without result: no partitions qualify");
         return {id, 0, 0};
       }
+      // We schedule partitions from the back, i.e., the oldest ones first, so
+      // that results arrive in roughly chronological order.
+      std::reverse(partitions.begin(), partitions.end());
       // Construct a new lookup context.
       VAST_DEBUG(self, "creates new lookup context", id);
+      if (!has_lookups(self, sender))
+        self->monitor(sender);
       auto ctx = self->state.lookups.insert({id, {expr, sender, {}}});
-      self->monitor(sender);
       VAST_ASSERT(ctx.second);
       // TODO: make initial value configurable and figure out a more meaningful
       // way to select the first N partitions, e.g., based on accumulated
@@ -291,14 +965,21 @@ behavior index(stateful_actor<index_state>* self, const path& dir,
         schedule(self, *i, id);
       partitions.resize(partitions.size() - n);
       ctx.first->second.partitions = std::move(partitions);
+      prefetch(self, id, taste_parts);
+      retire(self, id);
       return {id, num_partitions, n};
     },
     [=](uuid const& id, size_t n) {
-      auto& ctx = self->state.lookups[id];
+      auto x = self->state.lookups.find(id);
+      if (x == self->state.lookups.end()) {
+        VAST_DEBUG(self, "ignores request for completed lookup", id);
+        return;
+      }
+      auto& ctx = x->second;
       VAST_DEBUG(self, "processes lookup", id << ':', ctx.expr);
       if (n == 0) {
         VAST_DEBUG(self, "cancels lookup");
-        self->state.lookups.erase(id);
+        cancel(self, id);
         return;
       }
       n = std::min(ctx.partitions.size(), n);
@@ -306,6 +987,35 @@ behavior index(stateful_actor<index_state>* self, const path& dir,
       for (auto i = ctx.partitions.end() - n; i != ctx.partitions.end(); ++i)
         schedule(self, *i, id);
       ctx.partitions.resize(ctx.partitions.size() - n);
+      prefetch(self, id, n);
+      retire(self, id);
+    },
+    [=](flush_atom) {
+      if (self->state.active.partition) {
+        // Only record the partition in the persistent partition index after
+        // it has made it to the file system.
+        flush(self, self->state.active, [=] {
+          persist(self, [=](expected<void> result) {
+            if (!result)
+              VAST_ERROR(self, "failed to persist partition index:",
+                         self->system().render(result.error()));
+          });
+        });
+      }
+      compact(self, max_events, [](size_t) { /* nop */ });
+      // Only the timer re-arms itself, explicit flush requests don't.
+      if (!self->current_sender() && flush_interval > timespan::zero())
+        delayed_anon_send(self, flush_interval, flush_atom::value);
+    },
+    [=](compact_atom) {
+      auto rp = self->make_response_promise<size_t>();
+      compact(self, max_events, [=](size_t n) mutable { rp.deliver(n); });
+    },
+    [=](tier_atom) {
+      auto rp = self->make_response_promise<size_t>();
+      tier(self, [=](size_t n) mutable { rp.deliver(n); });
+      if (!self->current_sender() && self->state.policy.enabled())
+        delayed_anon_send(self, self->state.policy.interval, tier_atom::value);
     },
   };
 }
@@ -1,5 +1,6 @@
 #include <caf/all.hpp>
 
+#include "vast/chunk.hpp"
 #include "vast/concept/parseable/to.hpp"
 #include "vast/concept/parseable/vast/type.hpp"
 #include "vast/concept/printable/stream.hpp"
@@ -7,6 +8,8 @@
 #include "vast/concept/printable/vast/filesystem.hpp"
 #include "vast/concept/printable/vast/key.hpp"
 #include "vast/detail/assert.hpp"
+#include "vast/detail/cache.hpp"
+#include "vast/detail/chunk_deserializer.hpp"
 #include "vast/event.hpp"
 #include "vast/expression.hpp"
 #include "vast/expression_visitors.hpp"
@@ -17,7 +20,9 @@
 #include "vast/save.hpp"
 #include "vast/value_index.hpp"
 
+#include "vast/system/accountant.hpp"
 #include "vast/system/atoms.hpp"
+#include "vast/system/filesystem.hpp"
 #include "vast/system/indexer.hpp"
 
 using namespace caf;
@@ -26,84 +31,390 @@ namespace vast {
 namespace system {
 namespace {
 
+// The maximum number of lookup results to cache per value index.
+constexpr size_t max_cache_entries = 64;
+
+// The maximum number of bytes that cached lookup results may occupy per value
+// index.
+constexpr uint64_t max_cache_bytes = 4 << 20;
+
+// The maximum number of rows to index twice for extending stale cache entries.
+constexpr value_index::size_type max_delta_rows = 1 << 16;
+
+// The maximum number of segments in an index file before a flush rewrites the
+// file as a single segment.
+constexpr size_t max_segments = 16;
+
+// Each segment of an index file starts with a magic number and a format
+// version. Version 1 introduced the value statistics of value indexes and
+// the lazily loaded bitmaps of coders. Files from before have no header and
+// require rebuilding the index.
+constexpr uint32_t index_file_magic = 0x56495846;
+constexpr uint32_t index_file_version = 1;
+
+// Approximates the memory footprint of a bitmap.
+uint64_t footprint(bitmap const& bm) {
+  uint64_t result = sizeof(bitmap);
+  for (auto bits : bit_range(bm)) {
+    static_cast<void>(bits);
+    result += sizeof(bitmap::block_type);
+  }
+  return result;
+}
+
+// A cached lookup result.
+struct lookup_cache_entry {
+  bitmap hits;
+  value_index::size_type offset;
+  uint64_t bytes;
+};
+
 struct value_indexer_state {
   path filename;
   vast::type type;
+  // Holds all rows up to the last flush. The index file stores these rows as
+  // a sequence of segments, each of which covers the rows since the flush
+  // before.
   std::unique_ptr<value_index> idx;
+  // Holds the rows since the last flush, relative to *last_flush*.
+  std::unique_ptr<value_index> tail;
   value_index::size_type last_flush = 0;
+  size_t segments = 0;
+  // Set when the index file needs a rewrite, e.g., because a crash during a
+  // flush left a truncated segment behind or because a write failed.
+  bool rewrite = false;
+  // Caches lookup results, which remain valid for all rows up to the offset
+  // of the index at the time of the lookup.
+  detail::cache<predicate, lookup_cache_entry> cache{max_cache_entries};
+  uint64_t cache_bytes = 0;
+  uint64_t cache_hits = 0; // since the last report
+  uint64_t cache_misses = 0; // since the last report
+  // Indexes the rows since *delta_offset* while we have cached results, so
+  // that we can extend stale results by looking up only appended rows.
+  std::unique_ptr<value_index> delta;
+  value_index::size_type delta_offset = 0;
+  accountant_type accountant;
+  filesystem_type filesystem;
   const char* name = "value-indexer";
 };
 
+// Returns the number of rows in the index, including the unflushed ones.
+value_index::size_type offset(value_indexer_state const& st) {
+  return st.last_flush + st.tail->offset();
+}
+
+// Looks up a predicate in both the flushed and the unflushed rows.
+expected<bitmap> lookup(value_indexer_state const& st, relational_operator op,
+                        data const& x) {
+  auto result = st.idx->lookup(op, x);
+  if (!result || st.tail->offset() == 0)
+    return result;
+  auto tail = st.tail->lookup(op, x);
+  if (!tail)
+    return tail;
+  VAST_ASSERT(result->size() <= st.last_flush);
+  result->append_bits(false, st.last_flush - result->size());
+  result->append(*tail);
+  return result;
+}
+
+// Drops all stale cache entries and restarts the delta index at the current
+// offset.
+void rebase(stateful_actor<value_indexer_state>* self) {
+  auto& st = self->state;
+  std::vector<predicate> stale;
+  for (auto& x : st.cache)
+    if (x.second.offset < offset(st))
+      stale.push_back(x.first);
+  for (auto& pred : stale) {
+    auto i = st.cache.find(pred);
+    st.cache_bytes -= i->second.bytes;
+    st.cache.erase(pred);
+  }
+  if (st.cache.empty()) {
+    st.delta = nullptr;
+  } else {
+    st.delta = value_index::make(st.type);
+    st.delta_offset = offset(st);
+  }
+  VAST_DEBUG(self, "dropped", stale.size(), "stale cache entries");
+}
+
+// Looks up a predicate, consulting the cache first.
+expected<bitmap> cached_lookup(stateful_actor<value_indexer_state>* self,
+                               predicate const& pred) {
+  auto& st = self->state;
+  auto& x = get<data>(pred.rhs);
+  auto i = st.cache.find(pred);
+  if (i != st.cache.end()) {
+    ++st.cache_hits;
+    auto& entry = i->second;
+    if (entry.offset < offset(st)) {
+      // Extend the stale result with the hits from the appended rows only.
+      VAST_ASSERT(st.delta && entry.offset >= st.delta_offset);
+      auto delta = st.delta->lookup(pred.op, x);
+      if (!delta)
+        return delta;
+      entry.hits |= *delta;
+      entry.offset = offset(st);
+      st.cache_bytes -= entry.bytes;
+      entry.bytes = footprint(entry.hits);
+      st.cache_bytes += entry.bytes;
+    }
+    return entry.hits;
+  }
+  ++st.cache_misses;
+  auto result = lookup(st, pred.op, x);
+  if (!result)
+    return result;
+  auto bytes = footprint(*result);
+  if (bytes > max_cache_bytes)
+    return result;
+  while (!st.cache.empty() && st.cache_bytes + bytes > max_cache_bytes)
+    st.cache.evict();
+  if (!st.delta) {
+    st.delta = value_index::make(st.type);
+    st.delta_offset = offset(st);
+  }
+  st.cache.emplace(pred, lookup_cache_entry{*result, offset(st), bytes});
+  st.cache_bytes += bytes;
+  return result;
+}
+
+// The outcome of replaying the segments of an index file.
+struct replay_result {
+  size_t segments = 0;
+  bool truncated = false;
+};
+
+// Replays the segments of an index file. Loading maps the file into memory
+// and reads only the skeleton of the first segment, whose bitmaps materialize
+// on first access. Subsequent segments get appended to the first one.
+expected<replay_result> replay_segments(path const& filename, type const& t,
+                                        std::unique_ptr<value_index>& idx) {
+  auto chk = chunk::mmap(filename);
+  if (!chk)
+    return make_error(ec::filesystem_error, "failed to map file", filename);
+  replay_result result;
+  detail::chunk_deserializer source{chk};
+  while (source.tell() < chk->size()) {
+    uint32_t magic = 0;
+    uint32_t version = 0;
+    value_index::size_type to;
+    std::unique_ptr<value_index> segment;
+    try {
+      detail::read(source, magic, version);
+      if (magic != index_file_magic)
+        return make_error(ec::format_error, "unversioned index file",
+                          filename);
+      if (version != index_file_version)
+        return make_error(ec::version_error, filename, version,
+                          index_file_version);
+      detail::value_index_inspect_helper tmp{t, segment};
+      detail::read(source, to, tmp);
+    } catch (std::exception const&) {
+      // A crash during a flush leaves a truncated segment at the end of the
+      // file, which we ignore.
+      result.truncated = true;
+      break;
+    }
+    // A failed append followed by successful ones leaves a gap in the file,
+    // which we treat like a truncated segment: everything before the gap
+    // remains usable.
+    auto from = idx ? idx->offset() : value_index::size_type{0};
+    if (from + segment->offset() != to) {
+      result.truncated = true;
+      break;
+    }
+    if (!idx) {
+      idx = std::move(segment);
+    } else {
+      auto appended = idx->append(*segment);
+      if (!appended)
+        return appended.error();
+    }
+    if (idx->offset() != to)
+      return make_error(ec::unspecified, "segment offset mismatch:",
+                        idx->offset(), "!=", to);
+    ++result.segments;
+  }
+  if (!idx)
+    idx = value_index::make(t);
+  return result;
+}
+
+// Writes the unflushed rows to the index file and moves them to the flushed
+// index. Normally a flush appends a single segment to the file. Once the file
+// has accumulated too many segments, or when the caller asks for it, the
+// flush rewrites the file as a single segment instead. The FILESYSTEM performs
+// the write, if available, and *f* receives its outcome.
+template <class F>
+void flush(stateful_actor<value_indexer_state>* self, bool compact, F f) {
+  auto& st = self->state;
+  auto rewrite = st.rewrite || st.segments >= max_segments
+                 || (compact && st.segments > 1);
+  if (!rewrite && st.tail->offset() == 0) {
+    f(expected<void>{});
+    return;
+  }
+  auto to = offset(st);
+  VAST_DEBUG(self, "flushes index (" << (to - st.last_flush) << '/' << to,
+             "new/total bits)");
+  std::vector<char> bytes;
+  if (!rewrite) {
+    detail::value_index_inspect_helper tmp{st.type, st.tail};
+    auto result = save(bytes, index_file_magic, index_file_version, to, tmp);
+    if (!result) {
+      f(std::move(result));
+      return;
+    }
+  }
+  auto result = st.idx->append(*st.tail);
+  if (!result) {
+    f(std::move(result));
+    return;
+  }
+  st.tail = value_index::make(st.type);
+  st.last_flush = to;
+  auto done = [=](expected<void> x) mutable {
+    if (!x)
+      self->state.rewrite = true;
+    f(std::move(x));
+  };
+  if (!rewrite) {
+    ++st.segments;
+    submit(self, st.filesystem, append_atom::value, st.filename,
+           std::move(bytes), done);
+    return;
+  }
+  // The index may still reference the mapped file, which we therefore
+  // replace atomically instead of overwriting it in place.
+  detail::value_index_inspect_helper tmp{st.type, st.idx};
+  result = save(bytes, index_file_magic, index_file_version, to, tmp);
+  if (!result) {
+    st.rewrite = true;
+    f(std::move(result));
+    return;
+  }
+  st.rewrite = false;
+  st.segments = 1;
+  submit(self, st.filesystem, write_atom::value, st.filename,
+         std::move(bytes), done);
+}
+
 // Wraps a value index into an actor.
 template <class Extract>
 behavior value_indexer(stateful_actor<value_indexer_state>* self,
                        path filename, type index_type, Extract extract) {
   self->state.type = std::move(index_type);
   self->state.filename = std::move(filename);
+  if (auto a = self->system().registry().get(accountant_atom::value))
+    self->state.accountant = actor_cast<accountant_type>(a);
+  self->state.filesystem = get_filesystem(self->system());
+  self->state.cache.on_evict(
+    [=](predicate&, lookup_cache_entry& x) {
+      self->state.cache_bytes -= x.bytes;
+    }
+  );
   if (exists(self->state.filename)) {
-    // Materialize the index when encountering persistent state.
-    detail::value_index_inspect_helper tmp{self->state.type, self->state.idx};
-    auto result = load(self->state.filename, self->state.last_flush, tmp);
+    auto& st = self->state;
+    auto result = replay_segments(st.filename, st.type, st.idx);
     if (!result) {
       VAST_ERROR(self, "failed to load bitmap index:",
                  self->system().render(result.error()));
       self->quit(result.error());
-    } else {
-      VAST_DEBUG(self, "loaded value index with offset",
-                 self->state.idx->offset());
+      return {};
+    }
+    if (result->truncated) {
+      // We overwrite the unusable segments with the next flush.
+      VAST_WARNING(self, "ignores truncated segments in", st.filename);
+      st.rewrite = true;
     }
+    st.segments = result->segments;
+    st.last_flush = st.idx->offset();
+    VAST_DEBUG(self, "loaded value index with offset",
+               self->state.idx->offset(), "from", self->state.segments,
+               "segments");
   } else {
     // Otherwise construct a new one.
     self->state.idx = value_index::make(self->state.type);
-    if (!self->state.idx)
+    if (!self->state.idx) {
       self->quit(make_error(ec::unspecified, "failed to construct index"));
+      return {};
+    }
   }
+  self->state.tail = value_index::make(self->state.type);
+  // Reports the cache statistics of the interval since the last report, on
+  // every flush and on shutdown.
+  auto report = [=] {
+    auto& st = self->state;
+    auto lookups = st.cache_hits + st.cache_misses;
+    if (!st.accountant || lookups == 0)
+      return;
+    self->send(st.accountant, "indexer.cache.hits", st.cache_hits);
+    self->send(st.accountant, "indexer.cache.misses", st.cache_misses);
+    self->send(st.accountant, "indexer.cache.hit.rate",
+               double(st.cache_hits) / lookups);
+    self->send(st.accountant, "indexer.cache.bytes", st.cache_bytes);
+    st.cache_hits = 0;
+    st.cache_misses = 0;
+  };
   return {
     [=](std::vector<event> const& events) {
       VAST_TRACE(self, "got", events.size(), "events");
+      auto& st = self->state;
       for (auto& e : events) {
         VAST_ASSERT(e.id() != invalid_event_id);
+        VAST_ASSERT(e.id() >= st.last_flush);
         if (auto data = extract(e)) {
-          auto result = self->state.idx->push_back(*data, e.id());
+          auto result = st.tail->push_back(*data, e.id() - st.last_flush);
+          // The delta must see the same rows as the index, otherwise cached
+          // results would silently miss hits.
+          if (result && st.delta)
+            result = st.delta->push_back(*data, e.id());
           if (!result) {
             VAST_ERROR(self->system().render(result.error()));
             self->quit(result.error());
-            break;
+            return;
           }
         }
       }
+      if (st.delta && st.delta->offset() - st.delta_offset > max_delta_rows)
+        rebase(self);
     },
     [=](predicate const& pred) -> result<bitmap> {
       VAST_TRACE(self, "got predicate:", pred);
-      return self->state.idx->lookup(pred.op, get<data>(pred.rhs));
+      return cached_lookup(self, pred);
     },
-    [=](shutdown_atom) {
-      // Flush index to disk.
-      auto offset = self->state.idx->offset();
-      if (offset == self->state.last_flush) {
-        // Nothing to write.
-        self->quit(exit_reason::user_shutdown);
-        return;
-      }
-      // Create parent directory if it doesn't exist.
-      auto dir = self->state.filename.parent();
-      if (!exists(dir)) {
-        auto result = mkdir(dir);
+    [=](estimate_atom, predicate const& pred) -> uint64_t {
+      VAST_TRACE(self, "got estimate request for predicate:", pred);
+      auto& x = get<data>(pred.rhs);
+      return self->state.idx->estimate(pred.op, x)
+             + self->state.tail->estimate(pred.op, x);
+    },
+    [=](flush_atom) {
+      report();
+      auto rp = self->make_response_promise<ok_atom>();
+      flush(self, false, [=](expected<void> result) mutable {
         if (!result) {
-          self->quit(result.error());
-          return;
+          VAST_ERROR(self, "failed to flush index:",
+                     self->system().render(result.error()));
+          rp.deliver(result.error());
+        } else {
+          rp.deliver(ok_atom::value);
         }
-      }
-      VAST_DEBUG(self, "flushes index ("
-                 << (offset - self->state.last_flush) << '/' << offset,
-                 "new/total bits)");
-      self->state.last_flush = offset;
-      detail::value_index_inspect_helper tmp{self->state.type, self->state.idx};
-      auto result = save(self->state.filename, self->state.last_flush, tmp);
-      if (result)
-        self->quit(exit_reason::user_shutdown);
-      else
-        self->quit(result.error());
+      });
+    },
+    [=](shutdown_atom) {
+      report();
+      // Fold all segments into one, so that a subsequent load can defer
+      // materializing bitmaps.
+      flush(self, true, [=](expected<void> result) {
+        if (result)
+          self->quit(exit_reason::user_shutdown);
+        else
+          self->quit(result.error());
+      });
     },
   };
 }
@@ -343,6 +654,66 @@ behavior event_indexer(stateful_actor<event_indexer_state>* self,
       for (auto& x : indexers)
         send_as(reducer, x, msg);
     },
+    [=](estimate_atom, predicate const& pred) {
+      VAST_DEBUG(self, "got estimate request for predicate:", pred);
+      auto rp = self->make_response_promise<uint64_t>();
+      // A predicate that doesn't resolve for our type cannot yield hits.
+      auto resolved = type_resolver{self->state.event_type}(pred);
+      if (!resolved) {
+        rp.deliver(uint64_t{0});
+        return;
+      }
+      auto indexers = visit(loader{self}, *resolved);
+      if (indexers.empty()) {
+        rp.deliver(uint64_t{0});
+        return;
+      }
+      // Sum up the estimates of all relevant indexers.
+      auto n = std::make_shared<size_t>(indexers.size());
+      auto reducer = self->system().spawn([=]() mutable -> behavior {
+        auto result = std::make_shared<uint64_t>(0);
+        return {
+          [=](uint64_t x) mutable {
+            *result += x;
+            if (--*n == 0)
+              rp.deliver(*result);
+          },
+          [=](error& e) mutable {
+            rp.deliver(std::move(e));
+          }
+        };
+      });
+      auto msg = self->current_mailbox_element()->move_content_to_message();
+      for (auto& x : indexers)
+        send_as(reducer, x, msg);
+    },
+    [=](load_atom, predicate const& pred) {
+      // Spawning the INDEXERs for a predicate loads their state from disk,
+      // such that a subsequent query doesn't have to wait for it.
+      auto resolved = type_resolver{self->state.event_type}(pred);
+      if (resolved) {
+        auto indexers = visit(loader{self}, *resolved);
+        VAST_DEBUG(self, "prefetched", indexers.size(), "indexers for", pred);
+      }
+    },
+    [=](flush_atom) {
+      auto rp = self->make_response_promise<ok_atom>();
+      if (self->state.indexers.empty()) {
+        rp.deliver(ok_atom::value);
+        return;
+      }
+      auto n = std::make_shared<size_t>(self->state.indexers.size());
+      for (auto& x : self->state.indexers)
+        self->request(x.second, infinite, flush_atom::value).then(
+          [=](ok_atom) mutable {
+            if (--*n == 0)
+              rp.deliver(ok_atom::value);
+          },
+          [=](error& e) mutable {
+            rp.deliver(std::move(e));
+          }
+        );
+    },
     [=](shutdown_atom) {
       for (auto& i : self->state.indexers)
         self->send(i.second, shutdown_atom::value);
@@ -358,5 +729,62 @@ behavior event_indexer(stateful_actor<event_indexer_state>* self,
   };
 }
 
+expected<void> merge_event_indexers(std::vector<path> const& sources,
+                                    path const& dir, type const& event_type) {
+  // Enumerate the value indexes the same way an event indexer spawns them.
+  std::vector<std::pair<path, type>> indexes;
+  indexes.emplace_back(path{"meta"} / "time", timestamp_type{});
+  if (!skip(event_type)) {
+    auto r = get_if<record_type>(event_type);
+    if (!r) {
+      indexes.emplace_back(path{"data"}, event_type);
+    } else {
+      for (auto& f : record_type::each{*r}) {
+        auto& value_type = f.trace.back()->type;
+        if (!skip(value_type)) {
+          auto p = path{"data"};
+          for (auto& k : f.key())
+            p /= k;
+          indexes.emplace_back(std::move(p), value_type);
+        }
+      }
+    }
+  }
+  for (auto& x : indexes) {
+    std::unique_ptr<value_index> result;
+    for (auto& src : sources) {
+      auto filename = src / x.first;
+      if (!exists(filename))
+        continue;
+      std::unique_ptr<value_index> idx;
+      auto replayed = replay_segments(filename, x.second, idx);
+      if (!replayed)
+        return replayed.error();
+      if (!result) {
+        result = std::move(idx);
+      } else {
+        auto merged = result->merge(*idx);
+        if (!merged)
+          return merged;
+      }
+    }
+    if (!result)
+      continue;
+    auto filename = dir / x.first;
+    auto parent = filename.parent();
+    if (!exists(parent)) {
+      auto made = mkdir(parent);
+      if (!made)
+        return made;
+    }
+    detail::value_index_inspect_helper tmp{x.second, result};
+    auto saved = save(filename, index_file_magic, index_file_version,
+                      result->offset(), tmp);
+    if (!saved)
+      return saved;
+  }
+  return {};
+}
+
 } // namespace system
 } // namespace vast
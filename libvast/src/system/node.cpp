@@ -20,6 +20,7 @@
 
 #include "vast/system/accountant.hpp"
 #include "vast/system/consensus.hpp"
+#include "vast/system/filesystem.hpp"
 #include "vast/system/node.hpp"
 #include "vast/system/spawn.hpp"
 
@@ -248,6 +249,10 @@ caf::behavior node(node_ptr self, std::string id, path dir) {
   auto acc = self->spawn<monitored>(accountant, std::move(acc_log));
   auto ptr = actor_cast<strong_actor_ptr>(acc);
   self->system().registry().put(accountant_atom::value, ptr);
+  // Bring up the filesystem, which performs blocking I/O for the components.
+  auto fs = self->spawn<monitored>(filesystem, size_t{4});
+  ptr = actor_cast<strong_actor_ptr>(fs);
+  self->system().registry().put(filesystem_atom::value, ptr);
   // Bring up the tracker.
   self->state.tracker = self->spawn<monitored>(tracker, self->state.name);
   self->set_down_handler(
@@ -264,6 +269,9 @@ caf::behavior node(node_ptr self, std::string id, path dir) {
         (blocking_actor* terminator) {
           terminator->send_exit(tracker, msg.reason);
           terminator->wait_for(tracker);
+          // The components may still have pending I/O requests.
+          terminator->send_exit(fs, msg.reason);
+          terminator->wait_for(fs);
           terminator->send_exit(acc, msg.reason);
           terminator->wait_for(acc);
           terminator->send_exit(parent, msg.reason);
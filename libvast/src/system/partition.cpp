@@ -1,6 +1,10 @@
+#include <algorithm>
+#include <limits>
+
 #include <caf/all.hpp>
 
 #include "vast/bitmap.hpp"
+#include "vast/concept/hashable/uhash.hpp"
 #include "vast/concept/parseable/numeric/integral.hpp"
 #include "vast/concept/parseable/to.hpp"
 #include "vast/concept/printable/stream.hpp"
@@ -20,6 +24,7 @@
 
 #include "vast/system/accountant.hpp"
 #include "vast/system/atoms.hpp"
+#include "vast/system/filesystem.hpp"
 #include "vast/system/indexer.hpp"
 #include "vast/system/partition.hpp"
 #include "vast/system/task.hpp"
@@ -34,9 +39,11 @@ namespace system {
 
 namespace {
 
-template <class T>
-auto to_digest(const T& x) {
-  return to_string(std::hash<T>{}(x));
+// Computes the directory name of the INDEXER for a type. Since the meta data
+// of persistent partitions refers to these names, the hash function must not
+// change, e.g., with std::hash<type>.
+std::string to_digest(const type& t) {
+  return to_string(uhash<type::hasher>{}(t));
 }
 
 struct collector_state {
@@ -47,10 +54,10 @@ struct collector_state {
 };
 
 // Encapsulates a single predicate that is part of one or more expressions.
-// The COLLECTOR receives hits from INDEXERs and relays them to the EVALUATORs
-// after having received all hits for the given predicate.
+// The COLLECTOR receives hits from INDEXERs and relays them to its sink after
+// having received all hits for the given predicate.
 behavior collector(stateful_actor<collector_state>* self, predicate pred,
-                   actor evaluator, size_t expected) {
+                   actor sink, size_t expected) {
   self->state.name += '[' + to_string(pred) + ']';
   self->state.pred = std::move(pred);
   return {
@@ -59,8 +66,8 @@ behavior collector(stateful_actor<collector_state>* self, predicate pred,
                  (self->state.got + 1) << '/' << expected, "bitmaps");
       self->state.hits |= hits;
       if (++self->state.got == expected) {
-        VAST_DEBUG(self, "relays", rank(self->state.hits), "to evaluator");
-        self->send(evaluator, std::move(self->state.pred), self->state.hits);
+        VAST_DEBUG(self, "relays", rank(self->state.hits), "hits");
+        self->send(sink, std::move(self->state.pred), self->state.hits);
         self->quit();
       }
     }
@@ -113,35 +120,184 @@ struct bitmap_evaluator {
   const std::unordered_map<predicate, bitmap>& bitmaps;
 };
 
+// Computes the estimated number of hits of an expression from the estimates
+// of its predicates.
+struct cost_estimator {
+  cost_estimator(const std::unordered_map<predicate, uint64_t>& estimates)
+    : estimates{estimates} {
+    // nop
+  }
+
+  uint64_t operator()(none) const {
+    return 0;
+  }
+
+  uint64_t operator()(conjunction const& c) const {
+    // A conjunction cannot yield more hits than its most selective operand.
+    auto result = std::numeric_limits<uint64_t>::max();
+    for (auto& op : c)
+      result = std::min(result, visit(*this, op));
+    return result;
+  }
+
+  uint64_t operator()(disjunction const& d) const {
+    uint64_t result = 0;
+    for (auto& op : d) {
+      auto x = visit(*this, op);
+      if (x > std::numeric_limits<uint64_t>::max() - result)
+        return std::numeric_limits<uint64_t>::max();
+      result += x;
+    }
+    return result;
+  }
+
+  uint64_t operator()(negation const&) const {
+    // Without knowing the total number of values, we must assume the worst.
+    return std::numeric_limits<uint64_t>::max();
+  }
+
+  uint64_t operator()(predicate const& pred) const {
+    auto i = estimates.find(pred);
+    return i != estimates.end() ? i->second
+                                : std::numeric_limits<uint64_t>::max();
+  }
+
+  const std::unordered_map<predicate, uint64_t>& estimates;
+};
+
+// Reorders the operands of all conjunctions from most to least selective, so
+// that evaluation can short-circuit as early as possible.
+struct conjunction_reorderer {
+  conjunction_reorderer(const std::unordered_map<predicate, uint64_t>& xs)
+    : estimator{xs} {
+    // nop
+  }
+
+  expression operator()(none) const {
+    return expression{};
+  }
+
+  expression operator()(conjunction const& c) const {
+    std::vector<std::pair<uint64_t, expression>> xs;
+    xs.reserve(c.size());
+    for (auto& op : c) {
+      auto x = visit(*this, op);
+      xs.emplace_back(visit(estimator, x), std::move(x));
+    }
+    std::stable_sort(xs.begin(), xs.end(),
+                     [](auto& x, auto& y) { return x.first < y.first; });
+    conjunction result;
+    result.reserve(xs.size());
+    for (auto& x : xs)
+      result.push_back(std::move(x.second));
+    return result;
+  }
+
+  expression operator()(disjunction const& d) const {
+    disjunction result;
+    result.reserve(d.size());
+    for (auto& op : d)
+      result.push_back(visit(*this, op));
+    return result;
+  }
+
+  expression operator()(negation const& n) const {
+    return negation{visit(*this, n.expr())};
+  }
+
+  expression operator()(predicate const& pred) const {
+    return pred;
+  }
+
+  cost_estimator estimator;
+};
+
+// Splits an expression into a sequence of stages. The hits of all stages
+// combine conjunctively, i.e., once the running result of the stages becomes
+// empty, the remaining stages don't need to run anymore.
+std::vector<expression> make_stages(expression const& expr) {
+  if (auto c = get_if<conjunction>(expr))
+    return std::vector<expression>(c->begin(), c->end());
+  return {expr};
+}
+
 struct evaluator_state {
   bitmap hits;
   std::unordered_map<predicate, bitmap> predicates;
-  size_t num_predicates;
+  std::vector<expression> stages;
+  size_t stage = 0;
+  size_t pending = 0;
   const char* name = "evaluator";
 };
 
-// Wraps a query expression in an actor. Upon receiving hits from predicators,
-// re-evaluates the expression and relays new hits to its sinks.
+// Wraps a query expression in an actor. The EVALUATOR processes the stages of
+// a query plan one after another: it asks the PARTITION for the hits of each
+// predicate of the current stage and evaluates the stage once all predicates
+// have reported their hits. If the running result becomes empty, the
+// EVALUATOR skips all remaining stages. After the last stage, it relays the
+// hits to its sink.
 behavior evaluator(stateful_actor<evaluator_state>* self,
-                   expression expr, actor sink) {
-  self->state.num_predicates = visit(predicatizer{}, expr).size();
+                   std::vector<expression> stages, actor partition,
+                   actor sink) {
+  VAST_ASSERT(!stages.empty());
+  self->state.stages = std::move(stages);
+  auto finish = [=] {
+    if (any<1>(self->state.hits))
+      self->send(sink, std::move(self->state.hits));
+    self->send(sink, done_atom::value);
+    self->quit();
+  };
+  // Evaluates the current stage and returns false if the query has no hits.
+  auto evaluate = [=] {
+    auto& stage = self->state.stages[self->state.stage];
+    auto hits = visit(bitmap_evaluator{self->state.predicates}, stage);
+    if (self->state.stage == 0)
+      self->state.hits = std::move(hits);
+    else
+      self->state.hits &= hits;
+    VAST_DEBUG(self, "has", rank(self->state.hits), "hits after stage",
+               (self->state.stage + 1) << '/' << self->state.stages.size());
+    ++self->state.stage;
+    return !self->state.hits.empty() && !all<0>(self->state.hits);
+  };
+  // Dispatches the predicates of the current stage to the PARTITION.
+  auto dispatch = [=] {
+    while (self->state.stage < self->state.stages.size()) {
+      auto& stage = self->state.stages[self->state.stage];
+      vast::detail::flat_set<predicate> preds;
+      for (auto& pred : visit(predicatizer{}, stage))
+        if (self->state.predicates.count(pred) == 0)
+          preds.insert(pred);
+      if (!preds.empty()) {
+        VAST_DEBUG(self, "dispatches stage", (self->state.stage + 1) << '/'
+                   << self->state.stages.size() << ':', stage);
+        self->state.pending = preds.size();
+        for (auto& pred : preds)
+          self->send(partition, pred);
+        return;
+      }
+      // We can evaluate stages immediately when we know all their predicates.
+      if (!evaluate()) {
+        VAST_DEBUG(self, "skips", self->state.stages.size() - self->state.stage,
+                   "remaining stage(s)");
+        break;
+      }
+    }
+    finish();
+  };
+  dispatch();
   return {
     [=](predicate& pred, bitmap& hits) {
       self->state.predicates.emplace(std::move(pred), std::move(hits));
-      auto expr_hits = visit(bitmap_evaluator{self->state.predicates}, expr);
-      auto delta = expr_hits - self->state.hits;
-      VAST_DEBUG(self, "produced", rank(delta) << '/' << rank(expr_hits),
-                 "new/total hits for", expr);
-      if (any<0>(delta)) {
-        self->state.hits |= delta;
-        self->send(sink, std::move(delta));
-      }
-      // We're done with evaluation if all predicates have reported their hits.
-      if (self->state.predicates.size() == self->state.num_predicates) {
-        VAST_DEBUG(self, "completed", expr);
-        self->send(sink, done_atom::value);
-        self->quit();
+      if (--self->state.pending > 0)
+        return;
+      if (!evaluate()) {
+        VAST_DEBUG(self, "skips", self->state.stages.size() - self->state.stage,
+                   "remaining stage(s)");
+        finish();
+        return;
       }
+      dispatch();
     }
   };
 }
@@ -166,9 +322,65 @@ behavior partition(stateful_actor<partition_state>* self, path dir) {
       for (auto& x : indexers) {
         auto indexer = self->spawn(event_indexer, dir / x.first, x.second);
         self->state.indexers.emplace(x.second, indexer);
+        self->state.dirs.emplace(std::move(x.second), std::move(x.first));
       }
     }
   }
+  auto fs = get_filesystem(self->system());
+  // Persists the types of all INDEXERs and invokes *f* with the outcome.
+  // TODO: only do so when the partition got dirty.
+  auto persist = [=](auto f) {
+    std::vector<std::pair<std::string, type>> indexers;
+    indexers.reserve(self->state.dirs.size());
+    for (auto& x : self->state.dirs)
+      indexers.emplace_back(x.second, x.first);
+    std::vector<char> bytes;
+    auto result = save(bytes, indexers);
+    if (!result) {
+      f(std::move(result));
+      return;
+    }
+    submit(self, fs, write_atom::value, dir / "meta", std::move(bytes), f);
+  };
+  // Persists the partition and terminates all INDEXERs.
+  auto shutdown = [=] {
+    if (accountant && self->state.distinct_lookups > 0) {
+      auto distinct = self->state.distinct_lookups;
+      auto shared = self->state.shared_lookups;
+      self->send(accountant, "partition.lookups.distinct", distinct);
+      self->send(accountant, "partition.lookups.shared", shared);
+    }
+    if (self->state.indexers.empty()) {
+      self->quit(exit_reason::user_shutdown);
+      return;
+    }
+    // Save persistent state.
+    auto persisted = std::make_shared<bool>(false);
+    persist([=](expected<void> result) {
+      if (!result) {
+        self->quit(result.error());
+        return;
+      }
+      *persisted = true;
+      if (self->state.indexers.empty())
+        self->quit(exit_reason::user_shutdown);
+    });
+    for (auto& x : self->state.indexers) {
+      self->monitor(x.second);
+      self->send(x.second, shutdown_atom::value);
+    }
+    self->set_down_handler(
+      [=](const down_msg& msg) {
+        auto pred = [&](auto& x) { return x.second == msg.source; };
+        auto i = std::find_if(self->state.indexers.begin(),
+                              self->state.indexers.end(), pred);
+        VAST_ASSERT(i != self->state.indexers.end());
+        self->state.indexers.erase(i);
+        if (self->state.indexers.empty() && *persisted)
+          self->quit(exit_reason::user_shutdown);
+      }
+    );
+  };
   return {
     [=](std::vector<event> const& events) {
       VAST_ASSERT(!events.empty());
@@ -177,8 +389,11 @@ behavior partition(stateful_actor<partition_state>* self, path dir) {
       vast::detail::flat_set<actor> indexers;
       for (auto& e : events) {
         auto& i = self->state.indexers[e.type()];
-        if (!i)
-          i = self->spawn(event_indexer, dir / to_digest(e.type()), e.type());
+        if (!i) {
+          auto name = to_digest(e.type());
+          i = self->spawn(event_indexer, dir / name, e.type());
+          self->state.dirs.emplace(e.type(), std::move(name));
+        }
         indexers.insert(i);
       }
       // Forward events to all indexers.
@@ -196,12 +411,16 @@ behavior partition(stateful_actor<partition_state>* self, path dir) {
         return;
       }
       // Spawn a sink that accumulates the stream of bitmaps from the evaluator.
+      // We keep the INDEXERs alive until the query completes, even if we
+      // receive a shutdown request in the meantime.
+      ++self->state.inflight;
+      auto part = actor_cast<actor>(self);
       auto accumulator = self->system().spawn(
         [=](event_based_actor* job) mutable -> behavior {
           auto bm = std::make_shared<bitmap>();
           return {
             [=](const bitmap& hits) mutable {
-              VAST_ASSERT(any<0>(hits));
+              VAST_ASSERT(any<1>(hits));
               *bm |= hits;
             },
             [=](done_atom) mutable {
@@ -211,56 +430,168 @@ behavior partition(stateful_actor<partition_state>* self, path dir) {
               VAST_DEBUG(self, "answered", expr, "in", runtime);
               if (accountant)
                 job->send(accountant, "partition.query.runtime", runtime);
+              job->send(part, done_atom::value);
+              job->quit();
             }
           };
         }
       );
-      auto eval = self->spawn(evaluator, expr, accumulator);
-      // Connect COLLECTORs with INDEXERs and EVALUATOR.
-      for (auto& pred : visit(predicatizer{}, expr)) {
-        // FIXME: locate the smallest subset of INDEXERs (checking whether the
-        // predicate could match the type of the INDEXER) instead of querying
-        // all INDEXERs.
-        auto n = self->state.indexers.size();
-        auto coll = self->spawn(collector, pred, eval, n);
-        for (auto& x : self->state.indexers)
-          send_as(coll, x.second, pred);
+      std::vector<actor> indexers;
+      indexers.reserve(self->state.indexers.size());
+      for (auto& x : self->state.indexers)
+        indexers.push_back(x.second);
+      // Ask all INDEXERs for selectivity estimates of each predicate. Once
+      // all estimates have arrived, we order the query such that the most
+      // selective predicates run first.
+      // FIXME: locate the smallest subset of INDEXERs (checking whether the
+      // predicate could match the type of the INDEXER) instead of querying
+      // all INDEXERs.
+      auto preds = visit(predicatizer{}, expr);
+      std::sort(preds.begin(), preds.end());
+      preds.erase(std::unique(preds.begin(), preds.end()), preds.end());
+      auto estimates =
+        std::make_shared<std::unordered_map<predicate, uint64_t>>();
+      auto pending = std::make_shared<size_t>(preds.size() * indexers.size());
+      auto execute = [=] {
+        auto plan = visit(conjunction_reorderer{*estimates}, expr);
+        VAST_DEBUG(self, "executes plan", plan);
+        self->spawn(evaluator, make_stages(plan), part, accumulator);
+      };
+      if (*pending == 0) {
+        execute();
+        return;
+      }
+      for (auto& pred : preds) {
+        (*estimates)[pred] = 0;
+        for (auto& x : indexers)
+          self->request(x, infinite, estimate_atom::value, pred).then(
+            [=](uint64_t n) {
+              (*estimates)[pred] += n;
+              if (--*pending == 0)
+                execute();
+            },
+            [=](const error& e) {
+              VAST_WARNING(self, "failed to estimate", pred << ':',
+                           self->system().render(e));
+              (*estimates)[pred] = std::numeric_limits<uint64_t>::max();
+              if (--*pending == 0)
+                execute();
+            }
+          );
       }
     },
-    [=](shutdown_atom) {
-      if (self->state.indexers.empty()) {
-        self->quit(exit_reason::user_shutdown);
+    [=](predicate& pred) {
+      // Concurrent queries often share predicates, e.g., when multiple
+      // analysts investigate the same host. We look up each distinct
+      // predicate only once and fan out the hits to all EVALUATORs that asked
+      // for it in the meantime.
+      auto evaluator = actor_cast<actor>(self->current_sender());
+      auto& subscribers = self->state.lookups[pred];
+      subscribers.push_back(evaluator);
+      if (subscribers.size() > 1) {
+        VAST_DEBUG(self, "shares lookup of", pred, "with",
+                   subscribers.size() - 1, "other queries");
+        ++self->state.shared_lookups;
         return;
       }
-      for (auto& x : self->state.indexers) {
-        self->monitor(x.second);
-        self->send(x.second, shutdown_atom::value);
+      ++self->state.distinct_lookups;
+      auto part = actor_cast<actor>(self);
+      auto coll = self->spawn(collector, pred, part,
+                              self->state.indexers.size());
+      for (auto& x : self->state.indexers)
+        send_as(coll, x.second, pred);
+    },
+    [=](predicate& pred, bitmap& hits) {
+      auto i = self->state.lookups.find(pred);
+      VAST_ASSERT(i != self->state.lookups.end());
+      for (auto& evaluator : i->second)
+        self->send(evaluator, pred, hits);
+      self->state.lookups.erase(i);
+    },
+    [=](load_atom, expression const& expr) {
+      VAST_DEBUG(self, "prefetches indexers for", expr);
+      auto preds = visit(predicatizer{}, expr);
+      std::sort(preds.begin(), preds.end());
+      preds.erase(std::unique(preds.begin(), preds.end()), preds.end());
+      for (auto& x : self->state.indexers)
+        for (auto& pred : preds)
+          self->send(x.second, load_atom::value, pred);
+    },
+    [=](flush_atom) {
+      VAST_DEBUG(self, "flushes", self->state.indexers.size(), "indexers");
+      auto rp = self->make_response_promise<ok_atom>();
+      if (self->state.indexers.empty()) {
+        rp.deliver(ok_atom::value);
+        return;
       }
-      self->set_down_handler(
-        [=](const down_msg& msg) {
-          auto pred = [&](auto& x) { return x.second == msg.source; };
-          auto i = std::find_if(self->state.indexers.begin(),
-                                self->state.indexers.end(), pred);
-          VAST_ASSERT(i != self->state.indexers.end());
-          self->state.indexers.erase(i);
-          if (self->state.indexers.empty())
-            self->quit(exit_reason::user_shutdown);
+      persist([=](expected<void> result) mutable {
+        if (!result) {
+          rp.deliver(result.error());
+          return;
         }
-      );
-      // Save persistent state.
-      // TODO: only do so when the partition got dirty.
-      std::vector<std::pair<std::string, type>> indexers;
-      indexers.reserve(self->state.indexers.size());
-      for (auto& x : self->state.indexers)
-        indexers.emplace_back(to_digest(x.first), x.first);
-      if (!exists(dir))
-        mkdir(dir);
-      auto result = save(dir / "meta", indexers);
-      if (!result)
-        self->quit(result.error());
+        auto n = std::make_shared<size_t>(self->state.indexers.size());
+        for (auto& x : self->state.indexers)
+          self->request(x.second, infinite, flush_atom::value).then(
+            [=](ok_atom) mutable {
+              if (--*n == 0)
+                rp.deliver(ok_atom::value);
+            },
+            [=](error& e) mutable {
+              rp.deliver(std::move(e));
+            }
+          );
+      });
+    },
+    [=](done_atom) {
+      VAST_ASSERT(self->state.inflight > 0);
+      if (--self->state.inflight == 0 && self->state.shutting_down)
+        shutdown();
+    },
+    [=](shutdown_atom) {
+      if (self->state.shutting_down)
+        return;
+      self->state.shutting_down = true;
+      if (self->state.inflight > 0) {
+        VAST_DEBUG(self, "defers shutdown until", self->state.inflight,
+                   "queries complete");
+        return;
+      }
+      shutdown();
     },
   };
 }
 
+expected<void> merge_partitions(const std::vector<path>& sources,
+                                const path& dir) {
+  // Collect the event types of all partitions.
+  std::vector<std::pair<std::string, type>> indexers;
+  for (auto& src : sources) {
+    std::vector<std::pair<std::string, type>> xs;
+    auto result = load(src / "meta", xs);
+    if (!result)
+      return result;
+    for (auto& x : xs) {
+      auto pred = [&](auto& y) { return y.first == x.first; };
+      if (std::none_of(indexers.begin(), indexers.end(), pred))
+        indexers.push_back(std::move(x));
+    }
+  }
+  if (!exists(dir)) {
+    auto result = mkdir(dir);
+    if (!result)
+      return result;
+  }
+  for (auto& x : indexers) {
+    std::vector<path> xs;
+    for (auto& src : sources)
+      if (exists(src / x.first))
+        xs.push_back(src / x.first);
+    auto result = merge_event_indexers(xs, dir / x.first, x.second);
+    if (!result)
+      return result;
+  }
+  return save(dir / "meta", indexers);
+}
+
 } // namespace system
 } // namespace vast
@@ -1,6 +1,7 @@
 #include <caf/all.hpp>
 
 #include "vast/config.hpp"
+#include "vast/compression.hpp"
 
 #include "vast/concept/parseable/to.hpp"
 #include "vast/concept/parseable/vast/expression.hpp"
@@ -37,18 +38,91 @@ using namespace caf;
 namespace vast {
 namespace system {
 
+namespace {
+
+// Extracts the options of a tiering policy, which the ARCHIVE and the INDEX
+// share. Only the ARCHIVE can recompress data for the cold tier.
+expected<tiering_policy> extract_tiering_policy(options& opts,
+                                                bool recompress) {
+  auto cold_dir = std::string{};
+  auto cold_after = uint64_t{0};
+  auto max_age = uint64_t{0};
+  auto max_size = uint64_t{0};
+  auto codec_name = std::string{};
+  auto r = opts.params.extract_opts({
+    {"cold-dir", "root directory of the cold storage tier", cold_dir},
+    {"cold-after", "days until data moves to the cold tier", cold_after},
+    {"max-age", "days until data gets deleted (0 = never)", max_age},
+    {"max-size", "maximum size in MB before deleting data (0 = none)",
+     max_size},
+  });
+  opts.params = r.remainder;
+  if (!r.error.empty())
+    return make_error(ec::syntax_error, r.error);
+  if (recompress) {
+    r = opts.params.extract_opts({
+      {"cold-compression", "compression codec for the cold tier",
+       codec_name},
+    });
+    opts.params = r.remainder;
+    if (!r.error.empty())
+      return make_error(ec::syntax_error, r.error);
+  }
+  if (cold_dir.empty() != (cold_after == 0))
+    return make_error(ec::unspecified,
+                      "cold tier requires both directory and age");
+  tiering_policy policy;
+  if (!cold_dir.empty())
+    policy.cold_dir = path{cold_dir} / opts.label;
+  policy.cold_after = std::chrono::hours(24 * cold_after);
+  policy.max_age = std::chrono::hours(24 * max_age);
+  policy.max_bytes = max_size << 20; // MB'ify.
+  if (!codec_name.empty()) {
+    auto c = make_codec(codec_name);
+    if (!c)
+      return c.error();
+    policy.recompress = true;
+    policy.cold_codec = *c;
+  }
+  return policy;
+}
+
+} // namespace <anonymous>
+
 expected<actor> spawn_archive(local_actor* self, options& opts) {
   auto mss = size_t{128};
   auto segments = size_t{10};
+  auto shards = size_t{4};
+  auto codec_name = std::string{"lz4"};
   auto r = opts.params.extract_opts({
     {"segments,s", "number of cached segments", segments},
-    {"max-segment-size,m", "maximum segment size in MB", mss}
+    {"max-segment-size,m", "maximum segment size in MB", mss},
+    {"shards,n", "number of archive shards", shards},
+    {"compression,c", "compression codec (null, lz4, snappy, zstd[-level])",
+     codec_name},
+    {"dictionaries,d", "train compression dictionaries per event type"}
   });
   opts.params = r.remainder;
   if (!r.error.empty())
     return make_error(ec::syntax_error, r.error);
+  if (shards == 0)
+    return make_error(ec::unspecified, "number of shards must be positive");
+  auto method = make_codec(codec_name);
+  if (!method)
+    return method.error();
+  auto dictionaries = r.opts.count("dictionaries") > 0;
+  if (dictionaries) {
+#ifdef VAST_HAVE_ZSTD
+    if (method->method != compression::zstd)
+#endif
+      return make_error(ec::unspecified, "dictionaries require zstd");
+  }
+  auto policy = extract_tiering_policy(opts, true);
+  if (!policy)
+    return policy.error();
   mss <<= 20; // MB'ify.
-  auto a = self->spawn(archive, opts.dir / opts.label, segments, mss);
+  auto a = self->spawn(archive, opts.dir / opts.label, segments, mss,
+                       shards, *method, dictionaries, std::move(*policy));
   return actor_cast<actor>(a);
 }
 
@@ -58,6 +132,7 @@ expected<actor> spawn_exporter(local_actor* self, options& opts) {
     {"continuous,c", "marks a query as continuous"},
     {"historical,h", "marks a query as historical"},
     {"unified,u", "marks a query as unified"},
+    {"ordered,o", "returns historical results in timestamp order"},
     {"limit,l", "limit the number of results", limit},
   }, nullptr, true);
   if (!r.error.empty())
@@ -82,6 +157,11 @@ expected<actor> spawn_exporter(local_actor* self, options& opts) {
     query_opts = unified;
   if (query_opts == no_query_options)
     return make_error(ec::syntax_error, "missing query options (-h, -c, -u)");
+  if (r.opts.count("ordered") > 0) {
+    if (query_opts != historical)
+      return make_error(ec::syntax_error, "ordering requires -h");
+    query_opts = query_opts + ordered;
+  }
   auto exp = self->spawn(exporter, std::move(*expr), query_opts);
   if (limit > 0)
     anon_send(exp, extract_atom::value, limit);
@@ -103,18 +183,29 @@ expected<actor> spawn_importer(local_actor* self, options& opts) {
 
 expected<actor> spawn_index(local_actor* self, options& opts) {
   size_t max_events = 1 << 20;
-  size_t max_parts = 10;
+  uint64_t max_memory = 1024;
   size_t taste_parts = 5;
+  uint64_t flush_interval = 10;
   auto r = opts.params.extract_opts({
     {"max-events,e", "maximum events per partition", max_events},
-    {"max-parts,p", "maximum number of in-memory partitions", max_parts},
-    {"taste-parts,p", "number of immediately scheduled partitions", taste_parts}
+    {"max-memory,m", "memory budget for partitions in MB", max_memory},
+    {"taste-parts,t", "number of immediately scheduled partitions",
+     taste_parts},
+    {"flush-interval,f", "seconds between flushes (0 = on shutdown only)",
+     flush_interval}
   });
   opts.params = r.remainder;
   if (!r.error.empty())
     return make_error(ec::syntax_error, r.error);
-  return self->spawn(index, opts.dir / opts.label, max_events, max_parts,
-                     taste_parts);
+  if (max_memory == 0)
+    return make_error(ec::unspecified, "memory budget must be positive");
+  auto policy = extract_tiering_policy(opts, false);
+  if (!policy)
+    return policy.error();
+  max_memory <<= 20; // MB'ify.
+  timespan interval = std::chrono::seconds(flush_interval);
+  return self->spawn(index, opts.dir / opts.label, max_events, max_memory,
+                     taste_parts, interval, std::move(*policy));
 }
 
 expected<actor> spawn_metastore(local_actor* self, options& opts) {
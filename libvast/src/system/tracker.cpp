@@ -97,6 +97,8 @@ tracker(tracker_type::stateful_pointer<tracker_state> self, std::string node) {
           self->anon_send(component, actor_cast<archive_type>(a));
         for (auto& a : actors("index"))
           self->anon_send(component, index_atom::value, a);
+        for (auto& a : actors("importer"))
+          self->anon_send(component, importer_atom::value, a);
         for (auto& a : actors("sink"))
           self->anon_send(component, sink_atom::value, a);
       } else if (type == "importer") {
@@ -108,6 +110,8 @@ tracker(tracker_type::stateful_pointer<tracker_state> self, std::string node) {
           self->anon_send(component, index_atom::value, a);
         for (auto& a : actors("source"))
           self->anon_send(a, sink_atom::value, component);
+        for (auto& a : actors("exporter"))
+          self->anon_send(a, importer_atom::value, component);
       } else if (type == "source") {
         for (auto& a : actors("importer"))
           self->anon_send(component, sink_atom::value, a);
@@ -1,4 +1,6 @@
+#include <mutex>
 #include <tuple>
+#include <unordered_map>
 
 #include "vast/concept/printable/to_string.hpp"
 #include "vast/concept/printable/vast/type.hpp"
@@ -36,6 +38,17 @@ type& type::attributes(std::initializer_list<attribute> list) {
   return *this;
 }
 
+uint64_t type::digest() const {
+  if (ptr_->interned)
+    return ptr_->digest;
+  return uhash<xxhash64>{}(*this);
+}
+
+void type::detach() {
+  if (ptr_->interned)
+    ptr_.reset(new impl{ptr_->types});
+}
+
 namespace {
 
 struct equal_to {
@@ -65,13 +78,104 @@ struct less_than {
 } // namespace
 
 bool operator==(const type& x, const type& y) {
+  if (x.ptr_ == y.ptr_)
+    return true;
+  // Canonical instances never change, so their digests remain valid. Only a
+  // hash collision requires a structural comparison.
+  if (x.ptr_->interned && y.ptr_->interned && x.ptr_->digest != y.ptr_->digest)
+    return false;
   return visit(equal_to{}, x, y);
 }
 
 bool operator<(const type& x, const type& y) {
+  if (x.ptr_ == y.ptr_)
+    return false;
   return visit(less_than{}, x, y);
 }
 
+namespace {
+
+// Interns the types nested in a type, so that the canonical instance of the
+// enclosing type does not share any mutable representation.
+struct nested_interner {
+  template <class T>
+  void operator()(T&) const {
+    // nop
+  }
+
+  void operator()(vector_type& t) const {
+    t.value_type = intern(t.value_type);
+  }
+
+  void operator()(set_type& t) const {
+    t.value_type = intern(t.value_type);
+  }
+
+  void operator()(table_type& t) const {
+    t.key_type = intern(t.key_type);
+    t.value_type = intern(t.value_type);
+  }
+
+  void operator()(record_type& t) const {
+    for (auto& field : t.fields)
+      field.type = intern(field.type);
+  }
+
+  void operator()(alias_type& t) const {
+    t.value_type = intern(t.value_type);
+  }
+};
+
+using type_map = std::unordered_multimap<uint64_t, type>;
+
+struct type_interner {
+  std::mutex mtx;
+  type_map types;
+};
+
+type_interner& get_type_interner() {
+  static type_interner interner;
+  return interner;
+}
+
+// Looks for a structurally equal type among the types with a given digest.
+const type* find_equal(const type_map& xs, uint64_t digest, const type& x) {
+  auto range = xs.equal_range(digest);
+  for (auto i = range.first; i != range.second; ++i)
+    if (i->second == x)
+      return &i->second;
+  return nullptr;
+}
+
+} // namespace <anonymous>
+
+type intern(type const& t) {
+  if (t.ptr_->interned)
+    return t;
+  // Copy the representation, because the caller may still modify *t*.
+  type result;
+  result.ptr_.reset(new type::impl{t.ptr_->types});
+  visit(nested_interner{}, result);
+  auto digest = uhash<xxhash64>{}(result);
+  // Deserialization interns every type it reads, mostly the same few ones
+  // over and over. The thread-local cache keeps those off the global lock.
+  thread_local type_map cache;
+  if (auto x = find_equal(cache, digest, result))
+    return *x;
+  auto& interner = get_type_interner();
+  std::unique_lock<std::mutex> guard{interner.mtx};
+  if (auto x = find_equal(interner.types, digest, result)) {
+    result = *x;
+  } else {
+    result.ptr_->digest = digest;
+    result.ptr_->interned = true;
+    interner.types.emplace(digest, result);
+  }
+  guard.unlock();
+  cache.emplace(digest, result);
+  return result;
+}
+
 enumeration_type::enumeration_type(std::vector<std::string> fields)
   : fields{std::move(fields)} {
 }
@@ -1,9 +1,15 @@
 #include <cmath>
+#include <numeric>
+#include <stdexcept>
+#include <typeinfo>
 
 #include "vast/base.hpp"
+#include "vast/bitmap_algorithms.hpp"
 #include "vast/concept/parseable/numeric/integral.hpp"
 #include "vast/concept/parseable/to.hpp"
 #include "vast/concept/parseable/vast/base.hpp"
+#include "vast/concept/hashable/uhash.hpp"
+#include "vast/concept/hashable/xxhash.hpp"
 #include "vast/value_index.hpp"
 
 namespace vast {
@@ -27,6 +33,8 @@ optional<base> parse_base(type const& t) {
 
 } // namespace <anonymous>
 
+constexpr size_t value_index::num_buckets;
+
 std::unique_ptr<value_index> value_index::make(type const& t) {
   struct factory {
     using result_type = std::unique_ptr<value_index>;
@@ -124,15 +132,27 @@ std::unique_ptr<value_index> value_index::make(type const& t) {
   return visit(factory{}, t);
 }
 
+expected<void> value_index::try_push_back(data const& x, size_type skip) {
+  try {
+    if (!push_back_impl(x, skip))
+      return make_error(ec::unspecified, "push_back_impl");
+  } catch (std::exception const& e) {
+    return make_error(ec::unspecified, e.what());
+  }
+  return {};
+}
+
 expected<void> value_index::push_back(data const& x) {
   if (is<none>(x)) {
     none_.append_bit(true);
     ++nils_;
   } else {
-    if (!push_back_impl(x, nils_))
-      return make_error(ec::unspecified, "push_back_impl");
+    auto appended = try_push_back(x, nils_);
+    if (!appended)
+      return appended.error();
     nils_ = 0;
     none_.append_bit(false);
+    update_statistics(x);
   }
   mask_.append_bit(true);
   return {};
@@ -149,18 +169,96 @@ expected<void> value_index::push_back(data const& x, event_id id) {
   if (is<none>(x)) {
     none_.append_bits(false, skip);
     none_.append_bit(true);
-    ++nils_;
+    // The skipped rows don't reach the concrete index either.
+    nils_ += skip + 1;
   } else {
-    if (!push_back_impl(x, skip + nils_))
-      return make_error(ec::unspecified, "push_back_impl");
+    auto appended = try_push_back(x, skip + nils_);
+    if (!appended)
+      return appended.error();
     nils_ = 0;
     none_.append_bits(false, skip + 1);
+    update_statistics(x);
   }
   mask_.append_bits(false, skip);
   mask_.append_bit(true);
   return {};
 }
 
+expected<void> value_index::append(value_index const& other, size_type skip) {
+  if (typeid(*this) != typeid(other))
+    return make_error(ec::type_clash, "cannot append different value indexes");
+  // The concrete index lags behind by the number of trailing nils, which
+  // includes all rows of an index without any non-nil values.
+  if (other.cardinality() > 0) {
+    try {
+      if (!append_impl(other, skip + nils_))
+        return make_error(ec::unspecified, "append_impl");
+    } catch (std::exception const& e) {
+      return make_error(ec::unspecified, e.what());
+    }
+    nils_ = other.nils_;
+  } else {
+    nils_ += skip + other.offset();
+  }
+  mask_.append_bits(false, skip);
+  mask_.append(other.mask_);
+  none_.append_bits(false, skip);
+  none_.append(other.none_);
+  if (!other.buckets_.empty()) {
+    if (buckets_.empty())
+      buckets_.resize(num_buckets);
+    for (auto i = 0u; i < num_buckets; ++i)
+      buckets_[i] += other.buckets_[i];
+  }
+  return {};
+}
+
+expected<void> value_index::merge(value_index const& other) {
+  if (typeid(*this) != typeid(other))
+    return make_error(ec::type_clash, "cannot merge different value indexes");
+  if (any<1>(mask_ & other.mask_))
+    return make_error(ec::unspecified, "cannot merge overlapping rows");
+  // Rows of the concrete index without a value consist of padding, so the
+  // merged concrete index extends to the longer of the two.
+  auto size = std::max(offset() - nils_, other.offset() - other.nils_);
+  if (other.cardinality() > 0) {
+    try {
+      if (!merge_impl(other))
+        return make_error(ec::unspecified, "merge_impl");
+    } catch (std::exception const& e) {
+      return make_error(ec::unspecified, e.what());
+    }
+  }
+  mask_ |= other.mask_;
+  none_ |= other.none_;
+  nils_ = offset() - size;
+  if (!other.buckets_.empty()) {
+    if (buckets_.empty())
+      buckets_.resize(num_buckets);
+    for (auto i = 0u; i < num_buckets; ++i)
+      buckets_[i] += other.buckets_[i];
+  }
+  return {};
+}
+
+ewah_bitmap value_index::rows() const {
+  // The concrete index ends at the last non-nil value, i.e., it excludes the
+  // trailing nils.
+  auto values = mask_ - none_;
+  auto n = offset() - nils_;
+  ewah_bitmap result;
+  for (auto b : bit_range(values)) {
+    auto k = std::min(b.size(), n - result.size());
+    if (k == 0)
+      break;
+    if (b.size() > ewah_bitmap::word_type::width)
+      result.append_bits(b.data() != 0, k);
+    else
+      result.append_block(b.data(), k);
+  }
+  return result;
+}
+
 expected<bitmap>
 value_index::lookup(relational_operator op, data const& x) const {
   if (is<none>(x)) {
@@ -168,16 +266,67 @@ value_index::lookup(relational_operator op, data const& x) const {
       return make_error(ec::unsupported_operator, op);
     return op == equal ? none_ & mask_ : ~none_ & mask_;
   }
-  auto result = lookup_impl(op, x);
+  // Lazily loaded indexes materialize their bitmaps here, which fails if the
+  // persistent state turns out to be corrupt.
+  auto result = expected<bitmap>{bitmap{}};
+  try {
+    result = lookup_impl(op, x);
+  } catch (std::exception const& e) {
+    return make_error(ec::unspecified, e.what());
+  }
   if (!result)
     return result;
   return (*result - none_) & mask_;
 }
 
+value_index::size_type
+value_index::estimate(relational_operator op, data const& x) const {
+  if (is<none>(x)) {
+    auto nils = rank(none_ & mask_);
+    switch (op) {
+      default:
+        return 0;
+      case equal:
+        return nils;
+      case not_equal:
+        return rank(mask_) - nils;
+    }
+  }
+  if (buckets_.empty())
+    return 0;
+  auto total = cardinality();
+  // Without a value distribution, we fall back to the textbook heuristic of
+  // assuming that a range or membership predicate selects a third of all
+  // values.
+  auto fraction = total / 3;
+  switch (op) {
+    default:
+      return fraction;
+    case equal:
+      return buckets_[uhash<xxhash64>{}(x) % num_buckets];
+    case not_equal:
+      return total - buckets_[uhash<xxhash64>{}(x) % num_buckets];
+    case not_in:
+    case not_ni:
+    case not_match:
+      return total - fraction;
+  }
+}
+
 value_index::size_type value_index::offset() const {
   return mask_.size(); // none_ would work just as well.
 }
 
+value_index::size_type value_index::cardinality() const {
+  return std::accumulate(buckets_.begin(), buckets_.end(), size_type{0});
+}
+
+void value_index::update_statistics(data const& x) {
+  if (buckets_.empty())
+    buckets_.resize(num_buckets);
+  ++buckets_[uhash<xxhash64>{}(x) % num_buckets];
+}
+
 
 string_index::string_index(size_t max_length) : max_length_{max_length} {
 }
@@ -209,6 +358,34 @@ bool string_index::push_back_impl(data const& x, size_type skip) {
   return true;
 }
 
+bool string_index::append_impl(value_index const& other, size_type skip) {
+  auto x = dynamic_cast<string_index const*>(&other);
+  if (!x)
+    return false;
+  init();
+  if (x->chars_.size() > chars_.size())
+    chars_.resize(x->chars_.size(), char_bitmap_index{8});
+  for (auto i = 0u; i < x->chars_.size(); ++i) {
+    auto gap = length_.size() - chars_[i].size();
+    chars_[i].append(x->chars_[i], gap + skip);
+  }
+  length_.append(x->length_, skip);
+  return true;
+}
+
+bool string_index::merge_impl(value_index const& other) {
+  auto x = dynamic_cast<string_index const*>(&other);
+  if (!x)
+    return false;
+  init();
+  if (x->chars_.size() > chars_.size())
+    chars_.resize(x->chars_.size(), char_bitmap_index{8});
+  for (auto i = 0u; i < x->chars_.size(); ++i)
+    chars_[i].merge(x->chars_[i]);
+  length_.merge(x->length_);
+  return true;
+}
+
 expected<bitmap>
 string_index::lookup_impl(relational_operator op, data const& x) const {
   auto str = get_if<std::string>(x);
@@ -298,6 +475,30 @@ bool address_index::push_back_impl(data const& x, size_type skip) {
   return true;
 }
 
+bool address_index::append_impl(value_index const& other, size_type skip) {
+  auto x = dynamic_cast<address_index const*>(&other);
+  if (!x)
+    return false;
+  init();
+  for (auto i = 0u; i < 16; ++i) {
+    auto gap = v4_.size() - bytes_[i].size();
+    bytes_[i].append(x->bytes_[i], gap + skip);
+  }
+  v4_.append(x->v4_, skip);
+  return true;
+}
+
+bool address_index::merge_impl(value_index const& other) {
+  auto x = dynamic_cast<address_index const*>(&other);
+  if (!x)
+    return false;
+  init();
+  for (auto i = 0u; i < 16; ++i)
+    bytes_[i].merge(x->bytes_[i]);
+  v4_.merge(x->v4_, x->rows());
+  return true;
+}
+
 expected<bitmap>
 address_index::lookup_impl(relational_operator op, data const& x) const {
   auto size = v4_.size();
@@ -358,6 +559,26 @@ bool subnet_index::push_back_impl(data const& x, size_type skip) {
   return false;
 }
 
+bool subnet_index::append_impl(value_index const& other, size_type skip) {
+  auto x = dynamic_cast<subnet_index const*>(&other);
+  if (!x)
+    return false;
+  init();
+  // The network index has a row for every row of the length index.
+  VAST_ASSERT(network_.offset() == length_.size());
+  length_.append(x->length_, skip);
+  return !!network_.append(x->network_, skip);
+}
+
+bool subnet_index::merge_impl(value_index const& other) {
+  auto x = dynamic_cast<subnet_index const*>(&other);
+  if (!x)
+    return false;
+  init();
+  length_.merge(x->length_);
+  return !!network_.merge(x->network_);
+}
+
 expected<bitmap>
 subnet_index::lookup_impl(relational_operator op, data const& x) const {
   if (!(op == equal || op == not_equal))
@@ -393,6 +614,26 @@ bool port_index::push_back_impl(data const& x, size_type skip) {
   return false;
 }
 
+bool port_index::append_impl(value_index const& other, size_type skip) {
+  auto x = dynamic_cast<port_index const*>(&other);
+  if (!x)
+    return false;
+  init();
+  num_.append(x->num_, skip);
+  proto_.append(x->proto_, skip);
+  return true;
+}
+
+bool port_index::merge_impl(value_index const& other) {
+  auto x = dynamic_cast<port_index const*>(&other);
+  if (!x)
+    return false;
+  init();
+  num_.merge(x->num_);
+  proto_.merge(x->proto_);
+  return true;
+}
+
 expected<bitmap>
 port_index::lookup_impl(relational_operator op, data const& x) const {
   if (op == in || op == not_in)
@@ -435,6 +676,51 @@ bool sequence_index::push_back_impl(data const& x, size_type skip) {
   return false;
 }
 
+bool sequence_index::append_impl(value_index const& other, size_type skip) {
+  auto x = dynamic_cast<sequence_index const*>(&other);
+  if (!x || x->value_type_ != value_type_)
+    return false;
+  init();
+  if (x->elements_.size() > elements_.size()) {
+    auto old = elements_.size();
+    elements_.resize(x->elements_.size());
+    for (auto i = old; i < elements_.size(); ++i) {
+      elements_[i] = value_index::make(value_type_);
+      VAST_ASSERT(elements_[i]);
+    }
+  }
+  // Element indexes only have rows up to the last sequence that had a
+  // corresponding element.
+  auto first = size_.size() + skip;
+  for (auto i = 0u; i < x->elements_.size(); ++i) {
+    auto& element = elements_[i];
+    if (!element->append(*x->elements_[i], first - element->offset()))
+      return false;
+  }
+  size_.append(x->size_, skip);
+  return true;
+}
+
+bool sequence_index::merge_impl(value_index const& other) {
+  auto x = dynamic_cast<sequence_index const*>(&other);
+  if (!x || x->value_type_ != value_type_)
+    return false;
+  init();
+  if (x->elements_.size() > elements_.size()) {
+    auto old = elements_.size();
+    elements_.resize(x->elements_.size());
+    for (auto i = old; i < elements_.size(); ++i) {
+      elements_[i] = value_index::make(value_type_);
+      VAST_ASSERT(elements_[i]);
+    }
+  }
+  for (auto i = 0u; i < x->elements_.size(); ++i)
+    if (!elements_[i]->merge(*x->elements_[i]))
+      return false;
+  size_.merge(x->size_);
+  return true;
+}
+
 expected<bitmap>
 sequence_index::lookup_impl(relational_operator op, data const& x) const {
   if (op == ni)
@@ -1,3 +1,5 @@
+#include <random>
+
 #include "vast/concept/parseable/to.hpp"
 #include "vast/concept/parseable/vast/address.hpp"
 #include "vast/concept/printable/to_string.hpp"
@@ -136,3 +138,52 @@ TEST(parseable) {
   CHECK(to_string(a) == str);
 }
 
+TEST(fast parser) {
+  auto agree = [](std::string const& str) {
+    address x;
+    address y;
+    auto f = str.begin();
+    auto l = str.end();
+    auto x_ok = parsers::addr(f, l, x) && f == l;
+    f = str.begin();
+    auto y_ok = parsers::fast_addr(f, l, y) && f == l;
+    return x_ok == y_ok && (!x_ok || x == y);
+  };
+  std::mt19937 gen{42};
+  auto random_address = [&] {
+    uint32_t bytes[4];
+    for (auto& x : bytes)
+      x = gen() % 4 == 0 ? 0 : gen() & (gen() % 2 ? 0xffffffff : 0x0000ffff);
+    auto fam = gen() % 2 == 0 ? address::ipv4 : address::ipv6;
+    return to_string(address{bytes, fam, address::network});
+  };
+  auto mutate = [&](std::string str) {
+    auto chars = "0123456789abcdefABCDEF:.x"s;
+    auto c = chars[gen() % chars.size()];
+    auto i = gen() % (str.size() + 1);
+    switch (gen() % 3) {
+      case 0:
+        str.insert(i, 1, c);
+        break;
+      case 1:
+        if (i < str.size())
+          str[i] = c;
+        break;
+      default:
+        str.erase(i, 1);
+    }
+    return str;
+  };
+  auto disagreements = 0;
+  auto check = [&](std::string const& str) {
+    if (!agree(str) && disagreements++ == 0)
+      MESSAGE("parsers disagree on " << str);
+  };
+  MESSAGE("well-formed addresses");
+  for (auto i = 0; i < 10000; ++i)
+    check(random_address());
+  MESSAGE("mutated addresses");
+  for (auto i = 0; i < 100000; ++i)
+    check(mutate(mutate(random_address())));
+  CHECK_EQUAL(disagreements, 0);
+}
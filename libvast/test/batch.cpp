@@ -1,6 +1,7 @@
 #include "vast/batch.hpp"
 #include "vast/event.hpp"
 #include "vast/load.hpp"
+#include "vast/packed_record.hpp"
 #include "vast/save.hpp"
 #include "vast/concept/printable/vast/event.hpp"
 
@@ -76,4 +77,76 @@ TEST(events without IDs) {
   CHECK_EQUAL(xs->back(), event::make(41, event_type));
 }
 
+TEST(packed records) {
+  auto t = type{record_type{{"x", count_type{}},
+                            {"y", string_type{}},
+                            {"z", vector_type{integer_type{}}}}}.name("bar");
+  record_layout layout{t};
+  detail::monotonic_arena a;
+  batch::writer writer{compression::lz4};
+  std::vector<event> written;
+  for (auto i = 0; i < 100; ++i) {
+    auto xs = vector{count(i), std::to_string(i), vector{integer{-i}}};
+    auto ts = timestamp{timespan{i}};
+    if (i % 3 == 0) {
+      auto x = pack(layout, xs, a);
+      REQUIRE(x);
+      REQUIRE(writer.write(*x, ts));
+      written.push_back(event::make(std::move(xs), t));
+      written.back().timestamp(ts);
+    } else if (i % 3 == 1) {
+      // Record events take the packed path implicitly, and those that don't
+      // match their type the regular one.
+      if (i % 2 == 0)
+        xs.pop_back();
+      written.push_back(event::make(std::move(xs), t));
+      written.back().timestamp(ts);
+      REQUIRE(writer.write(written.back()));
+    } else {
+      // Interleave regular events of a different type.
+      written.push_back(event::make(i, event_type));
+      REQUIRE(writer.write(written.back()));
+    }
+  }
+  auto b = writer.seal();
+  batch::reader reader{b};
+  auto xs = reader.read();
+  REQUIRE(xs);
+  REQUIRE_EQUAL(xs->size(), written.size());
+  for (auto i = 0u; i < xs->size(); ++i) {
+    CHECK_EQUAL((*xs)[i], written[i]);
+    CHECK((*xs)[i].timestamp() == written[i].timestamp());
+  }
+}
+
+#ifdef VAST_HAVE_ZSTD
+TEST(zstd with dictionary) {
+  MESSAGE("train a dictionary");
+  std::vector<char> samples;
+  std::vector<size_t> sizes;
+  for (auto& e : events) {
+    auto before = samples.size();
+    REQUIRE(save(samples, e.timestamp(), e.data()));
+    sizes.push_back(samples.size() - before);
+  }
+  auto dict = zstd::train_dictionary(samples, sizes, 1 << 10);
+  REQUIRE(dict);
+  auto id = zstd::add_dictionary(*dict);
+  REQUIRE(id);
+  CHECK_EQUAL(*zstd::add_dictionary(*dict), *id);
+  MESSAGE("write a batch");
+  batch::writer writer{codec{compression::zstd, 19, *id}};
+  for (auto& e : events)
+    if (!writer.write(e))
+      REQUIRE(!"failed to write event");
+  auto b = writer.seal();
+  b.ids(666, 666 + 1000);
+  MESSAGE("read a batch");
+  batch::reader reader{b};
+  auto xs = reader.read();
+  REQUIRE(xs);
+  CHECK(*xs == events);
+}
+#endif
+
 FIXTURE_SCOPE_END()
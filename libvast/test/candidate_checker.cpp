@@ -0,0 +1,121 @@
+#include "vast/candidate_checker.hpp"
+#include "vast/event.hpp"
+#include "vast/expression.hpp"
+#include "vast/expression_visitors.hpp"
+#include "vast/schema.hpp"
+#include "vast/concept/parseable/to.hpp"
+#include "vast/concept/parseable/vast/address.hpp"
+#include "vast/concept/parseable/vast/expression.hpp"
+#include "vast/concept/parseable/vast/schema.hpp"
+#include "vast/concept/parseable/vast/time.hpp"
+
+#define SUITE candidate_checker
+#include "test.hpp"
+
+using namespace vast;
+
+namespace {
+
+struct fixture {
+  fixture() {
+    auto s = to<schema>(R"__(
+      type foo = record{
+        s1: string,
+        d1: real,
+        c: count,
+        i: int,
+        s2: string,
+        a: addr
+      }
+      type bar = record{ s1: string, r : record{ b: bool, s: string }}
+    )__");
+    REQUIRE(s);
+    sch = std::move(*s);
+    foo = sch.find("foo");
+    bar = sch.find("bar");
+    REQUIRE(foo);
+    REQUIRE(bar);
+    auto a = to<address>("10.1.2.3");
+    REQUIRE(a);
+    e0 = event::make(vector{"babba", 1.337, 42u, 100, "bar", *a}, *foo);
+    e1 = event::make(vector{"yadda", vector{false, "baz"}}, *bar);
+    auto tp = to<timestamp>("2014-01-16+05:30:12");
+    REQUIRE(tp);
+    e0.timestamp(*tp);
+    e1.timestamp(*tp);
+  }
+
+  // Checks an event with a compiled checker and verifies that the outcome
+  // agrees with the generic event evaluator.
+  bool check(event const& e, char const* str) {
+    auto expr = to<expression>(str);
+    REQUIRE(expr);
+    auto resolved = visit(type_resolver{e.type()}, normalize(*expr));
+    REQUIRE(resolved);
+    auto pruned = visit(type_pruner{e.type()}, *resolved);
+    auto checker = candidate_checker{pruned, e.type()};
+    auto result = checker(e);
+    CHECK_EQUAL(result, visit(event_evaluator{e}, pruned));
+    return result;
+  }
+
+  schema sch;
+  type const* foo;
+  type const* bar;
+  event e0;
+  event e1;
+};
+
+} // namespace <anonymous>
+
+FIXTURE_SCOPE(candidate_checker_tests, fixture)
+
+TEST(default construction) {
+  candidate_checker checker;
+  CHECK(!checker(e0));
+}
+
+TEST(attributes) {
+  CHECK(check(e0, "&type == \"foo\""));
+  CHECK(!check(e0, "&type != \"foo\""));
+  CHECK(check(e1, "! &type == \"foo\""));
+  CHECK(check(e0, "&time == 2014-01-16+05:30:12"));
+  CHECK(!check(e0, "&time == 2015-01-16+05:30:12"));
+  CHECK(check(e0, "&time < 2015-01-16+05:30:12"));
+}
+
+TEST(relational operators) {
+  CHECK(check(e0, ":count == 42"));
+  CHECK(!check(e0, ":count != 42"));
+  CHECK(check(e0, ":int >= 100"));
+  CHECK(check(e0, ":real < 2.0"));
+  CHECK(check(e0, "c > 41 && c <= 42"));
+  CHECK(!check(e0, "c < 41 || i > 100"));
+  CHECK(check(e0, "s1 == \"babba\""));
+  CHECK(check(e1, "r.b == F"));
+  CHECK(check(e1, "r.s == \"baz\" && s1 != \"babba\""));
+}
+
+TEST(strings and patterns) {
+  CHECK(check(e0, "s1 ~ /b.*a/"));
+  CHECK(!check(e0, "s1 ~ /a.*b/"));
+  CHECK(check(e0, "s2 !~ /foo/"));
+  CHECK(check(e0, "\"bab\" in s1"));
+  CHECK(check(e0, "s1 in \"xxbabbaxx\""));
+  CHECK(check(e0, "s1 !in \"bab\""));
+}
+
+TEST(subnets) {
+  CHECK(check(e0, ":addr in 10.0.0.0/8"));
+  CHECK(check(e0, "a !in 192.168.0.0/16"));
+  CHECK(!check(e0, "a in 10.1.3.0/24"));
+}
+
+TEST(missing fields) {
+  // The pruner removes predicates on fields that do not exist, leaving only
+  // the applicable parts of the expression.
+  CHECK(check(e1, "s1 == \"yadda\" || c == 42"));
+  CHECK(!check(e1, "r.s == \"qux\""));
+}
+
+FIXTURE_SCOPE_END()
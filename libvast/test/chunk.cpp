@@ -0,0 +1,67 @@
+#include <fstream>
+
+#include "vast/chunk.hpp"
+#include "vast/filesystem.hpp"
+#include "vast/load.hpp"
+#include "vast/save.hpp"
+#include "vast/detail/lazy_vector.hpp"
+#include "vast/detail/system.hpp"
+
+#define SUITE chunk
+#include "test.hpp"
+
+using namespace vast;
+
+TEST(owning chunk) {
+  auto chk = chunk::make({'f', 'o', 'o'});
+  REQUIRE(chk);
+  CHECK_EQUAL(chk->size(), 3u);
+  CHECK_EQUAL(std::string(chk->begin(), chk->end()), "foo");
+  CHECK_EQUAL(chunk::make({})->size(), 0u);
+}
+
+TEST(memory-mapped chunk) {
+  path p = "/tmp/vast-unit-test-chunk";
+  p /= std::to_string(detail::process_id());
+  REQUIRE(mkdir(p));
+  {
+    std::ofstream f{(p / "foo").str()};
+    f << "foobar";
+  }
+  auto chk = chunk::mmap(p / "foo");
+  REQUIRE(chk);
+  CHECK_EQUAL(std::string(chk->begin(), chk->end()), "foobar");
+  CHECK(!chunk::mmap(p / "bar"));
+  CHECK(rm(p.parent()));
+  // The mapping outlives the file.
+  CHECK_EQUAL(std::string(chk->data(), 3), "foo");
+}
+
+TEST(lazy vector) {
+  detail::lazy_vector<std::string> xs(3);
+  xs[0] = "foo";
+  xs[1] = "bar";
+  xs[2] = "baz";
+  std::vector<char> buf;
+  REQUIRE(save(buf, xs));
+  MESSAGE("eager deserialization");
+  detail::lazy_vector<std::string> ys;
+  REQUIRE(load(buf, ys));
+  CHECK_EQUAL(ys.frozen(), 0u);
+  CHECK(xs == ys);
+  MESSAGE("lazy deserialization");
+  auto chk = chunk::make(std::move(buf));
+  detail::lazy_vector<std::string> zs;
+  REQUIRE(load(chk, zs));
+  REQUIRE_EQUAL(zs.size(), 3u);
+  CHECK_EQUAL(zs.frozen(), 3u);
+  CHECK_EQUAL(zs[1], "bar");
+  CHECK_EQUAL(zs.frozen(), 2u);
+  MESSAGE("serialize frozen elements verbatim");
+  std::vector<char> buf2;
+  REQUIRE(save(buf2, zs));
+  CHECK_EQUAL(zs.frozen(), 2u);
+  CHECK(std::equal(buf2.begin(), buf2.end(), chk->begin(), chk->end()));
+  CHECK(zs == xs);
+  CHECK_EQUAL(zs.frozen(), 0u);
+}
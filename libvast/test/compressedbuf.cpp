@@ -46,6 +46,9 @@ TEST(compressedbuf - iostream interface) {
   std::vector<compression> methods = {compression::null, compression::lz4};
 #ifdef VAST_HAVE_SNAPPY
   methods.push_back(compression::snappy);
+#endif
+#ifdef VAST_HAVE_ZSTD
+  methods.push_back(compression::zstd);
 #endif
   std::vector<size_t> block_sizes = {1, 2, 64, 256, 1024, 16 << 10};
   auto data = "Im Kampf zwischen dir und der Welt sekundiere der Welt."s;
@@ -0,0 +1,45 @@
+#include <string>
+
+#include "vast/detail/cow_map.hpp"
+
+#define SUITE detail
+#include "test.hpp"
+
+using namespace vast;
+
+TEST(copy-on-write map) {
+  detail::cow_map<std::string, int, 4> xs;
+  xs["foo"] = 1;
+  xs["bar"] = 2;
+  xs["baz"] = 3;
+  CHECK_EQUAL(xs.size(), 3u);
+  REQUIRE(xs.find("foo"));
+  CHECK_EQUAL(*xs.find("foo"), 1);
+  CHECK(!xs.find("qux"));
+  MESSAGE("taking a view");
+  auto view = xs.view();
+  REQUIRE_EQUAL(view.size(), 4u);
+  auto lookup = [&](std::string const& key) -> int const* {
+    for (auto& shard : view) {
+      auto i = shard->find(key);
+      if (i != shard->end())
+        return &i->second;
+    }
+    return nullptr;
+  };
+  MESSAGE("modifying the map leaves the view intact");
+  xs["foo"] = 42;
+  xs["qux"] = 4;
+  CHECK_EQUAL(xs.erase("bar"), 1u);
+  CHECK_EQUAL(xs.erase("corge"), 0u);
+  CHECK_EQUAL(*xs.find("foo"), 42);
+  CHECK(!xs.find("bar"));
+  REQUIRE(lookup("foo"));
+  CHECK_EQUAL(*lookup("foo"), 1);
+  REQUIRE(lookup("bar"));
+  CHECK_EQUAL(*lookup("bar"), 2);
+  CHECK(!lookup("qux"));
+  xs.clear();
+  CHECK_EQUAL(xs.size(), 0u);
+  CHECK(lookup("baz"));
+}
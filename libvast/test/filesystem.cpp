@@ -1,3 +1,5 @@
+#include <fstream>
+
 #include "vast/filesystem.hpp"
 #include "vast/detail/system.hpp"
 
@@ -166,3 +168,25 @@ TEST(file_and_directory_manipulation) {
   CHECK(rm(p.parent()));
   CHECK(!p.parent().is_directory());
 }
+
+TEST(file_size) {
+  path p = "/tmp/vast-unit-test-file-size";
+  p /= std::to_string(detail::process_id());
+  REQUIRE(mkdir(p));
+  {
+    std::ofstream f{(p / "foo").str()};
+    f << std::string(42, 'x');
+  }
+  {
+    std::ofstream f{(p / "bar").str()};
+    f << std::string(58, 'y');
+  }
+  auto n = file_size(p / "foo");
+  REQUIRE(n);
+  CHECK_EQUAL(*n, 42u);
+  n = file_size(p);
+  REQUIRE(n);
+  CHECK_EQUAL(*n, 100u);
+  CHECK(!file_size(p / "qux"));
+  CHECK(rm(p.parent()));
+}
@@ -0,0 +1,151 @@
+#include <random>
+#include <string>
+#include <unordered_map>
+
+#include "vast/concept/hashable/uhash.hpp"
+#include "vast/concept/hashable/xxhash.hpp"
+#include "vast/detail/flat_hash_map.hpp"
+#include "vast/detail/flat_hash_set.hpp"
+
+#define SUITE detail
+#include "test.hpp"
+
+using namespace std::string_literals;
+using namespace vast;
+
+namespace {
+
+using map = detail::flat_hash_map<std::string, int>;
+
+struct fixture {
+  fixture() {
+    xs.insert({"foo", 42});
+    xs["baz"] = 1337;
+    xs.emplace("bar", 4711);
+  }
+
+  map xs;
+};
+
+} // namespace <anonymous>
+
+FIXTURE_SCOPE(flat_hash_map_tests, fixture)
+
+TEST(flat_hash_map membership) {
+  CHECK(xs.find("qux") == xs.end());
+  CHECK(xs.find("foo") != xs.end());
+  CHECK_EQUAL(xs.count("baz"), 1u);
+  CHECK_EQUAL(xs.size(), 3u);
+}
+
+TEST(flat_hash_map at) {
+  CHECK_EQUAL(xs.at("foo"), 42);
+  auto exception = std::out_of_range{""};
+  try {
+    xs.at("qux");
+  } catch (std::out_of_range& e) {
+    exception = std::move(e);
+  }
+  CHECK_EQUAL(exception.what(), "vast::detail::flat_hash_map::at"s);
+}
+
+TEST(flat_hash_map insert) {
+  auto i = xs.insert({"qux", 1});
+  CHECK(i.second);
+  CHECK_EQUAL(i.first->second, 1);
+  i = xs.insert({"foo", 666});
+  CHECK(!i.second);
+  CHECK_EQUAL(i.first->second, 42);
+  i = xs.try_emplace("corge", 2);
+  CHECK(i.second);
+  CHECK_EQUAL(xs.size(), 5u);
+}
+
+TEST(flat_hash_map erase) {
+  CHECK_EQUAL(xs.erase("qux"), 0u);
+  CHECK_EQUAL(xs.erase("baz"), 1u);
+  CHECK_EQUAL(xs.size(), 2u);
+  CHECK(xs.find("baz") == xs.end());
+  MESSAGE("erasing while iterating");
+  for (auto i = xs.begin(); i != xs.end(); )
+    i = xs.erase(i);
+  CHECK(xs.empty());
+  CHECK(xs.begin() == xs.end());
+  MESSAGE("reinserting into deleted slots");
+  xs["baz"] = 1;
+  CHECK_EQUAL(xs.at("baz"), 1);
+  CHECK_EQUAL(xs.size(), 1u);
+}
+
+TEST(flat_hash_map copy and move) {
+  auto copy = xs;
+  CHECK_EQUAL(copy.size(), 3u);
+  CHECK_EQUAL(copy.at("bar"), 4711);
+  auto moved = std::move(copy);
+  CHECK_EQUAL(moved.size(), 3u);
+  CHECK(copy.empty());
+  xs.clear();
+  CHECK(xs.empty());
+  CHECK_EQUAL(moved.at("foo"), 42);
+}
+
+FIXTURE_SCOPE_END()
+
+TEST(flat_hash_map random operations) {
+  // Checks the map against std::unordered_map under a long sequence of
+  // random insertions, lookups, and erasures, which exercises growth and
+  // rehashing in place with many deleted slots.
+  detail::flat_hash_map<int, int> xs;
+  std::unordered_map<int, int> ys;
+  std::mt19937 gen{42};
+  std::uniform_int_distribution<int> key{0, 4999};
+  std::uniform_int_distribution<int> op{0, 3};
+  for (auto i = 0; i < 200000; ++i) {
+    auto k = key(gen);
+    switch (op(gen)) {
+      case 0:
+      case 1:
+        xs[k] = i;
+        ys[k] = i;
+        break;
+      case 2:
+        REQUIRE_EQUAL(xs.erase(k), ys.erase(k));
+        break;
+      case 3: {
+        auto x = xs.find(k);
+        auto y = ys.find(k);
+        REQUIRE_EQUAL(x == xs.end(), y == ys.end());
+        if (y != ys.end())
+          REQUIRE_EQUAL(x->second, y->second);
+      }
+    }
+    REQUIRE_EQUAL(xs.size(), ys.size());
+  }
+  auto n = size_t{0};
+  for (auto& x : xs) {
+    REQUIRE_EQUAL(ys.count(x.first), 1u);
+    CHECK_EQUAL(ys[x.first], x.second);
+    ++n;
+  }
+  CHECK_EQUAL(n, ys.size());
+}
+
+TEST(flat_hash_map with uhash) {
+  detail::flat_hash_map<std::string, int, uhash<xxhash64>> xs;
+  for (auto i = 0; i < 1000; ++i)
+    xs[std::to_string(i)] = i;
+  CHECK_EQUAL(xs.size(), 1000u);
+  for (auto i = 0; i < 1000; ++i)
+    CHECK_EQUAL(xs.at(std::to_string(i)), i);
+}
+
+TEST(flat_hash_set) {
+  detail::flat_hash_set<int> xs{1, 2, 3, 2};
+  CHECK_EQUAL(xs.size(), 3u);
+  CHECK(xs.insert(4).second);
+  CHECK(!xs.insert(1).second);
+  CHECK_EQUAL(xs.count(2), 1u);
+  CHECK_EQUAL(xs.erase(2), 1u);
+  CHECK_EQUAL(xs.count(2), 0u);
+  CHECK_EQUAL(xs.size(), 3u);
+}
@@ -1,5 +1,11 @@
+#include <fstream>
+#include <sstream>
+
 #include "vast/concept/parseable/to.hpp"
 #include "vast/event.hpp"
+#include "vast/packed_record.hpp"
+#include "vast/concept/printable/vast/data.hpp"
+#include "vast/concept/printable/vast/type.hpp"
 
 #include "vast/format/bro.hpp"
 
@@ -72,4 +78,51 @@ TEST(bro writer) {
   CHECK(exists(dir / bro_http_log[0].type().name() + ".log"));
 }
 
+TEST(bro packed reader) {
+  format::bro::reader reader{std::make_unique<std::ifstream>(bro::conn)};
+  detail::monotonic_arena a;
+  std::vector<packed_record> xs;
+  std::vector<timestamp> timestamps;
+  auto x = expected<packed_record>{no_error};
+  while (x || !x.error()) {
+    timestamp ts;
+    x = reader.read(a, ts);
+    if (x) {
+      xs.push_back(*x);
+      timestamps.push_back(ts);
+    }
+  }
+  CHECK(x.error() == ec::end_of_input);
+  REQUIRE_EQUAL(xs.size(), bro_conn_log.size());
+  for (auto i = 0u; i < xs.size(); ++i) {
+    CHECK_EQUAL(xs[i].layout().type(), bro_conn_log[i].type());
+    CHECK_EQUAL(data{xs[i].to_data()}, bro_conn_log[i].data());
+    CHECK(timestamps[i] == bro_conn_log[i].timestamp());
+  }
+  MESSAGE("the records take a fraction of the data representation");
+  CHECK_LESS(a.bytes(), xs.size() * 512);
+}
+
+TEST(bro packed reader with truncated line) {
+  auto log = "#separator \\x09\n"
+             "#set_separator\t,\n"
+             "#empty_field\t(empty)\n"
+             "#unset_field\t-\n"
+             "#path\tfoo\n"
+             "#open\t2014-05-23-18-02-04\n"
+             "#fields\tts\tx\ty\n"
+             "#types\ttime\tcount\tstring\n"
+             "1258531221.486539\t42\tfoo\n"
+             "1258531221.486540\t43\n"s;
+  format::bro::reader reader{std::make_unique<std::istringstream>(log)};
+  detail::monotonic_arena a;
+  timestamp ts;
+  auto x = reader.read(a, ts);
+  REQUIRE(x);
+  CHECK_EQUAL(data{x->to_data()}, data{vector{ts, count{42}, "foo"}});
+  x = reader.read(a, ts);
+  REQUIRE(!x);
+  CHECK(x.error() == ec::parse_error);
+}
+
 FIXTURE_SCOPE_END()
@@ -1,5 +1,10 @@
+#include <algorithm>
+#include <array>
+#include <string>
+
 #include "vast/concept/hashable/crc.hpp"
 #include "vast/concept/hashable/uhash.hpp"
+#include "vast/concept/hashable/xxh3.hpp"
 #include "vast/concept/hashable/xxhash.hpp"
 
 #define SUITE hash
@@ -77,10 +82,53 @@ TEST(xxhash64) {
   CHECK(static_cast<size_t>(xxh64) == 6505385152087097371ul);
 }
 
+TEST(xxh3_64) {
+  // one-shot
+  CHECK(uhash<xxh3_64>{}(42) == 2392174772787195229ul);
+  CHECK(uhash<xxh3_64>{42}("42") == 18407214960136390519ul); // includes NUL
+  // incremental
+  xxh3_64 xxh3;
+  CHECK(static_cast<size_t>(xxh3) == 3244421341483603138ul);
+  xxh3("foo", 3);
+  CHECK(static_cast<size_t>(xxh3) == 12352915711150947722ul);
+  xxh3("bar", 3);
+  CHECK(static_cast<size_t>(xxh3) == 15532873758901296260ul);
+  xxh3("baz", 3);
+  CHECK(static_cast<size_t>(xxh3) == 18088372132676880310ul);
+}
+
+TEST(xxh3_64 long input) {
+  auto str = std::string(1000, 'x');
+  CHECK(xxh3_64{}.one_shot(str.data(), str.size()) == 13881368916332952194ul);
+  MESSAGE("incremental hashing in chunks of varying size");
+  xxh3_64 xxh3{42};
+  auto chunk = size_t{1};
+  for (auto i = size_t{0}; i < str.size(); i += chunk, chunk *= 2)
+    xxh3(str.data() + i, std::min(chunk, str.size() - i));
+  CHECK(static_cast<size_t>(xxh3) == 14632465229159035903ul);
+}
+
+TEST(one-shot hashing) {
+  // Contiguously hashable values take the one-shot path of the hasher, which
+  // must yield the same digest as the streaming interface.
+  auto xs = std::array<uint64_t, 3>{{1, 2, 3}};
+  xxh3_64 xxh3;
+  xxh3(xs.data(), sizeof(xs));
+  CHECK_EQUAL(uhash<xxh3_64>{}(xs), static_cast<size_t>(xxh3));
+  xxhash64 xxh64;
+  xxh64(xs.data(), sizeof(xs));
+  CHECK_EQUAL(uhash<xxhash64>{}(xs), static_cast<size_t>(xxh64));
+  MESSAGE("every invocation starts from a fresh hasher");
+  uhash<xxh3_64> h{42};
+  CHECK_EQUAL(h(foo{}), h(foo{}));
+}
+
 TEST(xxhash zero bytes) {
   // Should not segfault or trigger assertions.
   xxhash32 xxh32;
   xxh32(nullptr, 0);
   xxhash64 xxh64;
   xxh64(nullptr, 0);
+  xxh3_64 xxh3;
+  xxh3(nullptr, 0);
 }
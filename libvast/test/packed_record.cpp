@@ -0,0 +1,164 @@
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include "vast/packed_record.hpp"
+#include "vast/concept/parseable/to.hpp"
+#include "vast/concept/parseable/vast/address.hpp"
+#include "vast/concept/parseable/vast/subnet.hpp"
+#include "vast/concept/printable/vast/data.hpp"
+#include "vast/detail/monotonic_arena.hpp"
+
+#define SUITE packed_record
+#include "test.hpp"
+
+using namespace vast;
+using namespace std::chrono_literals;
+
+namespace {
+
+struct fixture {
+  fixture() {
+    auto inner = record_type{
+      {"orig_h", address_type{}},
+      {"resp_p", port_type{}},
+    };
+    record_type r{
+      {"ts", timestamp_type{}},
+      {"uid", string_type{}},
+      {"id", inner},
+      {"net", subnet_type{}},
+      {"duration", timespan_type{}},
+      {"bytes", count_type{}},
+      {"delta", integer_type{}},
+      {"ratio", real_type{}},
+      {"flag", boolean_type{}},
+      {"re", pattern_type{}},
+      {"tags", set_type{string_type{}}},
+      {"note", alias_type{string_type{}}},
+    };
+    layout = std::make_unique<record_layout>(type{r}.name("foo"));
+    xs = vector{
+      timestamp{1500000000s},
+      "CUM0KZ3MLUfNB0cl11",
+      vector{*to<address>("192.168.1.103"), port{80, port::tcp}},
+      *to<subnet>("10.0.0.0/8"),
+      42ms,
+      count{1024},
+      integer{-7},
+      real{4.2},
+      true,
+      pattern{"fo*"},
+      set{"a", "b"},
+      nil,
+    };
+  }
+
+  std::unique_ptr<record_layout> layout;
+  vector xs;
+  detail::monotonic_arena arena;
+};
+
+} // namespace <anonymous>
+
+FIXTURE_SCOPE(packed_record_tests, fixture)
+
+TEST(layout) {
+  REQUIRE_EQUAL(layout->size(), 13u);
+  CHECK((*layout)[0].kind == record_layout::kind::timestamp);
+  CHECK((*layout)[2].kind == record_layout::kind::address);
+  CHECK((*layout)[3].kind == record_layout::kind::port);
+  CHECK((*layout)[11].kind == record_layout::kind::container);
+  CHECK((*layout)[12].kind == record_layout::kind::string);
+  // 8 bytes of nil bitmap, 16 + 24 bytes for address and subnet, and 8 bytes
+  // for each of the remaining 11 leaves.
+  CHECK_EQUAL(layout->fixed_size(), 8u + 40 + 88);
+}
+
+TEST(pack and unpack) {
+  auto x = pack(*layout, xs, arena);
+  REQUIRE(x);
+  CHECK_EQUAL(x->size(), 13u);
+  CHECK(!x->nil(0));
+  CHECK(x->nil(12));
+  CHECK_EQUAL(x->get(1), data{"CUM0KZ3MLUfNB0cl11"});
+  CHECK_EQUAL(x->get(2), data{*to<address>("192.168.1.103")});
+  CHECK_EQUAL(x->get(3), data{port{80, port::tcp}});
+  auto str = x->string(1);
+  CHECK_EQUAL(std::string(str.first, str.second), "CUM0KZ3MLUfNB0cl11");
+  CHECK_EQUAL(data{x->to_data()}, data{xs});
+  CHECK_EQUAL(x->block_size(), layout->fixed_size() + 18 + 3);
+}
+
+TEST(little endian) {
+  auto x = pack(*layout, xs, arena);
+  REQUIRE(x);
+  std::vector<char> block(x->block(), x->block() + x->block_size());
+  to_little_endian(*layout, block.data());
+  MESSAGE("scalars have their least significant byte first");
+  auto bytes = block.data() + (*layout)[6].offset; // count{1024}
+  CHECK_EQUAL(bytes[0], 0x00);
+  CHECK_EQUAL(bytes[1], 0x04);
+  auto number = block.data() + (*layout)[3].offset; // 80/tcp
+  CHECK_EQUAL(number[0], 80);
+  CHECK_EQUAL(number[1], 0);
+  MESSAGE("converting back restores the record");
+  from_little_endian(*layout, block.data());
+  packed_record y{*layout, block.data(), block.size()};
+  CHECK_EQUAL(data{y.to_data()}, data{xs});
+}
+
+TEST(builder) {
+  packed_record::builder b{*layout};
+  MESSAGE("reject mismatching data");
+  CHECK(!b.add(count{42}));
+  b.reset();
+  MESSAGE("build records in succession");
+  for (auto i = 0; i < 3; ++i) {
+    for (auto j = 0u; j < layout->size(); ++j)
+      if (j == 1)
+        REQUIRE(b.add("foo", 3));
+      else
+        REQUIRE(b.add_nil());
+    CHECK(!b.add_nil());
+    auto x = b.finish(arena);
+    REQUIRE(x);
+    CHECK_EQUAL(x->get(1), data{"foo"});
+    CHECK(x->nil(0));
+    CHECK(x->nil(2));
+  }
+  MESSAGE("reject incomplete records");
+  CHECK(b.add_nil());
+  CHECK(!b.finish(arena));
+}
+
+TEST(nil record) {
+  xs[2] = nil;
+  auto x = pack(*layout, xs, arena);
+  REQUIRE(x);
+  CHECK(x->nil(2));
+  CHECK(x->nil(3));
+  auto ys = x->to_data();
+  CHECK_EQUAL(ys[2], data{vector{nil, nil}});
+}
+
+TEST(monotonic arena) {
+  detail::monotonic_arena a{64};
+  auto x = a.allocate(10, 1);
+  auto y = a.allocate(8, 8);
+  CHECK_EQUAL(reinterpret_cast<uintptr_t>(y) % 8, 0u);
+  CHECK_EQUAL(static_cast<char*>(y) - static_cast<char*>(x), 16);
+  MESSAGE("oversized allocations get their own chunk");
+  a.allocate(100);
+  CHECK_EQUAL(a.bytes(), 118u);
+  CHECK_EQUAL(a.capacity(), 164u);
+  MESSAGE("reset recycles the chunks and destroys objects");
+  auto s = a.make<std::string>(100, 'x');
+  CHECK_EQUAL(s->size(), 100u);
+  a.reset();
+  CHECK_EQUAL(a.bytes(), 0u);
+  CHECK(a.allocate(10, 1) == x);
+  CHECK_EQUAL(a.capacity(), 164u + 64);
+}
+
+FIXTURE_SCOPE_END()
@@ -1,3 +1,4 @@
+#include <random>
 #include <sstream>
 
 #include "vast/concept/parseable/core.hpp"
@@ -6,6 +7,8 @@
 #include "vast/concept/parseable/stream.hpp"
 #include "vast/concept/parseable/to.hpp"
 #include "vast/concept/parseable/vast/key.hpp"
+#include "vast/data.hpp"
+#include "vast/string_view.hpp"
 
 #define SUITE parseable
 #include "test.hpp"
@@ -262,6 +265,54 @@ TEST(recursive rule) {
   CHECK(c == 'x');
 }
 
+TEST(raw) {
+  using namespace parsers;
+  auto str = R"("foo\"bar" baz)"s;
+  auto f = str.begin();
+  auto l = str.end();
+  MESSAGE("string view");
+  string_view view;
+  CHECK(raw(qq_str)(f, l, view));
+  CHECK(view == R"("foo\"bar")");
+  CHECK(view.data() == str.data()); // No copy.
+  CHECK(f == str.begin() + view.size());
+  MESSAGE("string");
+  std::string copy = "stale";
+  f = str.begin();
+  CHECK(raw(qq_str)(f, l, copy));
+  CHECK(copy == R"("foo\"bar")");
+}
+
+TEST(in place) {
+  using namespace parsers;
+  MESSAGE("construct a new alternative");
+  data d;
+  CHECK(in_place<integer>(i64)("-42", d));
+  CHECK(d == data{integer{-42}});
+  MESSAGE("reuse the existing alternative");
+  d = std::string{"foo"};
+  auto ptr = get_if<std::string>(d);
+  REQUIRE(ptr);
+  CHECK(in_place<std::string>(raw(+alpha))("bar", d));
+  CHECK(get_if<std::string>(d) == ptr);
+  CHECK(*ptr == "bar");
+}
+
+TEST(static rule) {
+  using namespace parsers;
+  using rule_type =
+    static_rule<char const*, std::string, decltype(+alpha), decltype(+digit)>;
+  rule_type r = +alpha;
+  std::string str;
+  CHECK(r("foo", str));
+  CHECK(str == "foo");
+  CHECK(!r("42", unused));
+  r = +digit;
+  str.clear();
+  CHECK(r("42", str));
+  CHECK(str == "42");
+}
+
 // -- numeric -----------------------------------------------------------------
 
 TEST(bool) {
@@ -410,6 +461,36 @@ TEST(real) {
   //  CHECK(f == str.begin() + 4);
 }
 
+TEST(fast real) {
+  auto agree = [](std::string const& str) {
+    double x = 0;
+    double y = 0;
+    auto f = str.begin();
+    auto l = str.end();
+    auto x_ok = parsers::real(f, l, x);
+    auto x_end = f;
+    f = str.begin();
+    auto y_ok = parsers::fast_real(f, l, y);
+    return x_ok == y_ok && (!x_ok || (x == y && x_end == f));
+  };
+  std::mt19937_64 gen{42};
+  auto digits = [&](size_t n) {
+    std::string result;
+    for (auto i = 0u; i < n; ++i)
+      result += static_cast<char>('0' + gen() % 10);
+    return result;
+  };
+  auto disagreements = 0;
+  for (auto i = 0; i < 100000; ++i) {
+    auto str = digits(gen() % 18) + '.' + digits(gen() % 18);
+    if (i % 10 == 0)
+      str.insert(gen() % (str.size() + 1), 1, "-+.x"[gen() % 4]);
+    if (!agree(str) && disagreements++ == 0)
+      MESSAGE("parsers disagree on " << str);
+  }
+  CHECK_EQUAL(disagreements, 0);
+}
+
 TEST(byte) {
   using namespace parsers;
   auto str = "\x01\x02\x03\x04\x05\x06\x07\x08"s;
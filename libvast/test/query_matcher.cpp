@@ -0,0 +1,169 @@
+#include <algorithm>
+
+#include "vast/event.hpp"
+#include "vast/expression.hpp"
+#include "vast/query_matcher.hpp"
+#include "vast/schema.hpp"
+#include "vast/concept/parseable/to.hpp"
+#include "vast/concept/parseable/vast/address.hpp"
+#include "vast/concept/parseable/vast/expression.hpp"
+#include "vast/concept/parseable/vast/schema.hpp"
+
+#define SUITE query_matcher
+#include "test.hpp"
+
+using namespace vast;
+
+namespace {
+
+struct fixture {
+  fixture() {
+    auto s = to<schema>(R"__(
+      type conn = record{
+        orig: addr,
+        resp: addr,
+        service: string,
+        bytes: count
+      }
+      type dns = record{ query: string, answer: addr }
+    )__");
+    REQUIRE(s);
+    sch = std::move(*s);
+    conn = sch.find("conn");
+    dns = sch.find("dns");
+    REQUIRE(conn);
+    REQUIRE(dns);
+    e0 = make_conn("10.0.0.1", "192.168.1.1", "http", 42u);
+    e1 = make_conn("10.1.0.1", "8.8.8.8", "dns", 100u);
+    e2 = event::make(vector{"example.com", *to<address>("1.2.3.4")}, *dns);
+  }
+
+  event make_conn(char const* orig, char const* resp, char const* service,
+                  count bytes) {
+    auto x = to<address>(orig);
+    auto y = to<address>(resp);
+    REQUIRE(x);
+    REQUIRE(y);
+    return event::make(vector{*x, *y, service, bytes}, *conn);
+  }
+
+  query_matcher::query_id add(char const* str) {
+    auto expr = to<expression>(str);
+    REQUIRE(expr);
+    return matcher.add(normalize(*expr));
+  }
+
+  std::vector<query_matcher::query_id> match(event const& e) {
+    std::vector<query_matcher::query_id> result;
+    matcher.match(e, result);
+    std::sort(result.begin(), result.end());
+    return result;
+  }
+
+  using ids = std::vector<query_matcher::query_id>;
+
+  schema sch;
+  type const* conn;
+  type const* dns;
+  event e0;
+  event e1;
+  event e2;
+  query_matcher matcher;
+};
+
+} // namespace <anonymous>
+
+FIXTURE_SCOPE(query_matcher_tests, fixture)
+
+TEST(address equality) {
+  auto x = add(":addr == 192.168.1.1");
+  auto y = add("orig == 10.1.0.1");
+  auto z = add(":addr == 1.2.3.4");
+  CHECK_EQUAL(match(e0), (ids{x}));
+  CHECK_EQUAL(match(e1), (ids{y}));
+  CHECK_EQUAL(match(e2), (ids{z}));
+}
+
+TEST(subnet membership) {
+  auto x = add(":addr in 10.0.0.0/8");
+  auto y = add(":addr in 10.1.0.0/16");
+  auto z = add("resp in 8.8.8.0/24");
+  CHECK_EQUAL(match(e0), (ids{x}));
+  CHECK_EQUAL(match(e1), (ids{x, y, z}));
+  CHECK_EQUAL(match(e2), ids{});
+}
+
+TEST(string equality) {
+  auto x = add("service == \"http\"");
+  auto y = add(":string == \"example.com\"");
+  CHECK_EQUAL(match(e0), (ids{x}));
+  CHECK_EQUAL(match(e1), ids{});
+  CHECK_EQUAL(match(e2), (ids{y}));
+}
+
+TEST(compound queries) {
+  auto x = add("service == \"http\" && resp == 192.168.1.1");
+  auto y = add("service == \"dns\" || bytes > 50");
+  auto z = add("! service == \"dns\"");
+  auto w = add("orig in 10.0.0.0/8 && ! bytes < 100");
+  CHECK_EQUAL(match(e0), (ids{x, z}));
+  CHECK_EQUAL(match(e1), (ids{y, w}));
+  // The DNS event has no service field, hence no query applies.
+  CHECK_EQUAL(match(e2), ids{});
+}
+
+TEST(negated compound queries) {
+  // Neither query has a predicate that holds for the first event.
+  auto x = add("! service == \"dns\" && ! bytes < 10");
+  auto y = add("! (service == \"dns\" || orig == 10.1.0.1)");
+  CHECK_EQUAL(match(e0), (ids{x, y}));
+  CHECK_EQUAL(match(e1), ids{});
+}
+
+TEST(adding queries between events) {
+  auto x = add("service == \"http\" && resp == 192.168.1.1");
+  CHECK_EQUAL(match(e0), (ids{x}));
+  CHECK_EQUAL(match(e2), ids{});
+  // Only the plan of the DNS type changes.
+  auto y = add("query == \"example.com\" && answer == 1.2.3.4");
+  CHECK_EQUAL(match(e0), (ids{x}));
+  CHECK_EQUAL(match(e2), (ids{y}));
+  auto z = add(":addr == 1.2.3.4 || :addr == 192.168.1.1");
+  CHECK_EQUAL(match(e0), (ids{x, z}));
+  CHECK_EQUAL(match(e2), (ids{y, z}));
+  CHECK(matcher.erase(x));
+  CHECK_EQUAL(match(e0), (ids{z}));
+  CHECK_EQUAL(match(e2), (ids{y, z}));
+}
+
+TEST(many indicators) {
+  ids expected;
+  for (auto i = 0; i < 1000; ++i) {
+    auto str = ":addr == 172.16." + std::to_string(i / 256) + '.'
+               + std::to_string(i % 256);
+    add(str.c_str());
+  }
+  expected.push_back(add(":addr == 8.8.8.8"));
+  expected.push_back(add("resp == 8.8.8.8"));
+  expected.push_back(add(":addr in 8.0.0.0/8"));
+  auto e = make_conn("172.16.1.2", "8.8.8.8", "dns", 1u);
+  expected.push_back(1 * 256 + 2);
+  std::sort(expected.begin(), expected.end());
+  CHECK_EQUAL(match(e), expected);
+  CHECK_EQUAL(match(e0), ids{});
+}
+
+TEST(erasing queries) {
+  auto x = add(":addr == 192.168.1.1");
+  auto y = add("service == \"http\"");
+  CHECK_EQUAL(matcher.size(), 2u);
+  CHECK_EQUAL(match(e0), (ids{x, y}));
+  CHECK(matcher.erase(x));
+  CHECK(!matcher.erase(x));
+  CHECK_EQUAL(match(e0), (ids{y}));
+  CHECK(matcher.erase(y));
+  CHECK(matcher.empty());
+  CHECK_EQUAL(match(e0), ids{});
+}
+
+FIXTURE_SCOPE_END()
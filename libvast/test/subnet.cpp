@@ -1,3 +1,5 @@
+#include <random>
+
 #include "vast/concept/parseable/to.hpp"
 #include "vast/concept/parseable/vast/subnet.hpp"
 #include "vast/concept/printable/to_string.hpp"
@@ -59,3 +61,34 @@ TEST(subnet) {
   CHECK(s.network().is_v6());
 }
 
+TEST(fast parser) {
+  auto agree = [](std::string const& str) {
+    subnet x;
+    subnet y;
+    auto f = str.begin();
+    auto l = str.end();
+    auto x_ok = parsers::net(f, l, x) && f == l;
+    f = str.begin();
+    auto y_ok = parsers::fast_net(f, l, y) && f == l;
+    return x_ok == y_ok && (!x_ok || x == y);
+  };
+  std::mt19937 gen{42};
+  auto disagreements = 0;
+  for (auto i = 0; i < 10000; ++i) {
+    uint32_t bytes[4];
+    for (auto& x : bytes)
+      x = gen();
+    auto fam = i % 2 == 0 ? address::ipv4 : address::ipv6;
+    auto str = to_string(address{bytes, fam, address::network});
+    // Include invalid and malformed prefix lengths.
+    str += '/' + std::to_string(gen() % 140);
+    if (i % 10 == 0)
+      str.insert(str.size() - 1, 1, "0/x"[gen() % 3]);
+    if (!agree(str) && disagreements++ == 0)
+      MESSAGE("parsers disagree on " << str);
+  }
+  CHECK_EQUAL(disagreements, 0);
+  MESSAGE("prefix length exceeds address length");
+  CHECK(!to<subnet>("10.0.0.0/33"));
+  CHECK(!to<subnet>("10.0.0.0/300"));
+}
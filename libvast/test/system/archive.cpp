@@ -1,3 +1,5 @@
+#include <algorithm>
+
 #include "vast/concept/printable/stream.hpp"
 #include "vast/concept/printable/vast/event.hpp"
 #include "vast/system/archive.hpp"
@@ -12,7 +14,9 @@ using namespace vast;
 FIXTURE_SCOPE(archive_tests, fixtures::actor_system_and_events)
 
 TEST(archiving and querying) {
-  auto a = self->spawn(system::archive, directory, 10, 1024 * 1024);
+  auto a = self->spawn(system::archive, directory, 10, 1024 * 1024, 2,
+                       codec{compression::lz4}, false,
+                       system::tiering_policy{});
   MESSAGE("sending events");
   self->send(a, bro_conn_log);
   self->send(a, bro_dns_log);
@@ -26,9 +30,15 @@ TEST(archiving and querying) {
   bm.append_bits(true, 50);
   std::vector<event> result;
   self->request(a, infinite, bm).receive(
-    [&](std::vector<event>& xs) { result = std::move(xs); },
+    [&](system::done_atom) { /* nop */ },
     error_handler()
   );
+  self->do_receive(
+    [&](std::vector<event>& xs) {
+      std::move(xs.begin(), xs.end(), std::back_inserter(result));
+    },
+    error_handler()
+  ).until([&] { return result.size() == 100; });
   REQUIRE_EQUAL(result.size(), 100u);
   // We sort because the specific compression algorithm used at the archive
   // determines the order of results.
@@ -44,4 +54,137 @@ TEST(archiving and querying) {
   self->send_exit(a, exit_reason::user_shutdown);
 }
 
+TEST(streaming lookups) {
+  // Small segments spread the events over all shards.
+  auto a = self->spawn(system::archive, directory, 4, 64 * 1024, 4,
+                       codec{compression::lz4}, false,
+                       system::tiering_policy{});
+  MESSAGE("sending events in batches");
+  for (auto i = 0u; i < bro_conn_log.size(); i += 1000) {
+    auto n = std::min(size_t{1000}, bro_conn_log.size() - i);
+    auto first = bro_conn_log.begin() + i;
+    self->send(a, std::vector<event>(first, first + n));
+  }
+  self->request(a, infinite, flush_atom::value).receive(
+    [&](ok_atom) { /* nop */ },
+    error_handler()
+  );
+  MESSAGE("querying all events");
+  bitmap bm;
+  bm.append_bits(true, bro_conn_log.size());
+  self->request(a, infinite, bm).receive(
+    [&](system::done_atom) { /* nop */ },
+    error_handler()
+  );
+  // The archive replies after having shipped all chunks, which are waiting
+  // in our mailbox now.
+  std::vector<event> result;
+  size_t chunks = 0;
+  self->do_receive(
+    [&](std::vector<event>& xs) {
+      CHECK_LESS_EQUAL(xs.size(), system::archive_chunk_size);
+      ++chunks;
+      std::move(xs.begin(), xs.end(), std::back_inserter(result));
+    },
+    error_handler()
+  ).until([&] { return result.size() == bro_conn_log.size(); });
+  CHECK_GREATER(chunks, 1u);
+  REQUIRE_EQUAL(result.size(), bro_conn_log.size());
+  std::sort(result.begin(), result.end());
+  CHECK(result == bro_conn_log);
+  self->send_exit(a, exit_reason::user_shutdown);
+}
+
+TEST(restart with fewer shards) {
+  auto a = self->spawn(system::archive, directory, 4, 64 * 1024, 3,
+                       codec{compression::lz4}, false,
+                       system::tiering_policy{});
+  MESSAGE("sending events in batches");
+  for (auto i = 0u; i < bro_conn_log.size(); i += 1000) {
+    auto n = std::min(size_t{1000}, bro_conn_log.size() - i);
+    auto first = bro_conn_log.begin() + i;
+    self->send(a, std::vector<event>(first, first + n));
+  }
+  MESSAGE("shutting down");
+  self->send_exit(a, exit_reason::user_shutdown);
+  self->wait_for(a);
+  MESSAGE("restarting with fewer shards");
+  a = self->spawn(system::archive, directory, 4, 64 * 1024, 2,
+                  codec{compression::lz4}, false,
+                  system::tiering_policy{});
+  bitmap bm;
+  bm.append_bits(true, bro_conn_log.size());
+  self->request(a, infinite, bm).receive(
+    [&](system::done_atom) { /* nop */ },
+    error_handler()
+  );
+  std::vector<event> result;
+  self->do_receive(
+    [&](std::vector<event>& xs) {
+      std::move(xs.begin(), xs.end(), std::back_inserter(result));
+    },
+    error_handler()
+  ).until([&] { return result.size() == bro_conn_log.size(); });
+  REQUIRE_EQUAL(result.size(), bro_conn_log.size());
+  std::sort(result.begin(), result.end());
+  CHECK(result == bro_conn_log);
+  self->send_exit(a, exit_reason::user_shutdown);
+}
+
+TEST(cold tier) {
+  system::tiering_policy policy;
+  policy.cold_dir = directory / "cold";
+  policy.cold_after = timespan{1}; // All test events are old.
+  auto spawn_archive = [&](size_t shards) {
+    return self->spawn(system::archive, directory / "archive", 4, 64 * 1024,
+                       shards, codec{compression::lz4}, false, policy);
+  };
+  auto lookup = [&](auto& a) {
+    bitmap bm;
+    bm.append_bits(true, bro_conn_log.size());
+    self->request(a, infinite, bm).receive(
+      [&](system::done_atom) { /* nop */ },
+      error_handler()
+    );
+    std::vector<event> result;
+    self->do_receive(
+      [&](std::vector<event>& xs) {
+        std::move(xs.begin(), xs.end(), std::back_inserter(result));
+      },
+      error_handler()
+    ).until([&] { return result.size() == bro_conn_log.size(); });
+    std::sort(result.begin(), result.end());
+    return result;
+  };
+  auto a = spawn_archive(3);
+  MESSAGE("sending events in batches");
+  for (auto i = 0u; i < bro_conn_log.size(); i += 1000) {
+    auto n = std::min(size_t{1000}, bro_conn_log.size() - i);
+    auto first = bro_conn_log.begin() + i;
+    self->send(a, std::vector<event>(first, first + n));
+  }
+  self->request(a, infinite, system::flush_atom::value).receive(
+    [&](system::ok_atom) { /* nop */ },
+    error_handler()
+  );
+  MESSAGE("moving segments to the cold tier");
+  self->request(a, infinite, system::tier_atom::value).receive(
+    [&](size_t n) { CHECK_GREATER(n, 0u); },
+    error_handler()
+  );
+  CHECK(exists(policy.cold_dir));
+  CHECK(lookup(a) == bro_conn_log);
+  self->send_exit(a, exit_reason::user_shutdown);
+  self->wait_for(a);
+  MESSAGE("looking up cold segments after a restart");
+  a = spawn_archive(3);
+  CHECK(lookup(a) == bro_conn_log);
+  self->send_exit(a, exit_reason::user_shutdown);
+  self->wait_for(a);
+  MESSAGE("looking up cold segments after a restart with fewer shards");
+  a = spawn_archive(2);
+  CHECK(lookup(a) == bro_conn_log);
+  self->send_exit(a, exit_reason::user_shutdown);
+}
+
 FIXTURE_SCOPE_END()
@@ -1,5 +1,10 @@
+#include <algorithm>
+#include <vector>
+
 #include <caf/all.hpp>
 
+#include "vast/error.hpp"
+
 #include "vast/system/atoms.hpp"
 #include "vast/system/consensus.hpp"
 #include "vast/system/key_value_store.hpp"
@@ -68,7 +73,8 @@ TEST(single leader) {
   self->receive(
     [&](raft::index_type i, const message& msg) {
       CHECK_EQUAL(i, 3u);
-      CHECK_EQUAL(msg.get_as<std::vector<char>>(2).size(), 1024u);
+      CHECK_EQUAL(msg.get_as<std::vector<char>>(3).size(), 1024u);
+      CHECK(msg.get_as<bool>(4));
     },
     error_handler()
   );
@@ -89,6 +95,116 @@ TEST(single leader) {
   self->wait_for(server);
 }
 
+TEST(out of order failures of pipelined requests) {
+  using raft::append_entries;
+  using raft::request_vote;
+  directory /= "server";
+  auto server = self->spawn(raft::consensus, directory);
+  self->send(server, id_atom::value, raft::server_id{1});
+  self->send(server, peer_atom::value, self, raft::server_id{2});
+  self->send(server, run_atom::value);
+  MESSAGE("voting for the server");
+  auto term = raft::term_type{0};
+  self->receive(
+    [&](const request_vote::request& req) {
+      term = req.term;
+      self->make_response_promise().deliver(
+        request_vote::response{req.term, true});
+    }
+  );
+  MESSAGE("holding back the responses to three pipelined requests");
+  // Each command goes out only after the previous entry, so that the leader
+  // sends one request per entry.
+  // We never answer heartbeats, which the leader keeps sending.
+  std::vector<std::pair<response_promise, raft::index_type>> pending;
+  std::vector<response_promise> heartbeats;
+  auto last = raft::index_type{0};
+  self->receive_while([&] { return last < 3; })(
+    [&](const append_entries::request& req) {
+      if (req.entries.empty()) {
+        heartbeats.push_back(self->make_response_promise());
+        return;
+      }
+      pending.emplace_back(self->make_response_promise(), req.prev_log_index);
+      last = req.entries.back().index;
+      if (last < 3)
+        anon_send(server, replicate_atom::value,
+                  make_message(put_atom::value, "foo", last));
+    }
+  );
+  auto find = [&](raft::index_type prev_log_index) {
+    auto pred = [&](auto& x) { return x.second == prev_log_index; };
+    auto i = std::find_if(pending.begin(), pending.end(), pred);
+    REQUIRE(i != pending.end());
+    return i->first;
+  };
+  MESSAGE("failing the first request, then the last");
+  find(0).deliver(make_error(ec::unspecified, "lost request"));
+  find(2).deliver(append_entries::response{term, 2, false});
+  MESSAGE("expecting the leader to resend from the first entry");
+  auto prev_log_index = raft::index_type{0};
+  auto done = false;
+  self->receive_while([&] { return !done; })(
+    [&](const append_entries::request& req) {
+      heartbeats.push_back(self->make_response_promise());
+      if (!req.entries.empty()) {
+        prev_log_index = req.prev_log_index;
+        done = true;
+      }
+    }
+  );
+  CHECK_EQUAL(prev_log_index, 0u);
+  self->send_exit(server, exit_reason::user_shutdown);
+  self->wait_for(server);
+}
+
+TEST(segmented log) {
+  auto make_entry = [](raft::term_type term, char c) {
+    raft::log_entry x;
+    x.term = term;
+    x.data = std::vector<char>(40, c);
+    return x;
+  };
+  auto dir = directory / "log";
+  // Each segment holds two entries of 24 + 40 bytes.
+  auto segment_size = uint64_t{100};
+  {
+    raft::log log{dir, segment_size};
+    CHECK(log.empty());
+    std::vector<raft::log_entry> xs;
+    for (auto i = 0; i < 10; ++i)
+      xs.push_back(make_entry(i / 4 + 1, 'a' + i));
+    REQUIRE(log.append(std::move(xs)));
+    CHECK_EQUAL(log.first_index(), 1u);
+    CHECK_EQUAL(log.last_index(), 10u);
+    CHECK_EQUAL(bytes(log), 10 * 64u);
+    CHECK_EQUAL(log.term(5), 2u);
+    auto x = log.at(7);
+    CHECK_EQUAL(x.index, 7u);
+    CHECK_EQUAL(x.term, 2u);
+    CHECK(x.data == std::vector<char>(40, 'g'));
+    MESSAGE("truncating the prefix deletes the covered segments");
+    CHECK_EQUAL(log.truncate_before(4), 3u);
+    CHECK_EQUAL(log.first_index(), 4u);
+    CHECK(!exists(dir / "segment-1"));
+    CHECK(exists(dir / "segment-3"));
+    MESSAGE("truncating the suffix trims the last segment");
+    CHECK_EQUAL(log.truncate_after(7), 3u);
+    CHECK_EQUAL(log.last_index(), 7u);
+    CHECK(!exists(dir / "segment-9"));
+    CHECK_EQUAL(*file_size(dir / "segment-7"), 64u);
+    REQUIRE(log.append({make_entry(3, 'x')}));
+    CHECK(log.at(8).data == std::vector<char>(40, 'x'));
+  }
+  MESSAGE("reloading the log from its segments");
+  raft::log log{dir, segment_size};
+  CHECK_EQUAL(log.first_index(), 4u);
+  CHECK_EQUAL(log.last_index(), 8u);
+  CHECK_EQUAL(log.term(8), 3u);
+  CHECK(log.at(4).data == std::vector<char>(40, 'd'));
+  CHECK(log.at(8).data == std::vector<char>(40, 'x'));
+}
+
 FIXTURE_SCOPE_END()
 
 FIXTURE_SCOPE(consensus_tests, fixtures::consensus)
@@ -131,7 +247,7 @@ TEST(manual snapshotting) {
     [&](raft::index_type index, const caf::message& msg)  {
       last_index = index;
       if (self->current_sender() == server1 && index == 2)
-        CHECK_EQUAL(msg.get_as<std::vector<char>>(2).size(), 512u);
+        CHECK_EQUAL(msg.get_as<std::vector<char>>(3).size(), 512u);
     },
     error_handler()
   );
@@ -141,4 +257,49 @@ TEST(manual snapshotting) {
   await(5 + 2);
 }
 
+TEST(snapshot in parts) {
+  MESSAGE("replicating commands");
+  replicate(server1, make_message("foo"));
+  await(1 + 1);
+  replicate(server1, make_message("bar"));
+  await(2 + 1);
+  MESSAGE("sleeping until leader advances commit index");
+  std::this_thread::sleep_for(raft::heartbeat_period * 2);
+  MESSAGE("handing over a snapshot in three parts to server 1");
+  for (auto part = uint64_t{0}; part < 3; ++part)
+    self->request(server1, consensus_timeout, snapshot_atom::value,
+                  raft::index_type{3}, part,
+                  std::vector<char>(100, static_cast<char>('a' + part)),
+                  part == 2).receive(
+      [&](raft::index_type last_included_index) {
+        CHECK_EQUAL(last_included_index, 3u);
+      },
+      error_handler()
+    );
+  MESSAGE("restarting consensus quorum");
+  shutdown();
+  launch();
+  MESSAGE("consuming initial data");
+  // Server #1 sends the three parts of its snapshot in place of the two
+  // commands, the others send the commands.
+  auto parts = uint64_t{0};
+  auto i = 0;
+  self->receive_for(i, 3 + 2 * 2)(
+    [&](raft::index_type index, const caf::message& msg)  {
+      if (self->current_sender() != server1)
+        return;
+      CHECK_EQUAL(index, 3u);
+      REQUIRE(msg.match_elements<snapshot_atom, raft::index_type, uint64_t,
+                                 std::vector<char>, bool>());
+      CHECK_EQUAL(msg.get_as<uint64_t>(2), parts);
+      auto& data = msg.get_as<std::vector<char>>(3);
+      CHECK(data == std::vector<char>(100, static_cast<char>('a' + parts)));
+      CHECK_EQUAL(msg.get_as<bool>(4), parts == 2);
+      ++parts;
+    },
+    error_handler()
+  );
+  CHECK_EQUAL(parts, 3u);
+}
+
 FIXTURE_SCOPE_END()
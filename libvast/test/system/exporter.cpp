@@ -1,3 +1,5 @@
+#include <algorithm>
+
 #include "vast/concept/parseable/to.hpp"
 #include "vast/concept/parseable/vast/expression.hpp"
 #include "vast/query_options.hpp"
@@ -18,8 +20,12 @@ using namespace std::chrono;
 FIXTURE_SCOPE(exporter_tests, fixtures::actor_system_and_events)
 
 TEST(exporter) {
-  auto i = self->spawn(system::index, directory / "index", 1000, 5, 5);
-  auto a = self->spawn(system::archive, directory / "archive", 1, 1024);
+  auto i = self->spawn(system::index, directory / "index", 1000,
+                       uint64_t{1} << 30, 5, timespan::zero(),
+                       system::tiering_policy{});
+  auto a = self->spawn(system::archive, directory / "archive", 1, 1024, 2,
+                       codec{compression::lz4}, false,
+                       system::tiering_policy{});
   MESSAGE("ingesting conn.log");
   self->send(i, bro_conn_log);
   self->send(a, bro_conn_log);
@@ -48,4 +54,85 @@ TEST(exporter) {
   self->send_exit(a, exit_reason::user_shutdown);
 }
 
+TEST(exporter with limit) {
+  auto i = self->spawn(system::index, directory / "index", 1000,
+                       uint64_t{1} << 30, 5, timespan::zero(),
+                       system::tiering_policy{});
+  auto a = self->spawn(system::archive, directory / "archive", 1, 1024, 2,
+                       codec{compression::lz4}, false,
+                       system::tiering_policy{});
+  self->send(i, bro_conn_log);
+  self->send(a, bro_conn_log);
+  auto expr = to<expression>("service == \"http\" && :addr == 212.227.96.110");
+  REQUIRE(expr);
+  auto run = [&](query_options opts) {
+    auto e = self->spawn(system::exporter, *expr, opts);
+    self->send(e, a);
+    self->send(e, system::index_atom::value, i);
+    self->send(e, system::sink_atom::value, self);
+    self->send(e, system::run_atom::value);
+    self->send(e, system::extract_atom::value, uint64_t{5});
+    std::vector<event> results;
+    auto done = false;
+    self->do_receive(
+      [&](std::vector<event>& xs) {
+        std::move(xs.begin(), xs.end(), std::back_inserter(results));
+      },
+      [&](const uuid&, const system::query_statistics& stats) {
+        done = stats.requested == 0;
+      },
+      error_handler()
+    ).until([&] { return done; });
+    self->wait_for(e);
+    return results;
+  };
+  MESSAGE("extracting the first matches");
+  auto results = run(historical);
+  REQUIRE_EQUAL(results.size(), 5u);
+  std::sort(results.begin(), results.end());
+  CHECK_EQUAL(results.front().id(), 105u);
+  MESSAGE("extracting the earliest matches");
+  results = run(historical + ordered);
+  REQUIRE_EQUAL(results.size(), 5u);
+  auto by_time = [](auto& x, auto& y) { return x.timestamp() < y.timestamp(); };
+  CHECK(std::is_sorted(results.begin(), results.end(), by_time));
+  self->send_exit(i, exit_reason::user_shutdown);
+  self->send_exit(a, exit_reason::user_shutdown);
+}
+
+TEST(continuous exporter) {
+  auto expr = to<expression>("service == \"http\" && :addr == 212.227.96.110");
+  REQUIRE(expr);
+  auto e = self->spawn(system::exporter, *expr, continuous);
+  self->send(e, system::sink_atom::value, self);
+  self->send(e, system::extract_atom::value, uint64_t{10});
+  MESSAGE("registering at importer");
+  self->send(e, system::importer_atom::value, self);
+  self->receive(
+    [&](system::continuous_atom, const expression& x) {
+      CHECK_EQUAL(x, *expr);
+    },
+    error_handler()
+  );
+  MESSAGE("relaying matches");
+  auto matches = std::vector<event>(bro_conn_log.begin(),
+                                    bro_conn_log.begin() + 15);
+  for (auto i = 0u; i < matches.size(); ++i)
+    matches[i].id(i);
+  self->send(e, system::continuous_atom::value, matches);
+  std::vector<event> results;
+  self->do_receive(
+    [&](std::vector<event>& xs) {
+      std::move(xs.begin(), xs.end(), std::back_inserter(results));
+    },
+    [&](const uuid&, const system::query_statistics&) {
+      // nop
+    },
+    error_handler()
+  ).until([&] { return results.size() == 10; });
+  MESSAGE("terminating after reaching the limit");
+  self->wait_for(e);
+  CHECK_EQUAL(results.back().id(), 9u);
+}
+
 FIXTURE_SCOPE_END()
@@ -0,0 +1,50 @@
+#include <string>
+#include <vector>
+
+#include "vast/system/filesystem.hpp"
+
+#define SUITE system
+#include "test.hpp"
+#include "fixtures/actor_system.hpp"
+
+using namespace caf;
+using namespace vast;
+using namespace vast::system;
+
+FIXTURE_SCOPE(filesystem_tests, fixtures::actor_system)
+
+TEST(filesystem) {
+  auto fs = self->spawn(system::filesystem, 2);
+  auto filename = directory / "foo" / "bar";
+  auto bytes = [](std::string const& str) {
+    return std::vector<char>(str.begin(), str.end());
+  };
+  MESSAGE("writing a file in a new directory");
+  self->request(fs, infinite, write_atom::value, filename, bytes("foo"))
+    .receive([&](ok_atom) { /* nop */ }, error_handler());
+  CHECK(exists(filename));
+  CHECK(!exists(filename + ".tmp"));
+  MESSAGE("appending to the file");
+  self->request(fs, infinite, append_atom::value, filename, bytes("bar"))
+    .receive([&](ok_atom) { /* nop */ }, error_handler());
+  MESSAGE("reading the file");
+  self->request(fs, infinite, read_atom::value, filename).receive(
+    [&](std::vector<char> const& xs) { CHECK(xs == bytes("foobar")); },
+    error_handler()
+  );
+  MESSAGE("replacing the file");
+  self->request(fs, infinite, write_atom::value, filename, bytes("baz"))
+    .receive([&](ok_atom) { /* nop */ }, error_handler());
+  self->request(fs, infinite, read_atom::value, filename).receive(
+    [&](std::vector<char> const& xs) { CHECK(xs == bytes("baz")); },
+    error_handler()
+  );
+  MESSAGE("reading a nonexistent file");
+  self->request(fs, infinite, read_atom::value, directory / "qux").receive(
+    [&](std::vector<char> const&) { FAIL("expected an error"); },
+    [&](error const& e) { CHECK(e == ec::filesystem_error); }
+  );
+  self->send_exit(fs, exit_reason::user_shutdown);
+}
+
+FIXTURE_SCOPE_END()
@@ -1,5 +1,8 @@
+#include "vast/concept/parseable/to.hpp"
+#include "vast/concept/parseable/vast/expression.hpp"
 #include "vast/concept/printable/stream.hpp"
 #include "vast/concept/printable/vast/event.hpp"
+#include "vast/expression.hpp"
 
 #include "vast/system/archive.hpp"
 #include "vast/system/data_store.hpp"
@@ -33,4 +36,33 @@ TEST(importer) {
   self->send_exit(importer, exit_reason::user_shutdown);
 }
 
+TEST(importer continuous queries) {
+  directory /= "importer";
+  auto store = self->spawn(system::data_store<std::string, data>);
+  auto importer = self->spawn(system::importer, directory, 1024);
+  self->send(importer, store);
+  self->send(importer, actor_cast<system::archive_type>(self));
+  self->send(importer, system::index_atom::value, self);
+  MESSAGE("registering continuous query");
+  auto expr = to<expression>("service == \"http\" && :addr == 212.227.96.110");
+  REQUIRE(expr);
+  self->send(importer, system::continuous_atom::value, *expr);
+  MESSAGE("sending events");
+  self->send(importer, bro_conn_log);
+  MESSAGE("receiving matches and reflected events");
+  std::vector<event> matches;
+  auto batches = 0;
+  self->do_receive(
+    [&](system::continuous_atom, std::vector<event>& xs) {
+      std::move(xs.begin(), xs.end(), std::back_inserter(matches));
+    },
+    [&](const std::vector<event>&) { ++batches; },
+    error_handler()
+  ).until([&] { return batches == 2; });
+  // The importer relays matches before shipping the batch.
+  REQUIRE_EQUAL(matches.size(), 28u);
+  CHECK_EQUAL(matches.front().type().name(), "bro::conn");
+  self->send_exit(importer, exit_reason::user_shutdown);
+}
+
 FIXTURE_SCOPE_END()
@@ -3,6 +3,7 @@
 #include "vast/concept/parseable/vast/expression.hpp"
 #include "vast/query_options.hpp"
 
+#include "vast/system/atoms.hpp"
 #include "vast/system/index.hpp"
 
 #define SUITE index
@@ -22,7 +23,9 @@ FIXTURE_SCOPE(index_tests, fixtures::actor_system_and_events)
 TEST(index) {
   directory /= "index";
   MESSAGE("spawing");
-  auto index = self->spawn(system::index, directory, 1000, 5, 10);
+  auto budget = uint64_t{1} << 30;
+  auto index = self->spawn(system::index, directory, 1000, budget, 10,
+                            timespan::zero(), system::tiering_policy{});
   MESSAGE("indexing logs");
   self->send(index, bro_conn_log);
   self->send(index, bro_dns_log);
@@ -56,8 +59,9 @@ TEST(index) {
   self->send_exit(index, exit_reason::user_shutdown);
   self->wait_for(index);
   CHECK(exists(directory / "meta"));
-  MESSAGE("reloading index");
-  index = self->spawn(system::index, directory, 1000, 2, 2);
+  MESSAGE("reloading index with a budget for a single partition");
+  index = self->spawn(system::index, directory, 1000, 1, 2,
+                      timespan::zero(), system::tiering_policy{});
   MESSAGE("issueing queries");
   self->send(index, *expr);
   self->receive(
@@ -71,7 +75,7 @@ TEST(index) {
         [&](const bitmap& hits) { all |= hits; },
         error_handler()
       );
-      // Evict one partition.
+      // Schedule the last partition, which evicts a resident one.
       self->send(index, id, size_t{1});
       self->receive(
         [&](const bitmap& hits) { all |= hits; },
@@ -85,4 +89,119 @@ TEST(index) {
   self->wait_for(index);
 }
 
+TEST(compaction) {
+  directory /= "index-compaction";
+  auto budget = uint64_t{1} << 30;
+  auto spawn_index = [&] {
+    return self->spawn(system::index, directory, 1000, budget, 10,
+                       timespan::zero(), system::tiering_policy{});
+  };
+  auto expr = to<expression>("id.resp_p == 80/?");
+  REQUIRE(expr);
+  // Returns the number of partitions of a lookup along with its hits.
+  auto lookup = [&](const actor& index) {
+    auto result = std::make_pair(size_t{0}, bitmap{});
+    self->send(index, *expr);
+    self->receive(
+      [&](const uuid&, size_t total, size_t scheduled) {
+        result.first = total;
+        size_t i = 0;
+        self->receive_for(i, scheduled)(
+          [&](const bitmap& hits) { result.second |= hits; },
+          error_handler()
+        );
+      },
+      error_handler()
+    );
+    return result;
+  };
+  auto shutdown = [&](const actor& index) {
+    self->send_exit(index, exit_reason::user_shutdown);
+    self->wait_for(index);
+  };
+  MESSAGE("creating small partitions through restarts");
+  for (auto i = 0; i < 3; ++i) {
+    auto index = spawn_index();
+    auto first = bro_conn_log.begin() + i * 200;
+    self->send(index, std::vector<event>(first, first + 200));
+    shutdown(index);
+  }
+  auto index = spawn_index();
+  auto before = lookup(index);
+  CHECK_EQUAL(before.first, 3u);
+  CHECK_EQUAL(rank(before.second), 137u);
+  // Partitions that serve lookups remain in place.
+  shutdown(index);
+  MESSAGE("merging partitions");
+  index = spawn_index();
+  self->request(index, infinite, system::compact_atom::value).receive(
+    [&](size_t n) { CHECK_EQUAL(n, 3u); },
+    error_handler()
+  );
+  auto after = lookup(index);
+  CHECK_EQUAL(after.first, 1u);
+  CHECK_EQUAL(rank(after.second), 137u);
+  CHECK_EQUAL(rank(after.second & before.second), 137u);
+  shutdown(index);
+  MESSAGE("reloading merged partition");
+  index = spawn_index();
+  after = lookup(index);
+  CHECK_EQUAL(after.first, 1u);
+  CHECK_EQUAL(rank(after.second), 137u);
+  shutdown(index);
+}
+
+TEST(cold tier) {
+  directory /= "index-tiering";
+  system::tiering_policy policy;
+  policy.cold_dir = directory / "cold";
+  policy.cold_after = timespan{1}; // All test events are old.
+  auto spawn_index = [&] {
+    return self->spawn(system::index, directory / "hot", 1000,
+                       uint64_t{1} << 30, 10, timespan::zero(), policy);
+  };
+  auto expr = to<expression>(":addr == 74.125.19.100");
+  REQUIRE(expr);
+  auto total_hits = size_t{11u + 0 + 24}; // conn + dns + http
+  auto lookup = [&](const actor& index) {
+    bitmap all;
+    self->send(index, *expr);
+    self->receive(
+      [&](const uuid&, size_t total, size_t scheduled) {
+        CHECK_EQUAL(total, 3u);
+        size_t i = 0;
+        self->receive_for(i, scheduled)(
+          [&](const bitmap& hits) { all |= hits; },
+          error_handler()
+        );
+      },
+      error_handler()
+    );
+    return rank(all);
+  };
+  auto shutdown = [&](const actor& index) {
+    self->send_exit(index, exit_reason::user_shutdown);
+    self->wait_for(index);
+  };
+  MESSAGE("indexing logs");
+  auto index = spawn_index();
+  self->send(index, bro_conn_log);
+  self->send(index, bro_dns_log);
+  self->send(index, bro_http_log);
+  shutdown(index);
+  MESSAGE("moving partitions to the cold tier");
+  index = spawn_index();
+  self->request(index, infinite, system::tier_atom::value).receive(
+    [&](size_t n) { CHECK_EQUAL(n, 3u); },
+    error_handler()
+  );
+  CHECK(exists(policy.cold_dir));
+  CHECK_EQUAL(lookup(index), total_hits);
+  shutdown(index);
+  MESSAGE("looking up cold partitions after a restart");
+  index = spawn_index();
+  CHECK_EQUAL(lookup(index), total_hits);
+  shutdown(index);
+}
+
 FIXTURE_SCOPE_END()
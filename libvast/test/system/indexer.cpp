@@ -1,3 +1,5 @@
+#include <fstream>
+
 #include "vast/concept/parseable/to.hpp"
 #include "vast/concept/parseable/vast/expression.hpp"
 #include "vast/concept/printable/stream.hpp"
@@ -5,7 +7,9 @@
 #include "vast/concept/printable/vast/event.hpp"
 #include "vast/concept/printable/vast/expression.hpp"
 #include "vast/bitmap.hpp"
+#include "vast/filesystem.hpp"
 
+#include "vast/system/atoms.hpp"
 #include "vast/system/indexer.hpp"
 
 #define SUITE system
@@ -74,4 +78,146 @@ TEST(indexer) {
   );
 }
 
+TEST(indexer lookup cache) {
+  directory /= "indexer-cache";
+  const auto conn_log_type = bro_conn_log[0].type();
+  auto i = self->spawn(system::event_indexer, directory, conn_log_type);
+  auto pred = to<predicate>("id.resp_p == 995/?");
+  REQUIRE(pred);
+  auto query = [&] {
+    bitmap result;
+    self->request(i, infinite, *pred).receive(
+      [&](bitmap& bm) { result = std::move(bm); },
+      error_handler()
+    );
+    return result;
+  };
+  MESSAGE("ingesting first half of events");
+  auto half = bro_conn_log.begin() + bro_conn_log.size() / 2;
+  self->send(i, std::vector<event>(bro_conn_log.begin(), half));
+  auto first = query();
+  MESSAGE("repeating query on unchanged index");
+  CHECK_EQUAL(query(), first);
+  MESSAGE("extending cached result with appended events");
+  self->send(i, std::vector<event>(half, bro_conn_log.end()));
+  auto second = query();
+  CHECK_EQUAL(rank(second), 53u);
+  CHECK_EQUAL(rank(second & first), rank(first));
+  self->send(i, system::shutdown_atom::value);
+  self->wait_for(i);
+}
+
+TEST(indexer flush) {
+  directory /= "indexer-flush";
+  const auto conn_log_type = bro_conn_log[0].type();
+  auto i = self->spawn(system::event_indexer, directory, conn_log_type);
+  auto pred = to<predicate>("id.resp_p == 995/?");
+  REQUIRE(pred);
+  auto query = [&](actor const& a) {
+    bitmap result;
+    self->request(a, infinite, *pred).receive(
+      [&](bitmap& bm) { result = std::move(bm); },
+      error_handler()
+    );
+    return result;
+  };
+  auto flush = [&] {
+    self->request(i, infinite, system::flush_atom::value).receive(
+      [](system::ok_atom) { /* nop */ },
+      error_handler()
+    );
+  };
+  MESSAGE("ingesting and flushing first half of events");
+  auto split = bro_conn_log.size() / 2;
+  auto half = bro_conn_log.begin() + split;
+  self->send(i, std::vector<event>(bro_conn_log.begin(), half));
+  flush();
+  MESSAGE("ingesting second half of events without flushing");
+  self->send(i, std::vector<event>(half, bro_conn_log.end()));
+  auto all = query(i);
+  CHECK_EQUAL(rank(all), 53u);
+  auto flushed = 0u;
+  for (auto id : select(all))
+    if (id < split)
+      ++flushed;
+  // A second indexer on the same directory sees what a restart after a crash
+  // would see: the flushed events only.
+  MESSAGE("reading flushed segment");
+  auto j = self->spawn(system::event_indexer, directory, conn_log_type);
+  auto result = query(j);
+  CHECK_EQUAL(rank(result), flushed);
+  CHECK_EQUAL(rank(result & all), rank(result));
+  MESSAGE("reading two flushed segments");
+  flush();
+  auto k = self->spawn(system::event_indexer, directory, conn_log_type);
+  CHECK_EQUAL(rank(query(k)), 53u);
+  MESSAGE("compacting segments on shutdown");
+  for (auto& x : {j, k, i}) {
+    self->send(x, system::shutdown_atom::value);
+    self->wait_for(x);
+  }
+  i = self->spawn(system::event_indexer, directory, conn_log_type);
+  CHECK_EQUAL(rank(query(i)), 53u);
+  self->send(i, system::shutdown_atom::value);
+  self->wait_for(i);
+}
+
+TEST(indexer flush gap) {
+  directory /= "indexer-flush-gap";
+  const auto conn_log_type = bro_conn_log[0].type();
+  auto i = self->spawn(system::event_indexer, directory, conn_log_type);
+  auto pred = to<predicate>("id.resp_p == 995/?");
+  REQUIRE(pred);
+  auto query = [&](actor const& a) {
+    bitmap result;
+    self->request(a, infinite, *pred).receive(
+      [&](bitmap& bm) { result = std::move(bm); },
+      error_handler()
+    );
+    return result;
+  };
+  auto filename = directory / "data" / "id" / "resp_p";
+  std::vector<size_t> sizes;
+  auto ingest = [&](auto first, auto last) {
+    self->send(i, std::vector<event>(first, last));
+    self->request(i, infinite, system::flush_atom::value).receive(
+      [](system::ok_atom) { /* nop */ },
+      error_handler()
+    );
+    auto size = file_size(filename);
+    REQUIRE(size);
+    sizes.push_back(*size);
+  };
+  MESSAGE("flushing three segments");
+  auto third = bro_conn_log.size() / 3;
+  auto first = bro_conn_log.begin() + third;
+  auto second = first + third;
+  ingest(bro_conn_log.begin(), first);
+  ingest(first, second);
+  ingest(second, bro_conn_log.end());
+  auto all = query(i);
+  CHECK_EQUAL(rank(all), 53u);
+  // Shutting down compacts the segments, so we grab them beforehand.
+  auto contents = load_contents(filename);
+  REQUIRE(contents);
+  REQUIRE_EQUAL(contents->size(), sizes[2]);
+  self->send(i, system::shutdown_atom::value);
+  self->wait_for(i);
+  MESSAGE("dropping the second segment");
+  {
+    std::ofstream out{filename.str(), std::ios::binary | std::ios::trunc};
+    out.write(contents->data(), sizes[0]);
+    out.write(contents->data() + sizes[1], sizes[2] - sizes[1]);
+  }
+  MESSAGE("reading the segment before the gap");
+  auto flushed = 0u;
+  for (auto id : select(all))
+    if (id < third)
+      ++flushed;
+  i = self->spawn(system::event_indexer, directory, conn_log_type);
+  CHECK_EQUAL(rank(query(i)), flushed);
+  self->send(i, system::shutdown_atom::value);
+  self->wait_for(i);
+}
+
 FIXTURE_SCOPE_END()
@@ -1,6 +1,10 @@
+#include <algorithm>
+
 #include "vast/bitmap.hpp"
 #include "vast/concept/parseable/to.hpp"
 #include "vast/concept/parseable/vast/expression.hpp"
+#include "vast/load.hpp"
+#include "vast/save.hpp"
 
 #include "vast/system/partition.hpp"
 #include "vast/system/task.hpp"
@@ -12,6 +16,7 @@
 using namespace caf;
 using namespace vast;
 using namespace std::chrono;
+using namespace std::string_literals;
 
 namespace {
 
@@ -76,4 +81,86 @@ TEST(partition queries 2) {
   CHECK_EQUAL(rank(hits), 28u);
 }
 
+TEST(partition queries with empty conjunction) {
+  // The most selective operand yields no hits, which renders evaluating the
+  // remaining operands unnecessary. We act as ACCOUNTANT of the respawned
+  // partition to see how many lookups it performed.
+  system.registry().put(system::accountant_atom::value,
+                        actor_cast<strong_actor_ptr>(self));
+  auto hits = query("service == \"http\" && :addr == 1.2.3.4");
+  CHECK_EQUAL(rank(hits), 0u);
+  self->send(partition, system::shutdown_atom::value);
+  self->wait_for(partition);
+  system.registry().erase(system::accountant_atom::value);
+  MESSAGE("checking that the remaining stage skipped its lookup");
+  auto lookups = uint64_t{0};
+  auto reported = false;
+  self->receive_while([&] { return !reported; })(
+    [&](const std::string& key, uint64_t x) {
+      if (key == "partition.lookups.distinct") {
+        lookups = x;
+        reported = true;
+      }
+    }
+  );
+  CHECK_EQUAL(lookups, 1u);
+}
+
+TEST(concurrent partition queries) {
+  // Both queries share the predicate on the service field.
+  auto str_x = "service == \"http\" && :addr == 212.227.96.110"s;
+  auto str_y = "service == \"http\""s;
+  auto expected_x = query(str_x);
+  auto expected_y = query(str_y);
+  auto x = to<expression>(str_x);
+  auto y = to<expression>(str_y);
+  REQUIRE(x);
+  REQUIRE(y);
+  MESSAGE("sending queries concurrently");
+  auto i = self->request(partition, infinite, *x);
+  auto j = self->request(partition, infinite, *y);
+  i.receive(
+    [&](const bitmap& hits) { CHECK_EQUAL(hits, expected_x); },
+    error_handler()
+  );
+  j.receive(
+    [&](const bitmap& hits) { CHECK_EQUAL(hits, expected_y); },
+    error_handler()
+  );
+}
+
+TEST(reloading partitions with other INDEXER directories) {
+  auto expr = to<expression>("service == \"http\" && :addr == 212.227.96.110");
+  REQUIRE(expr);
+  MESSAGE("shutting down partition");
+  self->send(partition, system::shutdown_atom::value);
+  self->wait_for(partition);
+  MESSAGE("renaming INDEXER directories as an older version might have");
+  using indexer_list = std::vector<std::pair<std::string, type>>;
+  indexer_list indexers;
+  REQUIRE(load(directory / "meta", indexers));
+  REQUIRE_EQUAL(indexers.size(), 2u);
+  for (auto& x : indexers) {
+    auto name = "legacy-" + x.first;
+    REQUIRE(rename(directory / x.first, directory / name));
+    x.first = std::move(name);
+  }
+  REQUIRE(save(directory / "meta", indexers));
+  MESSAGE("respawning partition and sending query");
+  partition = self->spawn(system::partition, directory);
+  self->request(partition, infinite, *expr).receive(
+    [&](const bitmap& hits) { CHECK_EQUAL(rank(hits), 28u); },
+    error_handler()
+  );
+  MESSAGE("checking that the meta data keeps the directories");
+  self->send(partition, system::shutdown_atom::value);
+  self->wait_for(partition);
+  indexer_list persisted;
+  REQUIRE(load(directory / "meta", persisted));
+  std::sort(indexers.begin(), indexers.end());
+  std::sort(persisted.begin(), persisted.end());
+  CHECK(persisted == indexers);
+  partition = self->spawn(system::partition, directory);
+}
+
 FIXTURE_SCOPE_END()
@@ -1,3 +1,5 @@
+#include <algorithm>
+
 #include <caf/all.hpp>
 
 #include "vast/system/atoms.hpp"
@@ -118,4 +120,61 @@ TEST(multiple replicated stores) {
   self->wait_for(store3);
 }
 
+TEST(concurrent operations) {
+  auto store = self->spawn(replicated_store<int, int>, server1);
+  self->request(store, timeout, put_atom::value, 42, 0).receive(
+    [](ok_atom) { /* nop */ },
+    error_handler()
+  );
+  MESSAGE("sending a burst of operations that the store submits in batches");
+  auto n = 100;
+  for (auto i = 0; i < n; ++i)
+    self->send(store, add_atom::value, 42, 1);
+  std::vector<int> old;
+  auto i = 0;
+  self->receive_for(i, n)(
+    [&](int x) { old.push_back(x); },
+    error_handler()
+  );
+  std::sort(old.begin(), old.end());
+  for (auto j = 0; j < n; ++j)
+    CHECK_EQUAL(old[j], j);
+  self->request(store, timeout, get_atom::value, 42).receive(
+    [&](optional<int> x) {
+      REQUIRE(x);
+      CHECK_EQUAL(*x, n);
+    },
+    error_handler()
+  );
+  self->send_exit(store, exit_reason::user_shutdown);
+  self->wait_for(store);
+}
+
+TEST(linearizable reads) {
+  auto store1 = self->spawn(replicated_store<int, int>, server1);
+  auto store2 = self->spawn(replicated_store<int, int>, server2);
+  auto store3 = self->spawn(replicated_store<int, int>, server3);
+  MESSAGE("reading a completed write from all stores without delay");
+  for (auto value : {1, 2, 3}) {
+    self->request(store1, timeout, put_atom::value, 42, value).receive(
+      [](ok_atom) { /* nop */ },
+      error_handler()
+    );
+    for (auto store : {store1, store2, store3})
+      self->request(store, timeout, get_atom::value, 42).receive(
+        [&](optional<int> i) {
+          REQUIRE(i);
+          CHECK_EQUAL(*i, value);
+        },
+        error_handler()
+      );
+  }
+  self->send_exit(store1, exit_reason::user_shutdown);
+  self->send_exit(store2, exit_reason::user_shutdown);
+  self->send_exit(store3, exit_reason::user_shutdown);
+  self->wait_for(store1);
+  self->wait_for(store2);
+  self->wait_for(store3);
+}
+
 FIXTURE_SCOPE_END()
@@ -1,3 +1,7 @@
+#include <fstream>
+#include <memory>
+
+#include "vast/format/bro.hpp"
 #include "vast/format/pcap.hpp"
 #include "vast/system/source.hpp"
 
@@ -27,4 +31,23 @@ TEST(PCAP source) {
   });
 }
 
+TEST(Bro source) {
+  static_assert(has_packed_read<format::bro::reader>::value,
+                "Bro reader must produce packed records");
+  static_assert(!has_packed_read<format::pcap::reader>::value,
+                "PCAP reader must not produce packed records");
+  format::bro::reader reader{std::make_unique<std::ifstream>(bro::conn)};
+  auto src = self->spawn(source<format::bro::reader>, std::move(reader));
+  self->monitor(src);
+  self->send(src, sink_atom::value, self);
+  self->send(src, run_atom::value);
+  self->receive([&](std::vector<event> const& events) {
+    REQUIRE_EQUAL(events.size(), 8462u);
+    CHECK_EQUAL(events[0].type().name(), "bro::conn");
+  });
+  self->receive([&](caf::down_msg const& msg) {
+    CHECK(msg.reason == caf::exit_reason::normal);
+  });
+}
+
 FIXTURE_SCOPE_END()
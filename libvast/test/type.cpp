@@ -97,6 +97,50 @@ TEST(serialization) {
   CHECK(t0 == t1);
 }
 
+TEST(interning) {
+  auto make = [] {
+    auto r = record_type{
+      {"x", integer_type{}},
+      {"y", vector_type{address_type{}}}
+    };
+    r.name("foo");
+    return type{r};
+  };
+  auto t0 = make();
+  auto t1 = make();
+  MESSAGE("structurally equal types share a digest");
+  auto i0 = intern(t0);
+  auto i1 = intern(t1);
+  CHECK(i0 == i1);
+  CHECK_EQUAL(i0.digest(), t1.digest());
+  CHECK_EQUAL(std::hash<type>{}(i0), std::hash<type>{}(t0));
+  CHECK(i0 != intern(type{string_type{}}));
+  MESSAGE("modifying the original leaves the canonical instance intact");
+  t0.name("bar");
+  CHECK_EQUAL(i0.name(), "foo");
+  MESSAGE("modifying an interned type detaches it");
+  auto i2 = i1;
+  i2.name("baz");
+  CHECK_EQUAL(i1.name(), "foo");
+  CHECK(i2 != i1);
+  CHECK(intern(i2) != i0);
+  MESSAGE("mutable access to an interned type detaches it");
+  auto i3 = i1;
+  get<record_type>(i3).fields.pop_back();
+  const auto& c1 = i1;
+  CHECK_EQUAL(get<record_type>(c1).fields.size(), 2u);
+  CHECK_EQUAL(i1.digest(), i0.digest());
+  CHECK(i3 != i1);
+  CHECK(intern(i3) != i0);
+  MESSAGE("deserialization yields the canonical instance");
+  std::vector<char> buf;
+  save(buf, i0);
+  type t2;
+  load(buf, t2);
+  CHECK(t2 == i0);
+  CHECK_EQUAL(t2.digest(), i0.digest());
+}
+
 TEST(record range) {
   auto r = record_type{
     {"x", record_type{
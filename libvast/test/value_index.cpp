@@ -1,3 +1,4 @@
+#include "vast/chunk.hpp"
 #include "vast/value_index.hpp"
 #include "vast/load.hpp"
 #include "vast/save.hpp"
@@ -421,3 +422,207 @@ TEST(polymorphic none values) {
   REQUIRE(bm);
   CHECK_EQUAL(to_string(*bm), "00000001100000001110000");
 }
+
+TEST(estimates) {
+  type t = string_type{};
+  auto idx = value_index::make(t);
+  for (auto i = 0; i < 8; ++i)
+    REQUIRE(idx->push_back("foo"));
+  for (auto i = 0; i < 5; ++i)
+    REQUIRE(idx->push_back("bar"));
+  for (auto i = 0; i < 10; ++i)
+    REQUIRE(idx->push_back(nil));
+  CHECK_EQUAL(idx->cardinality(), 13u);
+  CHECK_EQUAL(idx->estimate(equal, nil), 10u);
+  CHECK_EQUAL(idx->estimate(not_equal, nil), 13u);
+  // Equality estimates represent upper bounds.
+  auto foo = idx->estimate(equal, "foo");
+  CHECK_GREATER_EQUAL(foo, 8u);
+  CHECK_LESS_EQUAL(foo, 13u);
+  CHECK_EQUAL(idx->estimate(not_equal, "foo"), 13u - foo);
+  CHECK_LESS_EQUAL(idx->estimate(ni, "oo"), 13u);
+  MESSAGE("serialization");
+  std::vector<char> buf;
+  save(buf, detail::value_index_inspect_helper{t, idx});
+  std::unique_ptr<value_index> idx2;
+  detail::value_index_inspect_helper helper{t, idx2};
+  load(buf, helper);
+  REQUIRE(idx2);
+  CHECK_EQUAL(idx2->cardinality(), 13u);
+  CHECK_EQUAL(idx2->estimate(equal, "foo"), foo);
+}
+
+TEST(lazy loading) {
+  type t = string_type{};
+  auto idx = value_index::make(t);
+  REQUIRE(idx);
+  REQUIRE(idx->push_back("foo"));
+  REQUIRE(idx->push_back("bar"));
+  REQUIRE(idx->push_back(nil));
+  REQUIRE(idx->push_back("foobar"));
+  std::vector<char> buf;
+  REQUIRE(save(buf, detail::value_index_inspect_helper{t, idx}));
+  MESSAGE("load skeleton from chunk");
+  std::unique_ptr<value_index> idx2;
+  detail::value_index_inspect_helper helper{t, idx2};
+  REQUIRE(load(chunk::make(std::move(buf)), helper));
+  REQUIRE(idx2);
+  CHECK_EQUAL(idx2->offset(), 4u);
+  CHECK_EQUAL(to_string(*idx2->lookup(equal, "foo")), "1000");
+  CHECK_EQUAL(to_string(*idx2->lookup(ni, "bar")), "0101");
+  MESSAGE("append to partially materialized index");
+  REQUIRE(idx2->push_back("bar"));
+  CHECK_EQUAL(to_string(*idx2->lookup(equal, "bar")), "01001");
+  MESSAGE("save partially materialized index");
+  std::vector<char> buf2;
+  REQUIRE(save(buf2, detail::value_index_inspect_helper{t, idx2}));
+  std::unique_ptr<value_index> idx3;
+  detail::value_index_inspect_helper helper3{t, idx3};
+  REQUIRE(load(buf2, helper3));
+  REQUIRE(idx3);
+  CHECK_EQUAL(to_string(*idx3->lookup(equal, "foobar")), "00010");
+  CHECK_EQUAL(to_string(*idx3->lookup(equal, nil)), "00100");
+}
+
+namespace {
+
+// Builds an index over a sequence of values with IDs, once in one pass and
+// once in two parts, where the second part has IDs relative to the end of the
+// first. Appending the second part to the first must yield the same index.
+void check_append(type const& t, std::vector<std::pair<data, event_id>> xs,
+                  std::vector<std::pair<relational_operator, data>> queries,
+                  size_t split) {
+  auto whole = value_index::make(t);
+  auto head = value_index::make(t);
+  auto tail = value_index::make(t);
+  REQUIRE(whole && head && tail);
+  for (auto& x : xs)
+    REQUIRE(whole->push_back(x.first, x.second));
+  for (auto i = 0u; i < split; ++i)
+    REQUIRE(head->push_back(xs[i].first, xs[i].second));
+  auto base = head->offset();
+  for (auto i = split; i < xs.size(); ++i)
+    REQUIRE(tail->push_back(xs[i].first, xs[i].second - base));
+  REQUIRE(head->append(*tail));
+  CHECK_EQUAL(head->offset(), whole->offset());
+  CHECK_EQUAL(head->cardinality(), whole->cardinality());
+  queries.emplace_back(equal, nil);
+  queries.emplace_back(not_equal, nil);
+  for (auto& q : queries) {
+    auto x = whole->lookup(q.first, q.second);
+    auto y = head->lookup(q.first, q.second);
+    REQUIRE(x && y);
+    CHECK_EQUAL(to_string(*x), to_string(*y));
+  }
+}
+
+// Builds an index over a sequence of values with IDs, once in one pass and
+// once in two interleaved parts. Merging the parts must yield the same index.
+// Splits the values into two parts, merges the parts, and compares the result
+// with an index over all values. If *split* is 0, the parts take turns,
+// otherwise the first part gets all IDs below *split*.
+void check_merge(type const& t, std::vector<std::pair<data, event_id>> xs,
+                 std::vector<std::pair<relational_operator, data>> queries,
+                 event_id split = 0) {
+  auto whole = value_index::make(t);
+  auto first = value_index::make(t);
+  auto second = value_index::make(t);
+  REQUIRE(whole && first && second);
+  for (auto i = 0u; i < xs.size(); ++i) {
+    REQUIRE(whole->push_back(xs[i].first, xs[i].second));
+    auto in_first = split == 0 ? i % 2 == 0 : xs[i].second < split;
+    auto& part = in_first ? first : second;
+    REQUIRE(part->push_back(xs[i].first, xs[i].second));
+  }
+  REQUIRE(second->merge(*first));
+  CHECK_EQUAL(second->offset(), whole->offset());
+  CHECK_EQUAL(second->cardinality(), whole->cardinality());
+  queries.emplace_back(equal, nil);
+  queries.emplace_back(not_equal, nil);
+  for (auto& q : queries) {
+    auto x = whole->lookup(q.first, q.second);
+    auto y = second->lookup(q.first, q.second);
+    REQUIRE(x && y);
+    CHECK_EQUAL(to_string(*x), to_string(*y));
+  }
+}
+
+} // namespace <anonymous>
+
+TEST(append) {
+  MESSAGE("integers");
+  check_append(integer_type{},
+               {{42, 0}, {43, 1}, {nil, 2}, {42, 3}, {-7, 5}, {43, 9}},
+               {{equal, 42}, {less, 43}, {greater_equal, 0}}, 3);
+  MESSAGE("strings with trailing nils and gaps");
+  check_append(string_type{},
+               {{"foo", 0}, {nil, 1}, {nil, 3}, {"foobar", 4}, {nil, 5},
+                {"bar", 8}},
+               {{equal, "foo"}, {equal, "foobar"}, {ni, "bar"}}, 3);
+  MESSAGE("empty head");
+  check_append(string_type{}, {{nil, 0}, {nil, 2}, {"qux", 3}, {"foo", 6}},
+               {{equal, "qux"}, {not_equal, "foo"}}, 2);
+  MESSAGE("addresses");
+  auto a = *to<address>("192.168.0.1");
+  auto b = *to<address>("::1");
+  check_append(address_type{}, {{a, 0}, {b, 1}, {a, 4}, {nil, 5}, {b, 7}},
+               {{equal, a}, {not_equal, b}}, 2);
+  MESSAGE("sequences");
+  check_append(vector_type{string_type{}},
+               {{vector{"foo", "bar"}, 0}, {vector{"qux"}, 1},
+                {vector{"bar", "baz", "foo"}, 4}, {vector{}, 5},
+                {vector{"foo"}, 6}},
+               {{in, "foo"}, {in, "baz"}, {not_in, "bar"}}, 2);
+  MESSAGE("type mismatch");
+  auto x = value_index::make(integer_type{});
+  auto y = value_index::make(string_type{});
+  CHECK(!x->append(*y));
+}
+
+TEST(merge) {
+  MESSAGE("integers");
+  check_merge(integer_type{},
+              {{42, 0}, {43, 1}, {nil, 2}, {42, 3}, {-7, 5}, {43, 9}},
+              {{equal, 42}, {less, 43}, {greater_equal, 0}});
+  MESSAGE("strings");
+  check_merge(string_type{},
+              {{"foo", 0}, {nil, 1}, {"foobar", 3}, {nil, 4}, {"bar", 5},
+               {nil, 8}},
+              {{equal, "foo"}, {equal, "foobar"}, {ni, "bar"}});
+  MESSAGE("ports");
+  check_merge(port_type{},
+              {{port{80, port::tcp}, 1}, {port{53, port::udp}, 2},
+               {port{80, port::tcp}, 3}, {port{443, port::tcp}, 7}},
+              {{equal, port{80, port::tcp}}, {less, port{100, port::unknown}}});
+  MESSAGE("sequences");
+  check_merge(vector_type{string_type{}},
+              {{vector{"foo", "bar"}, 0}, {vector{"qux"}, 1},
+               {vector{"bar", "baz", "foo"}, 4}, {vector{}, 5},
+               {vector{"foo"}, 6}},
+              {{in, "foo"}, {in, "baz"}, {not_in, "bar"}});
+  MESSAGE("booleans with disjoint ID ranges");
+  auto booleans = std::vector<std::pair<data, event_id>>{
+    {true, 0}, {false, 1}, {nil, 2}, {false, 4},
+    {false, 6}, {true, 7}, {nil, 8}, {false, 9}, {true, 12}};
+  check_merge(boolean_type{}, booleans, {{equal, true}, {equal, false},
+                                         {not_equal, true}}, 5);
+  check_merge(boolean_type{}, booleans, {{equal, true}, {equal, false}}, 10);
+  MESSAGE("addresses with disjoint ID ranges");
+  auto a = *to<address>("192.168.0.1");
+  auto b = *to<address>("::1");
+  auto c = *to<address>("10.0.0.1");
+  auto addrs = std::vector<std::pair<data, event_id>>{
+    {b, 0}, {a, 1}, {nil, 2}, {b, 4},
+    {c, 6}, {b, 7}, {nil, 8}, {a, 11}};
+  auto addr_queries = std::vector<std::pair<relational_operator, data>>{
+    {equal, a}, {equal, b}, {equal, c}, {not_equal, a}, {not_equal, b}};
+  check_merge(address_type{}, addrs, addr_queries, 5);
+  check_merge(address_type{}, addrs, addr_queries, 9);
+  check_merge(address_type{}, addrs, addr_queries);
+  MESSAGE("overlapping rows");
+  auto x = value_index::make(integer_type{});
+  auto y = value_index::make(integer_type{});
+  REQUIRE(x->push_back(42));
+  REQUIRE(y->push_back(43));
+  CHECK(!x->merge(*y));
+}
@@ -14,7 +14,10 @@
 #include "vast/bitmap.hpp"
 #include "vast/compression.hpp"
 #include "vast/detail/compressedbuf.hpp"
+#include "vast/detail/flat_hash_map.hpp"
+#include "vast/detail/monotonic_arena.hpp"
 #include "vast/expected.hpp"
+#include "vast/packed_record.hpp"
 #include "vast/time.hpp"
 #include "vast/type.hpp"
 
@@ -27,6 +30,9 @@ class batch {
   using buffer_type = std::vector<char>;
   using size_type = uint64_t;
 
+  // Marks type IDs of events stored as packed records.
+  static constexpr uint32_t packed_flag = 1u << 31;
+
 public:
   /// A proxy class to write events into the batch.
   class writer;
@@ -79,16 +85,40 @@ public:
   /// @param method The compression method to use.
   writer(compression method = compression::null);
 
-  /// Writes an event into the batch.
+  /// Constructs a writer from a batch.
+  /// @param c The codec to use. The batch records the compression method,
+  ///          while the compressed data carries the remaining parameters
+  ///          needed for reading, such as the ID of a dictionary.
+  writer(codec c);
+
+  /// Writes an event into the batch. Events with a record type go into the
+  /// batch as packed records.
   /// @param e The event to serialize.
   bool write(event const& e);
 
+  /// Writes a packed record as event into the batch. The batch stores the
+  /// memory of the record with scalars in little endian, followed by its
+  /// containers. Readers convert the record back to ::data.
+  /// @param x The record to serialize.
+  /// @param ts The timestamp of the event.
+  bool write(packed_record const& x, timestamp ts);
+
   /// Constructs a batch from the accumulated events.
   batch seal();
 
 private:
+  // Packs the records of one type.
+  struct packer {
+    explicit packer(type const& t);
+
+    record_layout layout;
+    packed_record::builder builder;
+  };
+
   batch batch_;
-  std::unordered_map<type, uint32_t> type_cache_;
+  detail::flat_hash_map<type, uint32_t> type_cache_;
+  std::unordered_map<type, packer> packers_;
+  detail::monotonic_arena arena_;
   caf::vectorbuf vectorbuf_;
   detail::compressedbuf compressedbuf_;
   caf::stream_serializer<detail::compressedbuf&> serializer_;
@@ -112,8 +142,12 @@ public:
 private:
   expected<event> materialize();
 
+  expected<vector> unpack(uint32_t type_id, type const& t);
+
   buffer_type const& data_;
-  std::unordered_map<uint32_t, type> type_cache_;
+  detail::flat_hash_map<uint32_t, type> type_cache_;
+  std::unordered_map<uint32_t, record_layout> layout_cache_;
+  detail::monotonic_arena arena_;
   select_range<bitmap_bit_range> id_range_;
   size_type available_;
   caf::charbuf charbuf_;
@@ -62,8 +62,28 @@ public:
 
   /// Appends the contents of another bitmap index to this one.
   /// @param other The other bitmap index.
-  void append(bitmap_index const& other) {
-    coder_.append(other.coder_);
+  /// @param skip The number of entries to skip before appending *other*.
+  /// @post Skipped entries show up as 0s during decoding.
+  void append(bitmap_index const& other, size_type skip = 0) {
+    coder_.append(other.coder_, skip);
+  }
+
+  /// Merges another bitmap index with this one.
+  /// @param other The other bitmap index.
+  /// @pre No entry has a value in both bitmap indexes.
+  void merge(bitmap_index const& other) {
+    coder_.merge(other.coder_);
+  }
+
+  /// Merges another bitmap index with this one, taking all entries in *rows*
+  /// from *other* and all remaining entries from this bitmap index.
+  /// @param other The other bitmap index.
+  /// @param rows The entries that *other* holds.
+  /// @pre No entry has a value in both bitmap indexes.
+  template <class C = coder_type>
+  auto merge(bitmap_index const& other, bitmap_type const& rows)
+  -> std::enable_if_t<is_singleton_coder<C>{}> {
+    coder_.merge(other.coder_, rows);
   }
 
   /// Retrieves a bitmap of a given value with respect to a given operator.
@@ -0,0 +1,56 @@
+#ifndef VAST_CANDIDATE_CHECKER_HPP
+#define VAST_CANDIDATE_CHECKER_HPP
+
+#include <cstdint>
+#include <functional>
+#include <vector>
+
+#include "vast/expression.hpp"
+#include "vast/type.hpp"
+
+namespace vast {
+
+class event;
+
+/// Checks whether events of a specific type satisfy an expression. The
+/// checker compiles the expression into a flat program upfront: it resolves
+/// record offsets to field accessors, specializes each operator for the type
+/// of its operand, converts constants into their most efficient form (e.g.,
+/// compiles patterns into regular expressions), and folds predicates that
+/// are constant for the type, such as `&type == "foo"`.
+class candidate_checker {
+public:
+  /// Constructs a checker that rejects all events.
+  candidate_checker() = default;
+
+  /// Compiles an expression for a given event type.
+  /// @param expr The expression after resolving and pruning it for *t*.
+  /// @param t The type of the events to check.
+  candidate_checker(expression const& expr, type const& t);
+
+  /// Checks whether an event satisfies the expression.
+  /// @param e The event to check.
+  /// @returns `true` iff *e* satisfies the expression.
+  /// @pre `e.type()` equals the type the checker was compiled for.
+  bool operator()(event const& e) const;
+
+private:
+  using predicate_function = std::function<bool(event const&)>;
+
+  enum opcode : uint8_t { op_and, op_or, op_not, op_pred, op_true, op_false };
+
+  struct instruction {
+    opcode op;
+    uint32_t arg;  // predicate index or number of operands
+    uint32_t size; // number of instructions of the subtree
+  };
+
+  bool run(instruction const* code, event const& e) const;
+
+  std::vector<instruction> code_;
+  std::vector<predicate_function> predicates_;
+};
+
+} // namespace vast
+
+#endif
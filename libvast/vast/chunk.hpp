@@ -0,0 +1,62 @@
+#ifndef VAST_CHUNK_HPP
+#define VAST_CHUNK_HPP
+
+#include <cstddef>
+#include <memory>
+#include <vector>
+
+#include "vast/filesystem.hpp"
+
+namespace vast {
+
+class chunk;
+
+/// A shared handle to an immutable chunk.
+using chunk_ptr = std::shared_ptr<chunk const>;
+
+/// A contiguous block of immutable memory. A chunk either owns its bytes or
+/// references a read-only memory mapping of a file. In the latter case, the
+/// operating system pages in only the parts of the file that readers touch.
+class chunk {
+public:
+  using value_type = char;
+  using size_type = size_t;
+  using const_iterator = char const*;
+
+  /// Constructs a chunk that owns a sequence of bytes.
+  /// @param xs The bytes to take ownership of.
+  /// @returns A chunk holding *xs*.
+  static chunk_ptr make(std::vector<char> xs);
+
+  /// Memory-maps a file into a chunk.
+  /// @param filename The path of the file to map.
+  /// @returns A chunk spanning the entire file or `nullptr` on failure.
+  static chunk_ptr mmap(path const& filename);
+
+  ~chunk();
+
+  chunk(chunk const&) = delete;
+  chunk& operator=(chunk const&) = delete;
+
+  /// @returns A pointer to the first byte of the chunk.
+  char const* data() const;
+
+  /// @returns The number of bytes in the chunk.
+  size_type size() const;
+
+  const_iterator begin() const;
+
+  const_iterator end() const;
+
+private:
+  chunk() = default;
+
+  char const* data_ = nullptr;
+  size_type size_ = 0;
+  std::vector<char> buffer_;
+  bool mapped_ = false;
+};
+
+} // namespace vast
+
+#endif
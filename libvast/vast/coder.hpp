@@ -13,6 +13,7 @@
 #include "vast/base.hpp"
 #include "vast/operator.hpp"
 #include "vast/detail/assert.hpp"
+#include "vast/detail/lazy_vector.hpp"
 #include "vast/detail/operators.hpp"
 
 namespace vast {
@@ -46,8 +47,16 @@ struct coder {
 
   /// Appends another coder to this instance.
   /// @param other The coder to append.
-  /// @pre `size() + other.size() < Bitmap::max_size`
-  void append(coder const& other);
+  /// @param skip The number of entries to skip before appending *other*.
+  /// @pre `size() + skip + other.size() < Bitmap::max_size`
+  /// @post Skipped entries show up as 0s during decoding.
+  void append(coder const& other, size_type skip = 0);
+
+  /// Merges another coder with this instance.
+  /// @param other The coder to merge.
+  /// @pre No row has a value in both coders.
+  /// @post The coder has `max(size(), other.size())` entries.
+  void merge(coder const& other);
 
   /// Retrieves the number entries in the coder, i.e., the number of rows.
   /// @returns The size of the coder measured in number of entries.
@@ -67,7 +76,8 @@ public:
 
   void encode(value_type x, size_type n = 1, size_type skip = 0) {
     VAST_ASSERT(Bitmap::max_size - size() >= n + skip);
-    bitmap_.append_bits(x, n + skip);
+    bitmap_.append_bits(false, skip);
+    bitmap_.append_bits(x, n);
   }
 
   Bitmap decode(relational_operator op, value_type x) const {
@@ -79,10 +89,24 @@ public:
     return result;
   }
 
-  void append(singleton_coder const& other) {
+  void append(singleton_coder const& other, size_type skip = 0) {
+    bitmap_.append_bits(false, skip);
     bitmap_.append(other.bitmap_);
   }
 
+  void merge(singleton_coder const& other) {
+    bitmap_ |= other.bitmap_;
+  }
+
+  /// Merges another coder whose padding may contain 1s, e.g., because it
+  /// predates zero-padding of skipped entries.
+  /// @param other The coder to merge.
+  /// @param rows The entries that *other* holds, which must not exceed the
+  ///             size of the merged coder.
+  void merge(singleton_coder const& other, Bitmap const& rows) {
+    bitmap_ = (bitmap_ - rows) | (other.bitmap_ & rows);
+  }
+
   size_type size() const {
     return bitmap_.size();
   }
@@ -117,8 +141,12 @@ public:
   vector_coder(size_t n) : size_{0}, bitmaps_(n) {
   }
 
-  void append(vector_coder const& other) {
-    append(other, false);
+  void append(vector_coder const& other, size_type skip = 0) {
+    append(other, false, skip);
+  }
+
+  void merge(vector_coder const& other) {
+    merge(other, false);
   }
 
   auto size() const {
@@ -133,23 +161,47 @@ public:
     return x.size_ == y.size_ && x.bitmaps_ == y.bitmaps_;
   }
 
+  // Part of the index file format, whose version lives in indexer.cpp.
   template <class Inspector>
   friend auto inspect(Inspector& f, vector_coder& ec) {
     return f(ec.size_, ec.bitmaps_);
   }
 
 protected:
-  void append(vector_coder const& other, bool bit) {
+  // Pads all bitmaps with *bit* up to the size of the coder plus *skip*
+  // before appending the bitmaps of *other*.
+  void append(vector_coder const& other, bool bit, size_type skip) {
     VAST_ASSERT(bitmaps_.size() == other.bitmaps_.size());
     for (auto i = 0u; i < bitmaps_.size(); ++i) {
-      bitmaps_[i].append_bits(bit, this->size() - bitmaps_[i].size());
+      bitmaps_[i].append_bits(bit, this->size() + skip - bitmaps_[i].size());
       bitmaps_[i].append(other.bitmaps_[i]);
     }
-    size_ += other.size_;
+    size_ += skip + other.size_;
+  }
+
+  // Combines the bitmaps of two coders whose values occupy disjoint rows.
+  // All other rows consist of *bit* in both coders, which makes AND the
+  // combining operation for padding with 1s and OR for padding with 0s.
+  void merge(vector_coder const& other, bool bit) {
+    VAST_ASSERT(bitmaps_.size() == other.bitmaps_.size());
+    auto n = std::max(size_, other.size_);
+    for (auto i = 0u; i < bitmaps_.size(); ++i) {
+      auto& x = bitmaps_[i];
+      auto y = other.bitmaps_[i];
+      x.append_bits(bit, n - x.size());
+      y.append_bits(bit, n - y.size());
+      if (bit)
+        x &= y;
+      else
+        x |= y;
+    }
+    size_ = n;
   }
 
   size_type size_;
-  std::vector<Bitmap> bitmaps_;
+  // Deserializing a coder from a chunk defers materializing its bitmaps until
+  // a lookup or an append operation touches them.
+  detail::lazy_vector<Bitmap> bitmaps_;
 };
 
 /// Encodes each value in its own bitmap.
@@ -290,8 +342,12 @@ public:
     }
   }
 
-  void append(range_coder const& other) {
-    vector_coder<Bitmap>::append(other, true);
+  void append(range_coder const& other, size_type skip = 0) {
+    vector_coder<Bitmap>::append(other, true, skip);
+  }
+
+  void merge(range_coder const& other) {
+    vector_coder<Bitmap>::merge(other, true);
   }
 };
 
@@ -427,10 +483,16 @@ public:
     return coders_.empty() ? bitmap_type{} : decode(coders_, op, x);
   }
 
-  void append(multi_level_coder const& other) {
+  void append(multi_level_coder const& other, size_type skip = 0) {
+    VAST_ASSERT(coders_.size() == other.coders_.size());
+    for (auto i = 0u; i < coders_.size(); ++i)
+      coders_[i].append(other.coders_[i], skip);
+  }
+
+  void merge(multi_level_coder const& other) {
     VAST_ASSERT(coders_.size() == other.coders_.size());
     for (auto i = 0u; i < coders_.size(); ++i)
-      coders_[i].append(other.coders_[i]);
+      coders_[i].merge(other.coders_[i]);
   }
 
   size_type size() const {
@@ -3,8 +3,11 @@
 
 #include <cstdint>
 #include <cstddef>
+#include <string>
+#include <vector>
 
 #include "vast/config.hpp"
+#include "vast/expected.hpp"
 
 namespace vast {
 
@@ -13,10 +16,32 @@ enum class compression : int8_t {
   null      = 0,
   lz4       = 1,
 #ifdef VAST_HAVE_SNAPPY
-  snappy    = 2
+  snappy    = 2,
 #endif
+#ifdef VAST_HAVE_ZSTD
+  zstd      = 3,
+#endif
+};
+
+/// A compression algorithm along with its parameters.
+struct codec {
+  codec(compression m = compression::null, int l = 0, uint32_t d = 0)
+    : method{m},
+      level{l},
+      dictionary{d} {
+  }
+
+  compression method;
+  int level;           ///< The compression level; 0 selects the default.
+  uint32_t dictionary; ///< The ID of a registered dictionary; 0 means none.
 };
 
+/// Looks up a codec by name. Valid names are `null`, `lz4`, `snappy`, and
+/// `zstd`, where the latter takes an optional level as in `zstd-19`.
+/// @param name The name of the codec.
+/// @returns The codec named *name*.
+expected<codec> make_codec(std::string const& name);
+
 /// The LZ4 compression algorithm.
 namespace lz4 {
 
@@ -53,6 +78,46 @@ bool uncompress(char const* in, size_t in_size, char* out);
 } // namespace snappy
 #endif // VAST_SNAPPY
 
+#ifdef VAST_HAVE_ZSTD
+/// The Zstandard compression algorithm. Zstandard supports dictionaries,
+/// which improve the compression ratio of small inputs considerably. Each
+/// compressed block records the ID of its dictionary, which must have been
+/// registered via ::add_dictionary before uncompressing the block.
+namespace zstd {
+
+/// Returns an upper bound for the compressed output.
+/// @param size The size of the uncompressed input.
+size_t compress_bound(size_t size);
+
+/// Compresses a contiguous byte sequence.
+/// @param level The compression level; 0 selects the default.
+/// @param dictionary The ID of a registered dictionary or 0.
+/// @returns The size of the compressed output or 0 on failure.
+size_t compress(char const* in, size_t in_size, char* out, size_t out_size,
+                int level = 0, uint32_t dictionary = 0);
+
+/// Uncompresses a contiguous byte sequence.
+/// @returns The size of the uncompressed output or 0 on failure.
+size_t uncompress(char const* in, size_t in_size, char* out, size_t out_size);
+
+/// Trains a dictionary from a set of samples.
+/// @param samples The concatenation of all samples.
+/// @param sizes The size of each sample.
+/// @param capacity The maximum size of the dictionary in bytes.
+/// @returns The dictionary.
+expected<std::vector<char>> train_dictionary(std::vector<char> const& samples,
+                                             std::vector<size_t> const& sizes,
+                                             size_t capacity);
+
+/// Makes a dictionary available to compression and uncompression in all
+/// threads. Adding a dictionary twice has no effect.
+/// @param dictionary The dictionary as returned by ::train_dictionary.
+/// @returns The ID of *dictionary*.
+expected<uint32_t> add_dictionary(std::vector<char> dictionary);
+
+} // namespace zstd
+#endif // VAST_HAVE_ZSTD
+
 } // namespace vast
 
 #endif
@@ -374,6 +374,7 @@ struct hash_inspector {
   using result_type = void;
 
   static constexpr bool reads_state = true;
+  static constexpr bool writes_state = false;
 
   hash_inspector(Hasher& h) : h_{h} {
   }
@@ -418,7 +419,8 @@ struct hash_inspector {
 
 template <class Hasher, class T>
 std::enable_if_t<
-  caf::detail::is_inspectable<detail::hash_inspector<Hasher>, T>::value
+  !detail::is_contiguously_hashable<T, Hasher>{}
+    && caf::detail::is_inspectable<detail::hash_inspector<Hasher>, T>::value
 >
 hash_append(Hasher& h, T const& x) noexcept {
   detail::hash_inspector<Hasher> f{h};
@@ -1,11 +1,38 @@
 #ifndef VAST_CONCEPT_HASHABLE_UHASH_HPP
 #define VAST_CONCEPT_HASHABLE_UHASH_HPP
 
+#include <cstddef>
+#include <memory>
+#include <type_traits>
+#include <utility>
+
 #include "vast/concept/hashable/hash_append.hpp"
 
 namespace vast {
+namespace detail {
+
+/// Checks whether a hasher can digest a contiguous input in one pass via a
+/// member function `one_shot(void const*, size_t)`.
+template <class Hasher>
+class has_one_shot {
+  template <class H>
+  static auto test(H const* h)
+  -> decltype(h->one_shot(static_cast<void const*>(nullptr), size_t{0}),
+              std::true_type());
+
+  template <class>
+  static auto test(...) -> std::false_type;
+
+public:
+  static constexpr bool value = decltype(test<Hasher>(nullptr))::value;
+};
 
-/// The universal hash function.
+} // namespace detail
+
+/// The universal hash function. Each invocation hashes its argument with a
+/// fresh copy of the hasher passed at construction. Values that are
+/// contiguously hashable go through the one-shot function of the hasher if
+/// it has one, which avoids the overhead of the streaming interface.
 template <class Hasher>
 class uhash {
 public:
@@ -16,12 +43,28 @@ public:
   }
 
   template <class T>
-  result_type operator()(T const& x) noexcept {
-    hash_append(h_, x);
-    return static_cast<result_type>(h_);
+  result_type operator()(T const& x) const noexcept {
+    using one_shot = std::integral_constant<
+      bool,
+      detail::has_one_shot<Hasher>::value
+        && detail::is_contiguously_hashable<T, Hasher>{}
+    >;
+    return hash(x, one_shot{});
   }
 
 private:
+  template <class T>
+  result_type hash(T const& x, std::true_type) const noexcept {
+    return h_.one_shot(std::addressof(x), sizeof(x));
+  }
+
+  template <class T>
+  result_type hash(T const& x, std::false_type) const noexcept {
+    auto h = h_;
+    hash_append(h, x);
+    return static_cast<result_type>(h);
+  }
+
   Hasher h_;
 };
 
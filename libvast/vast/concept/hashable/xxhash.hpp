@@ -24,6 +24,10 @@ public:
 
   explicit operator result_type() noexcept;
 
+  /// Computes the digest of a single contiguous input under the seed of this
+  /// hasher, bypassing the streaming state.
+  result_type one_shot(void const* x, size_t n) const noexcept;
+
   template <class Inspector>
   friend auto inspect(Inspector& f, xxhash32& xxh) {
     return f(xxh.state_);
@@ -33,6 +37,7 @@ private:
   struct state_type { long long ll[ 6]; };
 
   state_type state_;
+  result_type seed_;
 };
 
 /// The 64-bit version of xxHash.
@@ -44,6 +49,10 @@ public:
 
   explicit operator result_type() noexcept;
 
+  /// Computes the digest of a single contiguous input under the seed of this
+  /// hasher, bypassing the streaming state.
+  result_type one_shot(void const* x, size_t n) const noexcept;
+
   template <class Inspector>
   friend auto inspect(Inspector& f, xxhash64& xxh) {
     return f(xxh.state_);
@@ -53,6 +62,7 @@ private:
   struct state_type { long long ll[11]; };
 
   state_type state_;
+  result_type seed_;
 };
 
 /// The [xxhash](https://github.com/Cyan4973/xxHash) algorithm.
@@ -8,6 +8,7 @@
 #include "vast/concept/parseable/core/difference.hpp"
 #include "vast/concept/parseable/core/guard.hpp"
 #include "vast/concept/parseable/core/ignore.hpp"
+#include "vast/concept/parseable/core/in_place.hpp"
 #include "vast/concept/parseable/core/kleene.hpp"
 #include "vast/concept/parseable/core/list.hpp"
 #include "vast/concept/parseable/core/literal.hpp"
@@ -16,9 +17,11 @@
 #include "vast/concept/parseable/core/operators.hpp"
 #include "vast/concept/parseable/core/optional.hpp"
 #include "vast/concept/parseable/core/plus.hpp"
+#include "vast/concept/parseable/core/raw.hpp"
 #include "vast/concept/parseable/core/repeat.hpp"
 #include "vast/concept/parseable/core/rule.hpp"
 #include "vast/concept/parseable/core/sequence.hpp"
 #include "vast/concept/parseable/core/sequence_choice.hpp"
+#include "vast/concept/parseable/core/static_rule.hpp"
 
 #endif
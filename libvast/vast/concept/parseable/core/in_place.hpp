@@ -0,0 +1,70 @@
+#ifndef VAST_CONCEPT_PARSEABLE_CORE_IN_PLACE_HPP
+#define VAST_CONCEPT_PARSEABLE_CORE_IN_PLACE_HPP
+
+#include <type_traits>
+
+#include "vast/concept/parseable/core/parser.hpp"
+#include "vast/variant.hpp"
+
+namespace vast {
+namespace detail {
+
+template <typename T>
+T& in_place_attribute(T& a, std::true_type) {
+  return a;
+}
+
+// Reuses the alternative of a variant attribute if it already holds a T, which
+// keeps the memory a previous parse allocated.
+template <typename T, typename Attribute>
+T& in_place_attribute(Attribute& a, std::false_type) {
+  if (auto x = get_if<T>(a))
+    return *x;
+  a = T{};
+  return get<T>(a);
+}
+
+} // namespace detail
+
+/// Wraps a parser and constructs its attribute directly inside the attribute
+/// of the caller. If the caller passes a variant (e.g., ::data) which already
+/// holds a `T`, the parser writes into that instance, so that parsing into the
+/// same ::data repeatedly reuses its memory. The parser must overwrite its
+/// attribute rather than append to it.
+template <typename T, typename Parser>
+class in_place_parser : public parser<in_place_parser<T, Parser>> {
+public:
+  using attribute = T;
+
+  explicit in_place_parser(Parser p) : parser_{std::move(p)} {
+  }
+
+  template <typename Iterator>
+  bool parse(Iterator& f, Iterator const& l, unused_type) const {
+    return parser_(f, l, unused);
+  }
+
+  template <typename Iterator, typename Attribute>
+  bool parse(Iterator& f, Iterator const& l, Attribute& a) const {
+    auto same = std::is_same<T, Attribute>{};
+    return parser_(f, l, detail::in_place_attribute<T>(a, same));
+  }
+
+private:
+  Parser parser_;
+};
+
+/// Parses into a `T` inside the attribute of the caller.
+/// @relates in_place_parser
+template <typename T, typename Parser>
+auto in_place(Parser&& p)
+-> std::enable_if_t<
+     is_parser<std::decay_t<Parser>>::value,
+     in_place_parser<T, std::decay_t<Parser>>
+   > {
+  return in_place_parser<T, std::decay_t<Parser>>{std::forward<Parser>(p)};
+}
+
+} // namespace vast
+
+#endif
@@ -0,0 +1,69 @@
+#ifndef VAST_CONCEPT_PARSEABLE_CORE_RAW_HPP
+#define VAST_CONCEPT_PARSEABLE_CORE_RAW_HPP
+
+#include <string>
+#include <type_traits>
+
+#include "vast/concept/parseable/core/parser.hpp"
+#include "vast/string_view.hpp"
+
+namespace vast {
+
+/// Wraps a parser and exposes the consumed input as attribute instead of the
+/// attribute of the parser. With a ::string_view attribute, parsing allocates
+/// no memory, but the view references the input and requires an iterator
+/// over contiguous characters.
+template <typename Parser>
+class raw_parser : public parser<raw_parser<Parser>> {
+public:
+  using attribute = string_view;
+
+  explicit raw_parser(Parser p) : parser_{std::move(p)} {
+  }
+
+  template <typename Iterator>
+  bool parse(Iterator& f, Iterator const& l, unused_type) const {
+    return parser_(f, l, unused);
+  }
+
+  template <typename Iterator>
+  bool parse(Iterator& f, Iterator const& l, string_view& a) const {
+    auto begin = f;
+    if (!parser_(f, l, unused))
+      return false;
+    a = begin == f ? string_view{} : string_view{&*begin, size(begin, f)};
+    return true;
+  }
+
+  template <typename Iterator>
+  bool parse(Iterator& f, Iterator const& l, std::string& a) const {
+    auto begin = f;
+    if (!parser_(f, l, unused))
+      return false;
+    a.assign(begin, f);
+    return true;
+  }
+
+private:
+  template <typename Iterator>
+  static size_t size(Iterator const& begin, Iterator const& end) {
+    return static_cast<size_t>(end - begin);
+  }
+
+  Parser parser_;
+};
+
+/// Exposes the input that a parser consumes as attribute.
+/// @relates raw_parser
+template <typename Parser>
+auto raw(Parser&& p)
+-> std::enable_if_t<
+     is_parser<std::decay_t<Parser>>::value,
+     raw_parser<std::decay_t<Parser>>
+   > {
+  return raw_parser<std::decay_t<Parser>>{std::forward<Parser>(p)};
+}
+
+} // namespace vast
+
+#endif
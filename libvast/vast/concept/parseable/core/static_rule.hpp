@@ -0,0 +1,50 @@
+#ifndef VAST_CONCEPT_PARSEABLE_CORE_STATIC_RULE_HPP
+#define VAST_CONCEPT_PARSEABLE_CORE_STATIC_RULE_HPP
+
+#include <tuple>
+#include <type_traits>
+#include <utility>
+
+#include "vast/concept/parseable/core/parser.hpp"
+#include "vast/variant.hpp"
+
+#include "vast/detail/type_traits.hpp"
+
+namespace vast {
+
+/// A parser which can store one out of a closed set of parsers. Unlike
+/// ::rule, it stores the parser inline and dispatches without a virtual
+/// function call, which allows the compiler to inline the chosen parser.
+/// @tparam Iterator The iterator type of the input.
+/// @tparam Attribute The attribute of all parsers.
+/// @tparam Parsers The types of the parsers the rule can hold.
+template <typename Iterator, typename Attribute, typename... Parsers>
+class static_rule
+  : public parser<static_rule<Iterator, Attribute, Parsers...>> {
+public:
+  using attribute = Attribute;
+
+  template <
+    typename RHS,
+    typename = std::enable_if_t<
+      detail::contains<std::decay_t<RHS>, std::tuple<Parsers...>>::value
+    >
+  >
+  static_rule(RHS&& rhs) : parser_{std::forward<RHS>(rhs)} {
+  }
+
+  bool parse(Iterator& f, Iterator const& l, unused_type) const {
+    return visit([&](auto& p) { return p(f, l, unused); }, parser_);
+  }
+
+  bool parse(Iterator& f, Iterator const& l, Attribute& a) const {
+    return visit([&](auto& p) { return p(f, l, a); }, parser_);
+  }
+
+private:
+  variant<Parsers...> parser_;
+};
+
+} // namespace vast
+
+#endif
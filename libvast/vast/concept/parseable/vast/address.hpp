@@ -1,6 +1,9 @@
 #ifndef VAST_CONCEPT_PARSEABLE_VAST_ADDRESS_HPP
 #define VAST_CONCEPT_PARSEABLE_VAST_ADDRESS_HPP
 
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
 #include <cstring>
 
 #include <arpa/inet.h>  // inet_pton
@@ -9,6 +12,7 @@
 #include "vast/access.hpp"
 #include "vast/address.hpp"
 #include "vast/detail/assert.hpp"
+#include "vast/detail/swar.hpp"
 
 #include "vast/concept/parseable/core.hpp"
 #include "vast/concept/parseable/numeric/integral.hpp"
@@ -134,6 +138,143 @@ struct access::parser<address> : vast::parser<access::parser<address>> {
   }
 };
 
+namespace detail {
+
+// Parses a dotted quad into 4 bytes. Sets *canonical* to false if an octet
+// has leading zeros.
+inline char const* parse_v4(char const* p, uint8_t* bytes, bool& canonical) {
+  canonical = true;
+  for (auto i = 0; i < 4; ++i) {
+    if (i > 0 && *p++ != '.')
+      return nullptr;
+    auto chars = load_chars(p);
+    auto n = count_digits(chars);
+    if (n == 0 || n > 3)
+      return nullptr;
+    auto x = parse_digits(chars, n);
+    if (x > 255)
+      return nullptr;
+    if (n > 1 && *p == '0')
+      canonical = false;
+    bytes[i] = static_cast<uint8_t>(x);
+    p += n;
+  }
+  return p;
+}
+
+inline int hex_value(char c) {
+  if (c >= '0' && c <= '9')
+    return c - '0';
+  c |= 0x20;
+  if (c >= 'a' && c <= 'f')
+    return c - 'a' + 10;
+  return -1;
+}
+
+// Parses an IPv6 address into 16 bytes in network order. Like the grammar of
+// address_parser, it stops after the longest valid prefix.
+inline char const* parse_v6(char const* p, uint8_t* bytes) {
+  uint16_t groups[8];
+  auto n = 0;
+  auto gap = -1;
+  if (*p == ':') {
+    if (p[1] != ':')
+      return nullptr;
+    gap = 0;
+    p += 2;
+  }
+  // The gap stands for at least one group.
+  auto max_groups = [&] { return gap < 0 ? 8 : 7; };
+  while (n < max_groups()) {
+    auto value = 0;
+    auto k = 0;
+    for (auto h = hex_value(p[k]); k < 4 && h >= 0; h = hex_value(p[++k]))
+      value = value * 16 + h;
+    if (k == 0)
+      break;
+    if (p[k] == '.' && n + 2 <= max_groups()) {
+      // An embedded IPv4 address makes up the last two groups. Unlike in
+      // standalone addresses, inet_pton rejects octets with leading zeros.
+      uint8_t v4[4];
+      auto canonical = true;
+      if (auto end = parse_v4(p, v4, canonical)) {
+        if (!canonical)
+          return nullptr;
+        groups[n++] = static_cast<uint16_t>(v4[0] << 8 | v4[1]);
+        groups[n++] = static_cast<uint16_t>(v4[2] << 8 | v4[3]);
+        p = end;
+        break;
+      }
+    }
+    groups[n++] = static_cast<uint16_t>(value);
+    p += k;
+    if (p[0] != ':' || n == max_groups())
+      break;
+    if (p[1] == ':') {
+      if (gap >= 0)
+        break;
+      gap = n;
+      p += 2;
+    } else if (hex_value(p[1]) >= 0) {
+      ++p;
+    } else {
+      break;
+    }
+  }
+  if (gap < 0 && n < 8)
+    return nullptr;
+  auto zeros = 8 - n;
+  for (auto i = 0, j = 0; i < 8; ++i) {
+    auto x = i >= gap && i < gap + zeros ? 0 : groups[j++];
+    bytes[2 * i] = static_cast<uint8_t>(x >> 8);
+    bytes[2 * i + 1] = static_cast<uint8_t>(x & 0xff);
+  }
+  return p;
+}
+
+} // namespace detail
+
+/// An IP address parser that produces the same results as parsers::addr, but
+/// processes the digits of dotted quads in parallel. It requires a
+/// random-access iterator.
+struct fast_address_parser : vast::parser<fast_address_parser> {
+  using attribute = address;
+
+  // The longest IPv6 address has 45 characters, and parsing looks at most at
+  // one character beyond an address.
+  static constexpr ptrdiff_t lookahead = 48;
+
+  template <typename Iterator>
+  bool parse(Iterator& f, Iterator const& l, unused_type) const {
+    address a;
+    return parse(f, l, a);
+  }
+
+  template <typename Iterator>
+  bool parse(Iterator& f, Iterator const& l, address& a) const {
+    // Work on a zero-padded copy so that we can always read 8 characters.
+    char buf[lookahead + 16] = {};
+    auto n = l - f < lookahead ? l - f : lookahead;
+    std::copy(f, f + n, buf);
+    uint8_t bytes[16];
+    auto canonical = true;
+    auto end = detail::parse_v4(buf, bytes, canonical);
+    if (end) {
+      uint32_t v4;
+      std::memcpy(&v4, bytes, 4);
+      a = address{&v4, address::ipv4, address::network};
+    } else if ((end = detail::parse_v6(buf, bytes))) {
+      uint32_t v6[4];
+      std::memcpy(v6, bytes, 16);
+      a = address{v6, address::ipv6, address::network};
+    } else {
+      return false;
+    }
+    f += end - buf;
+    return true;
+  }
+};
+
 template <>
 struct parser_registry<address> {
   using type = access::parser<address>;
@@ -142,6 +283,7 @@ struct parser_registry<address> {
 namespace parsers {
 
 static auto const addr = make_parser<vast::address>();
+static auto const fast_addr = fast_address_parser{};
 
 } // namespace parsers
 
@@ -1,11 +1,15 @@
 #ifndef VAST_CONCEPT_PARSEABLE_VAST_SUBNET_HPP
 #define VAST_CONCEPT_PARSEABLE_VAST_SUBNET_HPP
 
+#include <algorithm>
+#include <cstdint>
+
 #include "vast/subnet.hpp"
 
 #include "vast/concept/parseable/core/parser.hpp"
 #include "vast/concept/parseable/numeric/integral.hpp"
 #include "vast/concept/parseable/vast/address.hpp"
+#include "vast/detail/swar.hpp"
 
 namespace vast {
 
@@ -16,7 +20,8 @@ struct access::parser<subnet> : vast::parser<access::parser<subnet>> {
   static auto make() {
     using namespace parsers;
     auto addr = make_parser<address>{};
-    auto prefix = u8.with([](auto x) { return x <= 128; });
+    auto prefix = integral_parser<uint16_t, 3, 1>{}
+      .with([](auto x) { return x <= 128; });
     return addr >> '/' >> prefix;
   }
 
@@ -29,9 +34,45 @@ struct access::parser<subnet> : vast::parser<access::parser<subnet>> {
   template <typename Iterator>
   bool parse(Iterator& f, Iterator const& l, subnet& a) const {
     static auto p = make();
-    if (!p(f, l, a.network_, a.length_))
+    auto save = f;
+    if (p(f, l, a.network_, a.length_) && a.initialize())
+      return true;
+    f = save;
+    return false;
+  }
+};
+
+/// A subnet parser that produces the same results as parsers::net, but
+/// builds on the faster parsers::fast_addr.
+struct fast_subnet_parser : vast::parser<fast_subnet_parser> {
+  using attribute = subnet;
+
+  template <typename Iterator>
+  bool parse(Iterator& f, Iterator const& l, unused_type) const {
+    subnet a;
+    return parse(f, l, a);
+  }
+
+  template <typename Iterator>
+  bool parse(Iterator& f, Iterator const& l, subnet& a) const {
+    static auto const addr = fast_address_parser{};
+    auto save = f;
+    address network;
+    if (!addr(f, l, network) || f == l || *f++ != '/') {
+      f = save;
+      return false;
+    }
+    char buf[8] = {};
+    std::copy(f, f + (l - f < 4 ? l - f : 4), buf);
+    auto chars = detail::load_chars(buf);
+    auto n = detail::count_digits(chars);
+    auto length = n > 0 && n <= 3 ? detail::parse_digits(chars, n) : 129;
+    if (length > (network.is_v4() ? 32 : 128)) {
+      f = save;
       return false;
-    a.initialize();
+    }
+    a = {network, static_cast<uint8_t>(length)};
+    f += n;
     return true;
   }
 };
@@ -44,6 +85,7 @@ struct parser_registry<subnet> {
 namespace parsers {
 
 static auto const net = make_parser<vast::subnet>();
+static auto const fast_net = fast_subnet_parser{};
 
 } // namespace parsers
 
@@ -0,0 +1,65 @@
+#ifndef VAST_DETAIL_CHUNK_DESERIALIZER_HPP
+#define VAST_DETAIL_CHUNK_DESERIALIZER_HPP
+
+#include <ios>
+
+#include <caf/stream_deserializer.hpp>
+#include <caf/streambuf.hpp>
+
+#include "vast/chunk.hpp"
+
+namespace vast {
+namespace detail {
+
+// Holds the input of a chunk_deserializer, which must exist before the
+// deserializer base class.
+struct chunk_input {
+  explicit chunk_input(chunk_ptr chk)
+    : chunk_{std::move(chk)},
+      buf_{const_cast<char*>(chunk_->data()), chunk_->size()} {
+  }
+
+  chunk_ptr chunk_;
+  caf::arraybuf<char> buf_;
+};
+
+/// A deserializer that reads from a chunk. Types that support lazy
+/// deserialization can detect this deserializer, record the position of their
+/// parts in the chunk, and skip over them to materialize them later.
+class chunk_deserializer
+  : private chunk_input,
+    public caf::stream_deserializer<caf::arraybuf<char>&> {
+public:
+  /// Constructs a deserializer that reads from the beginning of a chunk.
+  /// @param chk The chunk to read from.
+  /// @pre `chk != nullptr`
+  explicit chunk_deserializer(chunk_ptr chk)
+    : chunk_input{std::move(chk)},
+      caf::stream_deserializer<caf::arraybuf<char>&>{buf_} {
+  }
+
+  /// @returns The chunk this deserializer reads from.
+  chunk_ptr const& input() const {
+    return chunk_;
+  }
+
+  /// @returns The current read position in the chunk.
+  size_t tell() {
+    return static_cast<size_t>(
+      buf_.pubseekoff(0, std::ios_base::cur, std::ios_base::in));
+  }
+
+  /// Moves the read position.
+  /// @param pos The absolute position to move to.
+  /// @returns `true` iff *pos* lies within the chunk.
+  bool seek(size_t pos) {
+    if (pos > chunk_->size())
+      return false;
+    return buf_.pubseekpos(pos, std::ios_base::in) != -1;
+  }
+};
+
+} // namespace detail
+} // namespace vast
+
+#endif
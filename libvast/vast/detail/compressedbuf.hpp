@@ -40,6 +40,14 @@ public:
                 compression method = compression::null,
                 size_t block_size = default_block_size);
 
+  /// Constructs an compressed streambuffer.
+  /// @param sb The underlying streambuffer to read from or write to.
+  /// @param c The codec to use for each block.
+  /// @param block_size The size of the internal buffer for uncompressed data.
+  /// @pre `block_size > 1`
+  compressedbuf(std::streambuf& sb, codec c,
+                size_t block_size = default_block_size);
+
 protected:
   // -- buffer management and positioning ------------------------------------
 
@@ -63,10 +71,10 @@ protected:
 
 private:
   void compress();
-  void uncompress();
+  bool uncompress();
 
   std::streambuf& streambuf_;
-  compression method_;
+  codec codec_;
   size_t block_size_;
   std::vector<char> compressed_;
   std::vector<char> uncompressed_;
@@ -0,0 +1,99 @@
+#ifndef VAST_DETAIL_COW_MAP_HPP
+#define VAST_DETAIL_COW_MAP_HPP
+
+#include <cstddef>
+#include <functional>
+#include <memory>
+#include <vector>
+
+#include "vast/detail/flat_hash_map.hpp"
+
+namespace vast {
+namespace detail {
+
+/// A hash map that hands out immutable views of its contents in constant
+/// time. The map spreads its entries over a fixed number of shards. A view
+/// shares all shards with the map, and the first modification of a shard
+/// after taking a view copies only that shard. Views remain valid and
+/// unchanged for as long as they exist, even when another thread reads them
+/// while the map changes.
+template <class Key, class T, size_t Shards = 64>
+class cow_map {
+  static_assert(Shards > 0, "need at least one shard");
+
+public:
+  using key_type = Key;
+  using mapped_type = T;
+  using map_type = flat_hash_map<Key, T>;
+  using size_type = typename map_type::size_type;
+
+  /// An immutable view of the map in the form of its shards.
+  using view_type = std::vector<std::shared_ptr<map_type const>>;
+
+  cow_map() : shards_(Shards) {
+    for (auto& shard : shards_)
+      shard = std::make_shared<map_type>();
+  }
+
+  /// Looks up a value.
+  /// @param key The key to look for.
+  /// @returns A pointer to the value of *key* or `nullptr` if *key* does not
+  ///          exist.
+  T const* find(Key const& key) const {
+    auto& shard = *shards_[index(key)];
+    auto i = shard.find(key);
+    return i == shard.end() ? nullptr : &i->second;
+  }
+
+  /// Accesses a value for modification, inserting it if it does not exist.
+  T& operator[](Key const& key) {
+    return mutable_shard(key)[key];
+  }
+
+  /// Removes a value.
+  /// @param key The key of the value to remove.
+  /// @returns The number of removed values.
+  size_type erase(Key const& key) {
+    if (shards_[index(key)]->count(key) == 0)
+      return 0;
+    return mutable_shard(key).erase(key);
+  }
+
+  /// Removes all values without touching existing views.
+  void clear() {
+    for (auto& shard : shards_)
+      shard = std::make_shared<map_type>();
+  }
+
+  /// Returns the number of values.
+  size_type size() const {
+    auto result = size_type{0};
+    for (auto& shard : shards_)
+      result += shard->size();
+    return result;
+  }
+
+  /// Takes an immutable view of the current contents.
+  view_type view() const {
+    return {shards_.begin(), shards_.end()};
+  }
+
+private:
+  static size_t index(Key const& key) {
+    return std::hash<Key>{}(key) % Shards;
+  }
+
+  map_type& mutable_shard(Key const& key) {
+    auto& shard = shards_[index(key)];
+    if (shard.use_count() > 1)
+      shard = std::make_shared<map_type>(*shard);
+    return *shard;
+  }
+
+  std::vector<std::shared_ptr<map_type>> shards_;
+};
+
+} // namespace detail
+} // namespace vast
+
+#endif
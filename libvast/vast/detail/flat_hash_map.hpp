@@ -0,0 +1,84 @@
+#ifndef VAST_DETAIL_FLAT_HASH_MAP_HPP
+#define VAST_DETAIL_FLAT_HASH_MAP_HPP
+
+#include <functional>
+#include <stdexcept>
+#include <tuple>
+#include <utility>
+
+#include "vast/detail/flat_hash_table.hpp"
+
+namespace vast {
+namespace detail {
+
+struct flat_hash_map_key {
+  template <class Pair>
+  auto& operator()(Pair const& x) const {
+    return x.first;
+  }
+};
+
+/// A hash map with open addressing. Drop-in replacement for
+/// `std::unordered_map`, except that inserting an element invalidates all
+/// iterators and references. See ::flat_hash_table for details.
+template <class Key, class T, class Hash = std::hash<Key>,
+          class Equal = std::equal_to<Key>>
+class flat_hash_map
+  : public flat_hash_table<std::pair<Key, T>, Key, flat_hash_map_key, Hash,
+                           Equal> {
+  using super = flat_hash_table<std::pair<Key, T>, Key, flat_hash_map_key,
+                                Hash, Equal>;
+
+public:
+  // -- types ----------------------------------------------------------------
+
+  using mapped_type = T;
+  using typename super::key_type;
+  using typename super::iterator;
+  using typename super::const_iterator;
+
+  // -- construction ---------------------------------------------------------
+
+  using super::super;
+
+  // -- modifiers ------------------------------------------------------------
+
+  /// Inserts a value constructed from *xs* unless *key* exists already.
+  template <class... Ts>
+  std::pair<iterator, bool> try_emplace(key_type const& key, Ts&&... xs) {
+    return this->emplace_unique(key, std::piecewise_construct,
+                                std::forward_as_tuple(key),
+                                std::forward_as_tuple(std::forward<Ts>(xs)...));
+  }
+
+  // -- lookup ---------------------------------------------------------------
+
+  mapped_type& at(key_type const& key) {
+    auto i = this->find(key);
+    if (i == this->end())
+      throw std::out_of_range{"vast::detail::flat_hash_map::at"};
+    return i->second;
+  }
+
+  mapped_type const& at(key_type const& key) const {
+    auto i = this->find(key);
+    if (i == this->end())
+      throw std::out_of_range{"vast::detail::flat_hash_map::at"};
+    return i->second;
+  }
+
+  mapped_type& operator[](key_type const& key) {
+    return try_emplace(key).first->second;
+  }
+};
+
+template <class Key, class T, class Hash, class Equal>
+void swap(flat_hash_map<Key, T, Hash, Equal>& x,
+          flat_hash_map<Key, T, Hash, Equal>& y) noexcept {
+  x.swap(y);
+}
+
+} // namespace detail
+} // namespace vast
+
+#endif
@@ -0,0 +1,27 @@
+#ifndef VAST_DETAIL_FLAT_HASH_SET_HPP
+#define VAST_DETAIL_FLAT_HASH_SET_HPP
+
+#include <functional>
+
+#include "vast/detail/flat_hash_table.hpp"
+
+namespace vast {
+namespace detail {
+
+struct flat_hash_set_key {
+  template <class T>
+  T const& operator()(T const& x) const {
+    return x;
+  }
+};
+
+/// A hash set with open addressing. Drop-in replacement for
+/// `std::unordered_set`, except that inserting an element invalidates all
+/// iterators and references. See ::flat_hash_table for details.
+template <class T, class Hash = std::hash<T>, class Equal = std::equal_to<T>>
+using flat_hash_set = flat_hash_table<T, T, flat_hash_set_key, Hash, Equal>;
+
+} // namespace detail
+} // namespace vast
+
+#endif
@@ -0,0 +1,546 @@
+#ifndef VAST_DETAIL_FLAT_HASH_TABLE_HPP
+#define VAST_DETAIL_FLAT_HASH_TABLE_HPP
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <initializer_list>
+#include <iterator>
+#include <memory>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+#include "vast/detail/swar.hpp"
+
+namespace vast {
+namespace detail {
+
+/// A group of 8 control bytes of a ::flat_hash_table, which the table probes
+/// in parallel. A control byte is either a special value or holds the 7 low
+/// bits of the hash value of the element in the corresponding slot.
+class flat_hash_group {
+public:
+  static constexpr size_t width = 8;
+
+  enum control : uint8_t {
+    empty = 0x80,
+    deleted = 0xFE,
+    sentinel = 0xFF,
+  };
+
+  static bool is_full(uint8_t ctrl) {
+    return ctrl < 0x80;
+  }
+
+  explicit flat_hash_group(uint8_t const* ctrl)
+    : ctrl_{load_chars(reinterpret_cast<char const*>(ctrl))} {
+  }
+
+  /// Returns a bit mask with the high bit set for each byte that may hold
+  /// *h2*. There may be false positives, but no false negatives.
+  uint64_t match(uint8_t h2) const {
+    auto x = ctrl_ ^ (lsbs * h2);
+    return (x - lsbs) & ~x & msbs;
+  }
+
+  /// Returns a bit mask with the high bit set for each empty byte.
+  uint64_t match_empty() const {
+    return ctrl_ & (~ctrl_ << 6) & msbs;
+  }
+
+  /// Returns a bit mask with the high bit set for each empty or deleted byte.
+  uint64_t match_empty_or_deleted() const {
+    return ctrl_ & (~ctrl_ << 7) & msbs;
+  }
+
+  /// Returns the index of the lowest byte with a bit set in *mask*.
+  /// @pre `mask != 0`
+  static size_t lowest(uint64_t mask) {
+    return static_cast<size_t>(__builtin_ctzll(mask)) / 8;
+  }
+
+private:
+  static constexpr uint64_t lsbs = 0x0101010101010101;
+  static constexpr uint64_t msbs = 0x8080808080808080;
+
+  uint64_t ctrl_;
+};
+
+/// A hash table with open addressing in the style of Google's SwissTable. It
+/// stores elements inline in a single array of slots and keeps one control
+/// byte per slot in a separate array. A lookup probes groups of 8 control
+/// bytes at once and compares only the keys whose 7-bit hash fragment
+/// matches. Unlike `std::unordered_map`, the table allocates no nodes, but
+/// inserting an element may move all other elements, which invalidates all
+/// iterators, pointers, and references. Erasing an element leaves all other
+/// elements in place.
+/// @tparam Value The element type.
+/// @tparam Key The key type.
+/// @tparam KeyOf A function object that extracts the key from an element.
+/// @tparam Hash A hash function for keys.
+/// @tparam Equal A function object that compares two keys for equality.
+template <class Value, class Key, class KeyOf, class Hash, class Equal>
+class flat_hash_table {
+  using group = flat_hash_group;
+
+public:
+  // -- types ----------------------------------------------------------------
+
+  using key_type = Key;
+  using value_type = Value;
+  using size_type = size_t;
+  using difference_type = ptrdiff_t;
+  using hasher = Hash;
+  using key_equal = Equal;
+  using reference = value_type&;
+  using const_reference = value_type const&;
+  using pointer = value_type*;
+  using const_pointer = value_type const*;
+
+  template <bool Const>
+  class iterator_base {
+    friend flat_hash_table;
+
+  public:
+    using iterator_category = std::forward_iterator_tag;
+    using value_type = typename flat_hash_table::value_type;
+    using difference_type = ptrdiff_t;
+    using pointer = std::conditional_t<Const, value_type const*, value_type*>;
+    using reference = std::conditional_t<Const, value_type const&,
+                                         value_type&>;
+
+    iterator_base() = default;
+
+    template <bool C = Const, class = std::enable_if_t<C>>
+    iterator_base(iterator_base<false> const& other)
+      : ctrl_{other.ctrl_},
+        slot_{other.slot_} {
+    }
+
+    reference operator*() const {
+      return *slot_;
+    }
+
+    pointer operator->() const {
+      return slot_;
+    }
+
+    iterator_base& operator++() {
+      ++ctrl_;
+      ++slot_;
+      skip_free();
+      return *this;
+    }
+
+    iterator_base operator++(int) {
+      auto result = *this;
+      ++*this;
+      return result;
+    }
+
+    friend bool operator==(iterator_base const& x, iterator_base const& y) {
+      return x.ctrl_ == y.ctrl_;
+    }
+
+    friend bool operator!=(iterator_base const& x, iterator_base const& y) {
+      return x.ctrl_ != y.ctrl_;
+    }
+
+  private:
+    iterator_base(uint8_t const* ctrl, pointer slot)
+      : ctrl_{ctrl},
+        slot_{slot} {
+    }
+
+    // Advances to the next occupied slot or the sentinel at the end.
+    void skip_free() {
+      while (!group::is_full(*ctrl_) && *ctrl_ != group::sentinel) {
+        ++ctrl_;
+        ++slot_;
+      }
+    }
+
+    uint8_t const* ctrl_ = nullptr;
+    pointer slot_ = nullptr;
+  };
+
+  using iterator = iterator_base<false>;
+  using const_iterator = iterator_base<true>;
+
+  // -- construction ---------------------------------------------------------
+
+  flat_hash_table() = default;
+
+  explicit flat_hash_table(size_type n, Hash const& hash = Hash{},
+                           Equal const& equal = Equal{})
+    : hash_{hash},
+      equal_{equal} {
+    reserve(n);
+  }
+
+  flat_hash_table(std::initializer_list<value_type> xs)
+    : flat_hash_table(xs.begin(), xs.end()) {
+  }
+
+  template <class InputIterator>
+  flat_hash_table(InputIterator first, InputIterator last) {
+    insert(first, last);
+  }
+
+  flat_hash_table(flat_hash_table const& other)
+    : hash_{other.hash_},
+      equal_{other.equal_} {
+    reserve(other.size());
+    for (auto& x : other)
+      emplace_new(x);
+  }
+
+  flat_hash_table(flat_hash_table&& other) noexcept
+    : hash_{std::move(other.hash_)},
+      equal_{std::move(other.equal_)} {
+    steal(other);
+  }
+
+  ~flat_hash_table() {
+    destroy();
+  }
+
+  flat_hash_table& operator=(flat_hash_table const& other) {
+    if (this != &other) {
+      auto copy = other;
+      swap(copy);
+    }
+    return *this;
+  }
+
+  flat_hash_table& operator=(flat_hash_table&& other) noexcept {
+    if (this != &other) {
+      destroy();
+      hash_ = std::move(other.hash_);
+      equal_ = std::move(other.equal_);
+      steal(other);
+    }
+    return *this;
+  }
+
+  // -- iterators ------------------------------------------------------------
+
+  iterator begin() {
+    auto result = iterator{ctrl_, slots_};
+    if (capacity_ > 0)
+      result.skip_free();
+    return result;
+  }
+
+  const_iterator begin() const {
+    return const_cast<flat_hash_table&>(*this).begin();
+  }
+
+  const_iterator cbegin() const {
+    return begin();
+  }
+
+  iterator end() {
+    return {ctrl_ + capacity_, slots_ + capacity_};
+  }
+
+  const_iterator end() const {
+    return const_cast<flat_hash_table&>(*this).end();
+  }
+
+  const_iterator cend() const {
+    return end();
+  }
+
+  // -- capacity -------------------------------------------------------------
+
+  bool empty() const {
+    return size_ == 0;
+  }
+
+  size_type size() const {
+    return size_;
+  }
+
+  /// Makes room for at least *n* elements without further rehashing.
+  void reserve(size_type n) {
+    if (n > size_ + growth_left_)
+      rehash(capacity_for(n));
+  }
+
+  // -- buckets --------------------------------------------------------------
+
+  // The bucket interface of `std::unordered_map`, where each slot forms a
+  // bucket that holds at most one element.
+
+  size_type bucket_count() const {
+    return capacity_;
+  }
+
+  size_type bucket_size(size_type n) const {
+    return group::is_full(ctrl_[n]) ? 1 : 0;
+  }
+
+  /// Returns an iterator to the element in slot *n*.
+  /// @pre `bucket_size(n) == 1`
+  iterator begin(size_type n) {
+    return {ctrl_ + n, slots_ + n};
+  }
+
+  const_iterator begin(size_type n) const {
+    return {ctrl_ + n, slots_ + n};
+  }
+
+  // -- modifiers ------------------------------------------------------------
+
+  void clear() {
+    if (capacity_ == 0)
+      return;
+    for (auto i = size_type{0}; i < capacity_; ++i)
+      if (group::is_full(ctrl_[i]))
+        slots_[i].~value_type();
+    reset_ctrl();
+    size_ = 0;
+    growth_left_ = growth(capacity_);
+  }
+
+  std::pair<iterator, bool> insert(value_type const& x) {
+    return emplace_unique(KeyOf{}(x), x);
+  }
+
+  std::pair<iterator, bool> insert(value_type&& x) {
+    return emplace_unique(KeyOf{}(x), std::move(x));
+  }
+
+  template <class InputIterator>
+  void insert(InputIterator first, InputIterator last) {
+    while (first != last)
+      insert(*first++);
+  }
+
+  template <class... Ts>
+  std::pair<iterator, bool> emplace(Ts&&... xs) {
+    return insert(value_type(std::forward<Ts>(xs)...));
+  }
+
+  iterator erase(const_iterator i) {
+    auto next = iterator{i.ctrl_, const_cast<pointer>(i.slot_)};
+    ++next;
+    erase_slot(static_cast<size_type>(i.ctrl_ - ctrl_));
+    return next;
+  }
+
+  iterator erase(iterator i) {
+    return erase(const_iterator{i});
+  }
+
+  size_type erase(key_type const& key) {
+    auto i = find(key);
+    if (i == end())
+      return 0;
+    erase_slot(static_cast<size_type>(i.ctrl_ - ctrl_));
+    return 1;
+  }
+
+  void swap(flat_hash_table& other) noexcept {
+    using std::swap;
+    swap(ctrl_, other.ctrl_);
+    swap(slots_, other.slots_);
+    swap(capacity_, other.capacity_);
+    swap(size_, other.size_);
+    swap(growth_left_, other.growth_left_);
+    swap(hash_, other.hash_);
+    swap(equal_, other.equal_);
+  }
+
+  // -- lookup ---------------------------------------------------------------
+
+  iterator find(key_type const& key) {
+    if (capacity_ == 0)
+      return end();
+    auto h = hash(key);
+    auto pos = h1(h) & capacity_;
+    for (auto step = group::width; ; step += group::width) {
+      group g{ctrl_ + pos};
+      for (auto m = g.match(h2(h)); m != 0; m &= m - 1) {
+        auto i = (pos + group::lowest(m)) & capacity_;
+        if (equal_(KeyOf{}(slots_[i]), key))
+          return {ctrl_ + i, slots_ + i};
+      }
+      if (g.match_empty() != 0)
+        return end();
+      pos = (pos + step) & capacity_;
+    }
+  }
+
+  const_iterator find(key_type const& key) const {
+    return const_cast<flat_hash_table&>(*this).find(key);
+  }
+
+  size_type count(key_type const& key) const {
+    return find(key) == end() ? 0 : 1;
+  }
+
+protected:
+  /// Inserts an element unless an element with key *key* exists already.
+  /// @param key The key of the element.
+  /// @param xs The arguments to construct the element from.
+  template <class... Ts>
+  std::pair<iterator, bool> emplace_unique(key_type const& key, Ts&&... xs) {
+    auto i = find(key);
+    if (i != end())
+      return {i, false};
+    return {emplace_new(std::forward<Ts>(xs)...), true};
+  }
+
+  /// Inserts an element whose key does not exist in the table.
+  template <class... Ts>
+  iterator emplace_new(Ts&&... xs) {
+    // Construct the element first, since its arguments may refer to an
+    // element that a rehash would move.
+    value_type x(std::forward<Ts>(xs)...);
+    if (growth_left_ == 0)
+      rehash(capacity_for(size_ + 1));
+    auto h = hash(KeyOf{}(x));
+    auto i = find_free(h);
+    new (slots_ + i) value_type(std::move(x));
+    if (ctrl_[i] == group::empty)
+      --growth_left_;
+    set_ctrl(i, h2(h));
+    ++size_;
+    return {ctrl_ + i, slots_ + i};
+  }
+
+private:
+  static size_t h1(size_t h) {
+    return h >> 7;
+  }
+
+  static uint8_t h2(size_t h) {
+    return static_cast<uint8_t>(h & 0x7F);
+  }
+
+  // Spreads the entropy of weak hash functions, e.g., identity hashes of
+  // integers, over all bits.
+  size_t hash(key_type const& key) const {
+    auto x = static_cast<uint64_t>(hash_(key)) * 0x9E3779B97F4A7C15;
+    return static_cast<size_t>(x ^ (x >> 32));
+  }
+
+  // The number of elements a table of a given capacity holds before it
+  // rehashes. We keep the load factor at most 7/8.
+  static size_type growth(size_type capacity) {
+    return capacity == group::width - 1 ? capacity - 1
+                                        : capacity - capacity / 8;
+  }
+
+  // The smallest valid capacity for *n* elements. Capacities have the form
+  // 2^k - 1, so that they double as mask for slot indices.
+  static size_type capacity_for(size_type n) {
+    auto result = group::width - 1;
+    while (growth(result) < n)
+      result = result * 2 + 1;
+    return result;
+  }
+
+  // Returns the first empty or deleted slot in the probe sequence of *h*.
+  size_type find_free(size_t h) const {
+    auto pos = h1(h) & capacity_;
+    for (auto step = group::width; ; step += group::width) {
+      auto m = group{ctrl_ + pos}.match_empty_or_deleted();
+      if (m != 0)
+        return (pos + group::lowest(m)) & capacity_;
+      pos = (pos + step) & capacity_;
+    }
+  }
+
+  // Sets a control byte and its clone after the sentinel, which allows for
+  // loading a group at any position without wrapping around.
+  void set_ctrl(size_type i, uint8_t x) {
+    ctrl_[i] = x;
+    if (i < group::width - 1)
+      ctrl_[capacity_ + 1 + i] = x;
+  }
+
+  void reset_ctrl() {
+    std::memset(ctrl_, group::empty, capacity_ + group::width);
+    ctrl_[capacity_] = group::sentinel;
+  }
+
+  void erase_slot(size_type i) {
+    slots_[i].~value_type();
+    set_ctrl(i, group::deleted);
+    --size_;
+  }
+
+  // Moves all elements into a table of the given capacity, which drops all
+  // deleted slots.
+  void rehash(size_type capacity) {
+    flat_hash_table tmp;
+    tmp.ctrl_ = new uint8_t[capacity + group::width];
+    tmp.slots_ = std::allocator<value_type>{}.allocate(capacity);
+    tmp.capacity_ = capacity;
+    tmp.reset_ctrl();
+    tmp.growth_left_ = growth(capacity);
+    for (auto i = size_type{0}; i < capacity_; ++i) {
+      if (!group::is_full(ctrl_[i]))
+        continue;
+      auto h = hash(KeyOf{}(slots_[i]));
+      auto j = tmp.find_free(h);
+      new (tmp.slots_ + j) value_type(std::move(slots_[i]));
+      tmp.set_ctrl(j, h2(h));
+      --tmp.growth_left_;
+      ++tmp.size_;
+    }
+    using std::swap;
+    swap(ctrl_, tmp.ctrl_);
+    swap(slots_, tmp.slots_);
+    swap(capacity_, tmp.capacity_);
+    swap(size_, tmp.size_);
+    swap(growth_left_, tmp.growth_left_);
+  }
+
+  void destroy() {
+    if (capacity_ == 0)
+      return;
+    for (auto i = size_type{0}; i < capacity_; ++i)
+      if (group::is_full(ctrl_[i]))
+        slots_[i].~value_type();
+    std::allocator<value_type>{}.deallocate(slots_, capacity_);
+    delete[] ctrl_;
+    ctrl_ = nullptr;
+    slots_ = nullptr;
+    capacity_ = 0;
+    size_ = 0;
+    growth_left_ = 0;
+  }
+
+  void steal(flat_hash_table& other) {
+    ctrl_ = other.ctrl_;
+    slots_ = other.slots_;
+    capacity_ = other.capacity_;
+    size_ = other.size_;
+    growth_left_ = other.growth_left_;
+    other.ctrl_ = nullptr;
+    other.slots_ = nullptr;
+    other.capacity_ = 0;
+    other.size_ = 0;
+    other.growth_left_ = 0;
+  }
+
+  uint8_t* ctrl_ = nullptr;
+  value_type* slots_ = nullptr;
+  size_type capacity_ = 0;
+  size_type size_ = 0;
+  size_type growth_left_ = 0;
+  Hash hash_;
+  Equal equal_;
+};
+
+} // namespace detail
+} // namespace vast
+
+#endif
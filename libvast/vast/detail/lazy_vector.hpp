@@ -0,0 +1,187 @@
+#ifndef VAST_DETAIL_LAZY_VECTOR_HPP
+#define VAST_DETAIL_LAZY_VECTOR_HPP
+
+#include <algorithm>
+#include <cstdint>
+#include <stdexcept>
+#include <vector>
+
+#include <caf/deserializer.hpp>
+#include <caf/serializer.hpp>
+#include <caf/stream_deserializer.hpp>
+#include <caf/stream_serializer.hpp>
+#include <caf/streambuf.hpp>
+
+#include "vast/chunk.hpp"
+#include "vast/detail/chunk_deserializer.hpp"
+
+namespace vast {
+namespace detail {
+
+/// A vector whose elements deserialize on demand. The serialized form begins
+/// with a directory of element sizes, followed by the elements themselves.
+/// When reading from a ::chunk_deserializer, a lazy vector only consumes the
+/// directory and keeps a reference to the chunk. It then deserializes each
+/// element individually when accessing it for the first time. Other
+/// deserializers materialize all elements upfront.
+/// @warning Accessing an element may throw if its serialized form turns out
+///          to be corrupt.
+template <class T>
+class lazy_vector {
+public:
+  using value_type = T;
+  using size_type = size_t;
+  using const_iterator = typename std::vector<T>::const_iterator;
+
+  lazy_vector() = default;
+
+  explicit lazy_vector(size_type n) : xs_(n) {
+  }
+
+  size_type size() const {
+    return xs_.size();
+  }
+
+  bool empty() const {
+    return xs_.empty();
+  }
+
+  /// @returns The number of elements that still await deserialization.
+  size_type frozen() const {
+    return frozen_;
+  }
+
+  T const& operator[](size_type i) const {
+    materialize(i);
+    return xs_[i];
+  }
+
+  T& operator[](size_type i) {
+    materialize(i);
+    return xs_[i];
+  }
+
+  const_iterator begin() const {
+    materialize();
+    return xs_.begin();
+  }
+
+  const_iterator end() const {
+    materialize();
+    return xs_.end();
+  }
+
+  friend bool operator==(lazy_vector const& x, lazy_vector const& y) {
+    return x.size() == y.size() && std::equal(x.begin(), x.end(), y.begin());
+  }
+
+  friend bool operator!=(lazy_vector const& x, lazy_vector const& y) {
+    return !(x == y);
+  }
+
+  friend void serialize(caf::serializer& sink, lazy_vector const& xs) {
+    // Frozen elements go to the sink verbatim, without a round-trip through
+    // their deserialized form.
+    std::vector<std::vector<char>> blobs(xs.size());
+    for (auto i = 0u; i < xs.size(); ++i) {
+      auto& blob = blobs[i];
+      if (xs.frozen_ > 0 && xs.slices_[i].frozen) {
+        auto first = xs.chunk_->data() + xs.slices_[i].offset;
+        blob.assign(first, first + xs.slices_[i].size);
+      } else {
+        caf::containerbuf<std::vector<char>> buf{blob};
+        caf::stream_serializer<caf::containerbuf<std::vector<char>>&> s{buf};
+        s << xs.xs_[i];
+      }
+    }
+    auto n = blobs.size();
+    raise(sink.begin_sequence(n));
+    for (auto& blob : blobs) {
+      auto size = uint64_t{blob.size()};
+      sink & size;
+    }
+    for (auto& blob : blobs)
+      raise(sink.apply_raw(blob.size(), blob.data()));
+    raise(sink.end_sequence());
+  }
+
+  friend void serialize(caf::deserializer& source, lazy_vector& xs) {
+    size_t n;
+    raise(source.begin_sequence(n));
+    std::vector<uint64_t> sizes(n);
+    for (auto& size : sizes)
+      source & size;
+    xs.xs_.clear();
+    xs.xs_.resize(n);
+    xs.slices_.clear();
+    xs.chunk_ = nullptr;
+    xs.frozen_ = 0;
+    if (auto cd = dynamic_cast<chunk_deserializer*>(&source)) {
+      // Remember where each element resides and skip over all of them.
+      auto offset = cd->tell();
+      xs.slices_.resize(n);
+      for (auto i = 0u; i < n; ++i) {
+        xs.slices_[i] = {offset, sizes[i], true};
+        offset += sizes[i];
+      }
+      if (!cd->seek(offset))
+        throw std::runtime_error{"lazy vector exceeds chunk boundary"};
+      xs.chunk_ = cd->input();
+      xs.frozen_ = n;
+    } else {
+      std::vector<char> blob;
+      for (auto i = 0u; i < n; ++i) {
+        blob.resize(sizes[i]);
+        raise(source.apply_raw(blob.size(), blob.data()));
+        thaw(blob.data(), blob.size(), xs.xs_[i]);
+      }
+    }
+    raise(source.end_sequence());
+  }
+
+private:
+  // The location of a serialized element in the chunk.
+  struct slice {
+    size_t offset;
+    size_t size;
+    bool frozen;
+  };
+
+  static void raise(caf::error const& e) {
+    if (e)
+      throw std::runtime_error{to_string(e)};
+  }
+
+  static void thaw(char const* data, size_t size, T& x) {
+    caf::arraybuf<char> buf{const_cast<char*>(data), size};
+    caf::stream_deserializer<caf::arraybuf<char>&> s{buf};
+    s >> x;
+  }
+
+  void materialize(size_type i) const {
+    if (frozen_ == 0 || !slices_[i].frozen)
+      return;
+    thaw(chunk_->data() + slices_[i].offset, slices_[i].size, xs_[i]);
+    slices_[i].frozen = false;
+    // Release the chunk as soon as we no longer need it.
+    if (--frozen_ == 0) {
+      slices_.clear();
+      chunk_ = nullptr;
+    }
+  }
+
+  void materialize() const {
+    for (auto i = 0u; frozen_ > 0 && i < xs_.size(); ++i)
+      materialize(i);
+  }
+
+  mutable std::vector<T> xs_;
+  mutable std::vector<slice> slices_;
+  mutable chunk_ptr chunk_;
+  mutable size_type frozen_ = 0;
+};
+
+} // namespace detail
+} // namespace vast
+
+#endif
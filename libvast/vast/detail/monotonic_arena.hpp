@@ -0,0 +1,81 @@
+#ifndef VAST_DETAIL_MONOTONIC_ARENA_HPP
+#define VAST_DETAIL_MONOTONIC_ARENA_HPP
+
+#include <cstddef>
+#include <memory>
+#include <new>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace vast {
+namespace detail {
+
+/// A bump allocator that hands out memory from a list of chunks. Individual
+/// allocations cannot be freed; instead, resetting the arena releases all of
+/// them at once and recycles the chunks for subsequent allocations. Objects
+/// with non-trivial destructors constructed through ::make get destroyed on
+/// reset.
+class monotonic_arena {
+public:
+  /// Constructs an arena.
+  /// @param chunk_size The size of a chunk in bytes. Allocations larger than
+  ///                   a chunk receive a chunk of their own.
+  explicit monotonic_arena(size_t chunk_size = 64 << 10);
+
+  ~monotonic_arena();
+
+  monotonic_arena(monotonic_arena const&) = delete;
+  monotonic_arena& operator=(monotonic_arena const&) = delete;
+
+  /// Allocates uninitialized memory.
+  /// @param n The number of bytes to allocate.
+  /// @param alignment The alignment of the allocation, a power of 2 no larger
+  ///                  than `alignof(std::max_align_t)`.
+  /// @returns A pointer to *n* bytes of memory, valid until the next reset.
+  void* allocate(size_t n, size_t alignment = alignof(std::max_align_t));
+
+  /// Constructs an object in the arena.
+  /// @param xs The arguments to construct the object from.
+  /// @returns A pointer to the object, valid until the next reset.
+  template <class T, class... Ts>
+  T* make(Ts&&... xs) {
+    auto ptr = new (allocate(sizeof(T), alignof(T)))
+      T(std::forward<Ts>(xs)...);
+    if (!std::is_trivially_destructible<T>::value)
+      finalizers_.push_back({ptr, [](void* x) { static_cast<T*>(x)->~T(); }});
+    return ptr;
+  }
+
+  /// Destroys all objects and makes all memory available again.
+  void reset();
+
+  /// @returns The number of bytes allocated since the last reset.
+  size_t bytes() const;
+
+  /// @returns The number of bytes the arena holds in its chunks.
+  size_t capacity() const;
+
+private:
+  struct chunk {
+    std::unique_ptr<char[]> data;
+    size_t size;
+  };
+
+  struct finalizer {
+    void* ptr;
+    void (*destroy)(void*);
+  };
+
+  size_t chunk_size_;
+  std::vector<chunk> chunks_;
+  size_t current_ = 0;
+  size_t position_ = 0;
+  size_t bytes_ = 0;
+  std::vector<finalizer> finalizers_;
+};
+
+} // namespace detail
+} // namespace vast
+
+#endif
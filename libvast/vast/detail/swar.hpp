@@ -0,0 +1,86 @@
+#ifndef VAST_DETAIL_SWAR_HPP
+#define VAST_DETAIL_SWAR_HPP
+
+#include <cstdint>
+#include <cstring>
+
+#include "vast/detail/assert.hpp"
+#include "vast/detail/byte_swap.hpp"
+
+// Helpers to process 8 characters at once in a 64-bit integer (SIMD within a
+// register). All functions operate on characters loaded with load_chars, such
+// that the first character occupies the least significant byte.
+
+namespace vast {
+namespace detail {
+
+/// Loads 8 characters into an integer.
+/// @param p A pointer to at least 8 readable characters.
+/// @returns The characters with the first one in the least significant byte.
+inline uint64_t load_chars(char const* p) {
+  uint64_t x;
+  std::memcpy(&x, p, sizeof(x));
+#ifdef VAST_BIG_ENDIAN
+  x = byte_swap(x);
+#endif
+  return x;
+}
+
+/// Counts the leading decimal digits among 8 loaded characters.
+/// @param chars The result of ::load_chars.
+/// @returns The number of leading digits in *[0, 8]*.
+inline int count_digits(uint64_t chars) {
+  // A character is a digit iff its high nibble is 3 and remains 3 after adding
+  // 6. A carry out of a byte only affects bytes after a non-digit.
+  auto nibbles = uint64_t{0xF0F0F0F0F0F0F0F0};
+  auto threes = uint64_t{0x3030303030303030};
+  auto mask = ((chars & nibbles) ^ threes)
+            | (((chars + 0x0606060606060606) & nibbles) ^ threes);
+  return mask == 0 ? 8 : __builtin_ctzll(mask) / 8;
+}
+
+/// Computes the value of the leading decimal digits of 8 loaded characters.
+/// @param chars The result of ::load_chars.
+/// @param n The number of leading digits to use.
+/// @returns The value of the first *n* digits.
+/// @pre `0 < n && n <= count_digits(chars)`
+inline uint32_t parse_digits(uint64_t chars, int n) {
+  VAST_ASSERT(0 < n && n <= 8);
+  // Shift the digits into the most significant bytes, which pads them with
+  // leading zeros, and then combine pairs of digits, pairs of pairs, and so on.
+  chars <<= 8 * (8 - n);
+  chars = ((chars & 0x0F0F0F0F0F0F0F0F) * 2561) >> 8;
+  chars = ((chars & 0x00FF00FF00FF00FF) * 6553601) >> 16;
+  return static_cast<uint32_t>(
+    ((chars & 0x0000FFFF0000FFFF) * 42949672960001) >> 32);
+}
+
+/// Counts up to 16 leading decimal digits.
+/// @param p A pointer to at least 16 readable characters.
+/// @returns The number of leading digits in *[0, 16]*.
+inline int count_digits(char const* p) {
+  auto n = count_digits(load_chars(p));
+  return n < 8 ? n : 8 + count_digits(load_chars(p + 8));
+}
+
+/// Computes the value of up to 16 leading decimal digits.
+/// @param p A pointer to at least 16 readable characters.
+/// @param n The number of leading digits to use.
+/// @returns The value of the first *n* digits.
+/// @pre `0 < n && n <= count_digits(p)`
+inline uint64_t parse_digits(char const* p, int n) {
+  VAST_ASSERT(0 < n && n <= 16);
+  if (n <= 8)
+    return parse_digits(load_chars(p), n);
+  auto hi = uint64_t{parse_digits(load_chars(p), 8)};
+  auto lo = parse_digits(load_chars(p + 8), n - 8);
+  auto scale = uint64_t{1};
+  for (auto i = 8; i < n; ++i)
+    scale *= 10;
+  return hi * scale + lo;
+}
+
+} // namespace detail
+} // namespace vast
+
+#endif
@@ -301,6 +301,25 @@ void create_symlink(path const& target, path const& link);
 /// @returns `true` if *p* has been successfully deleted.
 bool rm(path const& p);
 
+/// Moves a file, atomically replacing the destination if it exists.
+/// @param from The path of the file to move.
+/// @param to The new path of the file.
+/// @returns Nothing on success or an error upon failure.
+expected<void> rename(path const& from, path const& to);
+
+/// Copies a file or a directory recursively. Unlike ::rename, copying works
+/// across file systems.
+/// @param from The path of the file or directory to copy.
+/// @param to The path of the copy, which must not exist.
+/// @returns Nothing on success or an error upon failure.
+expected<void> copy(path const& from, path const& to);
+
+/// Computes the number of bytes a path occupies on the filesystem. For a
+/// directory, the result is the sum over all contained files.
+/// @param p The path to a file or directory.
+/// @returns The size of *p* in bytes.
+expected<size_t> file_size(path const& p);
+
 /// If the path does not exist, create it as directory.
 /// @param p The path to a directory to create.
 /// @returns `true` on success or if *p* exists already.
@@ -21,9 +21,9 @@ struct bgpdump_parser : parser<bgpdump_parser> {
 
   template <class Iterator>
   bool parse(Iterator& f, Iterator& l, event& e) const {
-    using parsers::addr;
+    auto const& addr = parsers::fast_addr;
     using parsers::any;
-    using parsers::net;
+    auto const& net = parsers::fast_net;
     using parsers::u64;
     using namespace std::chrono;
     static auto str = +(any - '|');
@@ -3,6 +3,8 @@
 
 #include <chrono>
 #include <iostream>
+#include <iterator>
+#include <memory>
 #include <string>
 #include <unordered_map>
 #include <vector>
@@ -15,9 +17,11 @@
 #include "vast/data.hpp"
 #include "vast/expected.hpp"
 #include "vast/filesystem.hpp"
+#include "vast/packed_record.hpp"
 #include "vast/schema.hpp"
 
 #include "vast/detail/line_range.hpp"
+#include "vast/detail/string.hpp"
 
 namespace vast {
 
@@ -26,6 +30,47 @@ class event;
 namespace format {
 namespace bro {
 
+/// Parses an escaped Bro string and unescapes it directly into the string of
+/// the attribute. Together with ::in_place, parsing a field into the same
+/// ::data repeatedly reuses the memory of its string.
+template <class Parser>
+class bro_string_parser : public parser<bro_string_parser<Parser>> {
+public:
+  using attribute = std::string;
+
+  explicit bro_string_parser(Parser p) : parser_{std::move(p)} {
+  }
+
+  template <class Iterator>
+  bool parse(Iterator& f, Iterator const& l, unused_type) const {
+    return parser_(f, l, unused);
+  }
+
+  template <class Iterator>
+  bool parse(Iterator& f, Iterator const& l, std::string& a) const {
+    string_view escaped;
+    if (!parser_(f, l, escaped))
+      return false;
+    a.clear();
+    auto i = escaped.begin();
+    auto out = std::back_inserter(a);
+    while (i != escaped.end())
+      if (!detail::byte_unescaper(i, escaped.end(), out)) {
+        a.clear();
+        break;
+      }
+    return true;
+  }
+
+private:
+  raw_parser<Parser> parser_;
+};
+
+template <class Parser>
+auto make_bro_string_parser(Parser p) {
+  return in_place<std::string>(bro_string_parser<Parser>{std::move(p)});
+}
+
 /// Parses non-container types.
 template <class Iterator, class Attribute>
 struct bro_parser {
@@ -60,7 +105,7 @@ struct bro_parser {
   }
 
   bool operator()(timestamp_type const&) const {
-    static auto p = parsers::real ->* [](real x) {
+    static auto p = parsers::fast_real ->* [](real x) {
       auto i = std::chrono::duration_cast<timespan>(double_seconds(x));
       return timestamp{i};
     };
@@ -68,31 +113,29 @@ struct bro_parser {
   }
 
   bool operator()(timespan_type const&) const {
-    static auto p = parsers::real ->* [](real x) {
+    static auto p = parsers::fast_real ->* [](real x) {
       return std::chrono::duration_cast<timespan>(double_seconds(x));
     };
     return parse(p);
   }
 
   bool operator()(string_type const&) const {
-    static auto p = +parsers::any
-      ->* [](std::string x) { return detail::byte_unescape(x); };
+    static auto p = make_bro_string_parser(+parsers::any);
     return parse(p);
   }
 
   bool operator()(pattern_type const&) const {
-    static auto p = +parsers::any
-      ->* [](std::string x) { return detail::byte_unescape(x); };
+    static auto p = make_bro_string_parser(+parsers::any);
     return parse(p);
   }
 
   bool operator()(address_type const&) const {
-    static auto p = parsers::addr ->* [](address x) { return x; };
+    static auto p = parsers::fast_addr ->* [](address x) { return x; };
     return parse(p);
   }
 
   bool operator()(subnet_type const&) const {
-    static auto p = parsers::net ->* [](subnet x) { return x; };
+    static auto p = parsers::fast_net ->* [](subnet x) { return x; };
     return parse(p);
   }
 
@@ -134,42 +177,38 @@ struct bro_parser_factory {
   }
 
   result_type operator()(timestamp_type const&) const {
-    return parsers::real ->* [](real x) {
+    return parsers::fast_real ->* [](real x) {
       auto i = std::chrono::duration_cast<timespan>(double_seconds(x));
       return timestamp{i};
     };
   }
 
   result_type operator()(timespan_type const&) const {
-    return parsers::real ->* [](real x) {
+    return parsers::fast_real ->* [](real x) {
       return std::chrono::duration_cast<timespan>(double_seconds(x));
     };
   }
 
   result_type operator()(string_type const&) const {
     if (set_separator_.empty())
-      return +parsers::any
-        ->* [](std::string x) { return detail::byte_unescape(x); };
+      return make_bro_string_parser(+parsers::any);
     else
-      return +(parsers::any - set_separator_)
-               ->*[](std::string x) { return detail::byte_unescape(x); };
+      return make_bro_string_parser(+(parsers::any - set_separator_));
   }
 
   result_type operator()(pattern_type const&) const {
     if (set_separator_.empty())
-      return +parsers::any
-        ->* [](std::string x) { return detail::byte_unescape(x); };
+      return make_bro_string_parser(+parsers::any);
     else
-      return +(parsers::any - set_separator_)
-        ->* [](std::string x) { return detail::byte_unescape(x); };
+      return make_bro_string_parser(+(parsers::any - set_separator_));
   }
 
   result_type operator()(address_type const&) const {
-    return parsers::addr ->* [](address x) { return x; };
+    return parsers::fast_addr ->* [](address x) { return x; };
   }
 
   result_type operator()(subnet_type const&) const {
-    return parsers::net ->* [](subnet x) { return x; };
+    return parsers::fast_net ->* [](subnet x) { return x; };
   }
 
   result_type operator()(port_type const&) const {
@@ -221,6 +260,13 @@ public:
 
   expected<event> read();
 
+  /// Reads the next event as packed record, which avoids constructing a tree
+  /// of ::data per event.
+  /// @param a The arena to allocate the record from.
+  /// @param ts Receives the timestamp of the event.
+  /// @returns The record of the event.
+  expected<packed_record> read(detail::monotonic_arena& a, timestamp& ts);
+
   expected<void> schema(vast::schema const& sch);
 
   expected<vast::schema> schema() const;
@@ -228,6 +274,12 @@ public:
   const char* name() const;
 
 private:
+  using field_list =
+    std::vector<std::pair<std::string::const_iterator,
+                          std::string::const_iterator>>;
+
+  expected<field_list> next_line();
+
   expected<void> parse_header();
 
   std::unique_ptr<std::istream> input_;
@@ -240,6 +292,8 @@ private:
   vast::schema schema_;
   type type_;
   std::vector<rule<std::string::const_iterator, data>> parsers_;
+  std::unordered_map<type, record_layout> layouts_;
+  std::unique_ptr<packed_record::builder> builder_;
 };
 
 /// A Bro writer.
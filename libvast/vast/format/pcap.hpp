@@ -4,12 +4,13 @@
 #include <pcap.h>
 
 #include <chrono>
-#include <unordered_map>
 #include <random>
 
 #include "vast/address.hpp"
 #include "vast/concept/hashable/hash_append.hpp"
-#include "vast/concept/hashable/xxhash.hpp"
+#include "vast/concept/hashable/uhash.hpp"
+#include "vast/concept/hashable/xxh3.hpp"
+#include "vast/detail/flat_hash_map.hpp"
 #include "vast/detail/operators.hpp"
 #include "vast/expected.hpp"
 #include "vast/port.hpp"
@@ -51,7 +52,7 @@ namespace std {
 template <>
 struct hash<vast::format::pcap::connection> {
   size_t operator()(vast::format::pcap::connection const& c) const {
-    return vast::uhash<vast::xxhash>{}(c);
+    return vast::uhash<vast::xxh3_64>{}(c);
   }
 };
 
@@ -100,7 +101,7 @@ private:
 
   pcap_t* pcap_ = nullptr;
   type packet_type_;
-  std::unordered_map<connection, connection_state> flows_;
+  detail::flat_hash_map<connection, connection_state> flows_;
   uint64_t cutoff_;
   size_t max_flows_;
   std::mt19937 generator_;
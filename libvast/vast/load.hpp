@@ -9,7 +9,9 @@
 #include <caf/stream_deserializer.hpp>
 #include <caf/streambuf.hpp>
 
+#include "vast/chunk.hpp"
 #include "vast/compression.hpp"
+#include "vast/detail/chunk_deserializer.hpp"
 #include "vast/detail/compressedbuf.hpp"
 #include "vast/detail/type_traits.hpp"
 #include "vast/detail/variadic_serialization.hpp"
@@ -72,6 +74,24 @@ auto load(Container const& container, T&& x, Ts&&... xs)
   return load<Method>(sink, std::forward<T>(x), std::forward<Ts>(xs)...);
 }
 
+/// Deserializes a sequence of objects from a chunk. Unlike the other
+/// overloads, this one allows types to defer deserializing parts of their
+/// state (see detail::lazy_vector), in which case they keep a reference to
+/// the chunk.
+/// @see save
+template <class T, class... Ts>
+expected<void> load(chunk_ptr const& chk, T&& x, Ts&&... xs) {
+  if (!chk)
+    return make_error(ec::unspecified, "cannot load from invalid chunk");
+  try {
+    detail::chunk_deserializer s{chk};
+    detail::read(s, std::forward<T>(x), std::forward<Ts>(xs)...);
+  } catch (std::exception const& e) {
+    return make_error(ec::unspecified, e.what());
+  }
+  return {};
+}
+
 /// Deserializes a sequence of objects from a file.
 /// @see save
 template <
@@ -0,0 +1,219 @@
+#ifndef VAST_PACKED_RECORD_HPP
+#define VAST_PACKED_RECORD_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "vast/aliases.hpp"
+#include "vast/data.hpp"
+#include "vast/expected.hpp"
+#include "vast/type.hpp"
+
+#include "vast/detail/monotonic_arena.hpp"
+
+namespace vast {
+
+/// The flat memory layout of a record type. The layout enumerates the leaves
+/// of the record in depth-first order, i.e., it flattens nested records, and
+/// assigns each leaf a fixed-size slot. A packed record consists of a bitmap
+/// of nil leaves, followed by the slots, followed by a region with the bytes
+/// of all strings and patterns. Containers don't have a flat representation;
+/// their slots point to ::data in the same arena as the record.
+class record_layout {
+public:
+  /// The representation of a leaf.
+  enum class kind : uint8_t {
+    none,
+    boolean,
+    integer,
+    count,
+    real,
+    timespan,
+    timestamp,
+    string,
+    pattern,
+    address,
+    subnet,
+    port,
+    enumeration,
+    container
+  };
+
+  /// A leaf of the record.
+  struct field {
+    vast::type type;
+    record_layout::kind kind;
+    uint32_t offset;
+  };
+
+  /// Constructs the layout of a record type.
+  /// @param t The record type.
+  /// @pre `is<record_type>(t)`
+  explicit record_layout(vast::type t);
+
+  /// @returns The record type of the layout.
+  vast::type const& type() const;
+
+  /// @returns The number of leaves.
+  size_t size() const;
+
+  /// Retrieves a leaf.
+  /// @param i The index of the leaf.
+  /// @returns The *i*-th leaf.
+  field const& operator[](size_t i) const;
+
+  /// @returns The number of bytes of the nil bitmap plus all slots.
+  uint32_t fixed_size() const;
+
+private:
+  void add(record_type const& r);
+
+  vast::type type_;
+  std::vector<field> fields_;
+  uint32_t fixed_size_ = 0;
+};
+
+/// A record in the flat representation of a ::record_layout. A packed record
+/// is a view: it neither owns its memory nor its layout, both of which must
+/// outlive it. Scalars live in host byte order, see ::to_little_endian for a
+/// portable representation.
+class packed_record {
+public:
+  /// Packs one record after another into an arena.
+  class builder;
+
+  /// Constructs an invalid record.
+  packed_record() = default;
+
+  /// Constructs a record from memory.
+  /// @param layout The layout of the record.
+  /// @param block The memory of the record.
+  /// @param size The number of bytes of *block*.
+  packed_record(record_layout const& layout, char const* block, size_t size);
+
+  /// @returns The layout of the record.
+  record_layout const& layout() const;
+
+  /// @returns The number of leaves.
+  size_t size() const;
+
+  /// Checks whether a leaf is nil.
+  /// @param i The index of the leaf.
+  bool nil(size_t i) const;
+
+  /// Retrieves a leaf.
+  /// @param i The index of the leaf.
+  /// @returns The *i*-th leaf as ::data.
+  data get(size_t i) const;
+
+  /// Retrieves the bytes of a string or pattern leaf without a copy.
+  /// @param i The index of the leaf.
+  /// @returns A pointer to the bytes and their number.
+  /// @pre `!nil(i)` and the leaf is a string or pattern.
+  std::pair<char const*, size_t> string(size_t i) const;
+
+  /// Converts the record to its ::data representation, with nested records
+  /// as nested vectors.
+  vector to_data() const;
+
+  /// @returns The memory of the record.
+  char const* block() const;
+
+  /// @returns The number of bytes of the record.
+  size_t block_size() const;
+
+private:
+  template <class T>
+  T load(size_t i) const;
+
+  record_layout const* layout_ = nullptr;
+  char const* block_ = nullptr;
+  uint32_t size_ = 0;
+};
+
+class packed_record::builder {
+public:
+  /// Constructs a builder.
+  /// @param layout The layout of the records to build.
+  explicit builder(record_layout const& layout);
+
+  /// @returns The layout of the records to build.
+  record_layout const& layout() const;
+
+  /// Appends the next leaf.
+  /// @param x The value of the leaf.
+  /// @returns An error if *x* doesn't match the type of the leaf.
+  expected<void> add(data const& x);
+
+  /// Appends a string or pattern leaf without constructing ::data.
+  /// @param str The bytes of the leaf.
+  /// @param size The number of bytes.
+  /// @returns An error if the leaf is neither a string nor a pattern.
+  expected<void> add(char const* str, size_t size);
+
+  /// Appends a nil leaf.
+  /// @returns An error if the record has no more leaves.
+  expected<void> add_nil();
+
+  /// Copies the record into an arena and prepares the builder for the next
+  /// record.
+  /// @param a The arena to allocate the record and its containers from.
+  /// @returns The packed record or an error if leaves are missing.
+  expected<packed_record> finish(detail::monotonic_arena& a);
+
+  /// Discards a partially built record.
+  void reset();
+
+private:
+  expected<record_layout::field const*> next();
+
+  template <class T>
+  void store(uint32_t offset, T x);
+
+  void store_string(uint32_t offset, char const* str, size_t size);
+
+  record_layout const& layout_;
+  size_t field_ = 0;
+  std::vector<char> block_;
+  std::vector<char> strings_;
+  std::vector<std::pair<uint32_t, data>> containers_;
+};
+
+/// Packs a record.
+/// @param layout The layout of the record.
+/// @param xs The record, with nested records as nested vectors.
+/// @param a The arena to allocate the record from.
+/// @returns The packed record or an error if *xs* doesn't match *layout*.
+expected<packed_record> pack(record_layout const& layout, vector const& xs,
+                             detail::monotonic_arena& a);
+
+/// Packs a record with an existing builder, which saves the allocations of a
+/// new builder per record.
+/// @param b The builder for the layout of the record.
+/// @param xs The record, with nested records as nested vectors.
+/// @param a The arena to allocate the record from.
+/// @returns The packed record or an error if *xs* doesn't match the layout
+///          of *b*, in which case *b* is ready for the next record.
+expected<packed_record> pack(packed_record::builder& b, vector const& xs,
+                             detail::monotonic_arena& a);
+
+/// Converts the scalars of a packed record from host byte order to little
+/// endian, which makes the record portable across machines. The conversion is
+/// a no-op on little-endian hosts.
+/// @param layout The layout of the record.
+/// @param block The memory of the record.
+void to_little_endian(record_layout const& layout, char* block);
+
+/// Converts the scalars of a packed record from little endian to host byte
+/// order.
+/// @param layout The layout of the record.
+/// @param block The memory of the record.
+/// @see to_little_endian
+void from_little_endian(record_layout const& layout, char* block);
+
+} // namespace vast
+
+#endif
@@ -43,6 +43,9 @@ public:
   /// @returns `true` if the pattern matches inside *str*.
   bool search(std::string const& str) const;
 
+  /// @returns The regular expression of the pattern.
+  std::string const& string() const;
+
   friend bool operator==(pattern const& lhs, pattern const& rhs);
   friend bool operator<(pattern const& lhs, pattern const& rhs);
 
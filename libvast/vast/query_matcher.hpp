@@ -0,0 +1,115 @@
+#ifndef VAST_QUERY_MATCHER_HPP
+#define VAST_QUERY_MATCHER_HPP
+
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <unordered_map>
+#include <vector>
+
+#include "vast/address.hpp"
+#include "vast/data.hpp"
+#include "vast/expression.hpp"
+#include "vast/offset.hpp"
+#include "vast/type.hpp"
+
+#include "vast/concept/hashable/uhash.hpp"
+#include "vast/concept/hashable/xxhash.hpp"
+
+namespace vast {
+
+class event;
+
+/// Evaluates events against a set of standing queries. The matcher compiles
+/// all queries into one plan per event type, which evaluates every distinct
+/// predicate at most once per event. Equality predicates on addresses,
+/// subnets, and strings as well as subnet membership predicates share a
+/// single hash table lookup per field, so that the cost of matching an event
+/// remains nearly independent of the number of such predicates. Compound
+/// queries only run when one of their predicates holds, unless they can hold
+/// without any, e.g., due to a negation.
+class query_matcher {
+public:
+  using query_id = uint64_t;
+
+  /// Registers a standing query.
+  /// @param expr The normalized query expression.
+  /// @returns The ID of the query.
+  query_id add(expression expr);
+
+  /// Unregisters a standing query.
+  /// @param id The ID of the query to remove.
+  /// @returns `true` if *id* referred to a registered query.
+  bool erase(query_id id);
+
+  /// @returns The number of registered queries.
+  size_t size() const;
+
+  /// @returns `true` if no queries are registered.
+  bool empty() const;
+
+  /// Evaluates an event against all registered queries.
+  /// @param e The event to evaluate.
+  /// @param result The vector to append the IDs of all matching queries to.
+  void match(event const& e, std::vector<query_id>& result);
+
+private:
+  struct data_hasher {
+    template <class T>
+    size_t operator()(T const& x) const {
+      return uhash<xxhash>{}(x);
+    }
+  };
+
+  // A query expression in prefix notation over the predicates of a plan.
+  struct program {
+    enum opcode : uint8_t { op_and, op_or, op_not, op_pred };
+
+    struct instruction {
+      opcode op;
+      uint32_t arg;  // predicate index or number of operands
+      uint32_t size; // number of instructions of the subtree
+    };
+
+    query_id id;
+    std::vector<instruction> code;
+  };
+
+  // Predicates on a single field that we evaluate via hash table lookups.
+  struct field_matcher {
+    offset off;
+    std::unordered_map<data, std::vector<size_t>, data_hasher> equal;
+    std::map<unsigned, std::unordered_map<address, std::vector<size_t>,
+                                          data_hasher>> subnets;
+  };
+
+  // The compiled form of all queries for a single event type.
+  struct plan {
+    std::vector<predicate> predicates;
+    std::vector<field_matcher> fields;
+    std::vector<size_t> generic;
+    std::vector<std::vector<query_id>> direct;
+    std::vector<program> programs;
+    std::vector<std::vector<size_t>> triggers; // predicate -> programs
+    std::vector<size_t> unconditional; // programs that hold without hits
+    std::vector<uint64_t> stamps;
+    std::vector<uint64_t> runs; // the last epoch in which a program ran
+    uint64_t epoch = 0;
+  };
+
+  plan& compile(type const& t);
+
+  // Drops the plans of all event types to which a query applies.
+  void invalidate(expression const& expr);
+
+  static bool run(plan const& p, program::instruction const* code);
+
+  std::unordered_map<query_id, expression> queries_;
+  std::unordered_map<type, std::unique_ptr<plan>> plans_;
+  std::vector<size_t> hits_;
+  query_id next_ = 0;
+};
+
+} // namespace vast
+
+#endif
@@ -0,0 +1,96 @@
+#ifndef VAST_STRING_VIEW_HPP
+#define VAST_STRING_VIEW_HPP
+
+#include <algorithm>
+#include <cstddef>
+#include <cstring>
+#include <ostream>
+#include <string>
+
+#include "vast/detail/assert.hpp"
+#include "vast/detail/operators.hpp"
+
+namespace vast {
+
+/// A non-owning reference to a contiguous sequence of characters, modeled
+/// after C++17's `std::string_view`. The referenced characters must outlive
+/// the view.
+class string_view : detail::totally_ordered<string_view> {
+public:
+  using value_type = char;
+  using size_type = size_t;
+  using const_iterator = char const*;
+  using iterator = const_iterator;
+
+  constexpr string_view() = default;
+
+  constexpr string_view(char const* data, size_type size)
+    : data_{data},
+      size_{size} {
+  }
+
+  string_view(char const* str) : string_view{str, std::strlen(str)} {
+  }
+
+  string_view(std::string const& str) : string_view{str.data(), str.size()} {
+  }
+
+  constexpr const_iterator begin() const {
+    return data_;
+  }
+
+  constexpr const_iterator end() const {
+    return data_ + size_;
+  }
+
+  constexpr char const* data() const {
+    return data_;
+  }
+
+  constexpr size_type size() const {
+    return size_;
+  }
+
+  constexpr bool empty() const {
+    return size_ == 0;
+  }
+
+  char operator[](size_type i) const {
+    VAST_ASSERT(i < size_);
+    return data_[i];
+  }
+
+  /// Returns a view of the characters in *[pos, pos + n)*, truncated to the
+  /// end of this view.
+  /// @pre `pos <= size()`
+  string_view substr(size_type pos, size_type n = -1) const {
+    VAST_ASSERT(pos <= size_);
+    return {data_ + pos, std::min(n, size_ - pos)};
+  }
+
+  /// Copies the referenced characters into a string.
+  std::string str() const {
+    return {data_, size_};
+  }
+
+  friend bool operator==(string_view x, string_view y) {
+    return x.size_ == y.size_ && std::equal(x.begin(), x.end(), y.begin());
+  }
+
+  friend bool operator<(string_view x, string_view y) {
+    return std::lexicographical_compare(x.begin(), x.end(),
+                                        y.begin(), y.end());
+  }
+
+  friend std::ostream& operator<<(std::ostream& os, string_view x) {
+    return os.write(x.data_, x.size_);
+  }
+
+private:
+  char const* data_ = nullptr;
+  size_type size_ = 0;
+};
+
+} // namespace vast
+
+#endif
@@ -1,7 +1,11 @@
 #ifndef VAST_SYSTEM_ARCHIVE_HPP
 #define VAST_SYSTEM_ARCHIVE_HPP
 
+#include <deque>
+#include <functional>
 #include <map>
+#include <set>
+#include <unordered_map>
 #include <vector>
 
 #include <caf/all.hpp>
@@ -18,6 +22,8 @@
 
 #include "vast/system/atoms.hpp"
 #include "vast/system/accountant.hpp"
+#include "vast/system/filesystem.hpp"
+#include "vast/system/tiering.hpp"
 
 namespace vast {
 namespace system {
@@ -35,6 +41,18 @@ public:
 
   expected<std::vector<event>> extract(bitmap const& bm) const;
 
+  /// Extracts events in chunks of bounded size.
+  /// @param bm The IDs of the events to extract.
+  /// @param chunk_size The maximum number of events per chunk.
+  /// @param f The function to invoke with each chunk.
+  /// @pre `chunk_size > 0`
+  expected<void> extract(bitmap const& bm, size_t chunk_size,
+                         std::function<void(std::vector<event>)> f) const;
+
+  /// Re-encodes all batches with a different codec.
+  /// @param c The codec to compress the batches with.
+  expected<void> recompress(codec c);
+
   uuid const& id() const;
 
   template <class Inspector>
@@ -51,33 +69,78 @@ private:
   uuid id_ = uuid::random();
 };
 
+/// The maximum number of events per result chunk of a lookup.
+constexpr size_t archive_chunk_size = 1024;
+
+/// An ongoing lookup at the archive.
+struct archive_lookup {
+  bitmap ids;
+  caf::actor sink;
+  // The candidate segments per shard, in reverse order of processing.
+  std::vector<std::vector<uuid>> candidates;
+  std::vector<bool> busy; // whether a shard processes a candidate
+  size_t inflight = 0;
+  caf::typed_response_promise<done_atom> promise;
+};
+
 struct archive_state {
   path dir;
-  uint64_t max_segment_size;
-  compression method;
-  detail::range_map<event_id, uuid> segments;
-  detail::cache<uuid, segment> cache;
-  segment active;
-  accountant_type accountant;
+  detail::range_map<event_id, uuid> segments; // merged over all shards
+  std::unordered_map<uuid, size_t> owners; // segment -> shard
+  std::vector<caf::actor> shards;
+  size_t next_shard = 0;
+  uint64_t next_batch = 0;
+  std::set<uint64_t> ingesting; // batches in flight to the shards
+  std::deque<std::pair<uint64_t, uuid>> deferred; // lookups awaiting batches
+  std::unordered_map<uuid, archive_lookup> lookups;
+  std::unordered_map<caf::actor_addr, size_t> sinks; // sink -> #lookups
+  tiering_policy policy;
+  bool terminating = false;
+  caf::error exit_reason;
   char const* name = "archive";
 };
 
 using archive_type = caf::typed_actor<
   caf::reacts_to<std::vector<event>>,
   caf::replies_to<flush_atom>::with<ok_atom>,
-  caf::replies_to<bitmap>::with<std::vector<event>>
+  caf::replies_to<bitmap>::with<done_atom>,
+  caf::replies_to<tier_atom>::with<size_t>
 >;
 
 /// The *ARCHIVE* stores raw events in the form of compressed batches and
-/// answers queries for specific bitmaps.
+/// answers queries for specific bitmaps. Each batch records its compression
+/// method, so that changing the codec keeps previously archived data
+/// readable. The archive distributes incoming
+/// batches round-robin over a number of shards, each of which compresses,
+/// flushes, and caches its own disjoint set of segments. A lookup involves
+/// only the shards owning segments that intersect the query bitmap and
+/// streams the resulting events to the requester in chunks of at most
+/// ::archive_chunk_size events. After the last chunk, the archive replies with
+/// `done_atom`. When the requester terminates, the archive cancels its pending
+/// lookups.
+///
+/// With a tiering policy, the archive periodically moves segments whose most
+/// recent event exceeds a certain age to a cold directory, optionally
+/// re-encoding them with a stronger codec, and deletes the oldest segments
+/// beyond the retention limits. A `tier_atom` triggers this immediately and
+/// yields the number of moved or deleted segments.
 /// @param self The actor handle.
 /// @param dir The root directory of the archive.
-/// @param capacity The number of segments to cache in memory.
+/// @param capacity The number of segments to cache in memory, split evenly
+///                 over the shards.
 /// @param max_segment_size The maximum segment size in bytes.
-/// @pre `max_segment_size > 0`
+/// @param shards The number of shards.
+/// @param method The codec to compress batches with.
+/// @param dictionaries Whether to train a dictionary per event type, which
+///                     requires `method` to be Zstandard. Batches then use
+///                     the dictionary for the type of their first event.
+/// @param policy The policy for moving and deleting aging segments. The size
+///               limit applies to each shard in equal parts.
+/// @pre `max_segment_size > 0 && shards > 0`
 archive_type::behavior_type
 archive(archive_type::stateful_pointer<archive_state> self, path dir,
-        size_t capacity, size_t max_segment_size);
+        size_t capacity, size_t max_segment_size, size_t shards,
+        codec method, bool dictionaries, tiering_policy policy);
 
 } // namespace system
 } // namespace vast
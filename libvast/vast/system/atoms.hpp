@@ -22,7 +22,9 @@ using caf::subscribe_atom;
 // Generic
 using accept_atom = caf::atom_constant<caf::atom("accept")>;
 using announce_atom = caf::atom_constant<caf::atom("announce")>;
+using append_atom = caf::atom_constant<caf::atom("append")>;
 using batch_atom = caf::atom_constant<caf::atom("batch")>;
+using compact_atom = caf::atom_constant<caf::atom("compact")>;
 using continuous_atom = caf::atom_constant<caf::atom("continuous")>;
 using cpu_atom = caf::atom_constant<caf::atom("cpu")>;
 using data_atom = caf::atom_constant<caf::atom("data")>;
@@ -32,6 +34,7 @@ using done_atom = caf::atom_constant<caf::atom("done")>;
 using election_atom = caf::atom_constant<caf::atom("election")>;
 using empty_atom = caf::atom_constant<caf::atom("empty")>;
 using enable_atom = caf::atom_constant<caf::atom("enable")>;
+using estimate_atom = caf::atom_constant<caf::atom("estimate")>;
 using exists_atom = caf::atom_constant<caf::atom("exists")>;
 using extract_atom = caf::atom_constant<caf::atom("extract")>;
 using heartbeat_atom = caf::atom_constant<caf::atom("heartbeat")>;
@@ -68,6 +71,7 @@ using statistics_atom = caf::atom_constant<caf::atom("statistics")>;
 using stop_atom = caf::atom_constant<caf::atom("stop")>;
 using store_atom = caf::atom_constant<caf::atom("store")>;
 using submit_atom = caf::atom_constant<caf::atom("submit")>;
+using tier_atom = caf::atom_constant<caf::atom("tier")>;
 using unload_atom = caf::atom_constant<caf::atom("unload")>;
 using value_atom = caf::atom_constant<caf::atom("value")>;
 using write_atom = caf::atom_constant<caf::atom("write")>;
@@ -76,7 +80,9 @@ using write_atom = caf::atom_constant<caf::atom("write")>;
 using accountant_atom = caf::atom_constant<caf::atom("accountant")>;
 using candidate_atom = caf::atom_constant<caf::atom("candidate")>;
 using consensus_atom = caf::atom_constant<caf::atom("consensus")>;
+using filesystem_atom = caf::atom_constant<caf::atom("filesystem")>;
 using identifier_atom = caf::atom_constant<caf::atom("identifier")>;
+using importer_atom = caf::atom_constant<caf::atom("importer")>;
 using index_atom = caf::atom_constant<caf::atom("index")>;
 using follower_atom = caf::atom_constant<caf::atom("follower")>;
 using leader_atom = caf::atom_constant<caf::atom("leader")>;
@@ -11,6 +11,7 @@
 
 #include <caf/stateful_actor.hpp>
 
+#include "vast/chunk.hpp"
 #include "vast/expected.hpp"
 #include "vast/filesystem.hpp"
 #include "vast/optional.hpp"
@@ -40,6 +41,23 @@ constexpr auto request_timeout = election_timeout * 4;
 /// The heartbeat period.
 constexpr auto heartbeat_period = election_timeout / 2;
 
+/// The duration for which the acknowledgement of a heartbeat by a majority
+/// keeps the leadership of a server valid. Followers neither vote nor start
+/// an election within the election timeout after hearing from the leader, so
+/// no other leader can arise before this lease expires.
+constexpr auto lease_timeout = election_timeout / 2;
+
+/// The maximum number of entries in a single AppendEntries request.
+constexpr size_t max_entries_per_request = 1024;
+
+/// The maximum number of snapshot bytes in a single InstallSnapshot request.
+constexpr size_t snapshot_chunk_size = 1 << 20;
+
+/// The maximum number of AppendEntries requests in flight per peer. The
+/// leader sends further entries to a peer without waiting for the responses
+/// to prior requests until it hits this limit.
+constexpr size_t max_inflight_requests = 4;
+
 /// A type to uniquely represent a server in the system. An ID of 0 is invalid.
 using server_id = uint64_t;
 
@@ -66,24 +84,30 @@ auto inspect(Inspector& f, log_entry& e) {
 /// A sequence of log entries accessed through monotonically increasing
 /// indexes. The first entry has index 1. Index 0 is invalid. Mutable
 /// operations do not return before they have been made persistent.
+///
+/// The log stores its entries in a sequence of append-only segment files,
+/// each of which begins with the entry whose index the filename carries. An
+/// in-memory index maps each entry to its segment and offset, whereas the
+/// entry data remains on disk and gets mapped into memory on demand.
+/// Truncating the log therefore never rewrites entries: dropping a prefix
+/// deletes the segments that precede the new first index, and dropping a
+/// suffix deletes the segments that follow the last index and trims the
+/// segment that contains it.
 class log {
 public:
+  /// The default number of bytes after which the log starts a new segment.
+  static constexpr uint64_t default_segment_size = 8 << 20;
+
   /// Constructs a log and attempts to read persistent state from the
   /// filesystem.
   /// @param dir The directory where the log stores persistent state.
-  log(path dir);
-
-  /// Retrieves the first log entry.
-  /// @pre `!empty()`
-  log_entry& first();
+  /// @param segment_size The number of bytes after which the log starts a
+  ///                     new segment.
+  log(path dir, uint64_t segment_size = default_segment_size);
 
   /// Retrieves the first index in the log.
   index_type first_index() const;
 
-  /// Retrieves the last log entry.
-  /// @pre `!empty()`
-  log_entry& last();
-
   /// Retrieves the last index in the log.
   index_type last_index() const;
 
@@ -93,34 +117,67 @@ public:
   /// Truncates all entries *after* a given index.
   index_type truncate_after(index_type index);
 
-  /// Accesses a log entry at a given index.
-  log_entry& at(index_type i);
+  /// Retrieves the term of the entry at a given index without touching the
+  /// entry data.
+  /// @pre `i >= first_index() && i <= last_index()`
+  term_type term(index_type i) const;
+
+  /// Reads the log entry at a given index from its segment.
+  /// @pre `i >= first_index() && i <= last_index()`
+  log_entry at(index_type i);
 
-  /// Appends entries to the log.
+  /// Appends entries to the log. All entries become persistent with a single
+  /// flush, which makes appending many entries at once much cheaper than
+  /// appending them one by one.
   expected<void> append(std::vector<log_entry> xs);
 
   /// Checks whether the log is empty.
   bool empty() const;
 
-  /// Returns the number of bytes the serialized entries in the log occupy.
+  /// Returns the number of bytes the segments of the log occupy.
   friend uint64_t bytes(log& l);
 
 private:
-  expected<void> persist_meta_data();
+  // Locates an entry within its segment.
+  struct entry_meta {
+    term_type term;
+    uint64_t offset;
+    uint64_t size;
+  };
+
+  // A segment file holding consecutive entries, starting at *first*.
+  struct segment {
+    index_type first;
+    std::vector<entry_meta> entries;
+    uint64_t bytes = 0;
+    chunk_ptr chunk;
+  };
+
+  segment& locate(index_type i);
+
+  segment const& locate(index_type i) const;
+
+  path segment_filename(index_type first) const;
+
+  expected<void> load_segment(path const& filename, index_type first);
 
-  expected<void> persist_entries();
+  expected<void> migrate(path const& filename);
 
-  std::deque<log_entry> entries_;
+  expected<void> persist_meta_data();
+
+  std::deque<segment> segments_;
   index_type start_ = 1;
-  std::ofstream meta_file_;
-  std::ofstream entries_file_;
+  uint64_t segment_size_;
+  std::ofstream active_;
   path dir_;
 };
 
 /// A snapshot covering log entries indices in *[1, L]* where *L* is the last
-/// included index.
+/// included index. In the snapshot file, the header precedes the parts of the
+/// state machine state, each of which is a serialized `std::vector<char>`.
+/// Version 1 snapshots consist of a single part.
 struct snapshot_header {
-  uint32_t version = 1;
+  uint32_t version = 2;
   index_type last_included_index;
   term_type last_included_term;
 };
@@ -242,6 +299,13 @@ struct peer_state {
   /// Indicates whether we have a vote from this peer.
   bool have_vote = false;
 
+  /// The number of requests awaiting a response from this peer.
+  size_t inflight = 0;
+
+  /// The point in time when the leader sent the latest AppendEntries request
+  /// the peer acknowledged in the current term.
+  clock::time_point last_ack;
+
   /// The index of the last log entry in the last snapshot.
   index_type last_snapshot_index = 0;
 
@@ -282,6 +346,24 @@ struct server_state {
   /// The snapshot file when writing the snapshot to disk.
   std::ofstream snapshot;
 
+  /// The file for a snapshot that the state machine hands over in parts.
+  std::ofstream local_snapshot;
+
+  /// The index of the snapshot in *local_snapshot*.
+  index_type local_snapshot_index = 0;
+
+  /// The number of parts written to *local_snapshot*.
+  uint64_t local_snapshot_parts = 0;
+
+  /// The snapshot file when delivering a snapshot to the state machine.
+  std::ifstream delivered_snapshot;
+
+  /// Identifies the delivery from *delivered_snapshot* in progress.
+  uint64_t delivery = 0;
+
+  /// The last committed index to deliver after the snapshot in delivery.
+  index_type deferred_index = 0;
+
   // -- volatile implementation details ---------------------------------------
 
   // The different states of a server.
@@ -302,6 +384,31 @@ struct server_state {
   // Flag that indicates whether we've kicked of the heartbeat loop.
   bool heartbeat_inflight = false;
 
+  // Client commands that the leader has yet to append to its log. The leader
+  // appends all commands that arrive while a flush is pending in one go, so
+  // that they share a single write to disk.
+  std::vector<log_entry> pending_entries;
+  std::vector<caf::response_promise> pending_promises;
+
+  // Flag that indicates whether we've scheduled a flush of pending commands.
+  bool flush_inflight = false;
+
+  // The index of the first entry in the current term of the leader. The
+  // leader serves reads only after having committed this entry.
+  index_type term_start_index = 0;
+
+  // Linearizable reads awaiting confirmation of leadership, in the order of
+  // their arrival.
+  std::vector<std::pair<clock::time_point, caf::response_promise>>
+    pending_reads;
+
+  // The point in time when the leader started the pending confirmation of
+  // its leadership, if any.
+  optional<clock::time_point> read_round;
+
+  // The point in time when a follower last heard from the leader.
+  clock::time_point last_heard;
+
   // The point in time when a follower should hold an election.
   clock::time_point election_time = clock::time_point::max();
 
@@ -315,7 +422,26 @@ struct server_state {
   const char* name = "raft";
 };
 
-/// Spawns a consensus module.
+/// Spawns a consensus module. The leader coalesces concurrent client commands
+/// into a single append to its log (group commit) and replicates entries
+/// without waiting for peers to acknowledge prior AppendEntries requests
+/// (pipelining).
+///
+/// A state machine hands over a snapshot as a single byte sequence or in
+/// parts, one `(snapshot_atom, index, part, bytes, done)` request per part,
+/// which keeps the writes of the consensus module short. The consensus module
+/// sends each part as a separate request `(index, (snapshot_atom, index,
+/// part, bytes, last))` back when the state machine needs to restore a
+/// snapshot. It reads the next part only after the state machine has answered
+/// the previous request, and delivers subsequent entries only after the last
+/// part. Lagging peers receive snapshots in pipelined chunks of at most
+/// ::snapshot_chunk_size bytes.
+///
+/// A `read_atom` request returns an index up to which a state machine must
+/// have applied the log to answer a read linearizably. The leader returns its
+/// commit index once it has confirmed that it is still the leader, either
+/// through its lease or with one round of heartbeats. Reads go through
+/// neither the log nor the disk. Followers forward reads to the leader.
 /// @param self The actor handle.
 /// @param dir The directory where to store persistent state.
 caf::behavior consensus(caf::stateful_actor<server_state>* self, path dir);
@@ -1,10 +1,10 @@
 #ifndef VAST_SYSTEM_DATA_STORE_HPP
 #define VAST_SYSTEM_DATA_STORE_HPP
 
-#include <unordered_map>
-
 #include "vast/data.hpp"
 
+#include "vast/detail/flat_hash_map.hpp"
+
 #include "vast/system/key_value_store.hpp"
 
 namespace vast {
@@ -12,11 +12,11 @@ namespace system {
 
 template <class Key, class Value>
 struct data_store_state {
-  std::unordered_map<Key, Value> store;
+  detail::flat_hash_map<Key, Value> store;
   const char* name = "data-store";
 };
 
-/// A key-value store that stores its data in a `std::unordered_map`.
+/// A key-value store that stores its data in a hash table with open addressing.
 /// @param self The actor handle.
 template <class Key, class Value>
 typename key_value_store_type<Key, Value>::behavior_type
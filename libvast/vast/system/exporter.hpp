@@ -4,14 +4,16 @@
 #include <chrono>
 #include <deque>
 #include <memory>
-#include <unordered_map>
 
 #include "vast/aliases.hpp"
 #include "vast/bitmap.hpp"
+#include "vast/candidate_checker.hpp"
 #include "vast/expression.hpp"
 #include "vast/query_options.hpp"
 #include "vast/uuid.hpp"
 
+#include "vast/detail/flat_hash_map.hpp"
+
 #include "vast/system/accountant.hpp"
 #include "vast/system/archive.hpp"
 #include "vast/system/query_statistics.hpp"
@@ -25,19 +27,32 @@ struct exporter_state {
   caf::actor sink;
   accountant_type accountant;
   bitmap hits;
-  bitmap unprocessed;
-  std::unordered_map<type, expression> checkers;
+  bitmap deferred; // hits held back until the sink needs more events
+  bitmap unprocessed; // hits requested from the archive
+  bool limited = false; // whether the sink requested a fixed number
+  bitmap continuous_hits;
+  detail::flat_hash_map<type, candidate_checker> checkers;
   std::deque<event> candidates;
   std::vector<event> results;
   std::chrono::steady_clock::time_point start;
   query_statistics stats;
   uuid id;
+  query_options options;
   char const* name = "exporter";
 };
 
 /// The EXPORTER receives index hits, looks up the corresponding events in the
 /// archive, and performs a candidate check to select the resulting stream of
-/// matching events.
+/// matching events. For continuous queries, the EXPORTER registers its
+/// expression at all IMPORTERs, which relay matching events as they arrive.
+/// A unified query combines both result streams without duplicates.
+///
+/// The EXPORTER requests no more events from the ARCHIVE, and no more
+/// partitions from the INDEX, than the sink still needs. Once the sink got
+/// the number of events it asked for, a historical query terminates early.
+/// The INDEX delivers hits for the oldest partitions first. With the
+/// `ordered` option, the EXPORTER instead evaluates all hits and ships the
+/// results in timestamp order, keeping only as many as the sink requested.
 /// @param self The actor handle.
 /// @param ast The AST of query.
 /// @param qos The query options.
@@ -0,0 +1,105 @@
+#ifndef VAST_SYSTEM_FILESYSTEM_HPP
+#define VAST_SYSTEM_FILESYSTEM_HPP
+
+#include <cstddef>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include <caf/typed_actor.hpp>
+
+#include "vast/expected.hpp"
+#include "vast/filesystem.hpp"
+
+#include "vast/system/accountant.hpp"
+#include "vast/system/atoms.hpp"
+
+namespace vast {
+namespace system {
+
+/// Replaces the contents of a file atomically by writing to a temporary file
+/// first and renaming it afterwards. Creates the parent directory if needed.
+/// @param filename The file to write.
+/// @param bytes The new contents of *filename*.
+expected<void> replace_file(path const& filename,
+                            std::vector<char> const& bytes);
+
+/// Appends bytes to a file. Creates the file and its parent directory if
+/// needed.
+/// @param filename The file to append to.
+/// @param bytes The bytes to append.
+expected<void> append_file(path const& filename,
+                           std::vector<char> const& bytes);
+
+/// Reads the contents of a file.
+/// @param filename The file to read.
+/// @returns The contents of *filename*.
+expected<std::vector<char>> read_file(path const& filename);
+
+struct filesystem_state {
+  std::vector<caf::actor> workers;
+  uint64_t pending = 0;
+  accountant_type accountant;
+  char const* name = "filesystem";
+};
+
+using filesystem_type = caf::typed_actor<
+  caf::replies_to<write_atom, path, std::vector<char>>::with<ok_atom>,
+  caf::replies_to<append_atom, path, std::vector<char>>::with<ok_atom>,
+  caf::replies_to<read_atom, path>::with<std::vector<char>>
+>;
+
+/// The *FILESYSTEM* performs blocking file I/O on behalf of other components,
+/// so that slow disks don't stall the threads of the actor scheduler. A pool
+/// of detached workers executes the requests. All requests for files in the
+/// same directory go to the same worker and complete in the order of
+/// submission. A write replaces a file atomically (see ::replace_file) and an
+/// append extends it (see ::append_file).
+/// @param self The actor handle.
+/// @param workers The number of I/O threads.
+/// @pre `workers > 0`
+filesystem_type::behavior_type
+filesystem(filesystem_type::stateful_pointer<filesystem_state> self,
+           size_t workers);
+
+/// Retrieves the FILESYSTEM of an actor system, if available.
+/// @param sys The actor system to look into.
+/// @returns A handle to the FILESYSTEM or an invalid handle.
+filesystem_type get_filesystem(caf::actor_system& sys);
+
+/// Submits a write or an append to a FILESYSTEM. Without a FILESYSTEM, the
+/// calling actor performs the I/O itself.
+/// @param self The calling actor.
+/// @param fs The FILESYSTEM, which may be invalid.
+/// @param op Either `write_atom` or `append_atom`.
+/// @param filename The file to write.
+/// @param bytes The contents to write.
+/// @param f The function to invoke with the outcome of the operation.
+template <class Actor, class Operation, class F>
+void submit(Actor* self, filesystem_type const& fs, Operation op,
+            path filename, std::vector<char> bytes, F f) {
+  static_assert(std::is_same<Operation, write_atom>::value
+                || std::is_same<Operation, append_atom>::value,
+                "operation must be a write or an append");
+  if (!fs) {
+    if (std::is_same<Operation, write_atom>::value)
+      f(replace_file(filename, bytes));
+    else
+      f(append_file(filename, bytes));
+    return;
+  }
+  self->request(fs, caf::infinite, op, std::move(filename),
+                std::move(bytes)).then(
+    [=](ok_atom) mutable {
+      f(expected<void>{});
+    },
+    [=](caf::error& e) mutable {
+      f(expected<void>{std::move(e)});
+    }
+  );
+}
+
+} // namespace system
+} // namespace vast
+
+#endif
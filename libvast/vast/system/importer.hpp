@@ -2,6 +2,7 @@
 #define VAST_SYSTEM_IMPORTER_HPP
 
 #include <chrono>
+#include <unordered_map>
 #include <vector>
 
 #include <caf/stateful_actor.hpp>
@@ -10,6 +11,7 @@
 #include "vast/data.hpp"
 #include "vast/event.hpp"
 #include "vast/filesystem.hpp"
+#include "vast/query_matcher.hpp"
 
 #include "vast/system/archive.hpp"
 #include "vast/system/meta_store.hpp"
@@ -18,7 +20,9 @@ namespace vast {
 namespace system {
 
 /// Receives chunks from SOURCEs, imbues them with an ID, and relays them to
-/// ARCHIVE and INDEX.
+/// ARCHIVE and INDEX. Before shipping, the IMPORTER evaluates the events
+/// against all continuous queries and relays the matches to their
+/// subscribers.
 struct importer_state {
   meta_store_type meta_store;
   caf::actor archive;
@@ -28,6 +32,8 @@ struct importer_state {
   size_t batch_size;
   std::chrono::steady_clock::time_point last_replenish;
   std::vector<event> remainder;
+  query_matcher matcher;
+  std::unordered_map<query_matcher::query_id, caf::actor> subscribers;
   path dir;
   const char* name = "importer";
 };
@@ -2,6 +2,7 @@
 #define VAST_INDEX_HPP
 
 #include <unordered_map>
+#include <unordered_set>
 
 #include <caf/stateful_actor.hpp>
 
@@ -11,8 +12,12 @@
 #include "vast/uuid.hpp"
 #include "vast/time.hpp"
 
+#include "vast/detail/flat_hash_map.hpp"
 #include "vast/detail/flat_set.hpp"
 
+#include "vast/system/filesystem.hpp"
+#include "vast/system/tiering.hpp"
+
 namespace vast {
 
 class event;
@@ -31,14 +36,33 @@ public:
   /// Per-partition summary statistics.
   struct partition_synopsis {
     interval range;
+    size_t events = 0;
+    bool cold = false; ///< Whether the partition lives in the cold tier.
   };
 
   /// Adds a set of events to the index for a given partition.
   void add(const std::vector<event> xs, const uuid& partition);
 
+  /// Replaces a set of partitions with a single one that holds their events.
+  /// @param xs The partitions to replace.
+  /// @param y The partition that replaces *xs*.
+  void merge(const std::vector<uuid>& xs, const uuid& y);
+
+  /// Records that a partition has moved to the cold storage tier.
+  /// @param x The partition in the cold tier.
+  void freeze(const uuid& x);
+
+  /// Removes a partition from the index.
+  /// @param x The partition to remove.
+  void erase(const uuid& x);
+
   /// Retrieves the list of partition IDs for a given expression.
+  /// @returns The qualifying partitions in chronological order.
   std::vector<uuid> lookup(const expression& expr) const;
 
+  /// Retrieves the summary statistics of all partitions.
+  const std::unordered_map<uuid, partition_synopsis>& partitions() const;
+
   template <class Inspector>
   friend auto inspect(Inspector& f, interval& i) {
     return f(i.from, i.to);
@@ -46,7 +70,7 @@ public:
 
   template <class Inspector>
   friend auto inspect(Inspector& f, partition_synopsis& ps) {
-    return f(ps.range);
+    return f(ps.range, ps.events, ps.cold);
   }
 
   template <class Inspector>
@@ -64,8 +88,15 @@ struct active_partition_state {
   size_t events = 0;
 };
 
+struct loaded_partition_state {
+  caf::actor partition;
+  uint64_t bytes;
+  double priority;
+};
+
 struct scheduled_partition_state {
   uuid id;
+  uint64_t bytes;
   detail::flat_set<uuid> lookups;
 };
 
@@ -78,24 +109,54 @@ struct lookup_state {
 struct index_state {
   partition_index part_index;
   active_partition_state active;
-  std::unordered_map<uuid, caf::actor> loaded;
+  detail::flat_hash_map<uuid, loaded_partition_state> loaded;
   std::unordered_map<caf::actor, uuid> evicted;
   std::deque<scheduled_partition_state> scheduled;
-  std::unordered_map<uuid, lookup_state> lookups;
-  size_t capacity;
+  detail::flat_hash_map<uuid, lookup_state> lookups;
+  detail::flat_hash_map<uuid, uint64_t> sizes; // on disk, as last measured
+  std::unordered_set<uuid> measuring;
+  uint64_t budget;
+  uint64_t resident = 0;
+  uint64_t evicting = 0;
+  double clock = 0;
+  bool compacting = false;
+  bool tiering = false;
+  tiering_policy policy;
+  filesystem_type filesystem;
   path dir;
   char const* name = "index";
 };
 
 /// Indexes events in horizontal partitions.
+/// The INDEX keeps passive partitions in memory as long as their combined size
+/// stays within a memory budget. When it must make room for another
+/// partition, the INDEX evicts partitions according to the GreedyDual-Size
+/// policy, i.e., it prefers to evict partitions that are large and have not
+/// been accessed recently. While a lookup runs, the INDEX prefetches the
+/// partitions that the lookup will request next, provided that they fit into
+/// the remaining budget. The INDEX periodically flushes the active partition,
+/// which bounds the amount of indexed data lost in a crash. On the same
+/// occasion, it merges runs of adjacent small partitions in the background,
+/// e.g., those that restarts leave behind, and swaps the merged partition in
+/// once no lookup uses the original ones. A `compact_atom` triggers such a
+/// compaction explicitly and yields the number of merged partitions.
+/// Following a tiering policy, the INDEX periodically moves aging partitions
+/// to the cold tier and deletes expired ones. The partition index records the
+/// tier of each partition, so that lookups find it in either directory. A
+/// `tier_atom` applies the policy explicitly and yields the number of moved
+/// or deleted partitions.
 /// @param dir The directory of the index.
 /// @param max_events The maximum number of events per partition.
-/// @param max_parts The maximum number of partitions to hold in memory.
+/// @param max_bytes The memory budget in bytes for passive partitions.
 /// @param taste_parts The number of partitions to schedule immediately for
 ///                    each query
-/// @pre `max_events > 0 && max_parts > 0`
+/// @param flush_interval The time between two flushes of the active
+///                       partition, or zero to flush only on shutdown.
+/// @param policy The tiering policy.
+/// @pre `max_events > 0 && max_bytes > 0`
 caf::behavior index(caf::stateful_actor<index_state>* self, const path& dir,
-                    size_t max_events, size_t max_parts, size_t taste_parts);
+                    size_t max_events, uint64_t max_bytes, size_t taste_parts,
+                    timespan flush_interval, tiering_policy policy);
 
 } // namespace system
 } // namespace vast
@@ -2,9 +2,11 @@
 #define VAST_SYSTEM_INDEXER_HPP
 
 #include <unordered_map>
+#include <vector>
 
 #include <caf/stateful_actor.hpp>
 
+#include "vast/expected.hpp"
 #include "vast/filesystem.hpp"
 #include "vast/type.hpp"
 
@@ -25,6 +27,15 @@ struct event_indexer_state {
 caf::behavior event_indexer(caf::stateful_actor<event_indexer_state>* self,
                             path dir, type event_type);
 
+/// Merges the persistent state of several event indexers into a new one. The
+/// event indexers must cover disjoint sets of events.
+/// @param sources The directories of the event indexers to merge.
+/// @param dir The directory of the merged event indexer.
+/// @param event_type The type of the indexed events.
+/// @returns Nothing on success or an error upon failure.
+expected<void> merge_event_indexers(std::vector<path> const& sources,
+                                    path const& dir, type const& event_type);
+
 } // namespace system
 } // namespace vast
 
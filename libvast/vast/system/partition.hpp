@@ -1,28 +1,52 @@
 #ifndef VAST_SYSTEM_PARTITION_HPP
 #define VAST_SYSTEM_PARTITION_HPP
 
+#include <string>
 #include <unordered_map>
+#include <vector>
 
 #include <caf/stateful_actor.hpp>
 
 #include "vast/aliases.hpp"
+#include "vast/expected.hpp"
+#include "vast/expression.hpp"
 #include "vast/filesystem.hpp"
 #include "vast/type.hpp"
 
+#include "vast/detail/flat_hash_map.hpp"
+
 namespace vast {
 namespace system {
 
 struct partition_state {
-  std::unordered_map<type, caf::actor> indexers;
+  detail::flat_hash_map<type, caf::actor> indexers;
+  detail::flat_hash_map<type, std::string> dirs; // as in the meta data
+  std::unordered_map<predicate, std::vector<caf::actor>> lookups;
+  uint64_t distinct_lookups = 0;
+  uint64_t shared_lookups = 0;
+  size_t inflight = 0;
+  bool shutting_down = false;
   const char* name = "partition";
 };
 
 /// A horizontal partition of the INDEX.
 /// For each event batch, PARTITION spawns one event indexer per
-/// type occurring in the batch and forwards to them the events.
+/// type occurring in the batch and forwards to them the events. Concurrent
+/// queries share the lookups of identical predicates. Upon receiving a
+/// `flush_atom`, PARTITION persists the events indexed so far and responds
+/// with an `ok_atom`.
 /// @param dir The directory where to store this partition on the file system.
 caf::behavior partition(caf::stateful_actor<partition_state>* self, path dir);
 
+/// Merges persistent partitions over disjoint sets of events into a new
+/// partition. The merge operates on the file system only, i.e., no PARTITION
+/// may modify the partitions in the meantime.
+/// @param sources The directories of the partitions to merge.
+/// @param dir The directory of the merged partition.
+/// @returns Nothing on success or an error upon failure.
+expected<void> merge_partitions(const std::vector<path>& sources,
+                                const path& dir);
+
 } // namespace system
 } // namespace vast
 
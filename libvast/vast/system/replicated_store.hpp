@@ -2,10 +2,14 @@
 #define VAST_SYSTEM_REPLICATED_STORE_HPP
 
 #include <cstdint>
+#include <map>
+#include <utility>
 #include <vector>
 
 #include <caf/binary_deserializer.hpp>
 #include <caf/binary_serializer.hpp>
+#include <caf/blocking_actor.hpp>
+#include <caf/spawn_options.hpp>
 
 #include "vast/error.hpp"
 #include "vast/logger.hpp"
@@ -16,34 +20,42 @@
 #include "vast/system/timeouts.hpp"
 
 #include "vast/detail/assert.hpp"
+#include "vast/detail/cow_map.hpp"
 #include "vast/detail/operators.hpp"
 
 namespace vast {
 namespace system {
 
+/// The maximum number of key-value pairs in a snapshot part.
+constexpr size_t snapshot_part_entries = 1 << 14;
+
 template <class Key, class Value>
 struct replicated_store_state {
   // -- persistent state ----------------------
-  std::unordered_map<Key, Value> store;
+  vast::detail::cow_map<Key, Value> store;
   raft::index_type last_applied = 0;
   uint64_t last_snapshot_size = 0;
   // -- volatile state ------------------------
+  bool snapshot_inflight = false;
   uint64_t request_id = 0;
   std::unordered_map<uint64_t, caf::response_promise> requests;
+  // Operations awaiting submission to the consensus module, in the order of
+  // their request IDs.
+  std::vector<caf::message> pending;
+  bool flush_inflight = false;
+  // Reads awaiting the application of the log up to the read index that the
+  // consensus module returned for them.
+  std::multimap<raft::index_type, std::pair<Key, caf::response_promise>> reads;
   std::chrono::steady_clock::time_point last_stats_update;
   const char* name = "replicated-store";
 };
 
-template <class Inspector, class Key, class Value>
-auto inspect(Inspector& f, replicated_store_state<Key, Value>& state) {
-  return f(state.store, state.last_applied, state.last_snapshot_size);
-}
-
 template <class Key, class Value>
 using replicated_store_type =
   typename key_value_store_type<Key, Value>::template extend<
     caf::replies_to<snapshot_atom>::template with<ok_atom>,
-    caf::reacts_to<raft::index_type, caf::message>
+    caf::reacts_to<raft::index_type, caf::message>,
+    caf::reacts_to<flush_atom>
   >;
 
 // FIXME: Make it possible to deserialize caf::actor_addr. This semantically
@@ -111,66 +123,175 @@ auto apply(Actor* self, caf::message& operation) {
   });
 }
 
+// Applies an operation and answers the corresponding request if it
+// originated from this store.
+template <class Actor>
+void apply(Actor* self, const actor_identity& identity, uint64_t id,
+           caf::message& operation) {
+  if (identity != self->address()) {
+    VAST_DEBUG(self, "got remote operation", id);
+    apply(self, operation);
+  } else {
+    VAST_DEBUG(self, "got local operation", id);
+    auto i = self->state.requests.find(id);
+    if (i != self->state.requests.end()) {
+      i->second.deliver(apply(self, operation));
+      self->state.requests.erase(i);
+    }
+  }
+}
+
 // Applies a mutable operation coming from the consensus module.
+// @returns `false` iff *command* is a snapshot part that more parts follow.
 template <class Actor>
-void update(Actor* self, caf::message& command) {
+bool update(Actor* self, caf::message& command) {
+  auto complete = true;
   command.apply({
     [=](const actor_identity& identity, uint64_t id, caf::message operation) {
-      if (identity != self->address()) {
-        VAST_DEBUG(self, "got remote operation", id);
-        apply(self, operation);
-      } else {
-        VAST_DEBUG(self, "got local operation", id);
-        auto id = command.get_as<uint64_t>(1);
-        auto i = self->state.requests.find(id);
-        if (i != self->state.requests.end()) {
-          i->second.deliver(apply(self, operation));
-          self->state.requests.erase(i);
-        }
-      }
+      apply(self, identity, id, operation);
+    },
+    // A batch of operations with consecutive IDs, starting at *first*.
+    [=](const actor_identity& identity, uint64_t first,
+        std::vector<caf::message>& operations) {
+      for (auto i = 0u; i < operations.size(); ++i)
+        apply(self, identity, first + i, operations[i]);
     },
-    [=](snapshot_atom, raft::index_type, const std::vector<char>& data) {
-      VAST_DEBUG(self, "applies snapshot");
+    // A snapshot arrives in parts, each of which holds a sequence of
+    // key-value pairs. The first part replaces the entire state, and the
+    // state is complete only after the last part.
+    [&](snapshot_atom, raft::index_type, uint64_t part,
+        const std::vector<char>& data, bool last) {
+      using key_type = typename decltype(self->state.store)::key_type;
+      using value_type = typename decltype(self->state.store)::mapped_type;
+      VAST_DEBUG(self, "applies snapshot part", part);
+      if (part == 0) {
+        self->state.store.clear();
+        self->state.last_snapshot_size = 0;
+      }
+      std::vector<std::pair<key_type, value_type>> xs;
       caf::binary_deserializer bd{self->system(), data};
-      bd >> self->state;
-      self->state.last_snapshot_size = data.size();
-      return ok_atom::value;
+      bd >> xs;
+      for (auto& x : xs)
+        self->state.store[x.first] = std::move(x.second);
+      self->state.last_snapshot_size += data.size();
+      complete = last;
     }
   });
+  return complete;
 }
 
-// Replicates the current message through the consensus module.
+// Queues the current message for replication through the consensus module.
 template <class Actor>
-void replicate(Actor* self, const caf::actor& consensus,
-               caf::response_promise rp) {
+void replicate(Actor* self, caf::response_promise rp) {
   auto operation = self->current_mailbox_element()->move_content_to_message();
   auto id = ++self->state.request_id;
   self->state.requests.emplace(id, rp);
-  auto msg = make_message(actor_identity{self->address()}, id, operation);
+  self->state.pending.push_back(std::move(operation));
+  // Operations already in our mailbox make it into the same batch.
+  if (!self->state.flush_inflight) {
+    self->send(self, flush_atom::value);
+    self->state.flush_inflight = true;
+  }
+}
+
+// Submits all queued operations to the consensus module as a single command,
+// which the consensus module appends as a single log entry.
+template <class Actor>
+void flush(Actor* self, const caf::actor& consensus) {
+  self->state.flush_inflight = false;
+  auto n = self->state.pending.size();
+  if (n == 0)
+    return;
+  auto first = self->state.request_id - n + 1;
+  caf::message msg;
+  if (n == 1)
+    msg = make_message(actor_identity{self->address()}, first,
+                       std::move(self->state.pending.front()));
+  else
+    msg = make_message(actor_identity{self->address()}, first,
+                       std::move(self->state.pending));
+  self->state.pending.clear();
   self->request(consensus, consensus_timeout, replicate_atom::value, msg).then(
     [=](ok_atom) {
-      VAST_DEBUG(self, "submitted operation", id);
+      VAST_DEBUG(self, "submitted operations", first, "to", first + n - 1);
     },
-    [=](error& e) mutable {
-      rp.deliver(std::move(e));
-      self->state.requests.erase(id);
+    [=](error& e) {
+      for (auto id = first; id < first + n; ++id) {
+        auto i = self->state.requests.find(id);
+        if (i != self->state.requests.end()) {
+          i->second.deliver(e);
+          self->state.requests.erase(i);
+        }
+      }
+    }
+  );
+}
+
+// Serializes a view of the store and hands it over to the consensus module in
+// parts, awaiting the acknowledgement of each part before sending the next.
+// Runs in its own thread, so that the store keeps serving requests meanwhile.
+// Responds to a `run_atom` with the total size of all parts.
+template <class Key, class Value>
+void snapshot_worker(
+  caf::blocking_actor* self, caf::actor consensus, raft::index_type index,
+  typename vast::detail::cow_map<Key, Value>::view_type view) {
+  self->receive(
+    [&](run_atom) -> caf::result<uint64_t> {
+      auto part = uint64_t{0};
+      auto bytes = uint64_t{0};
+      caf::error err;
+      std::vector<std::pair<Key, Value>> xs;
+      auto submit = [&](bool done) {
+        std::vector<char> data;
+        caf::binary_serializer bs{self->system(), data};
+        bs << xs;
+        xs.clear();
+        bytes += data.size();
+        self->request(consensus, consensus_timeout, snapshot_atom::value,
+                      index, part++, std::move(data), done).receive(
+          [](raft::index_type) { /* nop */ },
+          [&](caf::error& e) { err = std::move(e); }
+        );
+        return !err;
+      };
+      for (auto& shard : view)
+        for (auto& x : *shard) {
+          xs.emplace_back(x.first, x.second);
+          if (xs.size() == snapshot_part_entries && !submit(false))
+            return err;
+        }
+      if (!submit(true))
+        return err;
+      return bytes;
     }
   );
 }
 
+// Answers all reads whose read index the store has applied.
+template <class Actor>
+void serve_reads(Actor* self) {
+  using value_type = typename decltype(self->state.store)::mapped_type;
+  auto& reads = self->state.reads;
+  auto last = reads.upper_bound(self->state.last_applied);
+  for (auto i = reads.begin(); i != last; ++i) {
+    auto& key = i->second.first;
+    auto& rp = i->second.second;
+    if (auto x = self->state.store.find(key))
+      rp.deliver(optional<value_type>{*x});
+    else
+      rp.deliver(optional<value_type>{});
+  }
+  reads.erase(reads.begin(), last);
+}
+
 } // namespace detail
 
-/// A replicated key-value store that sits on top of a consensus module.
+/// A replicated key-value store that sits on top of a consensus module. The
+/// store submits all mutable operations that arrive in a burst as a single
+/// command to the consensus module. Reads are linearizable without going
+/// through the log (see ::raft::consensus).
 /// @param self The actor handle.
 /// @param consensus The consensus module.
-// FIXME: The implementation currently does *not* guarantee linearizability.
-// Consider the case when the store crashes it has successfully submitted a log
-// entry to the consensus module but before returning to the client. The client
-// will then get an error and may try again, resulting in the same command
-// being applied twice.
-// The fix involves filtering out duplicate commands by associating unique
-// sequence numbers with client commands, turning at-least-once into
-// exactly-once semantics.
 template <class Key, class Value>
 typename replicated_store_type<Key, Value>::behavior_type
 replicated_store(
@@ -181,22 +302,16 @@ replicated_store(
   using namespace caf;
   self->monitor(consensus);
   self->anon_send(consensus, subscribe_atom::value, actor_cast<actor>(self));
-  // Takes a snapshot at the currently applied index.
-  auto make_snapshot = [=] {
-    VAST_ASSERT(self->state.last_applied > 0);
-    std::vector<char> state;
-    binary_serializer bs{self->system(), state};
-    bs << self->state;
-    VAST_DEBUG(self, "serialized", state.size(), "bytes");
-    return state;
-  };
   self->set_down_handler(
     [=](const down_msg& msg) {
       VAST_ASSERT(msg.source == consensus);
       VAST_DEBUG(self, "got DOWN from consensus module");
       // Abort outstdanding requests.
+      auto e = make_error(ec::unspecified, "consensus module down");
       for (auto& rp : self->state.requests)
-        rp.second.deliver(make_error(ec::unspecified, "consensus module down"));
+        rp.second.deliver(e);
+      for (auto& x : self->state.reads)
+        x.second.second.deliver(e);
       self->quit(msg.reason);
     }
   );
@@ -205,6 +320,8 @@ replicated_store(
       // Abort outstdanding requests.
       for (auto& rp : self->state.requests)
         rp.second.deliver(msg.reason);
+      for (auto& x : self->state.reads)
+        x.second.second.deliver(msg.reason);
       self->quit(msg.reason);
     }
   );
@@ -213,35 +330,49 @@ replicated_store(
     [=](put_atom, const Key&, const Value&) {
       VAST_DEBUG(self, "replicates PUT");
       auto rp = self->template make_response_promise<ok_atom>();
-      detail::replicate(self, consensus, rp);
+      detail::replicate(self, rp);
       return rp;
     },
     [=](add_atom, const Key&, const Value&) {
       VAST_DEBUG(self, "replicates ADD");
       auto rp = self->template make_response_promise<Value>();
-      detail::replicate(self, consensus, rp);
+      detail::replicate(self, rp);
       return rp;
     },
     [=](delete_atom, const Key&) {
       VAST_DEBUG(self, "replicates DELETE");
       auto rp = self->template make_response_promise<ok_atom>();
-      detail::replicate(self, consensus, rp);
+      detail::replicate(self, rp);
       return rp;
     },
-    // Sequential consistency: all reads may be stale since we're not going
-    // through the consensus module. (For linearizability, we would have to go
-    // through the leader.)
-    [=](get_atom, const Key& key) -> result<optional<Value>> {
-      auto i = self->state.store.find(key);
-      if (i == self->state.store.end())
-        return nil;
-      return i->second;
+    // Linearizability: reads obtain a read index from the leader without
+    // appending to the log, and we answer them once we have applied the log
+    // up to that index.
+    [=](get_atom, const Key& key) {
+      auto rp = self->template make_response_promise<optional<Value>>();
+      self->request(consensus, consensus_timeout, read_atom::value).then(
+        [=](raft::index_type index) mutable {
+          VAST_DEBUG(self, "got read index", index);
+          caf::response_promise promise = rp;
+          self->state.reads.emplace(index, std::make_pair(key, promise));
+          detail::serve_reads(self);
+        },
+        [=](error& e) mutable {
+          rp.deliver(std::move(e));
+        }
+      );
+      return rp;
     },
     [=](raft::index_type index, message& operation) {
       using namespace std::chrono_literals;
       VAST_DEBUG(self, "applies entry", index, "(consensus update)");
-      detail::update(self, operation);
+      // The consensus module sends the next snapshot part only after we
+      // have applied this one. Until the last part, we neither have applied
+      // the snapshot index nor can we answer reads.
+      if (!detail::update(self, operation))
+        return;
       self->state.last_applied = index;
+      detail::serve_reads(self);
       auto now = std::chrono::steady_clock::now();
       if (now - self->state.last_stats_update < 10s)
         return;
@@ -256,20 +387,33 @@ replicated_store(
         }
       );
     },
+    [=](flush_atom) {
+      detail::flush(self, consensus);
+    },
+    // Takes a snapshot at the currently applied index. A worker serializes
+    // a copy-on-write view of the store in the background.
     [=](snapshot_atom) {
-      VAST_DEBUG(self, "takes snapshot at index", self->state.last_applied);
       auto rp = self->template make_response_promise<ok_atom>();
-      auto snapshot = make_snapshot();
-      auto snapshot_size = snapshot.size();
-      self->request(consensus, consensus_timeout, snapshot_atom::value,
-                    self->state.last_applied, std::move(snapshot)).then(
-        [=](raft::index_type) mutable {
+      if (self->state.snapshot_inflight) {
+        rp.deliver(make_error(ec::unspecified, "snapshot in progress"));
+        return rp;
+      }
+      VAST_ASSERT(self->state.last_applied > 0);
+      VAST_DEBUG(self, "takes snapshot at index", self->state.last_applied);
+      self->state.snapshot_inflight = true;
+      auto worker = self->template spawn<detached>(
+        detail::snapshot_worker<Key, Value>, consensus,
+        self->state.last_applied, self->state.store.view());
+      self->request(worker, infinite, run_atom::value).then(
+        [=](uint64_t snapshot_size) mutable {
           VAST_DEBUG(self, "successfully snapshotted state");
+          self->state.snapshot_inflight = false;
           self->state.last_snapshot_size = snapshot_size;
           rp.deliver(ok_atom::value);
         },
         [=](error& e) mutable {
           VAST_ERROR(self, "failed to snapshot:", self->system().render(e));
+          self->state.snapshot_inflight = false;
           rp.deliver(std::move(e));
         }
       );
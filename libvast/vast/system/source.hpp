@@ -10,10 +10,12 @@
 #include "vast/concept/printable/std/chrono.hpp"
 #include "vast/concept/printable/vast/error.hpp"
 #include "vast/detail/assert.hpp"
+#include "vast/detail/monotonic_arena.hpp"
 #include "vast/error.hpp"
 #include "vast/event.hpp"
 #include "vast/expected.hpp"
 #include "vast/schema.hpp"
+#include "vast/time.hpp"
 
 #include "vast/system/accountant.hpp"
 #include "vast/system/atoms.hpp"
@@ -36,6 +38,23 @@ struct Reader {
 };
 #endif
 
+/// Checks whether a reader can produce packed records through
+/// `read(detail::monotonic_arena&, timestamp&)`.
+template <class Reader>
+class has_packed_read {
+  template <class R>
+  static auto test(R* r)
+  -> decltype(r->read(std::declval<vast::detail::monotonic_arena&>(),
+                      std::declval<timestamp&>()),
+              std::true_type());
+
+  template <class>
+  static auto test(...) -> std::false_type;
+
+public:
+  static constexpr bool value = decltype(test<Reader>(nullptr))::value;
+};
+
 /// The source state.
 /// @tparam Reader The reader type, which must model the *Reader* concept.
 template <class Reader>
@@ -43,6 +62,7 @@ struct source_state {
   static constexpr size_t max_batch_size = 1 << 20;
   uint64_t batch_size = 65536;
   std::vector<event> events;
+  vast::detail::monotonic_arena arena;
   std::chrono::steady_clock::time_point start;
   accountant_type accountant;
   caf::actor sink;
@@ -50,6 +70,28 @@ struct source_state {
   char const* name;
 };
 
+// Reads the next event the regular way.
+template <class Reader>
+expected<event> next_event(source_state<Reader>& st, std::false_type) {
+  return st.reader.read();
+}
+
+// Reads the next event through the packed representation, which parses a line
+// straight into a flat record instead of a tree of ::data. Events still cross
+// actor boundaries as ::data, so we materialize them right away and recycle
+// the memory of the record for the next one.
+template <class Reader>
+expected<event> next_event(source_state<Reader>& st, std::true_type) {
+  timestamp ts;
+  auto x = st.reader.read(st.arena, ts);
+  if (!x)
+    return x.error();
+  event e{{x->to_data(), x->layout().type()}};
+  e.timestamp(ts);
+  st.arena.reset();
+  return e;
+}
+
 /// An event producer.
 /// @tparam Reader The concrete source implementation.
 /// @param self The actor handle.
@@ -87,7 +129,10 @@ source(caf::stateful_actor<source_state<Reader>>* self, Reader&& reader) {
       auto start = steady_clock::now();
       auto done = false;
       while (self->state.events.size() < self->state.batch_size) {
-        auto e = self->state.reader.read();
+        auto e = next_event(self->state,
+                            std::integral_constant<
+                              bool, has_packed_read<Reader>::value
+                            >{});
         if (e) {
           self->state.events.push_back(std::move(*e));
         } else if (!e.error()) {
@@ -0,0 +1,60 @@
+#ifndef VAST_SYSTEM_TIERING_HPP
+#define VAST_SYSTEM_TIERING_HPP
+
+#include <chrono>
+#include <cstdint>
+
+#include "vast/compression.hpp"
+#include "vast/filesystem.hpp"
+#include "vast/time.hpp"
+
+namespace vast {
+namespace system {
+
+/// Governs where the ARCHIVE and the INDEX keep data as it ages, and when
+/// they delete it. The age of a segment or partition is the time since its
+/// most recent event.
+struct tiering_policy {
+  /// The directory of the cold tier, typically on cheaper storage. Data
+  /// older than *cold_after* moves there. An empty path disables migration.
+  path cold_dir;
+
+  /// The age at which data moves to the cold tier, or zero to keep data in
+  /// the primary directory.
+  timespan cold_after = timespan::zero();
+
+  /// Whether to recompress segments with *cold_codec* upon migration.
+  bool recompress = false;
+
+  /// The codec for segments in the cold tier.
+  codec cold_codec;
+
+  /// The age at which data gets deleted, or zero to keep data forever.
+  timespan max_age = timespan::zero();
+
+  /// The maximum number of bytes across both tiers, or zero for no limit.
+  /// Beyond the limit, the oldest data gets deleted first.
+  uint64_t max_bytes = 0;
+
+  /// The time between two applications of the policy.
+  timespan interval = std::chrono::minutes(1);
+
+  /// Checks whether the policy calls for any action at all.
+  bool enabled() const {
+    return (!cold_dir.empty() && cold_after > timespan::zero())
+           || max_age > timespan::zero() || max_bytes > 0;
+  }
+};
+
+/// Checks whether a piece of data has exceeded a given age.
+/// @param last The timestamp of the most recent event in the data.
+/// @param age The age to check, where zero means infinity.
+/// @param now The current time.
+inline bool older_than(timestamp last, timespan age, timestamp now) {
+  return age > timespan::zero() && last < now - age;
+}
+
+} // namespace system
+} // namespace vast
+
+#endif
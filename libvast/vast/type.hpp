@@ -9,6 +9,7 @@
 #include <caf/intrusive_ptr.hpp>
 #include <caf/ref_counted.hpp>
 #include <caf/detail/type_list.hpp>
+#include <caf/meta/load_callback.hpp>
 
 #include "vast/aliases.hpp"
 #include "vast/attribute.hpp"
@@ -57,6 +58,21 @@ struct table_type;
 struct record_type;
 struct alias_type;
 
+class type;
+
+/// Returns the canonical instance of a type. All interned types with the same
+/// structure share a single representation with a precomputed digest, which
+/// makes hashing them a load and comparing them a pointer comparison. The
+/// canonical instances live until the end of the program and never change:
+/// all mutable access to an interned type, e.g., through `name`,
+/// `attributes`, or a non-const `get`, detaches it from the canonical
+/// instance first. Each thread caches the canonical instances it has seen,
+/// so that only the first occurrence of a type per thread takes the global
+/// lock of the interner.
+/// @param t The type to intern.
+/// @returns The canonical instance of *t*.
+type intern(type const& t);
+
 /// An abstract type for ::data.
 class type : detail::totally_ordered<type> {
   friend schema; // pointer tracking
@@ -113,6 +129,11 @@ public:
   std::vector<attribute> const& attributes() const;
   type& attributes(std::initializer_list<attribute> list);
 
+  /// Computes a 64-bit digest over the structure of the type. Interned types
+  /// have their digest precomputed.
+  /// @returns The digest of the type.
+  uint64_t digest() const;
+
   /// Checks whether the hash digest of two types is equal.
   friend bool operator==(const type& x, const type& y);
 
@@ -120,18 +141,33 @@ public:
   /// another.
   friend bool operator<(const type& x, const type& y);
 
+  friend type intern(type const& t);
+
   template <class Inspector>
   friend auto inspect(Inspector& f, type& t) {
-    return f(*t.ptr_);
+    // Deserialization must not modify a canonical instance, and yields a
+    // canonical instance in turn.
+    if (Inspector::writes_state)
+      t = type{};
+    auto canonicalize = [&]() -> caf::error {
+      t = intern(t);
+      return {};
+    };
+    return f(*t.ptr_, caf::meta::load_callback(canonicalize));
   }
 
   friend auto& expose(type& t);
 
+  friend auto& expose(type const& t);
+
   friend bool convert(type const& t, json& j);
 
 private:
   struct impl;
 
+  // Gives an interned type its own copy of the representation.
+  void detach();
+
   template <class Inspector>
   friend auto inspect(Inspector&, impl&);
 
@@ -553,6 +589,8 @@ struct type::impl : caf::ref_counted {
   }
 
   type_variant types;
+  uint64_t digest = 0; // valid if interned
+  bool interned = false;
 
   template <class Inspector>
   friend auto inspect(Inspector& f, impl& i) {
@@ -561,6 +599,13 @@ struct type::impl : caf::ref_counted {
 };
 
 inline auto& expose(type& t) {
+  t.detach();
+  return t.ptr_->types;
+}
+
+// Read-only access must not detach, but the variant concept requires a
+// mutable variant.
+inline auto& expose(type const& t) {
   return t.ptr_->types;
 }
 
@@ -575,7 +620,7 @@ namespace std {
 template <>
 struct hash<vast::type> {
   size_t operator()(vast::type const& t) const {
-    return vast::uhash<vast::type::hasher>{}(t);
+    return t.digest();
   }
 };
 
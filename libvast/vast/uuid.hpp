@@ -2,7 +2,11 @@
 #define VAST_UUID_HPP
 
 #include <array>
+#include <type_traits>
 
+#include "vast/concept/hashable/hash_append.hpp"
+#include "vast/concept/hashable/uhash.hpp"
+#include "vast/concept/hashable/xxh3.hpp"
 #include "vast/detail/operators.hpp"
 
 namespace vast {
@@ -49,19 +53,22 @@ private:
   std::array<value_type, 16> id_;
 };
 
+namespace detail {
+
+// A UUID consists of its 16 bytes only, so we can hash it in one go.
+template <>
+struct is_uniquely_represented<uuid>
+  : std::integral_constant<bool, sizeof(uuid) == 16> {};
+
+} // namespace detail
 } // namespace vast
 
-// TODO: express in terms of hashable concept. This means simply hashing the
-// bytes of the entire std::array.
 namespace std {
 
 template <>
 struct hash<vast::uuid> {
   size_t operator()(vast::uuid const& u) const {
-    size_t x = 0;
-    for (auto& byte : u)
-      x ^= static_cast<size_t>(byte) + 0x9e3779b9 + (x << 6) + (x >> 2);
-    return x;
+    return vast::uhash<vast::xxh3_64>{}(u);
   }
 };
 
@@ -50,32 +50,74 @@ public:
   /// @returns The result of the lookup or an error upon failure.
   expected<bitmap> lookup(relational_operator op, data const& x) const;
 
-  /// Merges another value index with this one.
-  /// @param other The value index to merge.
-  /// @returns `true` on success.
-  //bool merge(value_index const& other);
+  /// Estimates the number of hits of a lookup without performing it. The
+  /// estimate derives from per-bucket value counts and therefore represents
+  /// an upper bound for equality lookups and a heuristic otherwise.
+  /// @param op The relation operator.
+  /// @param x The value to lookup.
+  /// @returns The estimated number of hits for *x* under *op*.
+  size_type estimate(relational_operator op, data const& x) const;
+
+  /// Appends the rows of another value index to this one.
+  /// @param other The value index to append, which must have the same type
+  ///              as this one.
+  /// @param skip The number of rows to skip before appending *other*.
+  /// @returns Nothing on success or an error if the indexes differ in type.
+  /// @post Skipped rows show up as neither nil nor non-nil values.
+  expected<void> append(value_index const& other, size_type skip = 0);
+
+  /// Merges another value index with this one. Unlike ::append, merging
+  /// combines indexes that cover disjoint sets of rows in the same ID space,
+  /// e.g., the indexes of two partitions.
+  /// @param other The value index to merge, which must have the same type as
+  ///              this one.
+  /// @returns Nothing on success or an error if the indexes differ in type or
+  ///          have a row in common.
+  expected<void> merge(value_index const& other);
 
   /// Retrieves the ID of the last ::push_back operation.
   /// @returns The largest ID in the index.
   size_type offset() const;
 
+  /// Retrieves the number of non-nil values in the index.
+  size_type cardinality() const;
+
+  // Index files carry a format version (see indexer.cpp), which must change
+  // along with the layout here.
   template <class Inspector>
   friend auto inspect(Inspector& f, value_index& vi) {
-    return f(vi.mask_, vi.none_);
+    return f(vi.mask_, vi.none_, vi.buckets_, vi.nils_);
   }
 
 protected:
   value_index() = default;
 
+  /// Retrieves the rows of the concrete index that hold a non-nil value. All
+  /// other rows of the concrete index consist of padding.
+  /// @returns A bitmap with one bit per row of the concrete index.
+  ewah_bitmap rows() const;
+
 private:
+  expected<void> try_push_back(data const& x, size_type skip);
+
   virtual bool push_back_impl(data const& x, size_type skip) = 0;
 
+  virtual bool append_impl(value_index const& other, size_type skip) = 0;
+
+  virtual bool merge_impl(value_index const& other) = 0;
+
   virtual expected<bitmap>
   lookup_impl(relational_operator op, data const& x) const = 0;
 
+  /// The number of buckets for the value frequency statistics.
+  static constexpr size_t num_buckets = 256;
+
+  void update_statistics(data const& x);
+
   size_type nils_ = 0;
   ewah_bitmap mask_;
   ewah_bitmap none_;
+  std::vector<size_type> buckets_;
 };
 
 /// An index for arithmetic values.
@@ -204,6 +246,32 @@ private:
     return visit(appender{bmi_, skip}, x);
   }
 
+  bool append_impl(value_index const& other, size_type skip) override {
+    auto x = dynamic_cast<arithmetic_index const*>(&other);
+    if (!x)
+      return false;
+    bmi_.append(x->bmi_, skip);
+    return true;
+  }
+
+  bool merge_impl(value_index const& other) override {
+    auto x = dynamic_cast<arithmetic_index const*>(&other);
+    if (!x)
+      return false;
+    merge(*x, is_singleton_coder<coder_type>{});
+    return true;
+  }
+
+  // Unlike the other coders, a singleton coder has no bitmap to tell values
+  // apart from padding, so we can only merge the rows that hold a value.
+  void merge(arithmetic_index const& other, std::true_type) {
+    bmi_.merge(other.bmi_, other.rows());
+  }
+
+  void merge(arithmetic_index const& other, std::false_type) {
+    bmi_.merge(other.bmi_);
+  }
+
   expected<bitmap>
   lookup_impl(relational_operator op, data const& x) const override {
     return visit(searcher{bmi_, op}, x);
@@ -237,6 +305,10 @@ private:
 
   bool push_back_impl(data const& x, size_type skip) override;
 
+  bool append_impl(value_index const& other, size_type skip) override;
+
+  bool merge_impl(value_index const& other) override;
+
   expected<bitmap>
   lookup_impl(relational_operator op, data const& x) const override;
 
@@ -263,6 +335,10 @@ private:
 
   bool push_back_impl(data const& x, size_type skip) override;
 
+  bool append_impl(value_index const& other, size_type skip) override;
+
+  bool merge_impl(value_index const& other) override;
+
   expected<bitmap>
   lookup_impl(relational_operator op, data const& x) const override;
 
@@ -287,6 +363,10 @@ private:
 
   bool push_back_impl(data const& x, size_type skip) override;
 
+  bool append_impl(value_index const& other, size_type skip) override;
+
+  bool merge_impl(value_index const& other) override;
+
   expected<bitmap>
   lookup_impl(relational_operator op, data const& x) const override;
 
@@ -321,6 +401,10 @@ private:
 
   bool push_back_impl(data const& x, size_type skip) override;
 
+  bool append_impl(value_index const& other, size_type skip) override;
+
+  bool merge_impl(value_index const& other) override;
+
   expected<bitmap>
   lookup_impl(relational_operator op, data const& x) const override;
 
@@ -371,6 +455,10 @@ private:
 
   bool push_back_impl(data const& x, size_type skip) override;
 
+  bool append_impl(value_index const& other, size_type skip) override;
+
+  bool merge_impl(value_index const& other) override;
+
   expected<bitmap>
   lookup_impl(relational_operator op, data const& x) const override;
 